@@ -0,0 +1,126 @@
+/*!
+ * \file perf_aggregate_kernels.cc
+ */
+#include <random>
+#include <vector>
+
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+#include "stdb/storage/operators/kernels.h"
+#include "stdb/storage/operators/operator.h"
+
+using namespace stdb;
+using namespace stdb::storage;
+
+#define LEAF_SIZE 1024
+#define NITERS 100000
+
+common::Timer timer;
+
+void perf_aggregate(const char* name, aggregate_kernel_t kernel, std::vector<double> const& xs) {
+  double sink = 0;
+  timer.restart();
+  for (int i = 0; i < NITERS; i++) {
+    KernelAggregate agg;
+    kernel(xs.data(), xs.size(), &agg);
+    sink += agg.sum + agg.argmin + agg.argmax;
+  }
+  double elapsed = timer.elapsed();
+  LOG(INFO) << name << ": " << NITERS * xs.size() / elapsed / 1e6 << "(M values/s), checksum " << sink;
+}
+
+void perf_do_the_math(std::vector<Timestamp>& ts, std::vector<double>& xs) {
+  double sink = 0;
+  timer.restart();
+  for (int i = 0; i < NITERS; i++) {
+    AggregationResult res = INIT_AGGRES;
+    res.do_the_math(ts.data(), xs.data(), xs.size(), false);
+    sink += res.sum;
+  }
+  double elapsed = timer.elapsed();
+  LOG(INFO) << "do_the_math: " << NITERS * xs.size() / elapsed / 1e6 << "(M values/s), checksum " << sink;
+}
+
+void perf_filter(const char* name, filter_kernel_t kernel, std::vector<Timestamp> const& ts, std::vector<double> const& xs) {
+  ValueFilter filter;
+  filter.greater_than(110);
+  std::vector<Timestamp> outts(ts.size());
+  std::vector<double> outxs(xs.size());
+  size_t sink = 0;
+  timer.restart();
+  for (int i = 0; i < NITERS; i++) {
+    sink += kernel(filter, ts.data(), xs.data(), ts.size(), outts.data(), outxs.data());
+  }
+  double elapsed = timer.elapsed();
+  LOG(INFO) << name << ": " << NITERS * ts.size() / elapsed / 1e6 << "(M values/s), "
+            << sink / NITERS << " values selected";
+
+  // Per-value ValueFilter::match loop
+  sink = 0;
+  timer.restart();
+  for (int i = 0; i < NITERS; i++) {
+    size_t n = 0;
+    for (size_t j = 0; j < ts.size(); j++) {
+      if (filter.match(xs[j])) {
+        outts[n] = ts[j];
+        outxs[n] = xs[j];
+        n++;
+      }
+    }
+    sink += n;
+  }
+  elapsed = timer.elapsed();
+  LOG(INFO) << "match loop: " << NITERS * ts.size() / elapsed / 1e6 << "(M values/s), "
+            << sink / NITERS << " values selected";
+}
+
+void perf_split(std::vector<Timestamp> const& ts, u64 step) {
+  std::vector<u32> bounds(ts.size());
+  size_t sink = 0;
+  timer.restart();
+  for (int i = 0; i < NITERS; i++) {
+    sink += split_buckets(ts.data(), ts.size(), 0, step, true, bounds.data());
+  }
+  double elapsed = timer.elapsed();
+  LOG(INFO) << "split_buckets, step " << step << ": " << NITERS * ts.size() / elapsed / 1e6
+            << "(M values/s), " << sink / NITERS << " buckets";
+
+  // Per-sample division, the way group aggregator used to find the boundaries
+  sink = 0;
+  timer.restart();
+  for (int i = 0; i < NITERS; i++) {
+    u64 bucket = ts.front() / step;
+    for (size_t j = 0; j < ts.size(); j++) {
+      u64 next = ts[j] / step;
+      if (next != bucket) {
+        bounds[sink % ts.size()] = static_cast<u32>(j);
+        bucket = next;
+        sink++;
+      }
+    }
+    sink++;
+  }
+  elapsed = timer.elapsed();
+  LOG(INFO) << "division loop, step " << step << ": " << NITERS * ts.size() / elapsed / 1e6
+            << "(M values/s), " << sink / NITERS << " buckets";
+}
+
+int main(int argc, char** argv) {
+  std::mt19937 gen(1);
+  std::normal_distribution<double> dist(100, 10);
+  std::vector<double> xs(LEAF_SIZE);
+  std::vector<Timestamp> ts(LEAF_SIZE);
+  for (size_t i = 0; i < LEAF_SIZE; i++) {
+    xs[i] = dist(gen);
+    ts[i] = 1000 * (i + 1);
+  }
+  perf_aggregate("scalar kernel", chose_aggregate_kernel(KernelHint::FORCE_SCALAR), xs);
+  perf_aggregate("AVX2 kernel", chose_aggregate_kernel(KernelHint::FORCE_AVX2), xs);
+  perf_do_the_math(ts, xs);
+  perf_filter("scalar filter", chose_filter_kernel(KernelHint::FORCE_SCALAR), ts, xs);
+  perf_filter("AVX2 filter", chose_filter_kernel(KernelHint::FORCE_AVX2), ts, xs);
+  for (u64 step: { 10000ul, 100000ul, 1000000ul }) {
+    perf_split(ts, step);
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*!
+ * \file perf_crc32c.cc
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/common/crc32c.h"
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+
+using namespace stdb;
+
+#define BLOCK_SIZE 4096
+#define NUM_BLOCKS 64
+#define NUM_COMPONENTS 4
+#define NUM_ITERATIONS 4000
+
+//! Block payload (block size minus SubtreeRef header)
+#define PAYLOAD_SIZE 3960
+
+std::vector<u8> data;
+common::Timer timer;
+
+template<class Fn>
+void run(const char* name, Fn const& fn) {
+  u32 sum = 0;
+  timer.restart();
+  for (int i = 0; i < NUM_ITERATIONS; i++) {
+    sum += fn();
+  }
+  auto elapsed = timer.elapsed();
+  double nbytes = static_cast<double>(NUM_ITERATIONS) * NUM_BLOCKS * PAYLOAD_SIZE;
+  LOG(INFO) << name << ": " << static_cast<u64>(nbytes / elapsed / 1024 / 1024) << " MB/sec"
+      << " (checksum " << sum << ")";
+}
+
+//! Checksum every block one by one (read path)
+u32 single(common::crc32c_impl_t impl) {
+  u32 sum = 0;
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    sum += impl(0, data.data() + i * BLOCK_SIZE, PAYLOAD_SIZE);
+  }
+  return sum;
+}
+
+//! Checksum all blocks using the batch API
+u32 batch(common::crc32c_batch_impl_t impl) {
+  static std::vector<const void*> bufs;
+  static std::vector<size_t> lens;
+  static std::vector<u32> out(NUM_BLOCKS);
+  if (bufs.empty()) {
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+      bufs.push_back(data.data() + i * BLOCK_SIZE);
+      lens.push_back(PAYLOAD_SIZE);
+    }
+  }
+  impl(bufs.data(), lens.data(), out.data(), NUM_BLOCKS);
+  u32 sum = 0;
+  for (auto crc: out) {
+    sum += crc;
+  }
+  return sum;
+}
+
+//! Checksum every block split into components one by one (write path)
+u32 iovec_chained(common::crc32c_impl_t impl) {
+  const size_t component = BLOCK_SIZE / NUM_COMPONENTS;
+  u32 sum = 0;
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    const u8* begin = data.data() + i * BLOCK_SIZE;
+    u32 crc = 0;
+    size_t size = PAYLOAD_SIZE;
+    for (int j = 0; j < NUM_COMPONENTS; j++) {
+      size_t sz = std::min(size, component);
+      crc = impl(crc, begin + j * component, sz);
+      size -= sz;
+    }
+    sum += crc;
+  }
+  return sum;
+}
+
+//! Checksum full components in lockstep, combine the results and append the rest (write path)
+u32 iovec_combined(common::crc32c_batch_impl_t batch, common::crc32c_impl_t impl) {
+  const size_t component = BLOCK_SIZE / NUM_COMPONENTS;
+  static const u32 op = common::crc32c_combine_gen(component);
+  u32 sum = 0;
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    const u8* begin = data.data() + i * BLOCK_SIZE;
+    const void* bufs[NUM_COMPONENTS];
+    size_t lens[NUM_COMPONENTS];
+    u32 crcs[NUM_COMPONENTS];
+    size_t size = PAYLOAD_SIZE;
+    int nfull = 0;
+    while (size >= component) {
+      bufs[nfull] = begin + nfull * component;
+      lens[nfull] = component;
+      size -= component;
+      nfull++;
+    }
+    batch(bufs, lens, crcs, nfull);
+    u32 crc = crcs[0];
+    for (int j = 1; j < nfull; j++) {
+      crc = common::crc32c_combine_op(crc, crcs[j], op);
+    }
+    crc = impl(crc, begin + nfull * component, size);
+    sum += crc;
+  }
+  return sum;
+}
+
+int main(int argc, char** argv) {
+  data.resize(BLOCK_SIZE * NUM_BLOCKS);
+  std::generate(data.begin(), data.end(), []() { return static_cast<u8>(rand()); });
+
+  auto sw = common::chose_crc32c_implementation(common::CRC32C_hint::FORCE_SW);
+  auto hw = common::chose_crc32c_implementation(common::CRC32C_hint::FORCE_HW);
+  auto clmul = common::chose_crc32c_implementation(common::CRC32C_hint::FORCE_HW_CLMUL);
+  auto bsw = common::chose_crc32c_batch_implementation(common::CRC32C_hint::FORCE_SW);
+  auto bhw = common::chose_crc32c_batch_implementation(common::CRC32C_hint::FORCE_HW);
+  auto bclmul = common::chose_crc32c_batch_implementation(common::CRC32C_hint::FORCE_HW_CLMUL);
+
+  run("software, block by block", [&]() { return single(sw); });
+  run("sse4.2, block by block", [&]() { return single(hw); });
+  run("sse4.2+pclmul, block by block", [&]() { return single(clmul); });
+  run("software, batch", [&]() { return batch(bsw); });
+  run("sse4.2, batch", [&]() { return batch(bhw); });
+  run("sse4.2+pclmul, batch", [&]() { return batch(bclmul); });
+  run("sse4.2, iovec components chained", [&]() { return iovec_chained(hw); });
+  run("sse4.2+pclmul, iovec components chained", [&]() { return iovec_chained(clmul); });
+  run("sse4.2, iovec components combined", [&]() { return iovec_combined(bhw, hw); });
+  run("sse4.2+pclmul, iovec components combined", [&]() { return iovec_combined(bclmul, clmul); });
+  return 0;
+}
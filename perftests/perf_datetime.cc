@@ -0,0 +1,66 @@
+/*!
+ * \file perf_datetime.cc
+ */
+#include <string>
+#include <vector>
+
+#include "stdb/common/datetime.h"
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+
+using namespace stdb;
+
+#define NUM_TIMESTAMPS 1000000
+
+std::vector<std::string> basic;
+std::vector<std::string> extended;
+std::vector<std::string> epoch;
+common::Timer timer;
+
+void init() {
+  Timestamp ts = 1136214245999999999ul;
+  for (u32 i = 0; i < NUM_TIMESTAMPS; i++) {
+    auto str = DateTimeUtil::to_iso_string(ts);
+    basic.push_back(str);
+    extended.push_back(str.substr(0, 4) + "-" + str.substr(4, 2) + "-" + str.substr(6, 2) + "T" +
+                       str.substr(9, 2) + ":" + str.substr(11, 2) + ":" + str.substr(13) + "Z");
+    epoch.push_back(std::to_string(ts / 1000000));
+    ts += 1000003331ul;
+  }
+}
+
+template<class Fn>
+void run(const char* name, std::vector<std::string> const& input, Fn const& fn) {
+  Timestamp sum = 0;
+  timer.restart();
+  for (auto const& str: input) {
+    sum += fn(str);
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << ": " << static_cast<u64>(input.size() / elapsed) << " timestamps/sec"
+      << " (checksum " << sum << ")";
+}
+
+int main(int argc, char** argv) {
+  init();
+  run("generic parser, basic format", basic, [](std::string const& str) {
+    return DateTimeUtil::parse_iso_string(str.c_str());
+  });
+  run("fast parser, basic format", basic, [](std::string const& str) {
+    Timestamp ts = 0;
+    DateTimeUtil::try_parse_iso_string(str.data(), str.size(), &ts);
+    return ts;
+  });
+  run("fast parser, extended format", extended, [](std::string const& str) {
+    Timestamp ts = 0;
+    DateTimeUtil::try_parse_iso_string(str.data(), str.size(), &ts);
+    return ts;
+  });
+  run("generic parser, epoch ms", epoch, [](std::string const& str) {
+    return DateTimeUtil::parse_iso_string(str.c_str());
+  });
+  run("fast parser, epoch ms", epoch, [](std::string const& str) {
+    return DateTimeUtil::from_epoch_string(str.data(), str.size(), EpochUnit::MILLISECONDS);
+  });
+  return 0;
+}
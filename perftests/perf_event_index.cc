@@ -0,0 +1,102 @@
+/*!
+ * \file perf_event_index.cc
+ */
+#include <random>
+
+#include "stdb/common/timer.h"
+#include "stdb/storage/column_store.h"
+
+using namespace stdb;
+using namespace stdb::storage;
+
+#define NEVENTS 1000000
+#define NQUERIES 3
+
+common::Timer timer;
+
+//! Log-like events, "timeout" is rare, "error" is frequent
+void write_log(CStoreSession* session, ParamId id) {
+  const char* levels[] = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR" };
+  const char* components[] = { "http", "db", "cache", "scheduler", "auth" };
+  std::mt19937 gen(1);
+  std::vector<char> buf(sizeof(Sample) + STDB_LIMITS_MAX_EVENT_LEN);
+  Sample* sample = reinterpret_cast<Sample*>(buf.data());
+  std::vector<LogicAddr> rpoints;
+  for (u32 i = 0; i < NEVENTS; i++) {
+    std::string body = levels[gen() % 6];
+    body += " [";
+    body += components[gen() % 5];
+    body += "] request_id=" + std::to_string(gen()) + " latency=" + std::to_string(gen() % 1000) + "ms";
+    if (gen() % 100000 == 0) {
+      body += " connection timeout, retrying";
+    }
+    sample->paramid = id;
+    sample->timestamp = 1000ul * (i + 1);
+    sample->payload.type = PAYLOAD_EVENT;
+    sample->payload.size = static_cast<u16>(sizeof(Sample) + body.size());
+    memcpy(sample->payload.data, body.data(), body.size());
+    session->write(*sample, &rpoints);
+  }
+}
+
+size_t count(std::vector<std::unique_ptr<BinaryDataOperator>>& ops) {
+  Timestamp ts[256];
+  std::string xs[256];
+  size_t total = 0;
+  for (auto& op: ops) {
+    while (true) {
+      common::Status status;
+      size_t size;
+      std::tie(status, size) = op->read(ts, xs, 256);
+      total += size;
+      if (!status.IsOk() || size == 0) {
+        break;
+      }
+    }
+  }
+  return total;
+}
+
+void run(ColumnStore const& cstore, const char* name, std::string const& regex, EventPredicate const& pred) {
+  const Timestamp end = 1000ul * (NEVENTS + 1);
+  size_t nresults = 0;
+  timer.restart();
+  for (int i = 0; i < NQUERIES; i++) {
+    std::vector<std::unique_ptr<BinaryDataOperator>> ops;
+    cstore.filter_events({ 1024 }, 0, end, regex, &ops);
+    nresults = count(ops);
+  }
+  LOG(INFO) << name << ", regex scan: " << timer.elapsed() * 1000 / NQUERIES << "(ms/query), " << nresults << " results";
+
+  timer.restart();
+  for (int i = 0; i < NQUERIES; i++) {
+    std::vector<std::unique_ptr<BinaryDataOperator>> ops;
+    cstore.filter_events({ 1024 }, 0, end, "", pred, &ops);
+    nresults = count(ops);
+  }
+  LOG(INFO) << name << ", token index: " << timer.elapsed() * 1000 / NQUERIES << "(ms/query), " << nresults << " results";
+}
+
+int main(int argc, char** argv) {
+  auto cstore = std::make_shared<ColumnStore>(BlockStoreBuilder::create_memstore());
+  cstore->create_new_column(1024);
+  cstore->enable_event_index();
+  CStoreSession session(cstore);
+  timer.restart();
+  write_log(&session, 1024);
+  LOG(INFO) << "write with index: " << NEVENTS / timer.elapsed() / 1e6 << "(M events/s)";
+
+  EventPredicate timeout;
+  timeout.add_keyword("timeout");
+  run(*cstore, "rare keyword", "\\btimeout\\b", timeout);
+
+  EventPredicate error_db;
+  error_db.add_keyword("error");
+  error_db.add_keyword("db");
+  run(*cstore, "frequent keywords", "ERROR \\[db\\]", error_db);
+
+  EventPredicate prefix;
+  prefix.add_prefix("retr");
+  run(*cstore, "prefix", "\\bretr", prefix);
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*!
+ * \file perf_geofence.cc
+ */
+#include <cmath>
+#include <random>
+
+#include "stdb/common/timer.h"
+#include "stdb/index/geofence.h"
+
+using namespace stdb;
+
+#define NFENCES 10000
+#define NOBJECTS 1000
+#define NSAMPLES 1000000
+
+common::Timer timer;
+
+//! Random convex-ish polygon with `n` vertices
+Polygon make_fence(std::mt19937& gen, u32 n) {
+  std::uniform_real_distribution<double> center(0.0, 1.0);
+  std::uniform_real_distribution<double> radius(0.002, 0.01);
+  double cx = 120.0 + center(gen);
+  double cy = 30.0 + center(gen);
+  Polygon::Ring ring;
+  for (u32 i = 0; i < n; i++) {
+    double a = 2 * M_PI * i / n;
+    double r = radius(gen);
+    Location loc;
+    loc.lon = static_cast<LocationType>(cx + r * std::cos(a));
+    loc.lat = static_cast<LocationType>(cy + r * std::sin(a));
+    ring.push_back(loc);
+  }
+  return Polygon({ ring });
+}
+
+std::vector<Sample> make_samples() {
+  std::mt19937 gen(2);
+  std::normal_distribution<double> step(0.0, 0.0005);
+  std::uniform_real_distribution<double> start(0.0, 1.0);
+  std::vector<Location> objects(NOBJECTS);
+  for (auto& loc: objects) {
+    loc.lon = static_cast<LocationType>(120.0 + start(gen));
+    loc.lat = static_cast<LocationType>(30.0 + start(gen));
+  }
+  std::vector<Sample> samples;
+  for (u32 i = 0; i < NSAMPLES; i++) {
+    auto id = i % NOBJECTS;
+    auto& loc = objects[id];
+    loc.lon += static_cast<LocationType>(step(gen));
+    loc.lat += static_cast<LocationType>(step(gen));
+    Sample sample = {};
+    sample.paramid = id + 1;
+    sample.timestamp = i;
+    sample.location = loc;
+    sample.payload.type = PAYLOAD_LOCATION_FLOAT;
+    sample.payload.size = sizeof(Sample);
+    samples.push_back(sample);
+  }
+  return samples;
+}
+
+int main(int argc, char** argv) {
+  auto samples = make_samples();
+  GeofenceRegistry registry;
+  size_t nevents = 0;
+  registry.subscribe([&nevents](std::vector<GeofenceEvent> const& events) {
+    nevents += events.size();
+  });
+
+  timer.restart();
+  for (auto const& sample: samples) {
+    registry.process(sample);
+  }
+  LOG(INFO) << "no fences: " << timer.elapsed() * 1e9 / NSAMPLES << "(ns/sample)";
+
+  std::mt19937 gen(1);
+  timer.restart();
+  for (u32 i = 0; i < NFENCES; i++) {
+    registry.add_fence(make_fence(gen, 32));
+  }
+  LOG(INFO) << "insert " << NFENCES << " fences: " << timer.elapsed() * 1000 << "(ms)";
+
+  timer.restart();
+  for (auto const& sample: samples) {
+    registry.process(sample);
+  }
+  LOG(INFO) << NFENCES << " fences: " << timer.elapsed() * 1e9 / NSAMPLES << "(ns/sample), "
+            << nevents << " events";
+  return 0;
+}
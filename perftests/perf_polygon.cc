@@ -0,0 +1,105 @@
+/*!
+ * \file perf_polygon.cc
+ */
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "stdb/common/timer.h"
+#include "stdb/index/polygon.h"
+#include "stdb/index/rtree.h"
+
+using namespace stdb;
+using namespace stdb::rtree;
+
+#define BLOCK_SIZE 2048
+#define NVERTICES 1000
+
+RTree<float, 2, BLOCK_SIZE> tree;
+std::vector<LocationType> xs, ys;
+common::Timer timer;
+
+//! Star-shaped polygon with 1k vertices around (120.5, 30.5)
+Polygon make_polygon() {
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> radius(0.2, 0.4);
+  Polygon::Ring ring;
+  for (u32 i = 0; i < NVERTICES; i++) {
+    double a = 2 * M_PI * i / NVERTICES;
+    double r = radius(gen);
+    Location loc;
+    loc.lon = static_cast<LocationType>(120.5 + r * std::cos(a));
+    loc.lat = static_cast<LocationType>(30.5 + r * std::sin(a));
+    ring.push_back(loc);
+  }
+  return Polygon({ ring });
+}
+
+void init() {
+  i64 payload = 1;
+  RTree<float, 2, BLOCK_SIZE>::Point point;
+  timer.restart();
+  for (u32 i = 0; i < 1000; i++) {
+    for (u32 j = 0; j < 1000; ++j) {
+      point.data[0] = 120.00 + i * 0.001;
+      point.data[1] = 30.00 + j * 0.001;
+      xs.push_back(point.data[0]);
+      ys.push_back(point.data[1]);
+      tree.Insert(point, payload++);
+    }
+  }
+  LOG(INFO) << "insert time:" << timer.elapsed() << "(s)";
+}
+
+void point_in_polygon(Polygon const& polygon) {
+  std::vector<u8> out(xs.size());
+  timer.restart();
+  polygon.contains_scalar(xs.data(), ys.data(), xs.size(), out.data());
+  auto scalar = timer.elapsed();
+  size_t n = std::count(out.begin(), out.end(), 1);
+
+  timer.restart();
+  polygon.contains(xs.data(), ys.data(), xs.size(), out.data());
+  auto batch = timer.elapsed();
+  LOG(INFO) << "points inside=" << n << "/" << std::count(out.begin(), out.end(), 1);
+  LOG(INFO) << "scalar PIP time:" << scalar * 1000UL << "(ms), "
+            << scalar * 1e9 / xs.size() << "(ns/point)";
+  LOG(INFO) << "batch PIP time:" << batch * 1000UL << "(ms), "
+            << batch * 1e9 / xs.size() << "(ns/point)";
+}
+
+void region_query(Polygon const& polygon) {
+  MultiPolygon region;
+  region.add(polygon);
+  std::vector<i64> results;
+  timer.restart();
+  tree.RegionQuery(region, results);
+  LOG(INFO) << "region query results.size()=" << results.size();
+  LOG(INFO) << "region query time:" << timer.elapsed() * 1000UL << "(ms)";
+
+  // Bounding box query followed by per-point test
+  RTree<float, 2, BLOCK_SIZE>::Rect rect;
+  rect.min.data[0] = polygon.get_min().lon;
+  rect.min.data[1] = polygon.get_min().lat;
+  rect.max.data[0] = polygon.get_max().lon;
+  rect.max.data[1] = polygon.get_max().lat;
+  std::vector<std::pair<RTree<float, 2, BLOCK_SIZE>::Point, i64>> points;
+  results.clear();
+  timer.restart();
+  tree.RangeQuery(rect, points);
+  for (auto const& p: points) {
+    if (polygon.contains(p.first.data[0], p.first.data[1])) {
+      results.push_back(p.second);
+    }
+  }
+  LOG(INFO) << "range query + filter results.size()=" << results.size();
+  LOG(INFO) << "range query + filter time:" << timer.elapsed() * 1000UL << "(ms)";
+}
+
+int main(int argc, char** argv) {
+  init();
+  auto polygon = make_polygon();
+  point_in_polygon(polygon);
+  region_query(polygon);
+  return 0;
+}
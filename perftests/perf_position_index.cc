@@ -0,0 +1,136 @@
+/*!
+ * \file perf_position_index.cc
+ */
+#include <random>
+#include <thread>
+
+#include "stdb/common/timer.h"
+#include "stdb/index/position_index.h"
+#include "stdb/index/rtree.h"
+#include "stdb/index/series_matcher_base.h"
+
+using namespace stdb;
+
+#define NOBJECTS 100000
+#define NUPDATES 10000000
+#define NQUERIES 100000
+#define NTHREADS 4
+
+common::Timer timer;
+
+//! Random walk of the objects in 1x1 degree area
+std::vector<Sample> make_samples() {
+  std::mt19937 gen(1);
+  std::normal_distribution<double> step(0.0, 0.0002);
+  std::uniform_real_distribution<double> start(0.0, 1.0);
+  std::vector<Location> objects(NOBJECTS);
+  for (auto& loc: objects) {
+    loc.lon = static_cast<LocationType>(120.0 + start(gen));
+    loc.lat = static_cast<LocationType>(30.0 + start(gen));
+  }
+  std::vector<Sample> samples;
+  samples.reserve(NUPDATES);
+  for (u32 i = 0; i < NUPDATES; i++) {
+    auto id = i % NOBJECTS;
+    auto& loc = objects[id];
+    loc.lon += static_cast<LocationType>(step(gen));
+    loc.lat += static_cast<LocationType>(step(gen));
+    Sample sample = {};
+    sample.paramid = STDB_STARTING_SERIES_ID + id;
+    sample.timestamp = i;
+    sample.location = loc;
+    sample.payload.type = PAYLOAD_LOCATION_FLOAT;
+    sample.payload.size = sizeof(Sample);
+    samples.push_back(sample);
+  }
+  return samples;
+}
+
+std::vector<Location> make_queries() {
+  std::mt19937 gen(2);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  std::vector<Location> queries(NQUERIES);
+  for (auto& loc: queries) {
+    loc.lon = static_cast<LocationType>(120.0 + dist(gen));
+    loc.lat = static_cast<LocationType>(30.0 + dist(gen));
+  }
+  return queries;
+}
+
+int main(int argc, char** argv) {
+  auto samples = make_samples();
+  auto queries = make_queries();
+
+  LatestPositionIndex index;
+  timer.restart();
+  for (auto const& sample: samples) {
+    index.process(sample);
+  }
+  LOG(INFO) << "update, 1 thread: " << NUPDATES / timer.elapsed() / 1e6 << "(M updates/s)";
+
+  // Every thread writes its own objects
+  std::vector<std::vector<Sample>> partitions(NTHREADS);
+  for (auto const& sample: samples) {
+    partitions[sample.paramid % NTHREADS].push_back(sample);
+  }
+  LatestPositionIndex mt_index;
+  timer.restart();
+  std::vector<std::thread> threads;
+  for (u32 t = 0; t < NTHREADS; t++) {
+    threads.emplace_back([&partitions, &mt_index, t]() {
+      for (auto const& sample: partitions[t]) {
+        mt_index.process(sample);
+      }
+    });
+  }
+  for (auto& th: threads) {
+    th.join();
+  }
+  LOG(INFO) << "update, " << NTHREADS << " threads: " << NUPDATES / timer.elapsed() / 1e6 << "(M updates/s)";
+
+  std::vector<ParamId> result;
+  size_t nresults = 0;
+  timer.restart();
+  for (auto const& point: queries) {
+    index.knn(point, 20, 0, &result);
+    nresults += result.size();
+  }
+  LOG(INFO) << "knn(20): " << timer.elapsed() * 1e6 / NQUERIES << "(us/query), " << nresults << " results";
+
+  nresults = 0;
+  timer.restart();
+  for (auto const& point: queries) {
+    Location min, max;
+    min.lon = point.lon - 0.01f;
+    min.lat = point.lat - 0.01f;
+    max.lon = point.lon + 0.01f;
+    max.lat = point.lat + 0.01f;
+    index.range(min, max, 0, &result);
+    nresults += result.size();
+  }
+  LOG(INFO) << "range(0.02 x 0.02): " << timer.elapsed() * 1e6 / NQUERIES << "(us/query), " << nresults << " results";
+
+  // Same data in the R-tree, static snapshot only (R-tree can't move points)
+  rtree::RTree<LocationType, 2, 4096> tree;
+  timer.restart();
+  for (u32 i = 0; i < NOBJECTS; i++) {
+    rtree::RTree<LocationType, 2, 4096>::Point p;
+    auto const& loc = samples[NUPDATES - NOBJECTS + i].location;
+    p.data[0] = loc.lon;
+    p.data[1] = loc.lat;
+    tree.Insert(p, i);
+  }
+  LOG(INFO) << "rtree insert: " << NOBJECTS / timer.elapsed() / 1e6 << "(M inserts/s)";
+
+  std::vector<i64> rresult;
+  timer.restart();
+  for (auto const& point: queries) {
+    rtree::RTree<LocationType, 2, 4096>::Point p;
+    p.data[0] = point.lon;
+    p.data[1] = point.lat;
+    rresult.clear();
+    tree.KnnQuery(p, 20, rresult);
+  }
+  LOG(INFO) << "rtree knn(20): " << timer.elapsed() * 1e6 / NQUERIES << "(us/query)";
+  return 0;
+}
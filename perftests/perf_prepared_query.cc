@@ -0,0 +1,82 @@
+/*!
+ * \file perf_prepared_query.cc
+ */
+#include <string>
+
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+#include "stdb/query/prepared_query.h"
+
+using namespace stdb;
+using namespace stdb::qp;
+
+#define NUM_SERIES 100000
+#define NUM_QUERIES 1000
+
+common::Timer timer;
+
+static const char* QUERY_TEMPLATE =
+    "{ \"group-aggregate\": { \"metric\": \"cpu.user\", \"step\": \"$step\", \"func\": [\"max\"] },"
+    "  \"range\": { \"from\": \"$from\", \"to\": \"$to\" },"
+    "  \"where\": { \"region\": [\"region_1\", \"region_2\"] },"
+    "  \"limit\": \"$limit\" }";
+
+std::string make_query(int i) {
+  // Dashboard panel, only the range changes
+  return "{ \"group-aggregate\": { \"metric\": \"cpu.user\", \"step\": \"10s\", \"func\": [\"max\"] },"
+         "  \"range\": { \"from\": \"" + std::to_string(1000000000ul * i) + "\", \"to\": \""
+         + std::to_string(1000000000ul * (i + 3600)) + "\" },"
+         "  \"where\": { \"region\": [\"region_1\", \"region_2\"] },"
+         "  \"limit\": 1000 }";
+}
+
+int main(int argc, char** argv) {
+  SeriesMatcher matcher;
+  for (u32 i = 0; i < NUM_SERIES; i++) {
+    std::string name = "cpu.user host=host_" + std::to_string(i) + " region=region_" + std::to_string(i % 16);
+    matcher.add(name.data(), name.data() + name.size());
+  }
+
+  size_t nids = 0;
+  timer.restart();
+  for (int i = 0; i < NUM_QUERIES; i++) {
+    auto query = make_query(i);
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error;
+    std::tie(status, ptree, error) = QueryParser::parse_json(query.c_str());
+    QueryKind kind;
+    std::tie(status, kind, error) = QueryParser::get_query_kind(ptree);
+    ReshapeRequest req;
+    std::tie(status, req, error) = QueryParser::parse_group_aggregate_query(ptree, matcher);
+    std::vector<std::shared_ptr<Node>> nodes;
+    std::tie(status, nodes, error) = QueryParser::parse_processing_topology(ptree, nullptr, req);
+    nids += req.select.columns.at(0).ids.size();
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << "parse query: " << elapsed * 1000000 / NUM_QUERIES << " us/query, " << nids / NUM_QUERIES << " series";
+
+  PreparedQueryCache cache;
+  common::Status status;
+  u64 id;
+  ErrorMsg error;
+  std::tie(status, id, error) = cache.prepare(QUERY_TEMPLATE, matcher);
+  nids = 0;
+  timer.restart();
+  for (int i = 0; i < NUM_QUERIES; i++) {
+    QueryParameters params;
+    params.begin = 1000000000ul * i;
+    params.end = 1000000000ul * (i + 3600);
+    params.step = 10000000000ul;
+    params.limit = 1000ul;
+    auto query = cache.get(id);
+    ReshapeRequest req;
+    std::tie(status, req, error) = query->bind(params);
+    std::vector<std::shared_ptr<Node>> nodes;
+    std::tie(status, nodes, error) = query->bind_processing_topology(params, nullptr, req);
+    nids += req.select.columns.at(0).ids.size();
+  }
+  elapsed = timer.elapsed();
+  LOG(INFO) << "prepared query: " << elapsed * 1000000 / NUM_QUERIES << " us/query, " << nids / NUM_QUERIES << " series";
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*!
+ * \file perf_query_output.cc
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+#include "stdb/core/query_results_formatter.h"
+#include "stdb/index/plain_series_matcher.h"
+
+using namespace stdb;
+
+#define NUM_SERIES 1000
+#define NUM_ROWS 1000000
+
+common::Timer timer;
+
+//! Session that resolves names using the matcher (same as the session's local matcher)
+struct MatcherSession : DatabaseSession {
+  PlainSeriesMatcher matcher;
+
+  common::Status init_series_id(const char*, const char*, const Location&, u64*) override {
+    return common::Status::NotPermitted();
+  }
+  common::Status init_series_id(const char*, const char*, u64*) override {
+    return common::Status::NotPermitted();
+  }
+  int get_series_name(ParamId id, char* buffer, size_t buffer_size) override {
+    auto name = matcher.id2str(static_cast<i64>(id));
+    if (name.first == nullptr) {
+      return 0;
+    }
+    if (static_cast<size_t>(name.second) > buffer_size) {
+      return -1 * static_cast<int>(name.second);
+    }
+    memcpy(buffer, name.first, static_cast<size_t>(name.second));
+    return static_cast<int>(name.second);
+  }
+  int get_series_name_and_location(ParamId, char*, size_t, Location*) override {
+    return 0;
+  }
+  common::Status write(const Sample&) override {
+    return common::Status::NotPermitted();
+  }
+  void query(InternalCursor*, const char*) override {}
+  void suggest(InternalCursor*, const char*) override {}
+  void search(InternalCursor*, const char*) override {}
+};
+
+//! Cursor that returns the same rows every time
+struct RowsCursor : ExternalCursor {
+  std::vector<Sample> rows;
+  size_t pos = 0;
+
+  u32 read(void* buffer, u32 buffer_size) override {
+    size_t n = std::min(rows.size() - pos, buffer_size / sizeof(Sample));
+    memcpy(buffer, rows.data() + pos, n * sizeof(Sample));
+    pos += n;
+    return static_cast<u32>(n * sizeof(Sample));
+  }
+  bool is_done() const override { return pos == rows.size(); }
+  bool is_error(common::Status*) const override { return false; }
+  bool is_error(const char**, common::Status*) const override { return false; }
+  void close() override {}
+};
+
+void run(const char* name, MatcherSession* session, RowsCursor* cursor, OutputOptions const& options) {
+  cursor->pos = 0;
+  std::vector<char> buf(0x10000);
+  size_t nbytes = 0;
+  timer.restart();
+  QueryResultsFormatter formatter(cursor, session, options);
+  while (auto n = formatter.read_some(buf.data(), buf.size())) {
+    nbytes += n;
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << ": " << NUM_ROWS / elapsed / 1e6 << " M rows/s, " << nbytes / NUM_ROWS << " bytes/row";
+}
+
+int main(int argc, char** argv) {
+  MatcherSession session;
+  for (u32 i = 0; i < NUM_SERIES; i++) {
+    std::string name = "cpu.user host=host_" + std::to_string(i) + " region=eu-central-1 rack=r" +
+                       std::to_string(i % 32) + " os=ubuntu-20.04";
+    session.matcher.add(name.data(), name.data() + name.size());
+  }
+  RowsCursor cursor;
+  cursor.rows.resize(NUM_ROWS);
+  for (u32 i = 0; i < NUM_ROWS; i++) {
+    Sample& sample = cursor.rows[i];
+    sample.paramid = 1024 + i % NUM_SERIES;
+    sample.timestamp = 1000000000ul * i;
+    sample.payload.type = PAYLOAD_FLOAT;
+    sample.payload.size = sizeof(Sample);
+    sample.payload.float64 = i * 0.5;
+  }
+
+  // Name is resolved and copied for every row
+  std::vector<char> name(1024);
+  std::string out;
+  size_t nbytes = 0;
+  timer.restart();
+  for (auto const& sample: cursor.rows) {
+    int len = session.get_series_name(sample.paramid, name.data(), name.size());
+    char buf[64];
+    out += '+';
+    out.append(name.data(), static_cast<size_t>(len));
+    out += "\r\n";
+    out.append(buf, static_cast<size_t>(snprintf(buf, sizeof(buf), ":%llu\r\n+%.17g\r\n",
+                                                 static_cast<unsigned long long>(sample.timestamp),
+                                                 sample.payload.float64)));
+    if (out.size() > 0x10000) {
+      nbytes += out.size();
+      out.clear();
+    }
+  }
+  nbytes += out.size();
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << "lookup per row: " << NUM_ROWS / elapsed / 1e6 << " M rows/s, " << nbytes / NUM_ROWS << " bytes/row";
+
+  OutputOptions options;
+  options.iso_timestamps = false;
+  run("name cache", &session, &cursor, options);
+  options.dictionary = true;
+  run("dictionary", &session, &cursor, options);
+  options.format = OutputFormat::CSV;
+  run("dictionary csv", &session, &cursor, options);
+  options.format = OutputFormat::ARROW;
+  run("arrow", &session, &cursor, options);
+  options.format = OutputFormat::PARQUET;
+  run("parquet", &session, &cursor, options);
+  return 0;
+}
@@ -0,0 +1,98 @@
+/*!
+ * \file perf_query_parser.cc
+ */
+#include <sstream>
+#include <string>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+#include "stdb/query/queryparser.h"
+
+using namespace stdb;
+using namespace stdb::qp;
+
+#define NUM_SERIES 10000
+
+common::Timer timer;
+
+static const char* SMALL_QUERY =
+    "{ \"group-aggregate\": { \"metric\": \"cpu.user\", \"step\": \"10s\", \"func\": [\"max\", \"min\"] },"
+    "  \"range\": { \"from\": \"20200101T000000\", \"to\": \"20200101T010000\" },"
+    "  \"where\": { \"region\": [\"region_1\", \"region_2\"] },"
+    "  \"limit\": 1000 }";
+
+//! Select with `nvalues` tag values in the where clause
+std::string make_huge_query(int nvalues) {
+  std::string query = "{ \"select\": \"cpu.user\","
+                      "  \"range\": { \"from\": \"20200101T000000\", \"to\": \"20200101T010000\" },"
+                      "  \"where\": { \"host\": [";
+  for (int i = 0; i < nvalues; i++) {
+    query += (i == 0 ? "\"host_" : ", \"host_") + std::to_string(i) + "\"";
+  }
+  query += "] } }";
+  return query;
+}
+
+//! Parse using boost::property_tree::json_parser
+boost::property_tree::ptree read_json(std::string const& query) {
+  std::stringstream stream(query);
+  boost::property_tree::ptree ptree;
+  boost::property_tree::json_parser::read_json(stream, ptree);
+  return ptree;
+}
+
+void run(const char* name, std::string const& query, int nqueries, SeriesMatcher const& matcher) {
+  size_t nnodes = 0;
+  timer.restart();
+  for (int i = 0; i < nqueries; i++) {
+    auto ptree = read_json(query);
+    nnodes += ptree.size();
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << ", json_parser: " << elapsed * 1000000 / nqueries << " us/query";
+
+  timer.restart();
+  for (int i = 0; i < nqueries; i++) {
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error;
+    std::tie(status, error) = QueryParser::parse_json(query.c_str(), &ptree);
+    nnodes += ptree.size();
+  }
+  elapsed = timer.elapsed();
+  LOG(INFO) << name << ", json reader: " << elapsed * 1000000 / nqueries << " us/query";
+
+  size_t nids = 0;
+  timer.restart();
+  for (int i = 0; i < nqueries; i++) {
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error;
+    std::tie(status, error) = QueryParser::parse_json(query.c_str(), &ptree);
+    QueryKind kind;
+    std::tie(status, kind, error) = QueryParser::get_query_kind(ptree);
+    ReshapeRequest req;
+    if (kind == QueryKind::SELECT) {
+      std::tie(status, req, error) = QueryParser::parse_select_query(ptree, matcher);
+    } else {
+      std::tie(status, req, error) = QueryParser::parse_group_aggregate_query(ptree, matcher);
+    }
+    nids += req.select.columns.at(0).ids.size();
+  }
+  elapsed = timer.elapsed();
+  LOG(INFO) << name << ", full parse: " << elapsed * 1000000 / nqueries << " us/query, "
+            << nids / nqueries << " series";
+}
+
+int main(int argc, char** argv) {
+  SeriesMatcher matcher;
+  for (u32 i = 0; i < NUM_SERIES; i++) {
+    std::string name = "cpu.user host=host_" + std::to_string(i) + " region=region_" + std::to_string(i % 16);
+    matcher.add(name.data(), name.data() + name.size());
+  }
+  run("small query", SMALL_QUERY, 1000, matcher);
+  run("huge query (5000 hosts)", make_huge_query(5000), 10, matcher);
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*!
+ * \file perf_queue.cc
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/common/blocking_queue.h"
+#include "stdb/common/lockfree_queue.h"
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+
+using namespace stdb;
+
+#define NUM_ITEMS_PER_PRODUCER 1000000
+
+template <class Queue>
+void run(const char* name, Queue& queue, int nproducers, int nconsumers) {
+  std::atomic<u64> count{0};
+  const u64 total = static_cast<u64>(NUM_ITEMS_PER_PRODUCER) * nproducers;
+  common::Timer timer;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < nproducers; p++) {
+    threads.emplace_back([&queue] {
+      for (u64 i = 0; i < NUM_ITEMS_PER_PRODUCER; i++) {
+        queue.Push(i);
+      }
+    });
+  }
+  for (int c = 0; c < nconsumers; c++) {
+    threads.emplace_back([&] {
+      std::vector<u64> batch;
+      while (queue.Pop(batch)) {
+        if (count.fetch_add(batch.size()) + batch.size() == total) {
+          queue.Exit();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << " " << nproducers << "P/" << nconsumers << "C: "
+      << static_cast<u64>(total / elapsed) << " ops/sec";
+}
+
+int main(int argc, char** argv) {
+  const int configs[][2] = { {1, 1}, {2, 2}, {4, 4}, {8, 8}, {16, 1} };
+  for (auto const& cfg : configs) {
+    {
+      common::BlockingQueue<u64> queue;
+      run("BlockingQueue", queue, cfg[0], cfg[1]);
+    }
+    {
+      common::MPMCQueue<u64> queue(0x10000);
+      run("MPMCQueue", queue, cfg[0], cfg[1]);
+    }
+  }
+  common::SPSCQueue<u64> queue(0x10000);
+  run("SPSCQueue", queue, 1, 1);
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*!
+ * \file perf_rwlock.cc
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/common/logging.h"
+#include "stdb/common/rwlock.h"
+#include "stdb/common/timer.h"
+
+using namespace stdb;
+
+#define NUM_READS_PER_THREAD 1000000
+
+struct State {
+  u64 begin;
+  u64 end;
+};
+
+template <class Lock, void (Lock::*on_enter)()>
+void run(const char* name, int nthreads) {
+  Lock lock;
+  State state = { 0, 0 };
+  std::atomic<u64> checksum{0};
+  common::Timer timer;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; t++) {
+    threads.emplace_back([&] {
+      u64 sum = 0;
+      for (u32 i = 0; i < NUM_READS_PER_THREAD; i++) {
+        common::LockGuard<Lock, on_enter> guard(lock);
+        sum += state.end - state.begin;
+      }
+      checksum += sum;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << " " << nthreads << " readers: "
+      << static_cast<u64>(NUM_READS_PER_THREAD * nthreads / elapsed) << " reads/sec";
+}
+
+void run_seqlock(int nthreads) {
+  common::SeqLock<State> lock(State{0, 0});
+  std::atomic<u64> checksum{0};
+  common::Timer timer;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; t++) {
+    threads.emplace_back([&] {
+      u64 sum = 0;
+      for (u32 i = 0; i < NUM_READS_PER_THREAD; i++) {
+        auto state = lock.load();
+        sum += state.end - state.begin;
+      }
+      checksum += sum;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << "SeqLock " << nthreads << " readers: "
+      << static_cast<u64>(NUM_READS_PER_THREAD * nthreads / elapsed) << " reads/sec";
+}
+
+int main(int argc, char** argv) {
+  for (int nthreads = 1; nthreads <= 64; nthreads *= 2) {
+    run<common::RWLock, &common::RWLock::rdlock>("RWLock", nthreads);
+    run<common::BiasedRWLock, &common::BiasedRWLock::rdlock>("BiasedRWLock", nthreads);
+    run_seqlock(nthreads);
+  }
+  return 0;
+}
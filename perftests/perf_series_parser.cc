@@ -0,0 +1,83 @@
+/*!
+ * \file perf_series_parser.cc
+ */
+#include <string>
+#include <vector>
+
+#include "stdb/common/timer.h"
+#include "stdb/index/series_name_cache.h"
+#include "stdb/index/seriesparser.h"
+
+using namespace stdb;
+
+#define NUM_SERIES 10000
+#define NUM_ROUNDS 100
+
+std::vector<std::string> names;
+PlainSeriesMatcher matcher;
+common::Timer timer;
+
+void init() {
+  char buf[LIMITS_MAX_SNAME];
+  for (u32 i = 0; i < NUM_SERIES; i++) {
+    // tags are not in canonical order, the way OpenTSDB clients send them
+    std::string name = "cpu.user region=region_" + std::to_string(i % 16) +
+        " host=host_" + std::to_string(i) + " os=ubuntu_20.04 dc=dc_" + std::to_string(i % 4);
+    names.push_back(name);
+    const char* ksbegin = nullptr;
+    const char* ksend = nullptr;
+    SeriesParser::to_canonical_form(name.data(), name.data() + name.size(),
+                                    buf, buf + LIMITS_MAX_SNAME, &ksbegin, &ksend);
+    matcher.add(buf, ksend);
+  }
+}
+
+void resolve_canonical() {
+  char buf[LIMITS_MAX_SNAME];
+  u64 found = 0;
+  timer.restart();
+  for (u32 round = 0; round < NUM_ROUNDS; round++) {
+    for (auto const& name: names) {
+      const char* ksbegin = nullptr;
+      const char* ksend = nullptr;
+      SeriesParser::to_canonical_form(name.data(), name.data() + name.size(),
+                                      buf, buf + LIMITS_MAX_SNAME, &ksbegin, &ksend);
+      found += matcher.match(buf, ksend) != 0;
+    }
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << "canonical form + match: " << found << " names, "
+      << static_cast<u64>(found / elapsed) << " names/sec";
+}
+
+void resolve_cached() {
+  char buf[LIMITS_MAX_SNAME];
+  SeriesNameCache cache;
+  u64 found = 0;
+  timer.restart();
+  for (u32 round = 0; round < NUM_ROUNDS; round++) {
+    for (auto const& name: names) {
+      auto begin = name.data();
+      auto end = name.data() + name.size();
+      auto id = cache.get(begin, end);
+      if (id == 0) {
+        const char* ksbegin = nullptr;
+        const char* ksend = nullptr;
+        SeriesParser::to_canonical_form(begin, end, buf, buf + LIMITS_MAX_SNAME, &ksbegin, &ksend);
+        id = matcher.match(buf, ksend);
+        cache.put(begin, end, id);
+      }
+      found += id != 0;
+    }
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << "name cache: " << found << " names, "
+      << static_cast<u64>(found / elapsed) << " names/sec";
+}
+
+int main(int argc, char** argv) {
+  init();
+  resolve_canonical();
+  resolve_cached();
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*!
+ * \file perf_string_hash.cc
+ */
+#include <cmath>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+#include "stdb/index/stringpool.h"
+
+using namespace stdb;
+
+#define NUM_SERIES 1000000
+#define NUM_ROUNDS 10
+
+typedef StringTools::StringT Str;
+
+common::Timer timer;
+
+//! Previous implementation of the StringTools::hash
+size_t djb2(Str str) {
+  const char* begin = str.first;
+  const char* end = begin + str.second;
+  size_t hash = 5381;
+  while (begin < end) {
+    hash = ((hash << 5) + hash) + static_cast<size_t>(*begin++);
+  }
+  return hash;
+}
+
+struct Djb2Hash {
+  std::size_t operator()(Str const& str) const noexcept {
+    return djb2(str);
+  }
+};
+
+typedef MapClass<Str, i64, Djb2Hash, StringTools::EqualTo> Djb2TableT;
+
+template<class Fn>
+void perf_hash(const char* name, std::vector<std::string> const& strings, Fn const& fn) {
+  size_t sink = 0;
+  size_t nbytes = 0;
+  timer.restart();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    for (auto const& str: strings) {
+      sink += fn(std::make_pair(str.data(), static_cast<int>(str.size())));
+      nbytes += str.size();
+    }
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << ": " << nbytes / elapsed / 1e6 << " MB/s, "
+            << strings.size() * NUM_ROUNDS / elapsed / 1e6 << " M hashes/s (" << sink % 10 << ")";
+}
+
+template<class Fn>
+void perf_collisions(const char* name, std::vector<std::string> const& strings, Fn const& fn) {
+  // Full hash collisions merge posting lists of the inverted index, collisions
+  // of the high and low bits affect sketches and hash tables
+  std::unordered_set<size_t> full, low, high;
+  for (auto const& str: strings) {
+    auto hash = fn(std::make_pair(str.data(), static_cast<int>(str.size())));
+    full.insert(hash);
+    low.insert(hash & 0xFFFFF);
+    high.insert(hash >> 44);
+  }
+  // Number of occupied buckets if the hash is uniform
+  double buckets = 0x100000;
+  double expected = buckets * (1.0 - std::pow(1.0 - 1.0 / buckets, static_cast<double>(strings.size())));
+  LOG(INFO) << name << ": " << strings.size() - full.size() << " full collisions, "
+            << low.size() << " low 20-bit buckets, " << high.size() << " high 20-bit buckets (uniform "
+            << static_cast<size_t>(expected) << ")";
+}
+
+template<class TableT>
+void perf_lookup(const char* name, std::vector<std::string> const& strings) {
+  TableT table(strings.size());
+  timer.restart();
+  for (size_t i = 0; i < strings.size(); i++) {
+    table[std::make_pair(strings[i].data(), static_cast<int>(strings[i].size()))] = static_cast<i64>(i);
+  }
+  auto elapsed = timer.elapsed();
+  LOG(INFO) << name << ", insert: " << strings.size() / elapsed / 1e6 << " M names/s";
+  size_t found = 0;
+  timer.restart();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    for (auto const& str: strings) {
+      found += table.count(std::make_pair(str.data(), static_cast<int>(str.size())));
+    }
+  }
+  elapsed = timer.elapsed();
+  LOG(INFO) << name << ", lookup: " << found / elapsed / 1e6 << " M names/s";
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> names;
+  std::vector<std::string> tags;
+  for (u32 i = 0; i < NUM_SERIES; i++) {
+    names.push_back("cpu.user dc=dc_" + std::to_string(i % 4) + " host=host_" + std::to_string(i) +
+                    " os=ubuntu_20.04 region=region_" + std::to_string(i % 16));
+    tags.push_back("host=host_" + std::to_string(i));
+  }
+  perf_hash("djb2, series names", names, &djb2);
+  perf_hash("StringTools::hash, series names", names, &StringTools::hash);
+  perf_hash("djb2, tags", tags, &djb2);
+  perf_hash("StringTools::hash, tags", tags, &StringTools::hash);
+
+  perf_collisions("djb2, series names", names, &djb2);
+  perf_collisions("StringTools::hash, series names", names, &StringTools::hash);
+  perf_collisions("djb2, tags", tags, &djb2);
+  perf_collisions("StringTools::hash, tags", tags, &StringTools::hash);
+
+  perf_lookup<Djb2TableT>("djb2 table", names);
+  perf_lookup<StringTools::TableT>("StringTools::TableT", names);
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*!
+ * \file perf_suggest.cc
+ */
+#include <algorithm>
+#include <string>
+
+#include "stdb/common/logging.h"
+#include "stdb/common/timer.h"
+#include "stdb/index/series_matcher.h"
+
+using namespace stdb;
+
+#define NUM_METRICS 50000
+#define NUM_HOSTS 200000
+#define NUM_QUERIES 1000
+
+common::Timer timer;
+
+//! Old approach, list the whole level and filter by prefix
+std::vector<StringT> list_and_filter(std::vector<StringT> results, std::string const& prefix) {
+  auto it = std::remove_if(results.begin(), results.end(), [&prefix](StringT val) {
+    return val.second < prefix.size() || !std::equal(prefix.begin(), prefix.end(), val.first);
+  });
+  results.erase(it, results.end());
+  return results;
+}
+
+int main(int argc, char** argv) {
+  SeriesMatcher matcher;
+  // Many metrics and one metric with high cardinality tag
+  for (u32 i = 0; i < NUM_METRICS * 4; i++) {
+    std::string name = "metric_" + std::to_string(i % NUM_METRICS) + ".value host=host_" +
+                       std::to_string(i % 1000) + " rack=r" + std::to_string(i % 64);
+    matcher.add(name.data(), name.data() + name.size());
+  }
+  for (u32 i = 0; i < NUM_HOSTS; i++) {
+    std::string name = "cpu.user host=host_" + std::to_string(i) + " rack=r" + std::to_string(i % 64);
+    matcher.add(name.data(), name.data() + name.size());
+  }
+  auto const& topology = matcher.index.get_topology();
+  std::string metric = "cpu.user";
+  LOG(INFO) << "topology memory use: " << topology.memory_use() / 1024 << " KB";
+
+  size_t nresults = 0;
+  timer.restart();
+  for (u32 i = 0; i < NUM_QUERIES; i++) {
+    std::string prefix = "metric_" + std::to_string(i % 100);
+    nresults += list_and_filter(topology.list_metric_names(), prefix).size();
+  }
+  LOG(INFO) << "metric names, list and filter: " << timer.elapsed() * 1e6 / NUM_QUERIES << " us/query, "
+            << nresults / NUM_QUERIES << " results";
+
+  for (size_t limit: { 0, 10 }) {
+    nresults = 0;
+    timer.restart();
+    for (u32 i = 0; i < NUM_QUERIES; i++) {
+      std::string prefix = "metric_" + std::to_string(i % 100);
+      nresults += matcher.suggest_metric(prefix, limit).size();
+    }
+    LOG(INFO) << "metric names, trie (limit " << limit << "): " << timer.elapsed() * 1e6 / NUM_QUERIES
+              << " us/query, " << nresults / NUM_QUERIES << " results";
+  }
+
+  nresults = 0;
+  timer.restart();
+  for (u32 i = 0; i < NUM_QUERIES; i++) {
+    std::string prefix = "host_" + std::to_string(i % 1000);
+    nresults += list_and_filter(topology.list_tag_values(tostrt(metric), tostrt("host")), prefix).size();
+  }
+  LOG(INFO) << "tag values, list and filter: " << timer.elapsed() * 1e6 / NUM_QUERIES << " us/query, "
+            << nresults / NUM_QUERIES << " results";
+
+  for (size_t limit: { 0, 10 }) {
+    nresults = 0;
+    timer.restart();
+    for (u32 i = 0; i < NUM_QUERIES; i++) {
+      std::string prefix = "host_" + std::to_string(i % 1000);
+      nresults += matcher.suggest_tag_values(metric, "host", prefix, limit).size();
+    }
+    LOG(INFO) << "tag values, trie (limit " << limit << "): " << timer.elapsed() * 1e6 / NUM_QUERIES
+              << " us/query, " << nresults / NUM_QUERIES << " results";
+  }
+  return 0;
+}
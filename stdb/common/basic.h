@@ -128,6 +128,15 @@ typedef struct {
   //! Path to input log root directory
   const char* input_log_path = "/data/input_log";
 
+  //! Build inverted index of the event series
+  bool enable_event_index = false;
+
+  //! Window size of the similarity (SAX) index, 0 - index is disabled
+  u32 sax_index_window = 0;
+
+  //! Number of segments in the SAX word
+  u32 sax_index_word_length = 8;
+
 } FineTuneParams;
 
 namespace common {
@@ -29,6 +29,7 @@
    1.0  10 Feb 2013  First version
    1.1   1 Aug 2013  Correct comments on why three crc instructions in parallel
    1.2  14 Jun 2016  C++ version without `main` function and other minor updates
+   1.3  18 Oct 2026  Carry-less multiply shifts, crc combining and batch API
  */
 
 #include "./crc32c.h"
@@ -37,6 +38,9 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <pthread.h>
+#ifndef DISABLE_EMBEDDED_ASM
+#include <emmintrin.h>
+#endif
 
 /* CRC-32C (iSCSI) polynomial in reversed bit order. */
 #define POLY 0x82f63b78
@@ -105,6 +109,72 @@ static uint32_t crc32c_sw(uint32_t crci, const void *buf, size_t len)
     return static_cast<uint32_t>(crc) ^ 0xffffffff;
 }
 
+/* Multiply a and b modulo the CRC-32C polynomial.  Both operands are in the
+   reflected bit order, so x^0 is the most significant bit. */
+static uint32_t multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m, p;
+
+    m = static_cast<uint32_t>(1) << 31;
+    p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+/* Table of x^2^n modulo the polynomial for n = 0..31, used to build shift
+   operators for arbitrary lengths in O(log(len)) multiplications. */
+static pthread_once_t crc32c_once_x2n = PTHREAD_ONCE_INIT;
+static uint32_t x2n_table[32];
+
+/* x^33 and x^-33 modulo the polynomial.  Combine operators are stored
+   multiplied by x^-33, so they can be applied using crc32c_shift_clmul. */
+static uint32_t x_33;
+static uint32_t x_inv33;
+
+static void crc32c_init_x2n(void)
+{
+    uint32_t p, xinv;
+    int n;
+
+    p = static_cast<uint32_t>(1) << 30;     /* x^1 */
+    x2n_table[0] = p;
+    for (n = 1; n < 32; n++)
+        x2n_table[n] = p = multmodp(p, p);
+
+    /* x * (POLY - 1) / x == 1 (mod POLY), so x^-1 is POLY shifted by one
+       bit with x^32 term becoming x^31 */
+    xinv = (POLY << 1) | 1;
+    x_33 = x_inv33 = static_cast<uint32_t>(1) << 31;
+    for (n = 0; n < 33; n++) {
+        x_33 = multmodp(x_33, x2n_table[0]);
+        x_inv33 = multmodp(x_inv33, xinv);
+    }
+}
+
+/* Return x^(n * 2^k) modulo the polynomial. */
+static uint32_t x2nmodp(uint64_t n, unsigned k)
+{
+    uint32_t p;
+
+    pthread_once(&crc32c_once_x2n, crc32c_init_x2n);
+    p = static_cast<uint32_t>(1) << 31;     /* x^0 == 1 */
+    while (n) {
+        if (n & 1)
+            p = multmodp(x2n_table[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
 #ifndef DISABLE_EMBEDDED_ASM
 /* Multiply a matrix times a vector over the Galois field of two elements,
    GF(2).  Each element is a bit in an unsigned integer.  mat must have at
@@ -312,6 +382,294 @@ static uint32_t crc32c_hw(uint32_t crc, const void *buf, size_t len)
     return static_cast<uint32_t>(crc0) ^ 0xffffffff;
 }
 
+/* Shift a crc by the number of zero bytes encoded in k = x^(8*len - 33) mod p
+   using a carry-less multiply.  The 64-bit product of two reflected 32-bit
+   values is multiplied by x once more, and crc32q over that product multiplies
+   it by x^32 and reduces it, hence the -33 in the constant.  This replaces four
+   lookups in a 4KiB table with two instructions that don't touch memory. */
+static inline uint32_t crc32c_shift_clmul(uint64_t k, uint32_t crc)
+{
+    __m128i a, b;
+    uint64_t prod, res;
+
+    a = _mm_cvtsi32_si128(static_cast<int>(crc));
+    b = _mm_cvtsi64_si128(static_cast<long long>(k));
+    __asm__("pclmulqdq\t" "$0x00, %1, %0"
+            : "+x"(a)
+            : "x"(b));
+    prod = static_cast<uint64_t>(_mm_cvtsi128_si64(a));
+    res = 0;
+    __asm__("crc32q\t" "%1, %0"
+            : "+r"(res)
+            : "r"(prod));
+    return static_cast<uint32_t>(res);
+}
+
+/* Shift constants for every block length that is a multiple of eight bytes,
+   up to CLMUL_LONG.  They are used to merge the streams of crc32c_fused and,
+   since any block length can be used, to split the tail of the buffer into
+   three equal parallel streams instead of fixed size blocks. */
+#define CLMUL_LONG 8192
+static pthread_once_t crc32c_once_clmul = PTHREAD_ONCE_INIT;
+static uint64_t crc32c_clmul_k[CLMUL_LONG/8 + 1];
+
+/* Constants for folding 128-bit lanes by 512 and by 128 bits, low qword
+   multiplies the earlier half of the lane (x^(F+31)), high qword the later
+   half (x^(F-33)). */
+static __m128i crc32c_fold_512;
+static __m128i crc32c_fold_128;
+
+static void crc32c_init_clmul(void)
+{
+    uint32_t x64;
+    size_t n;
+
+    /* k[n] = x^(64*n - 33), k[1] = x^31 */
+    x64 = x2nmodp(1, 6);
+    crc32c_clmul_k[0] = 0;
+    crc32c_clmul_k[1] = 1;
+    for (n = 2; n <= CLMUL_LONG/8; n++)
+        crc32c_clmul_k[n] = multmodp(static_cast<uint32_t>(crc32c_clmul_k[n - 1]), x64);
+
+    crc32c_fold_512 = _mm_set_epi64x(x2nmodp(512 - 33, 0), x2nmodp(512 + 31, 0));
+    crc32c_fold_128 = _mm_set_epi64x(x2nmodp(128 - 33, 0), x2nmodp(128 + 31, 0));
+}
+
+/* Fold 128-bit lane x forward by the distance encoded in k. */
+static inline __m128i crc32c_fold(__m128i x, __m128i k)
+{
+    __m128i hi = x;
+
+    __asm__("pclmulqdq\t" "$0x00, %1, %0"
+            : "+x"(x)
+            : "x"(k));
+    __asm__("pclmulqdq\t" "$0x11, %1, %0"
+            : "+x"(hi)
+            : "x"(k));
+    return _mm_xor_si128(x, hi);
+}
+
+#define CRC32Q(crc, p) \
+    __asm__("crc32q\t" "(%1), %0" : "+r"(crc) : "r"(p))
+
+/* Number of iterations of crc32c_fused per call, the scalar streams are
+   24*CLMUL_MAXITER bytes long and should fit into crc32c_clmul_k. */
+#define CLMUL_MAXITER 256
+
+/* Compute the crc on m*136 bytes using both the carry-less multiplier and the
+   crc32 unit.  The first m*64 bytes are folded by four 128-bit lanes, the
+   rest is split between three independent crc32q streams of m*24 bytes.  Both
+   units run in parallel, so the throughput is higher than the crc32
+   instruction alone can provide.  The results are merged at the end. */
+static inline uint64_t crc32c_fused(uint64_t crc0, const unsigned char *next,
+                                    size_t m)
+{
+    const unsigned char *v = next;
+    const unsigned char *s = next + 64*m;
+    size_t slen = 24*m;
+    const unsigned char *s1 = s, *s2 = s + slen, *s3 = s + 2*slen;
+    uint64_t crc1 = 0, crc2 = 0, crc3 = 0;
+    __m128i x0, x1, x2, x3, k;
+    size_t i;
+
+    x0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v)),
+                       _mm_cvtsi32_si128(static_cast<int>(crc0)));
+    x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + 16));
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + 32));
+    x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + 48));
+    k = crc32c_fold_512;
+    for (i = 0; i < m; i++) {
+        if (i) {
+            v += 64;
+            x0 = _mm_xor_si128(crc32c_fold(x0, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v)));
+            x1 = _mm_xor_si128(crc32c_fold(x1, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + 16)));
+            x2 = _mm_xor_si128(crc32c_fold(x2, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + 32)));
+            x3 = _mm_xor_si128(crc32c_fold(x3, k), _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + 48)));
+        }
+        CRC32Q(crc1, s1);
+        CRC32Q(crc2, s2);
+        CRC32Q(crc3, s3);
+        CRC32Q(crc1, s1 + 8);
+        CRC32Q(crc2, s2 + 8);
+        CRC32Q(crc3, s3 + 8);
+        CRC32Q(crc1, s1 + 16);
+        CRC32Q(crc2, s2 + 16);
+        CRC32Q(crc3, s3 + 16);
+        s1 += 24;
+        s2 += 24;
+        s3 += 24;
+    }
+
+    /* reduce four lanes to one, then to the crc of the vector part */
+    k = crc32c_fold_128;
+    x1 = _mm_xor_si128(crc32c_fold(x0, k), x1);
+    x2 = _mm_xor_si128(crc32c_fold(x1, k), x2);
+    x3 = _mm_xor_si128(crc32c_fold(x2, k), x3);
+    crc0 = 0;
+    __asm__("crc32q\t" "%1, %0"
+            : "+r"(crc0)
+            : "r"(static_cast<uint64_t>(_mm_cvtsi128_si64(x3))));
+    __asm__("crc32q\t" "%1, %0"
+            : "+r"(crc0)
+            : "r"(static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(x3, x3)))));
+
+    /* append scalar streams */
+    crc0 = crc32c_shift_clmul(crc32c_clmul_k[slen/8], static_cast<uint32_t>(crc0)) ^ crc1;
+    crc0 = crc32c_shift_clmul(crc32c_clmul_k[slen/8], static_cast<uint32_t>(crc0)) ^ crc2;
+    crc0 = crc32c_shift_clmul(crc32c_clmul_k[slen/8], static_cast<uint32_t>(crc0)) ^ crc3;
+    return crc0;
+}
+
+/* Compute the crc on three adjacent blocks of blklen bytes, executing three
+   independent crc instructions, then merge the results.  blklen must be a
+   multiple of eight. */
+static inline uint64_t crc32c_3way(uint64_t crc0, const unsigned char *next,
+                                   size_t blklen, uint64_t k)
+{
+    const unsigned char *end;
+    uint64_t crc1, crc2;
+
+    crc1 = 0;
+    crc2 = 0;
+    end = next + blklen;
+    do {
+        __asm__("crc32q\t" "(%3), %0\n\t"
+                "crc32q\t" "(%3,%4,1), %1\n\t"
+                "crc32q\t" "(%3,%4,2), %2"
+                : "=r"(crc0), "=r"(crc1), "=r"(crc2)
+                : "r"(next), "r"(blklen), "0"(crc0), "1"(crc1), "2"(crc2));
+        next += 8;
+    } while (next < end);
+    crc0 = crc32c_shift_clmul(k, static_cast<uint32_t>(crc0)) ^ crc1;
+    crc0 = crc32c_shift_clmul(k, static_cast<uint32_t>(crc0)) ^ crc2;
+    return crc0;
+}
+
+/* Compute CRC-32C using the Intel crc32 and pclmulqdq instructions. */
+static uint32_t crc32c_hw_clmul(uint32_t crc, const void *buf, size_t len)
+{
+    const unsigned char *next = reinterpret_cast<const uint8_t*>(buf);
+    const unsigned char *end;
+    uint64_t crc0;
+    size_t m, blk;
+
+    pthread_once(&crc32c_once_clmul, crc32c_init_clmul);
+
+    crc0 = crc ^ 0xffffffff;
+
+    while (len && (reinterpret_cast<uintptr_t>(next) & 7) != 0) {
+        __asm__("crc32b\t" "(%1), %0"
+                : "=r"(crc0)
+                : "r"(next), "0"(crc0));
+        next++;
+        len--;
+    }
+
+    while (len >= 136*2) {
+        m = len / 136;
+        if (m > CLMUL_MAXITER)
+            m = CLMUL_MAXITER;
+        crc0 = crc32c_fused(crc0, next, m);
+        next += 136*m;
+        len -= 136*m;
+    }
+
+    /* split the rest into three equal parts, at least 8 bytes each */
+    blk = (len / 24) * 8;
+    if (blk) {
+        crc0 = crc32c_3way(crc0, next, blk, crc32c_clmul_k[blk/8]);
+        next += blk*3;
+        len -= blk*3;
+    }
+
+    end = next + (len - (len & 7));
+    while (next < end) {
+        __asm__("crc32q\t" "(%1), %0"
+                : "=r"(crc0)
+                : "r"(next), "0"(crc0));
+        next += 8;
+    }
+    len &= 7;
+
+    while (len) {
+        __asm__("crc32b\t" "(%1), %0"
+                : "=r"(crc0)
+                : "r"(next), "0"(crc0));
+        next++;
+        len--;
+    }
+
+    return static_cast<uint32_t>(crc0) ^ 0xffffffff;
+}
+
+/* Compute crcs of three independent buffers of len bytes each.  The buffers
+   are processed in lockstep, so no shifting is needed to hide the latency of
+   the crc instruction.  The crcs are raw (not post-processed). */
+static inline void crc32c_x3(uint64_t *crc, const unsigned char **next,
+                             size_t len)
+{
+    const unsigned char *p0 = next[0], *p1 = next[1], *p2 = next[2];
+    uint64_t crc0 = crc[0], crc1 = crc[1], crc2 = crc[2];
+    size_t i;
+
+    for (i = 0; i < len; i += 8) {
+        __asm__("crc32q\t" "(%3,%6,1), %0\n\t"
+                "crc32q\t" "(%4,%6,1), %1\n\t"
+                "crc32q\t" "(%5,%6,1), %2"
+                : "=r"(crc0), "=r"(crc1), "=r"(crc2)
+                : "r"(p0), "r"(p1), "r"(p2), "r"(i),
+                  "0"(crc0), "1"(crc1), "2"(crc2));
+    }
+    crc[0] = crc0;
+    crc[1] = crc1;
+    crc[2] = crc2;
+    next[0] = p0 + len;
+    next[1] = p1 + len;
+    next[2] = p2 + len;
+}
+
+/* Compute crc of every buffer in the batch, three buffers at a time.  The
+   common prefix of each triple is computed by crc32c_x3 and the rest of every
+   buffer by crc32c_hw. */
+static void crc32c_batch_hw(const void* const* bufs, const size_t* lens,
+                            uint32_t* out, size_t n)
+{
+    const unsigned char *next[3];
+    uint64_t crc[3];
+    size_t i, j, common;
+
+    for (i = 0; i + 3 <= n; i += 3) {
+        common = lens[i];
+        for (j = 0; j < 3; j++) {
+            next[j] = reinterpret_cast<const unsigned char*>(bufs[i + j]);
+            crc[j] = 0xffffffff;
+            if (lens[i + j] < common)
+                common = lens[i + j];
+        }
+        common &= ~static_cast<size_t>(7);
+        if (common)
+            crc32c_x3(crc, next, common);
+        for (j = 0; j < 3; j++) {
+            out[i + j] = crc32c_hw(static_cast<uint32_t>(crc[j]) ^ 0xffffffff,
+                                   next[j], lens[i + j] - common);
+        }
+    }
+    for (; i < n; i++)
+        out[i] = crc32c_hw(0, bufs[i], lens[i]);
+}
+
+/* Batch version for processors with pclmulqdq.  crc32c_hw_clmul keeps both
+   the crc32 unit and the carry-less multiplier busy on a single buffer, which
+   is faster than running three buffers in lockstep on the crc32 unit alone. */
+static void crc32c_batch_hw_clmul(const void* const* bufs, const size_t* lens,
+                                  uint32_t* out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        out[i] = crc32c_hw_clmul(0, bufs[i], lens[i]);
+}
+
 /* Check for SSE 4.2.  SSE 4.2 was first supported in Nehalem processors
    introduced in November, 2008.  This does not check for the existence of the
    cpuid instruction itself, which was introduced on the 486SL in 1992, so this
@@ -326,8 +684,29 @@ static bool hardwared_crc32c_available() {
             : "%ebx", "%edx");
     return (ecx >> 20) & 1;
 }
+
+/* Check for PCLMULQDQ, first supported in Westmere processors. */
+static bool hardwared_clmul_available() {
+    uint32_t eax, ecx;
+    eax = 1;
+    __asm__("cpuid"
+            : "=c"(ecx)
+            : "a"(eax)
+            : "%ebx", "%edx");
+    return ((ecx >> 20) & 1) && ((ecx >> 1) & 1);
+}
 #endif
 
+/* Software batch version, computes crcs one by one. */
+static void crc32c_batch_sw(const void* const* bufs, const size_t* lens,
+                            uint32_t* out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        out[i] = crc32c_sw(0, bufs[i], lens[i]);
+}
+
 namespace stdb {
 namespace common {
 
@@ -338,14 +717,61 @@ crc32c_impl_t chose_crc32c_implementation(CRC32C_hint hint) {
   switch(hint) {
     case CRC32C_hint::FORCE_HW:
       return &crc32c_hw;
+    case CRC32C_hint::FORCE_HW_CLMUL:
+      return &crc32c_hw_clmul;
     case CRC32C_hint::FORCE_SW:
       return &crc32c_sw;
     case CRC32C_hint::DETECT:
+      if (hardwared_clmul_available()) {
+        return &crc32c_hw_clmul;
+      }
       return hardwared_crc32c_available() ? &crc32c_hw : &crc32c_sw;
   };
   return &crc32c_sw;
 #endif
 }
 
+crc32c_batch_impl_t chose_crc32c_batch_implementation(CRC32C_hint hint) {
+#ifdef DISABLE_EMBEDDED_ASM
+  return &crc32c_batch_sw;
+#else
+  switch(hint) {
+    case CRC32C_hint::FORCE_HW:
+      return &crc32c_batch_hw;
+    case CRC32C_hint::FORCE_HW_CLMUL:
+      return &crc32c_batch_hw_clmul;
+    case CRC32C_hint::FORCE_SW:
+      return &crc32c_batch_sw;
+    case CRC32C_hint::DETECT:
+      if (hardwared_clmul_available()) {
+        return &crc32c_batch_hw_clmul;
+      }
+      return hardwared_crc32c_available() ? &crc32c_batch_hw : &crc32c_batch_sw;
+  };
+  return &crc32c_batch_sw;
+#endif
+}
+
+uint32_t crc32c_combine_gen(size_t len2) {
+  // x^(8*len2 - 33), x2nmodp initializes x_inv33
+  uint32_t op = x2nmodp(len2, 3);
+  return multmodp(op, x_inv33);
+}
+
+uint32_t crc32c_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op) {
+#ifndef DISABLE_EMBEDDED_ASM
+  static const bool clmul = hardwared_clmul_available();
+  if (clmul) {
+    return crc32c_shift_clmul(op, crc1) ^ crc2;
+  }
+#endif
+  pthread_once(&crc32c_once_x2n, crc32c_init_x2n);
+  return multmodp(multmodp(op, x_33), crc1) ^ crc2;
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2) {
+  return crc32c_combine_op(crc1, crc2, crc32c_combine_gen(len2));
+}
+
 }  // namespace common
 }  // namespace stdb
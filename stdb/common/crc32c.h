@@ -12,15 +12,40 @@ namespace common {
 
 typedef uint32_t (*crc32c_impl_t)(uint32_t crc, const void *buf, size_t len);
 
+/** Batch crc32c function.
+ * Computes `out[i] = crc32c(0, bufs[i], lens[i])` for every i in [0, n).
+ * Independent buffers are processed in lockstep which hides the latency
+ * of the crc32 instruction.
+ */
+typedef void (*crc32c_batch_impl_t)(const void* const* bufs, const size_t* lens, uint32_t* out, size_t n);
+
 enum class CRC32C_hint {
   DETECT,
   FORCE_SW,
   FORCE_HW,
+  FORCE_HW_CLMUL,
 };
 
 //! Return crc32c implementation.
 crc32c_impl_t chose_crc32c_implementation(CRC32C_hint hint=CRC32C_hint::DETECT);
 
+//! Return batch crc32c implementation.
+crc32c_batch_impl_t chose_crc32c_batch_implementation(CRC32C_hint hint=CRC32C_hint::DETECT);
+
+/** Combine crc of two adjacent buffers.
+ * @param crc1 is a crc of the first buffer
+ * @param crc2 is a crc of the second buffer
+ * @param len2 is a length of the second buffer
+ * @return crc of the concatenation of both buffers
+ */
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+//! Precompute operator for `crc32c_combine_op` (for buffers of the same length).
+uint32_t crc32c_combine_gen(size_t len2);
+
+//! Same as `crc32c_combine` but uses operator computed by `crc32c_combine_gen`.
+uint32_t crc32c_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op);
+
 }  // namespace common
 }  // namespace stdb
 
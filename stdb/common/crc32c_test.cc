@@ -3,6 +3,9 @@
  */
 #include "stdb/common/crc32c.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "stdb/common/basic.h"
@@ -59,5 +62,81 @@ TEST(crc32, test_crc32c_2) {
   test_crc32c_composability(CRC32C_hint::FORCE_HW);
 }
 
+TEST(crc32, test_crc32c_3) {
+  test_crc32c_composability(CRC32C_hint::FORCE_HW_CLMUL);
+}
+
+TEST(crc32, test_crc32c_4) {
+  // Carry-less multiply version should match software version on
+  // every length and alignment
+  auto crc32hw = chose_crc32c_implementation(CRC32C_hint::DETECT);
+  auto crc32sw = chose_crc32c_implementation(CRC32C_hint::FORCE_SW);
+  if (crc32hw == crc32sw) {
+    LOG(ERROR) << "Can't compare crc32c implementation, hardware version is not available.";
+    return;
+  }
+  auto crc32clmul = chose_crc32c_implementation(CRC32C_hint::FORCE_HW_CLMUL);
+  std::vector<u8> data(30000, 0);
+  std::generate(data.begin(), data.end(), []() { return static_cast<u8>(rand()); });
+  for (size_t len = 0; len < 30000; len += 1 + len / 7) {
+    for (size_t off = 0; off < 8; off++) {
+      size_t sz = std::min(len, data.size() - off);
+      u32 sw = crc32sw(0, data.data() + off, sz);
+      u32 clmul = crc32clmul(0, data.data() + off, sz);
+      ASSERT_EQ(sw, clmul) << "len: " << sz << ", off: " << off;
+    }
+  }
+}
+
+TEST(crc32, test_crc32c_combine) {
+  auto crc32impl = chose_crc32c_implementation(CRC32C_hint::FORCE_SW);
+  std::vector<u8> data(5000, 0);
+  std::generate(data.begin(), data.end(), []() { return static_cast<u8>(rand()); });
+  u32 expected = crc32impl(0, data.data(), data.size());
+  for (size_t split = 0; split <= data.size(); split += 37) {
+    u32 crc1 = crc32impl(0, data.data(), split);
+    u32 crc2 = crc32impl(0, data.data() + split, data.size() - split);
+    EXPECT_EQ(expected, crc32c_combine(crc1, crc2, data.size() - split));
+    u32 op = crc32c_combine_gen(data.size() - split);
+    EXPECT_EQ(expected, crc32c_combine_op(crc1, crc2, op));
+  }
+}
+
+void test_crc32c_batch(CRC32C_hint hint) {
+  auto crc32impl = chose_crc32c_implementation(CRC32C_hint::FORCE_SW);
+  auto batch = chose_crc32c_batch_implementation(hint);
+  std::vector<std::vector<u8>> blocks;
+  for (int i = 0; i < 17; i++) {
+    // Mix of equal and different sizes
+    size_t size = i % 4 == 0 ? 4096 : static_cast<size_t>(rand() % 5000);
+    std::vector<u8> block(size, 0);
+    std::generate(block.begin(), block.end(), []() { return static_cast<u8>(rand()); });
+    blocks.push_back(std::move(block));
+  }
+  std::vector<const void*> bufs;
+  std::vector<size_t> lens;
+  for (const auto& block: blocks) {
+    bufs.push_back(block.data());
+    lens.push_back(block.size());
+  }
+  std::vector<u32> out(blocks.size(), 0);
+  batch(bufs.data(), lens.data(), out.data(), blocks.size());
+  for (size_t i = 0; i < blocks.size(); i++) {
+    EXPECT_EQ(crc32impl(0, blocks[i].data(), blocks[i].size()), out[i]);
+  }
+}
+
+TEST(crc32, test_crc32c_batch_0) {
+  test_crc32c_batch(CRC32C_hint::FORCE_SW);
+}
+
+TEST(crc32, test_crc32c_batch_1) {
+  test_crc32c_batch(CRC32C_hint::FORCE_HW);
+}
+
+TEST(crc32, test_crc32c_batch_2) {
+  test_crc32c_batch(CRC32C_hint::FORCE_HW_CLMUL);
+}
+
 }  // namespace common
 }  // namespace stdb
@@ -15,7 +15,9 @@
  */
 #include "stdb/common/datetime.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <boost/regex.hpp>
 
 namespace stdb {
@@ -57,7 +59,223 @@ static int parse_n_digits(const char* p, int n, const char* error_message = "can
   return value;
 }
 
+//! Check that 8 bytes are decimal digits and convert them to integer (SWAR)
+static inline bool parse_8_digits_swar(const char* p, u32* value) {
+  u64 val;
+  memcpy(&val, p, sizeof(val));
+  // every byte should be in [0x30:0x39] range
+  if (((val & 0xF0F0F0F0F0F0F0F0ull) | (((val + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))
+      != 0x3333333333333333ull) {
+    return false;
+  }
+  val -= 0x3030303030303030ull;
+  val = (val * 10) + (val >> 8);
+  val = (((val & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+         (((val >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+  *value = static_cast<u32>(val);
+  return true;
+}
+
+//! Parse two digits, return false on error
+static inline bool parse_2_digits(const char* p, int* value) {
+  u32 hi = static_cast<u32>(p[0] - '0');
+  u32 lo = static_cast<u32>(p[1] - '0');
+  if (hi > 9 || lo > 9) {
+    return false;
+  }
+  *value = static_cast<int>(hi * 10 + lo);
+  return true;
+}
+
+static const int FAST_MIN_YEAR = 1970;
+static const int FAST_MAX_YEAR = 2199;
+
+//! Number of days since epoch for the first day of every month in [FAST_MIN_YEAR, FAST_MAX_YEAR + 1)
+struct MonthTable {
+  enum {
+    NYEARS = FAST_MAX_YEAR - FAST_MIN_YEAR + 1,
+  };
+  // one extra month to compute the length of December of the last year
+  u32 days[NYEARS * 12 + 1];
+
+  MonthTable() {
+    static const u32 MDAYS[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    u32 acc = 0;
+    for (int y = 0; y < NYEARS; y++) {
+      int year = FAST_MIN_YEAR + y;
+      bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+      for (int m = 0; m < 12; m++) {
+        days[y * 12 + m] = acc;
+        acc += MDAYS[m] + (m == 1 && leap ? 1 : 0);
+      }
+    }
+    days[NYEARS * 12] = acc;
+  }
+};
+
+static const MonthTable& month_table() {
+  static MonthTable table;
+  return table;
+}
+
+bool DateTimeUtil::try_parse_iso_string(const char* str, size_t len, Timestamp* ts) {
+  static const u64 NS_PER_SEC = 1000000000ull;
+  static const u32 POW10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+  };
+  int year, month, day, hour, minute, second;
+  const char* p = str;
+  const char* pend = str + len;
+  if (len >= 15 && p[8] == 'T') {
+    // Basic format YYYYMMDDThhmmss
+    u32 date;
+    if (!parse_8_digits_swar(p, &date)) {
+      return false;
+    }
+    year = static_cast<int>(date / 10000);
+    month = static_cast<int>(date / 100 % 100);
+    day = static_cast<int>(date % 100);
+    if (!parse_2_digits(p + 9, &hour) || !parse_2_digits(p + 11, &minute) ||
+        !parse_2_digits(p + 13, &second)) {
+      return false;
+    }
+    p += 15;
+  } else if (len >= 19 && p[4] == '-' && p[7] == '-' && p[10] == 'T' && p[13] == ':' && p[16] == ':') {
+    // Extended format YYYY-MM-DDThh:mm:ss
+    int yh, yl;
+    if (!parse_2_digits(p, &yh) || !parse_2_digits(p + 2, &yl) || !parse_2_digits(p + 5, &month) ||
+        !parse_2_digits(p + 8, &day) || !parse_2_digits(p + 11, &hour) ||
+        !parse_2_digits(p + 14, &minute) || !parse_2_digits(p + 17, &second)) {
+      return false;
+    }
+    year = yh * 100 + yl;
+    p += 19;
+  } else {
+    return false;
+  }
+  if (pend != p && pend[-1] == 'Z') {
+    // UTC designator
+    pend--;
+  }
+  u32 nanoseconds = 0;
+  if (p != pend) {
+    if (*p != '.' && *p != ',') {
+      return false;
+    }
+    p++;
+    auto n = pend - p;
+    if (n < 1 || n > 9) {
+      return false;
+    }
+    u32 frac = 0;
+    if (n >= 8) {
+      if (!parse_8_digits_swar(p, &frac)) {
+        return false;
+      }
+      p += 8;
+    }
+    for (; p < pend; p++) {
+      u32 digit = static_cast<u32>(*p - '0');
+      if (digit > 9) {
+        return false;
+      }
+      frac = frac * 10 + digit;
+    }
+    nanoseconds = frac * POW10[9 - n];
+  }
+  if (year < FAST_MIN_YEAR || year > FAST_MAX_YEAR || month < 1 || month > 12 ||
+      hour > 23 || minute > 59 || second > 59) {
+    return false;
+  }
+  auto const& table = month_table();
+  auto mix = (year - FAST_MIN_YEAR) * 12 + month - 1;
+  u32 first_day = table.days[mix];
+  if (day < 1 || static_cast<u32>(day) > table.days[mix + 1] - first_day) {
+    return false;
+  }
+  u64 days = first_day + static_cast<u32>(day) - 1;
+  u64 seconds = days * 86400ull + static_cast<u64>(hour * 3600 + minute * 60 + second);
+  *ts = seconds * NS_PER_SEC + nanoseconds;
+  return true;
+}
+
+Timestamp DateTimeUtil::from_epoch_string(const char* str, size_t len, EpochUnit unit) {
+  const char* p = str;
+  const char* pend = str + len;
+  auto ndigits = len;
+  if (ndigits == 0 || ndigits > 20) {
+    BadDateTimeFormat error("can't parse unix-timestamp from string");
+    BOOST_THROW_EXCEPTION(error);
+  }
+  u64 value = 0;
+  while (pend - p >= 8 && value < 100000000000ull) {
+    u32 chunk;
+    if (!parse_8_digits_swar(p, &chunk)) {
+      BadDateTimeFormat error("unknown timestamp format");
+      BOOST_THROW_EXCEPTION(error);
+    }
+    value = value * 100000000ull + chunk;
+    p += 8;
+  }
+  for (; p < pend; p++) {
+    u64 digit = static_cast<u64>(*p - '0');
+    if (digit > 9) {
+      BadDateTimeFormat error("unknown timestamp format");
+      BOOST_THROW_EXCEPTION(error);
+    }
+    if (value > (~0ull - digit) / 10) {
+      BadDateTimeFormat error("can't parse unix-timestamp from string");
+      BOOST_THROW_EXCEPTION(error);
+    }
+    value = value * 10 + digit;
+  }
+  if (unit == EpochUnit::AUTO) {
+    if (ndigits <= 10) {
+      unit = EpochUnit::SECONDS;
+    } else if (ndigits <= 13) {
+      unit = EpochUnit::MILLISECONDS;
+    } else if (ndigits <= 16) {
+      unit = EpochUnit::MICROSECONDS;
+    } else {
+      unit = EpochUnit::NANOSECONDS;
+    }
+  }
+  u64 K = 1ull;
+  switch (unit) {
+    case EpochUnit::SECONDS:
+      K = 1000000000ull;
+      break;
+    case EpochUnit::MILLISECONDS:
+      K = 1000000ull;
+      break;
+    case EpochUnit::MICROSECONDS:
+      K = 1000ull;
+      break;
+    case EpochUnit::AUTO:
+    case EpochUnit::NANOSECONDS:
+      break;
+  }
+  if (value > (~0ull) / K) {
+    BadDateTimeFormat error("unix-timestamp is out of range");
+    BOOST_THROW_EXCEPTION(error);
+  }
+  return value * K;
+}
+
 Timestamp DateTimeUtil::from_iso_string(const char* iso_str) {
+  Timestamp ts;
+  size_t len = std::strlen(iso_str);
+  if (try_parse_iso_string(iso_str, len, &ts)) {
+    return ts;
+  }
+  if (len != 0 && len <= 20 && std::all_of(iso_str, iso_str + len, [](char c) { return c >= '0' && c <= '9'; })) {
+    // Raw timestamp (nanoseconds)
+    return from_epoch_string(iso_str, len, EpochUnit::NANOSECONDS);
+  }
+  return parse_iso_string(iso_str);
+}
+
+Timestamp DateTimeUtil::parse_iso_string(const char* iso_str) {
   u32 len = static_cast<u32>(std::strlen(iso_str));
   if (len == 0) {
     BadDateTimeFormat error("empty timestamp value");
@@ -37,6 +37,15 @@ struct BadDateTimeFormat : std::runtime_error {
   BadDateTimeFormat(const char* str) : std::runtime_error(str) { }
 };
 
+//! Unit of the integer epoch timestamp
+enum class EpochUnit {
+  AUTO,  //! Detect unit by number of digits (10 - s, 13 - ms, 16 - us, 19 - ns)
+  SECONDS,
+  MILLISECONDS,
+  MICROSECONDS,
+  NANOSECONDS,
+};
+
 //! Static utility class for date-time utility functions
 struct DateTimeUtil {
   static Timestamp from_std_chrono(std::chrono::system_clock::time_point timestamp);
@@ -49,12 +58,34 @@ struct DateTimeUtil {
    * Convert ISO formatter timestamp to Timestamp value.
    * 
    * @note This function implements ISO 8601 partially compatible parser. Most of the standard is not
-   * supported yet - extended formatting (only basic format is supported), fractions on minutes or hours (
-   * like "20150102T1230.999"), timezones (values is treated as UTC time).
+   * supported yet - extended formatting (only "YYYY-MM-DDThh:mm:ss[.fff][Z]" layout is supported),
+   * fractions on minutes or hours (like "20150102T1230.999"), timezones (values is treated as UTC time).
    *
    */
   static Timestamp from_iso_string(const char* iso_str);
 
+  /**
+   * Generic ISO 8601 parser used by `from_iso_string` when the timestamp doesn't
+   * match any of the fixed layouts supported by `try_parse_iso_string`.
+   * @throw BadDateTimeFormat on error
+   */
+  static Timestamp parse_iso_string(const char* iso_str);
+
+  /**
+   * Fast fixed-layout timestamp parser. Supports basic ("20060102T150405.999") and
+   * extended ("2006-01-02T15:04:05.999Z") formats with up to 9 fractional digits.
+   * Dates between 1970 and 2199 are supported.
+   * @return false if the string doesn't match the layout, in this case the generic
+   *         parser should be used
+   */
+  static bool try_parse_iso_string(const char* str, size_t len, Timestamp* ts);
+
+  /**
+   * Convert integer epoch timestamp to Timestamp value.
+   * @throw BadDateTimeFormat on error
+   */
+  static Timestamp from_epoch_string(const char* str, size_t len, EpochUnit unit = EpochUnit::AUTO);
+
   /**
    * Convert timestamp to string.
    */
@@ -3,6 +3,8 @@
  */
 #include "stdb/common/datetime.h"
 
+#include <random>
+
 #include "gtest/gtest.h"
 
 namespace stdb {
@@ -64,4 +66,107 @@ TEST(DateTime, Test_string_to_duration_minutes) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(DateTime, Test_fast_iso_basic_format) {
+  const char* timestamp_str = "20060102T150405.999999999";
+  Timestamp actual = 0;
+  EXPECT_TRUE(DateTimeUtil::try_parse_iso_string(timestamp_str, strlen(timestamp_str), &actual));
+  EXPECT_EQ(1136214245999999999ul, actual);
+
+  timestamp_str = "20060102T150405";
+  EXPECT_TRUE(DateTimeUtil::try_parse_iso_string(timestamp_str, strlen(timestamp_str), &actual));
+  EXPECT_EQ(1136214245000000000ul, actual);
+
+  timestamp_str = "20060102T150405,5";
+  EXPECT_TRUE(DateTimeUtil::try_parse_iso_string(timestamp_str, strlen(timestamp_str), &actual));
+  EXPECT_EQ(1136214245500000000ul, actual);
+}
+
+TEST(DateTime, Test_fast_iso_extended_format) {
+  const char* timestamp_str = "2006-01-02T15:04:05.999999999Z";
+  Timestamp actual = DateTimeUtil::from_iso_string(timestamp_str);
+  EXPECT_EQ(1136214245999999999ul, actual);
+
+  timestamp_str = "2016-02-29T00:00:00.001";
+  actual = DateTimeUtil::from_iso_string(timestamp_str);
+  EXPECT_EQ(1456704000001000000ul, actual);
+}
+
+TEST(DateTime, Test_fast_iso_fallback) {
+  Timestamp actual = 0;
+  // Invalid date
+  const char* timestamp_str = "20060230T150405";
+  EXPECT_FALSE(DateTimeUtil::try_parse_iso_string(timestamp_str, strlen(timestamp_str), &actual));
+  EXPECT_THROW(DateTimeUtil::from_iso_string(timestamp_str), BadDateTimeFormat);
+  // Out of range of the fast parser
+  timestamp_str = "22000101T000000";
+  EXPECT_FALSE(DateTimeUtil::try_parse_iso_string(timestamp_str, strlen(timestamp_str), &actual));
+  EXPECT_EQ(DateTimeUtil::parse_iso_string(timestamp_str), DateTimeUtil::from_iso_string(timestamp_str));
+  // Raw timestamp
+  timestamp_str = "1136214245999999999";
+  EXPECT_FALSE(DateTimeUtil::try_parse_iso_string(timestamp_str, strlen(timestamp_str), &actual));
+  EXPECT_EQ(1136214245999999999ul, DateTimeUtil::from_iso_string(timestamp_str));
+  // Raw timestamps are always nanoseconds
+  EXPECT_EQ(42ul, DateTimeUtil::from_iso_string("42"));
+  EXPECT_EQ(1136214245ul, DateTimeUtil::from_iso_string("1136214245"));
+  EXPECT_THROW(DateTimeUtil::from_iso_string("18446744073709551616"), BadDateTimeFormat);
+}
+
+TEST(DateTime, Test_fast_iso_fuzz_equivalence) {
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<u64> tsdist(0, 7258118399999999999ull);  // up to 2199-12-31
+  char basic[64];
+  char extended[128];
+  for (int i = 0; i < 100000; i++) {
+    Timestamp expected = tsdist(rng);
+    int ndigits = static_cast<int>(rng() % 10);
+    Timestamp truncated = expected;
+    u64 div = 1;
+    for (int k = ndigits; k < 9; k++) {
+      div *= 10;
+    }
+    truncated -= expected % div;
+    DateTimeUtil::to_iso_string(truncated, basic, sizeof(basic));
+    // "YYYYMMDDThhmmss.fffffffff" -> keep ndigits fractional digits
+    basic[ndigits == 0 ? 15 : 16 + ndigits] = '\0';
+    snprintf(extended, sizeof(extended), "%.4s-%.2s-%.2sT%.2s:%.2s:%.2s%sZ",
+             basic, basic + 4, basic + 6, basic + 9, basic + 11, basic + 13, basic + 15);
+
+    Timestamp fast = 0;
+    ASSERT_TRUE(DateTimeUtil::try_parse_iso_string(basic, strlen(basic), &fast)) << basic;
+    ASSERT_EQ(DateTimeUtil::parse_iso_string(basic), fast) << basic;
+    ASSERT_EQ(truncated, fast) << basic;
+    ASSERT_TRUE(DateTimeUtil::try_parse_iso_string(extended, strlen(extended), &fast)) << extended;
+    ASSERT_EQ(truncated, fast) << extended;
+
+    // Corrupt one character, fast parser should either reject the value or agree
+    // with the generic parser (which doesn't support UTC designator)
+    std::string corrupted(basic);
+    corrupted[rng() % corrupted.size()] = static_cast<char>(rng() % 128);
+    if (corrupted.back() != 'Z' &&
+        DateTimeUtil::try_parse_iso_string(corrupted.data(), corrupted.size(), &fast)) {
+      ASSERT_EQ(DateTimeUtil::parse_iso_string(corrupted.c_str()), fast) << corrupted;
+    }
+  }
+}
+
+TEST(DateTime, Test_epoch_string) {
+  const char* ts = "1136214245";
+  EXPECT_EQ(1136214245000000000ul, DateTimeUtil::from_epoch_string(ts, strlen(ts)));
+  ts = "1136214245999";
+  EXPECT_EQ(1136214245999000000ul, DateTimeUtil::from_epoch_string(ts, strlen(ts)));
+  ts = "1136214245999999";
+  EXPECT_EQ(1136214245999999000ul, DateTimeUtil::from_epoch_string(ts, strlen(ts)));
+  ts = "1136214245999999999";
+  EXPECT_EQ(1136214245999999999ul, DateTimeUtil::from_epoch_string(ts, strlen(ts)));
+  ts = "42";
+  EXPECT_EQ(42ul, DateTimeUtil::from_epoch_string(ts, strlen(ts), EpochUnit::NANOSECONDS));
+  EXPECT_EQ(42000ul, DateTimeUtil::from_epoch_string(ts, strlen(ts), EpochUnit::MICROSECONDS));
+  ts = "18446744073709551615";
+  EXPECT_EQ(18446744073709551615ul, DateTimeUtil::from_epoch_string(ts, strlen(ts)));
+  ts = "18446744073709551616";
+  EXPECT_THROW(DateTimeUtil::from_epoch_string(ts, strlen(ts)), BadDateTimeFormat);
+  ts = "1136214245.5";
+  EXPECT_THROW(DateTimeUtil::from_epoch_string(ts, strlen(ts)), BadDateTimeFormat);
+}
+
 }  // namespace stdb
@@ -0,0 +1,33 @@
+/*!
+ * \file geo.h
+ *
+ * Geodesic helpers shared by the spatial indexes and query nodes.
+ */
+#ifndef STDB_COMMON_GEO_H_
+#define STDB_COMMON_GEO_H_
+
+#include <algorithm>
+#include <cmath>
+
+namespace stdb {
+namespace common {
+
+static const double EARTH_RADIUS = 6371008.8;  // mean radius in meters
+static const double DEG2RAD = M_PI / 180.0;
+
+/** Great-circle distance between two points in meters.
+ * Longitude difference doesn't need to be normalized, points on the
+ * different sides of the antimeridian are handled correctly.
+ */
+inline double haversine(double lon0, double lat0, double lon1, double lat1) {
+  double dlat = (lat1 - lat0) * DEG2RAD;
+  double dlon = (lon1 - lon0) * DEG2RAD;
+  double a = std::sin(dlat / 2) * std::sin(dlat / 2) +
+      std::cos(lat0 * DEG2RAD) * std::cos(lat1 * DEG2RAD) * std::sin(dlon / 2) * std::sin(dlon / 2);
+  return 2 * EARTH_RADIUS * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+}  // namespace common
+}  // namespace stdb
+
+#endif  // STDB_COMMON_GEO_H_
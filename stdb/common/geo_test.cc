@@ -0,0 +1,24 @@
+/*!
+ * \file geo_test.cc
+ */
+#include "stdb/common/geo.h"
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+namespace common {
+
+TEST(TestGeo, Test_haversine) {
+  // One degree of latitude
+  EXPECT_NEAR(111195, haversine(30, 10, 30, 11), 10);
+  // One degree of longitude at 60 degrees latitude is half as long
+  EXPECT_NEAR(111195 / 2.0, haversine(30, 60, 31, 60), 100);
+  EXPECT_EQ(0, haversine(30, 60, 30, 60));
+}
+
+TEST(TestGeo, Test_haversine_antimeridian) {
+  EXPECT_NEAR(haversine(0, 10, 0.2, 10), haversine(179.9, 10, -179.9, 10), 1e-6);
+}
+
+}  // namespace common
+}  // namespace stdb
@@ -71,7 +71,7 @@ class ConsistentHash {
   // virtual node num per physical node
   int virtual_node_num_;
 
-  RWLock lock_;
+  BiasedRWLock lock_;
 
  public:
   explicit ConsistentHash(int virtual_node_num) : virtual_node_num_(virtual_node_num) { }
@@ -79,7 +79,7 @@ class ConsistentHash {
   virtual ~ConsistentHash() { }
 
   void Remove(const std::string& node) {
-    LockGuard<RWLock, &RWLock::wrlock> lck(lock_);
+    BiasedWriteLockGuard lck(lock_);
 
     auto iter = ip2hash_.find(node);
     if (iter != ip2hash_.end()) {
@@ -93,7 +93,7 @@ class ConsistentHash {
   }
 
   void MarkEnable(const std::string& node, bool enable) {
-    LockGuard<RWLock, &RWLock::wrlock> lck(lock_);
+    BiasedWriteLockGuard lck(lock_);
 
     auto iter = ip2hash_.find(node);
     if (iter != ip2hash_.end()) {
@@ -108,7 +108,7 @@ class ConsistentHash {
   }
   
   std::vector<uint64_t> GetHashs(const std::string& node) {
-    LockGuard<RWLock, &RWLock::rdlock> lck(lock_);
+    BiasedReadLockGuard lck(lock_);
 
     auto iter = ip2hash_.find(node);
     if (iter != ip2hash_.end()) {
@@ -120,7 +120,7 @@ class ConsistentHash {
   }
 
   std::string GetNode(uint64_t hash) {
-    LockGuard<RWLock, &RWLock::rdlock> lck(lock_);
+    BiasedReadLockGuard lck(lock_);
 
     auto iter = hash2ip_.find(hash);
     if (iter == hash2ip_.end()) {
@@ -131,7 +131,7 @@ class ConsistentHash {
   }
 
   std::tuple<uint64_t, uint64_t> GetNeighbour(uint64_t hash) {
-    LockGuard<RWLock, &RWLock::rdlock> lck(lock_);
+    BiasedReadLockGuard lck(lock_);
 
     auto iter = hash2ip_.find(hash);
     uint64_t left, right;
@@ -153,7 +153,7 @@ class ConsistentHash {
   }
 
   void AddNode(const std::string& node) {
-    LockGuard<RWLock, &RWLock::wrlock> lck(lock_);
+    BiasedWriteLockGuard lck(lock_);
     
     std::vector<uint64_t> hashs;
     for (auto i = 0; i < virtual_node_num_; ++i) {
@@ -168,7 +168,7 @@ class ConsistentHash {
   }
 
   void AddNode(const std::string& node, const std::vector<uint64_t>& hashs) {
-    LockGuard<RWLock, &RWLock::wrlock> lck(lock_);
+    BiasedWriteLockGuard lck(lock_);
     
     for (auto& hash : hashs) {
       hash2ip_[hash] = node;
@@ -178,7 +178,7 @@ class ConsistentHash {
   }
 
   std::string GetKeyNode(const std::string& key) {
-    LockGuard<RWLock, &RWLock::rdlock> lck(lock_);
+    BiasedReadLockGuard lck(lock_);
     
     auto hash = MurmurHash64A(key.c_str(), key.length());
 
@@ -0,0 +1,472 @@
+/*
+ * \file lockfree_queue.h
+ * \brief The bounded lock-free queues
+ */
+#ifndef STDB_COMMON_LOCKFREE_QUEUE_H_
+#define STDB_COMMON_LOCKFREE_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stdb {
+namespace common {
+
+#define STDB_CACHELINE_SIZE 64
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+/**
+ * Adaptive waiting strategy: spin for a while, then yield, then park the
+ * thread on the condition variable. Notification is cheap when there are no
+ * parked threads (no mutex, no syscall).
+ */
+class SpinParkWaiter {
+ public:
+  enum {
+    SPIN_COUNT = 128,
+    YIELD_COUNT = 16,
+  };
+
+  /**
+   * Block until `ready` returns true.
+   * @return the last value returned by `ready`
+   */
+  template <class Pred>
+  bool Wait(Pred const& ready) {
+    for (int i = 0; i < SPIN_COUNT; i++) {
+      if (ready()) return true;
+      cpu_relax();
+    }
+    for (int i = 0; i < YIELD_COUNT; i++) {
+      if (ready()) return true;
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    bool result = ready();
+    while (!result && !exit_.load(std::memory_order_acquire)) {
+      // timeout protects from the lost wakeups
+      condition_.wait_for(lock, std::chrono::milliseconds(10));
+      result = ready();
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  // Wake up one parked thread (if any)
+  void NotifyOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      condition_.notify_one();
+    }
+  }
+
+  // Wake up all parked threads (if any)
+  void NotifyAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      condition_.notify_all();
+    }
+  }
+
+  // Stop waiting, all parked threads are woken up
+  void Exit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_.store(true, std::memory_order_release);
+    condition_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::atomic<int> waiters_{0};
+  std::atomic_bool exit_{false};
+};
+
+inline size_t round_up_pow2(size_t value) {
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+/**
+ * Bounded multi-producer multi-consumer lock-free queue (D. Vyukov's
+ * algorithm). Has the same interface as BlockingQueue, Push blocks
+ * when the queue is full and Pop blocks when the queue is empty.
+ */
+template <typename T>
+class MPMCQueue {
+ public:
+  explicit MPMCQueue(size_t capacity = 0x10000)
+      : mask_(round_up_pow2(capacity) - 1),
+        cells_(new Cell[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+    exit_.store(false);
+  }
+
+  // Push an element into the queue, returns false if the queue is full.
+  bool TryPush(T&& item) {
+    Cell* cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    not_empty_.NotifyOne();
+    return true;
+  }
+
+  // Pop an element from the queue, returns false if the queue is empty.
+  bool TryPop(T& result) {
+    Cell* cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    result = std::move(cell->data);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    not_full_.NotifyOne();
+    return true;
+  }
+
+  // Push an element into the queue, if the queue is full, thread call push
+  // would be blocked. Returns false if the queue was closed.
+  bool Push(T item) {
+    if (TryPush(std::move(item))) {
+      return true;
+    }
+    bool pushed = false;
+    not_full_.Wait([&] {
+      pushed = TryPush(std::move(item));
+      return pushed || exit_.load(std::memory_order_acquire);
+    });
+    return pushed;
+  }
+
+  // Push a batch of elements, blocks while the queue is full.
+  // Returns number of pushed elements.
+  size_t PushBatch(std::vector<T>& items) {
+    size_t npushed = 0;
+    for (auto& item : items) {
+      if (!Push(std::move(item))) {
+        break;
+      }
+      npushed++;
+    }
+    return npushed;
+  }
+
+  // Pop an element from the queue, if the queue is empty, thread call pop would
+  // be blocked.
+  bool Pop(T& result) {
+    if (TryPop(result)) {
+      return true;
+    }
+    bool popped = false;
+    not_empty_.Wait([&] {
+      popped = TryPop(result);
+      return popped || exit_.load(std::memory_order_acquire);
+    });
+    return popped;
+  }
+
+  // Pop up to `max_items` elements without blocking.
+  // Returns number of popped elements.
+  size_t TryPopBatch(std::vector<T>& result, size_t max_items) {
+    size_t count = 0;
+    T item;
+    while (count < max_items && TryPop(item)) {
+      result.emplace_back(std::move(item));
+      count++;
+    }
+    return count;
+  }
+
+  // Pop all elemnts from the queue, if the queue is empty, thread call pop
+  // would be blocked.
+  bool Pop(std::vector<T>& result) {
+    result.clear();
+    T item;
+    if (!Pop(item)) {
+      return false;
+    }
+    result.emplace_back(std::move(item));
+    // bounded by capacity, otherwise fast producers can keep the consumer here forever
+    TryPopBatch(result, mask_);
+    return true;
+  }
+
+  // Get the number of elements in the queue (approximate)
+  int Size() const {
+    auto enq = enqueue_pos_.load(std::memory_order_acquire);
+    auto deq = dequeue_pos_.load(std::memory_order_acquire);
+    return enq > deq ? static_cast<int>(enq - deq) : 0;
+  }
+
+  // Whether queue is empty or not
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+  // Get the queue capacity
+  size_t Capacity() const {
+    return mask_ + 1;
+  }
+
+  // Exit queue, awake all threads blocked by the queue
+  void Exit() {
+    exit_.store(true);
+    not_empty_.Exit();
+    not_full_.Exit();
+  }
+
+  // Whether alive
+  bool Alive() {
+    return exit_ == false;
+  }
+
+ protected:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(STDB_CACHELINE_SIZE) std::atomic<size_t> enqueue_pos_;
+  alignas(STDB_CACHELINE_SIZE) std::atomic<size_t> dequeue_pos_;
+  alignas(STDB_CACHELINE_SIZE) std::atomic_bool exit_;
+  SpinParkWaiter not_empty_;
+  SpinParkWaiter not_full_;
+
+  MPMCQueue(const MPMCQueue&);
+  void operator=(const MPMCQueue&);
+};
+
+/**
+ * Bounded single-producer single-consumer lock-free ring buffer. Same
+ * interface as MPMCQueue, only one thread can push and only one thread can
+ * pop elements at the same time.
+ */
+template <typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(size_t capacity = 0x10000)
+      : mask_(round_up_pow2(capacity) - 1),
+        buffer_(new T[mask_ + 1]) {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    exit_.store(false);
+  }
+
+  // Push an element into the queue, returns false if the queue is full.
+  bool TryPush(T&& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) {
+        return false;
+      }
+    }
+    buffer_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    not_empty_.NotifyOne();
+    return true;
+  }
+
+  // Push a batch of elements without blocking, the tail is published once.
+  // Returns number of pushed elements.
+  size_t TryPushBatch(std::vector<T>& items) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    head_cache_ = head_.load(std::memory_order_acquire);
+    size_t space = mask_ + 1 - (tail - head_cache_);
+    size_t count = std::min(space, items.size());
+    for (size_t i = 0; i < count; i++) {
+      buffer_[(tail + i) & mask_] = std::move(items[i]);
+    }
+    if (count) {
+      tail_.store(tail + count, std::memory_order_release);
+      not_empty_.NotifyOne();
+    }
+    return count;
+  }
+
+  // Pop an element from the queue, returns false if the queue is empty.
+  bool TryPop(T& result) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    result = std::move(buffer_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    not_full_.NotifyOne();
+    return true;
+  }
+
+  // Pop all available elements without blocking, the head is published once.
+  // Returns number of popped elements.
+  size_t TryPopBatch(std::vector<T>& result) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    tail_cache_ = tail_.load(std::memory_order_acquire);
+    size_t count = tail_cache_ - head;
+    for (size_t i = 0; i < count; i++) {
+      result.emplace_back(std::move(buffer_[(head + i) & mask_]));
+    }
+    if (count) {
+      head_.store(head + count, std::memory_order_release);
+      not_full_.NotifyOne();
+    }
+    return count;
+  }
+
+  // Push an element into the queue, if the queue is full, thread call push
+  // would be blocked. Returns false if the queue was closed.
+  bool Push(T item) {
+    if (TryPush(std::move(item))) {
+      return true;
+    }
+    bool pushed = false;
+    not_full_.Wait([&] {
+      pushed = TryPush(std::move(item));
+      return pushed || exit_.load(std::memory_order_acquire);
+    });
+    return pushed;
+  }
+
+  // Push a batch of elements, blocks while the queue is full.
+  // Returns number of pushed elements.
+  size_t PushBatch(std::vector<T>& items) {
+    size_t npushed = TryPushBatch(items);
+    while (npushed < items.size()) {
+      if (!Push(std::move(items[npushed]))) {
+        break;
+      }
+      npushed++;
+    }
+    return npushed;
+  }
+
+  // Pop an element from the queue, if the queue is empty, thread call pop would
+  // be blocked.
+  bool Pop(T& result) {
+    if (TryPop(result)) {
+      return true;
+    }
+    bool popped = false;
+    not_empty_.Wait([&] {
+      popped = TryPop(result);
+      return popped || exit_.load(std::memory_order_acquire);
+    });
+    return popped;
+  }
+
+  // Pop all elemnts from the queue, if the queue is empty, thread call pop
+  // would be blocked.
+  bool Pop(std::vector<T>& result) {
+    result.clear();
+    if (TryPopBatch(result)) {
+      return true;
+    }
+    bool popped = false;
+    not_empty_.Wait([&] {
+      popped = TryPopBatch(result) != 0;
+      return popped || exit_.load(std::memory_order_acquire);
+    });
+    return popped;
+  }
+
+  // Get the number of elements in the queue (approximate)
+  int Size() const {
+    return static_cast<int>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+  }
+
+  // Whether queue is empty or not
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+  // Get the queue capacity
+  size_t Capacity() const {
+    return mask_ + 1;
+  }
+
+  // Exit queue, awake all threads blocked by the queue
+  void Exit() {
+    exit_.store(true);
+    not_empty_.Exit();
+    not_full_.Exit();
+  }
+
+  // Whether alive
+  bool Alive() {
+    return exit_ == false;
+  }
+
+ protected:
+  const size_t mask_;
+  std::unique_ptr<T[]> buffer_;
+  // consumer side
+  alignas(STDB_CACHELINE_SIZE) std::atomic<size_t> head_;
+  size_t tail_cache_ = 0;
+  // producer side
+  alignas(STDB_CACHELINE_SIZE) std::atomic<size_t> tail_;
+  size_t head_cache_ = 0;
+  alignas(STDB_CACHELINE_SIZE) std::atomic_bool exit_;
+  SpinParkWaiter not_empty_;
+  SpinParkWaiter not_full_;
+
+  SPSCQueue(const SPSCQueue&);
+  void operator=(const SPSCQueue&);
+};
+
+}  // namespace common
+}  // namespace stdb
+
+#endif  // STDB_COMMON_LOCKFREE_QUEUE_H_
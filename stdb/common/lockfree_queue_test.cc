@@ -0,0 +1,109 @@
+/*!
+ * \file lockfree_queue_test.cc
+ */
+#include "stdb/common/lockfree_queue.h"
+
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "stdb/common/basic.h"
+
+namespace stdb {
+namespace common {
+
+TEST(MPMCQueue, Test_push_pop) {
+  MPMCQueue<int> queue(4);
+  EXPECT_EQ(4, queue.Capacity());
+  EXPECT_TRUE(queue.Empty());
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.TryPush(std::move(i)));
+  }
+  int value = 100;
+  EXPECT_FALSE(queue.TryPush(std::move(value)));
+  EXPECT_EQ(4, queue.Size());
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.Pop(value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(queue.TryPop(value));
+
+  queue.Push(1);
+  queue.Push(2);
+  std::vector<int> result;
+  EXPECT_TRUE(queue.Pop(result));
+  EXPECT_EQ(2, result.size());
+  EXPECT_EQ(1, result[0]);
+  EXPECT_EQ(2, result[1]);
+}
+
+TEST(MPMCQueue, Test_exit) {
+  MPMCQueue<int> queue(4);
+  std::thread consumer([&queue] {
+    int value;
+    EXPECT_FALSE(queue.Pop(value));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  queue.Exit();
+  consumer.join();
+  EXPECT_FALSE(queue.Alive());
+}
+
+template <class Queue>
+void test_concurrent(Queue& queue, int nproducers, int nconsumers) {
+  const u64 N = 100000;
+  std::atomic<u64> sum{0};
+  std::atomic<u64> count{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < nproducers; p++) {
+    threads.emplace_back([&queue, N] {
+      for (u64 i = 1; i <= N; i++) {
+        queue.Push(i);
+      }
+    });
+  }
+  for (int c = 0; c < nconsumers; c++) {
+    threads.emplace_back([&] {
+      std::vector<u64> batch;
+      while (queue.Pop(batch)) {
+        for (auto value : batch) {
+          sum += value;
+        }
+        if (count.fetch_add(batch.size()) + batch.size() == N * nproducers) {
+          queue.Exit();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(N * nproducers, count.load());
+  EXPECT_EQ(nproducers * N * (N + 1) / 2, sum.load());
+}
+
+TEST(MPMCQueue, Test_concurrent) {
+  MPMCQueue<u64> queue(1024);
+  test_concurrent(queue, 4, 4);
+}
+
+TEST(SPSCQueue, Test_push_pop) {
+  SPSCQueue<int> queue(4);
+  std::vector<int> items = { 1, 2, 3, 4, 5 };
+  EXPECT_EQ(4, queue.TryPushBatch(items));
+  std::vector<int> result;
+  EXPECT_TRUE(queue.Pop(result));
+  EXPECT_EQ(4, result.size());
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(i + 1, result[i]);
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SPSCQueue, Test_concurrent) {
+  SPSCQueue<u64> queue(1024);
+  test_concurrent(queue, 1, 1);
+}
+
+}  // namespace common
+}  // namespace stdb
@@ -3,6 +3,13 @@
  */
 #include "stdb/common/rwlock.h"
 
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
 #include "stdb/common/logging.h"
 
 namespace stdb {
@@ -68,5 +75,154 @@ void RWLock::unlock() {
   }
 }
 
+// BiasedRWLock //
+
+namespace {
+
+//! Visible readers table, every thread owns SLOTS_PER_THREAD consecutive slots (one cache line)
+struct VisibleReaders {
+  alignas(64) std::atomic<BiasedRWLock*> slots[MAX_THREADS * BiasedRWLock::SLOTS_PER_THREAD];
+
+  VisibleReaders() {
+    for (auto& slot : slots) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+};
+
+VisibleReaders g_visible_readers;
+std::atomic<u32> g_thread_counter{0};
+std::mutex g_free_indexes_mutex;
+std::vector<u32> g_free_indexes;
+
+//! Thread index holder, indexes of the finished threads are reused
+struct ThreadIndex {
+  u32 index;
+
+  ThreadIndex() {
+    std::lock_guard<std::mutex> guard(g_free_indexes_mutex);
+    if (g_free_indexes.empty()) {
+      index = g_thread_counter.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      index = g_free_indexes.back();
+      g_free_indexes.pop_back();
+    }
+  }
+
+  ~ThreadIndex() {
+    std::lock_guard<std::mutex> guard(g_free_indexes_mutex);
+    g_free_indexes.push_back(index);
+  }
+};
+
+//! Get thread index, threads with index >= MAX_THREADS always use the slow path
+u32 thread_index() {
+  static thread_local ThreadIndex holder;
+  return holder.index;
+}
+
+u64 now_ns() {
+  return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+u32 lock_hash(const void* lock) {
+  auto addr = reinterpret_cast<uintptr_t>(lock);
+  return static_cast<u32>((addr >> 6) ^ (addr >> 12)) % BiasedRWLock::SLOTS_PER_THREAD;
+}
+
+}  // namespace
+
+BiasedRWLock::BiasedRWLock() : rbias_(true), inhibit_until_(0) { }
+
+std::atomic<BiasedRWLock*>* BiasedRWLock::slot() {
+  u32 index = thread_index();
+  if (index >= MAX_THREADS) {
+    return nullptr;
+  }
+  return &g_visible_readers.slots[index * SLOTS_PER_THREAD + lock_hash(this)];
+}
+
+void BiasedRWLock::rdlock() {
+  if (rbias_.load(std::memory_order_acquire)) {
+    if (try_rdlock()) {
+      return;
+    }
+  }
+  underlying_.rdlock();
+  if (!rbias_.load(std::memory_order_relaxed) &&
+      now_ns() >= inhibit_until_.load(std::memory_order_relaxed)) {
+    rbias_.store(true, std::memory_order_release);
+  }
+}
+
+bool BiasedRWLock::try_rdlock() {
+  if (rbias_.load(std::memory_order_acquire)) {
+    auto pslot = slot();
+    BiasedRWLock* expected = nullptr;
+    if (pslot && pslot->compare_exchange_strong(expected, this, std::memory_order_seq_cst)) {
+      if (rbias_.load(std::memory_order_seq_cst)) {
+        // fast path
+        return true;
+      }
+      // bias was revoked by the writer
+      pslot->store(nullptr, std::memory_order_release);
+    }
+  }
+  return underlying_.try_rdlock();
+}
+
+void BiasedRWLock::revoke() {
+  rbias_.store(false, std::memory_order_seq_cst);
+  u64 start = now_ns();
+  u32 nthreads = std::min(g_thread_counter.load(std::memory_order_acquire), static_cast<u32>(MAX_THREADS));
+  u32 offset = lock_hash(this);
+  for (u32 i = 0; i < nthreads; i++) {
+    auto& pslot = g_visible_readers.slots[i * SLOTS_PER_THREAD + offset];
+    while (pslot.load(std::memory_order_acquire) == this) {
+      sched_yield();
+    }
+  }
+  u64 end = now_ns();
+  inhibit_until_.store(end + (end - start) * INHIBIT_MULTIPLIER, std::memory_order_relaxed);
+}
+
+void BiasedRWLock::wrlock() {
+  underlying_.wrlock();
+  if (rbias_.load(std::memory_order_relaxed)) {
+    revoke();
+  }
+}
+
+bool BiasedRWLock::try_wrlock() {
+  if (!underlying_.try_wrlock()) {
+    return false;
+  }
+  if (rbias_.load(std::memory_order_relaxed)) {
+    rbias_.store(false, std::memory_order_seq_cst);
+    u32 nthreads = std::min(g_thread_counter.load(std::memory_order_acquire), static_cast<u32>(MAX_THREADS));
+    u32 offset = lock_hash(this);
+    for (u32 i = 0; i < nthreads; i++) {
+      if (g_visible_readers.slots[i * SLOTS_PER_THREAD + offset].load(std::memory_order_acquire) == this) {
+        // the lock is held by the fast path reader, can't wait here
+        rbias_.store(true, std::memory_order_release);
+        underlying_.unlock();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void BiasedRWLock::unlock() {
+  auto pslot = slot();
+  if (pslot && pslot->load(std::memory_order_relaxed) == this) {
+    // the slot is owned by the current thread so it can only be a fast path reader
+    pslot->store(nullptr, std::memory_order_release);
+    return;
+  }
+  underlying_.unlock();
+}
+
 }  // namespace common
 }  // namespace stdb
@@ -6,6 +6,12 @@
 
 #include "pthread.h"
 
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "stdb/common/basic.h"
+
 namespace stdb {
 namespace common {
 
@@ -35,6 +41,122 @@ class RWLock {
   void unlock();
 };
 
+/**
+ * Reader biased reader writer lock (BRAVO, Dice & Kogan).
+ * While the lock is biased towards readers, readers don't touch the lock
+ * itself, they publish the lock's address in a per-thread slot of the global
+ * visible readers table instead. A writer revokes the bias and waits until
+ * all published readers are gone, after that the lock behaves like a normal
+ * RWLock until the inhibition period (proportional to the revocation cost)
+ * passes. The lock is small so it can be used per series.
+ */
+class BiasedRWLock {
+  RWLock underlying_;
+  std::atomic<bool> rbias_;
+  std::atomic<u64> inhibit_until_;
+
+ public:
+  //! Number of slots per thread in the visible readers table
+  static const u32 SLOTS_PER_THREAD = 8;
+  //! Inhibition period is N times larger than the revocation time
+  static const u64 INHIBIT_MULTIPLIER = 9;
+
+  BiasedRWLock();
+
+  BiasedRWLock(BiasedRWLock const&) = delete;
+  BiasedRWLock(BiasedRWLock &&) = delete;
+  BiasedRWLock& operator = (BiasedRWLock const&) = delete;
+
+  void rdlock();
+
+  bool try_rdlock();
+
+  void wrlock();
+
+  bool try_wrlock();
+
+  void unlock();
+
+ private:
+  //! Get current thread's slot for this lock (nullptr if the thread has no slots)
+  std::atomic<BiasedRWLock*>* slot();
+
+  //! Wait until all readers on the fast path will release the lock
+  void revoke();
+};
+
+/**
+ * Sequence lock for small trivially copyable state. Readers never write
+ * to shared memory, they retry if the value was changed during the read.
+ * Writers are serialized by the sequence counter.
+ */
+template<class T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires trivially copyable type");
+
+  enum {
+    NWORDS = (sizeof(T) + sizeof(u64) - 1) / sizeof(u64),
+  };
+
+  std::atomic<u64> seq_;
+  std::atomic<u64> words_[NWORDS];
+
+ public:
+  SeqLock() : seq_(0) {
+    for (auto& w : words_) {
+      w.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  explicit SeqLock(T const& value) : SeqLock() {
+    store(value);
+  }
+
+  SeqLock(SeqLock const&) = delete;
+  SeqLock& operator = (SeqLock const&) = delete;
+
+  //! Read consistent copy of the value
+  T load() const {
+    u64 buf[NWORDS];
+    while (true) {
+      u64 begin = seq_.load(std::memory_order_acquire);
+      if (begin & 1) {
+        // write in progress
+        continue;
+      }
+      for (int i = 0; i < NWORDS; i++) {
+        buf[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == begin) {
+        break;
+      }
+    }
+    T result;
+    memcpy(&result, buf, sizeof(T));
+    return result;
+  }
+
+  //! Replace the value
+  void store(T const& value) {
+    u64 buf[NWORDS] = {};
+    memcpy(buf, &value, sizeof(T));
+    u64 seq = seq_.load(std::memory_order_relaxed);
+    while (true) {
+      if ((seq & 1) == 0 &&
+          seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire)) {
+        break;
+      }
+      seq = seq_.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < NWORDS; i++) {
+      words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+};
+
 template<class T, void (T::*on_enter)()>
 struct LockGuard {
   T& lock;
@@ -53,10 +175,15 @@ struct LockGuard {
 };
 
 using UniqueLock = LockGuard<RWLock, &RWLock::wrlock>;
-using SharedLock = LockGuard<RWLock, &RWLock::wrlock>;
+using SharedLock = LockGuard<RWLock, &RWLock::rdlock>;
 using ReadLockGuard = LockGuard<RWLock, &RWLock::rdlock>;
 using WriteLockGuard = LockGuard<RWLock, &RWLock::wrlock>;
 
+using BiasedUniqueLock = LockGuard<BiasedRWLock, &BiasedRWLock::wrlock>;
+using BiasedSharedLock = LockGuard<BiasedRWLock, &BiasedRWLock::rdlock>;
+using BiasedReadLockGuard = LockGuard<BiasedRWLock, &BiasedRWLock::rdlock>;
+using BiasedWriteLockGuard = LockGuard<BiasedRWLock, &BiasedRWLock::wrlock>;
+
 }  // namespace common
 }  // namespace stdb
 
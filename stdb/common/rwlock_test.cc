@@ -3,6 +3,9 @@
  */
 #include "stdb/common/rwlock.h"
 
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace stdb {
@@ -15,5 +18,98 @@ TEST(TestRWLock, Test) {
   rwlock.unlock();
 }
 
+TEST(TestBiasedRWLock, Test_read_write) {
+  BiasedRWLock rwlock;
+
+  rwlock.rdlock();
+  EXPECT_FALSE(rwlock.try_wrlock());
+  rwlock.unlock();
+
+  rwlock.wrlock();
+  EXPECT_FALSE(rwlock.try_rdlock());
+  rwlock.unlock();
+
+  // Bias should be restored after inhibition period
+  for (int i = 0; i < 10; i++) {
+    BiasedReadLockGuard guard(rwlock);
+  }
+  EXPECT_TRUE(rwlock.try_wrlock());
+  rwlock.unlock();
+}
+
+TEST(TestBiasedRWLock, Test_nested_read) {
+  BiasedRWLock lock1;
+  BiasedRWLock lock2;
+  lock1.rdlock();
+  lock1.rdlock();
+  lock2.rdlock();
+  lock1.unlock();
+  lock2.unlock();
+  lock1.unlock();
+  EXPECT_TRUE(lock1.try_wrlock());
+  EXPECT_TRUE(lock2.try_wrlock());
+  lock1.unlock();
+  lock2.unlock();
+}
+
+TEST(TestBiasedRWLock, Test_concurrent) {
+  BiasedRWLock rwlock;
+  u64 values[2] = { 0, 0 };
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 10000; j++) {
+        if (i == 0 && j % 10 == 0) {
+          BiasedWriteLockGuard guard(rwlock);
+          values[0]++;
+          values[1]++;
+        } else {
+          BiasedReadLockGuard guard(rwlock);
+          if (values[0] != values[1]) {
+            failed = true;
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(failed.load());
+  EXPECT_EQ(1000u, values[0]);
+}
+
+TEST(TestSeqLock, Test_concurrent) {
+  struct State {
+    u64 a;
+    u64 b;
+    u32 c;
+  };
+  SeqLock<State> lock(State{0, 0, 0});
+  std::atomic<bool> done{false};
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        State s = lock.load();
+        if (s.a != s.b || s.a != s.c) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for (u32 i = 1; i <= 100000; i++) {
+    lock.store(State{i, i, i});
+  }
+  done = true;
+  for (auto& thread : readers) {
+    thread.join();
+  }
+  EXPECT_FALSE(failed.load());
+  EXPECT_EQ(100000u, lock.load().c);
+}
+
 }  // namespace common
 }  // namespace stdb
@@ -0,0 +1,842 @@
+/*!
+ * \file columnar_writer.cc
+ */
+#include "stdb/core/columnar_writer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+namespace stdb {
+
+namespace {
+
+//! Names of the value columns
+std::vector<std::string> value_column_names(ColumnarSchema const& schema) {
+  std::vector<std::string> names;
+  if (schema.nvalues == 1) {
+    names.push_back("value");
+  } else {
+    for (u32 i = 0; i < schema.nvalues; i++) {
+      names.push_back("value_" + std::to_string(i));
+    }
+  }
+  return names;
+}
+
+template <class T>
+void append_pod(T value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// ///////////////// //
+// FlatBufferBuilder //
+// ///////////////// //
+
+/** Minimal flatbuffers builder (enough to encode Arrow IPC metadata).
+ * Buffer is built back to front, objects are addressed by the offset
+ * from the end of the buffer. Child objects should be created before
+ * the table that refers to them.
+ */
+class FlatBufferBuilder {
+  std::vector<u8> buf_;  // data occupies the tail of the vector
+  size_t size_;
+  size_t minalign_;
+  size_t table_start_;
+  std::vector<std::pair<u16, size_t>> fields_;
+
+  u8* front() {
+    return buf_.data() + buf_.size() - size_;
+  }
+
+  void grow(size_t n) {
+    if (size_ + n > buf_.size()) {
+      std::vector<u8> tmp(std::max(buf_.size() * 2, size_ + n));
+      memcpy(tmp.data() + tmp.size() - size_, front(), size_);
+      buf_.swap(tmp);
+    }
+    size_ += n;
+  }
+
+ public:
+  FlatBufferBuilder()
+      : buf_(0x200)
+      , size_(0)
+      , minalign_(1)
+      , table_start_(0)
+  {
+  }
+
+  void push_bytes(const void* data, size_t n) {
+    grow(n);
+    memcpy(front(), data, n);
+  }
+
+  //! Add padding so the next `extra` bytes will end up aligned
+  void align(size_t alignment, size_t extra = 0) {
+    minalign_ = std::max(minalign_, alignment);
+    size_t pad = (alignment - (size_ + extra) % alignment) % alignment;
+    grow(pad);
+    memset(front(), 0, pad);
+  }
+
+  template <class T>
+  void push(T value) {
+    align(sizeof(T));
+    push_bytes(&value, sizeof(T));
+  }
+
+  void push_offset(size_t offset) {
+    align(4);
+    push(static_cast<u32>(size_ + 4 - offset));
+  }
+
+  size_t create_string(std::string const& str) {
+    align(4, str.size() + 1);
+    push<u8>(0);
+    push_bytes(str.data(), str.size());
+    push(static_cast<u32>(str.size()));
+    return size_;
+  }
+
+  size_t create_vector(std::vector<size_t> const& offsets) {
+    align(4, offsets.size() * 4);
+    for (auto it = offsets.rbegin(); it != offsets.rend(); it++) {
+      push_offset(*it);
+    }
+    push(static_cast<u32>(offsets.size()));
+    return size_;
+  }
+
+  //! Create vector of structs that consist of 64-bit fields
+  size_t create_struct_vector(std::vector<i64> const& fields, size_t fields_per_struct) {
+    size_t nbytes = fields.size() * sizeof(i64);
+    align(8, nbytes);
+    push_bytes(fields.data(), nbytes);
+    push(static_cast<u32>(fields.size() / fields_per_struct));
+    return size_;
+  }
+
+  void start_table() {
+    fields_.clear();
+    table_start_ = size_;
+  }
+
+  template <class T>
+  void add_scalar(u16 slot, T value) {
+    push(value);
+    fields_.emplace_back(slot, size_);
+  }
+
+  void add_offset(u16 slot, size_t offset) {
+    push_offset(offset);
+    fields_.emplace_back(slot, size_);
+  }
+
+  size_t end_table() {
+    push<i32>(0);  // placeholder for the vtable offset
+    size_t table = size_;
+    u16 nslots = 0;
+    for (auto const& field : fields_) {
+      nslots = std::max(nslots, static_cast<u16>(field.first + 1));
+    }
+    std::vector<u16> vtable(nslots, 0);
+    for (auto const& field : fields_) {
+      vtable[field.first] = static_cast<u16>(table - field.second);
+    }
+    for (auto it = vtable.rbegin(); it != vtable.rend(); it++) {
+      push(*it);
+    }
+    push(static_cast<u16>(table - table_start_));
+    push(static_cast<u16>((nslots + 2) * sizeof(u16)));
+    i32 vtable_offset = static_cast<i32>(size_ - table);
+    memcpy(buf_.data() + buf_.size() - table, &vtable_offset, sizeof(vtable_offset));
+    return table;
+  }
+
+  std::string finish(size_t root) {
+    align(minalign_, 4);
+    push_offset(root);
+    return std::string(reinterpret_cast<const char*>(front()), size_);
+  }
+};
+
+// ///////////////// //
+// ArrowStreamWriter //
+// ///////////////// //
+
+enum {
+  ARROW_METADATA_V5 = 4,
+  ARROW_HEADER_SCHEMA = 1,
+  ARROW_HEADER_DICTIONARY_BATCH = 2,
+  ARROW_HEADER_RECORD_BATCH = 3,
+  ARROW_TYPE_INT = 2,
+  ARROW_TYPE_FLOATING_POINT = 3,
+  ARROW_TYPE_UTF8 = 5,
+  ARROW_TYPE_TIMESTAMP = 10,
+  ARROW_PRECISION_SINGLE = 1,
+  ARROW_PRECISION_DOUBLE = 2,
+  ARROW_TIME_UNIT_NANOSECOND = 3,
+  ARROW_CONTINUATION = -1,
+  ARROW_ALIGNMENT = 8,
+};
+
+class ArrowStreamWriter : public ColumnarWriter {
+  ColumnarSchema schema_;
+  bool header_written_;
+  //! Number of dictionary entries that were sent
+  size_t dict_sent_;
+  //! Message body and its buffers (offset, length pairs)
+  std::string body_;
+  std::vector<i64> buffers_;
+  std::vector<i64> nodes_;
+
+  void add_buffer(const void* data, size_t size) {
+    buffers_.push_back(static_cast<i64>(body_.size()));
+    buffers_.push_back(static_cast<i64>(size));
+    if (size != 0) {
+      body_.append(reinterpret_cast<const char*>(data), size);
+    }
+    body_.append((ARROW_ALIGNMENT - body_.size() % ARROW_ALIGNMENT) % ARROW_ALIGNMENT, '\0');
+  }
+
+  void add_node(size_t length, size_t null_count) {
+    nodes_.push_back(static_cast<i64>(length));
+    nodes_.push_back(static_cast<i64>(null_count));
+  }
+
+  static size_t make_field(FlatBufferBuilder* fb, std::string const& name, bool nullable,
+                           u8 type_id, size_t type, size_t dictionary) {
+    size_t name_offset = fb->create_string(name);
+    size_t children = fb->create_vector({});
+    fb->start_table();
+    fb->add_offset(0, name_offset);
+    fb->add_scalar<u8>(1, nullable);
+    fb->add_scalar<u8>(2, type_id);
+    fb->add_offset(3, type);
+    if (dictionary != 0) {
+      fb->add_offset(4, dictionary);
+    }
+    fb->add_offset(5, children);
+    return fb->end_table();
+  }
+
+  static size_t make_float_type(FlatBufferBuilder* fb, i16 precision) {
+    fb->start_table();
+    fb->add_scalar<i16>(0, precision);
+    return fb->end_table();
+  }
+
+  //! Create RecordBatch table from the collected nodes and buffers
+  size_t make_record_batch(FlatBufferBuilder* fb, size_t length) {
+    size_t nodes = fb->create_struct_vector(nodes_, 2);
+    size_t buffers = fb->create_struct_vector(buffers_, 2);
+    fb->start_table();
+    fb->add_scalar<i64>(0, static_cast<i64>(length));
+    fb->add_offset(1, nodes);
+    fb->add_offset(2, buffers);
+    return fb->end_table();
+  }
+
+  //! Write the message and the collected body, reset the body
+  void write_message(FlatBufferBuilder* fb, u8 header_type, size_t header, std::string* out) {
+    fb->start_table();
+    fb->add_scalar<i16>(0, ARROW_METADATA_V5);
+    fb->add_scalar<u8>(1, header_type);
+    fb->add_offset(2, header);
+    fb->add_scalar<i64>(3, static_cast<i64>(body_.size()));
+    std::string metadata = fb->finish(fb->end_table());
+    metadata.append((ARROW_ALIGNMENT - metadata.size() % ARROW_ALIGNMENT) % ARROW_ALIGNMENT, '\0');
+    append_pod<i32>(ARROW_CONTINUATION, out);
+    append_pod<i32>(static_cast<i32>(metadata.size()), out);
+    out->append(metadata);
+    out->append(body_);
+    body_.clear();
+    buffers_.clear();
+    nodes_.clear();
+  }
+
+  void write_schema(std::string* out) {
+    FlatBufferBuilder fb;
+    std::vector<size_t> fields;
+
+    // Series names are dictionary encoded, indexes are int32
+    fb.start_table();
+    size_t utf8 = fb.end_table();
+    fb.start_table();
+    fb.add_scalar<i32>(0, 32);
+    fb.add_scalar<u8>(1, 1);
+    size_t index_type = fb.end_table();
+    fb.start_table();
+    fb.add_scalar<i64>(0, 0);
+    fb.add_offset(1, index_type);
+    size_t encoding = fb.end_table();
+    fields.push_back(make_field(&fb, "series", false, ARROW_TYPE_UTF8, utf8, encoding));
+
+    fb.start_table();
+    fb.add_scalar<i16>(0, ARROW_TIME_UNIT_NANOSECOND);
+    size_t timestamp = fb.end_table();
+    fields.push_back(make_field(&fb, "timestamp", false, ARROW_TYPE_TIMESTAMP, timestamp, 0));
+
+    for (auto const& name : value_column_names(schema_)) {
+      size_t type = make_float_type(&fb, ARROW_PRECISION_DOUBLE);
+      fields.push_back(make_field(&fb, name, true, ARROW_TYPE_FLOATING_POINT, type, 0));
+    }
+    if (schema_.location) {
+      for (auto name : { "lon", "lat" }) {
+        size_t type = make_float_type(&fb, ARROW_PRECISION_SINGLE);
+        fields.push_back(make_field(&fb, name, false, ARROW_TYPE_FLOATING_POINT, type, 0));
+      }
+    }
+    size_t field_vec = fb.create_vector(fields);
+    fb.start_table();
+    fb.add_offset(1, field_vec);
+    size_t schema = fb.end_table();
+    write_message(&fb, ARROW_HEADER_SCHEMA, schema, out);
+  }
+
+  void write_dictionary(std::vector<const std::string*> const& dictionary, std::string* out) {
+    size_t count = dictionary.size() - dict_sent_;
+    std::vector<i32> offsets;
+    offsets.reserve(count + 1);
+    std::string data;
+    offsets.push_back(0);
+    for (size_t i = dict_sent_; i < dictionary.size(); i++) {
+      data += *dictionary[i];
+      offsets.push_back(static_cast<i32>(data.size()));
+    }
+    add_node(count, 0);
+    add_buffer(nullptr, 0);
+    add_buffer(offsets.data(), offsets.size() * sizeof(i32));
+    add_buffer(data.data(), data.size());
+
+    FlatBufferBuilder fb;
+    size_t batch = make_record_batch(&fb, count);
+    fb.start_table();
+    fb.add_scalar<i64>(0, 0);
+    fb.add_offset(1, batch);
+    fb.add_scalar<u8>(2, dict_sent_ != 0);
+    size_t header = fb.end_table();
+    write_message(&fb, ARROW_HEADER_DICTIONARY_BATCH, header, out);
+    dict_sent_ = dictionary.size();
+  }
+
+ public:
+  explicit ArrowStreamWriter(ColumnarSchema const& schema)
+      : schema_(schema)
+      , header_written_(false)
+      , dict_sent_(0)
+  {
+  }
+
+  void write_batch(ColumnBatch const& batch, std::vector<const std::string*> const& dictionary,
+                   std::string* out) override {
+    if (!header_written_) {
+      write_schema(out);
+      header_written_ = true;
+      write_dictionary(dictionary, out);
+    } else if (dict_sent_ != dictionary.size()) {
+      write_dictionary(dictionary, out);
+    }
+    const size_t nrows = batch.size();
+    add_node(nrows, 0);
+    add_buffer(nullptr, 0);
+    add_buffer(batch.series.data(), nrows * sizeof(u32));
+    add_node(nrows, 0);
+    add_buffer(nullptr, 0);
+    add_buffer(batch.timestamps.data(), nrows * sizeof(i64));
+    for (u32 i = 0; i < schema_.nvalues; i++) {
+      add_node(nrows, batch.null_count[i]);
+      if (batch.null_count[i] != 0) {
+        add_buffer(batch.validity[i].data(), batch.validity[i].size());
+      } else {
+        add_buffer(nullptr, 0);
+      }
+      add_buffer(batch.values[i].data(), nrows * sizeof(double));
+    }
+    if (schema_.location) {
+      add_node(nrows, 0);
+      add_buffer(nullptr, 0);
+      add_buffer(batch.lon.data(), nrows * sizeof(float));
+      add_node(nrows, 0);
+      add_buffer(nullptr, 0);
+      add_buffer(batch.lat.data(), nrows * sizeof(float));
+    }
+    FlatBufferBuilder fb;
+    size_t header = make_record_batch(&fb, nrows);
+    write_message(&fb, ARROW_HEADER_RECORD_BATCH, header, out);
+  }
+
+  void finish(std::string* out) override {
+    if (!header_written_) {
+      write_schema(out);
+      header_written_ = true;
+    }
+    append_pod<i32>(ARROW_CONTINUATION, out);
+    append_pod<i32>(0, out);
+  }
+};
+
+// //////////////////// //
+// ThriftCompactWriter  //
+// //////////////////// //
+
+enum {
+  THRIFT_BOOL_TRUE = 1,
+  THRIFT_BOOL_FALSE = 2,
+  THRIFT_I32 = 5,
+  THRIFT_I64 = 6,
+  THRIFT_BINARY = 8,
+  THRIFT_LIST = 9,
+  THRIFT_STRUCT = 12,
+};
+
+//! Thrift compact protocol encoder (used for Parquet metadata)
+class ThriftCompactWriter {
+  std::string* out_;
+  std::vector<i16> stack_;
+  i16 last_field_;
+
+  void field(i16 id, u8 type) {
+    i16 delta = id - last_field_;
+    if (delta > 0 && delta <= 15) {
+      out_->push_back(static_cast<char>((delta << 4) | type));
+    } else {
+      out_->push_back(static_cast<char>(type));
+      varint(zigzag(id));
+    }
+    last_field_ = id;
+  }
+
+  static u64 zigzag(i64 value) {
+    return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63);
+  }
+
+ public:
+  explicit ThriftCompactWriter(std::string* out)
+      : out_(out)
+      , last_field_(0)
+  {
+  }
+
+  void varint(u64 value) {
+    while (value >= 0x80) {
+      out_->push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    out_->push_back(static_cast<char>(value));
+  }
+
+  void begin_struct() {
+    stack_.push_back(last_field_);
+    last_field_ = 0;
+  }
+
+  void end_struct() {
+    out_->push_back(0);
+    last_field_ = stack_.back();
+    stack_.pop_back();
+  }
+
+  void field_i32(i16 id, i32 value) {
+    field(id, THRIFT_I32);
+    varint(zigzag(value));
+  }
+
+  void field_i64(i16 id, i64 value) {
+    field(id, THRIFT_I64);
+    varint(zigzag(value));
+  }
+
+  void field_bool(i16 id, bool value) {
+    field(id, value ? THRIFT_BOOL_TRUE : THRIFT_BOOL_FALSE);
+  }
+
+  void field_string(i16 id, std::string const& value) {
+    field(id, THRIFT_BINARY);
+    binary(value);
+  }
+
+  void field_struct(i16 id) {
+    field(id, THRIFT_STRUCT);
+    begin_struct();
+  }
+
+  void field_list(i16 id, u8 elem_type, size_t size) {
+    field(id, THRIFT_LIST);
+    if (size < 15) {
+      out_->push_back(static_cast<char>((size << 4) | elem_type));
+    } else {
+      out_->push_back(static_cast<char>(0xF0 | elem_type));
+      varint(size);
+    }
+  }
+
+  void list_i32(i32 value) {
+    varint(zigzag(value));
+  }
+
+  void binary(std::string const& value) {
+    varint(value.size());
+    out_->append(value);
+  }
+};
+
+// ///////////// //
+// ParquetWriter //
+// ///////////// //
+
+enum {
+  PARQUET_INT64 = 2,
+  PARQUET_FLOAT = 4,
+  PARQUET_DOUBLE = 5,
+  PARQUET_BYTE_ARRAY = 6,
+  PARQUET_REQUIRED = 0,
+  PARQUET_OPTIONAL = 1,
+  PARQUET_UTF8 = 0,
+  PARQUET_PLAIN = 0,
+  PARQUET_RLE = 3,
+  PARQUET_RLE_DICTIONARY = 8,
+  PARQUET_DATA_PAGE = 0,
+  PARQUET_DICTIONARY_PAGE = 2,
+};
+
+static const char PARQUET_MAGIC[] = "PAR1";
+
+class ParquetWriter : public ColumnarWriter {
+  struct ColumnChunkInfo {
+    i32 type;
+    std::string name;
+    i64 dictionary_page_offset;  // -1 if not dictionary encoded
+    i64 data_page_offset;
+    i64 size;
+    i64 num_values;
+  };
+
+  struct RowGroupInfo {
+    i64 num_rows;
+    i64 size;
+    std::vector<ColumnChunkInfo> columns;
+  };
+
+  ColumnarSchema schema_;
+  std::vector<std::string> value_names_;
+  //! Number of bytes written
+  i64 offset_;
+  i64 num_rows_;
+  std::vector<RowGroupInfo> row_groups_;
+  std::string page_;
+
+  void write_header(std::string* out) {
+    out->append(PARQUET_MAGIC, 4);
+    offset_ = 4;
+  }
+
+  //! Write page from `page_`, return its offset
+  i64 write_page(i32 page_type, i32 num_values, i32 encoding, std::string* out) {
+    std::string header;
+    ThriftCompactWriter thrift(&header);
+    thrift.begin_struct();
+    thrift.field_i32(1, page_type);
+    thrift.field_i32(2, static_cast<i32>(page_.size()));
+    thrift.field_i32(3, static_cast<i32>(page_.size()));
+    if (page_type == PARQUET_DICTIONARY_PAGE) {
+      thrift.field_struct(7);
+      thrift.field_i32(1, num_values);
+      thrift.field_i32(2, encoding);
+      thrift.end_struct();
+    } else {
+      thrift.field_struct(5);
+      thrift.field_i32(1, num_values);
+      thrift.field_i32(2, encoding);
+      thrift.field_i32(3, PARQUET_RLE);
+      thrift.field_i32(4, PARQUET_RLE);
+      thrift.end_struct();
+    }
+    thrift.end_struct();
+    i64 offset = offset_;
+    out->append(header);
+    out->append(page_);
+    offset_ += static_cast<i64>(header.size() + page_.size());
+    page_.clear();
+    return offset;
+  }
+
+  //! Write column chunk that consists of one plain encoded data page
+  template <class T>
+  ColumnChunkInfo write_plain(i32 type, std::string const& name, std::vector<T> const& values,
+                              std::string* out) {
+    ColumnChunkInfo info = { type, name, -1, 0, 0, static_cast<i64>(values.size()) };
+    i64 begin = offset_;
+    page_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    info.data_page_offset = write_page(PARQUET_DATA_PAGE, static_cast<i32>(values.size()), PARQUET_PLAIN, out);
+    info.size = offset_ - begin;
+    return info;
+  }
+
+  //! Bit-packed run of RLE/bit-packing hybrid encoding
+  void bit_pack(const u32* values, size_t size, int width) {
+    size_t groups = (size + 7) / 8;
+    ThriftCompactWriter(&page_).varint((groups << 1) | 1);
+    u64 acc = 0;
+    int nbits = 0;
+    for (size_t i = 0; i < groups * 8; i++) {
+      u64 value = i < size ? values[i] : 0;
+      acc |= value << nbits;
+      nbits += width;
+      while (nbits >= 8) {
+        page_.push_back(static_cast<char>(acc & 0xFF));
+        acc >>= 8;
+        nbits -= 8;
+      }
+    }
+  }
+
+  ColumnChunkInfo write_series(ColumnBatch const& batch, std::vector<const std::string*> const& dictionary,
+                               std::string* out) {
+    ColumnChunkInfo info = { PARQUET_BYTE_ARRAY, "series", 0, 0, 0, static_cast<i64>(batch.size()) };
+    i64 begin = offset_;
+    // Row group dictionary contains only the names used by the row group
+    std::unordered_map<u32, u32> local;
+    std::vector<u32> indexes;
+    indexes.reserve(batch.size());
+    for (auto code : batch.series) {
+      auto it = local.find(code);
+      if (it == local.end()) {
+        auto const& name = *dictionary[code];
+        append_pod<u32>(static_cast<u32>(name.size()), &page_);
+        page_.append(name);
+        it = local.emplace(code, static_cast<u32>(local.size())).first;
+      }
+      indexes.push_back(it->second);
+    }
+    info.dictionary_page_offset = write_page(PARQUET_DICTIONARY_PAGE, static_cast<i32>(local.size()),
+                                             PARQUET_PLAIN, out);
+    int width = 1;
+    while (width < 32 && (static_cast<u64>(1) << width) < local.size()) {
+      width++;
+    }
+    page_.push_back(static_cast<char>(width));
+    bit_pack(indexes.data(), indexes.size(), width);
+    info.data_page_offset = write_page(PARQUET_DATA_PAGE, static_cast<i32>(indexes.size()),
+                                       PARQUET_RLE_DICTIONARY, out);
+    info.size = offset_ - begin;
+    return info;
+  }
+
+  ColumnChunkInfo write_values(ColumnBatch const& batch, u32 column, std::string* out) {
+    ColumnChunkInfo info = { PARQUET_DOUBLE, value_names_[column], -1, 0, 0, static_cast<i64>(batch.size()) };
+    i64 begin = offset_;
+    // Definition levels, validity bitmap is a bit-packed run of width 1
+    auto const& validity = batch.validity[column];
+    std::string levels;
+    ThriftCompactWriter(&levels).varint((validity.size() << 1) | 1);
+    levels.append(reinterpret_cast<const char*>(validity.data()), validity.size());
+    append_pod<u32>(static_cast<u32>(levels.size()), &page_);
+    page_.append(levels);
+    // Only non-null values are stored
+    auto const& values = batch.values[column];
+    if (batch.null_count[column] == 0) {
+      page_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+    } else {
+      for (size_t i = 0; i < values.size(); i++) {
+        if (validity[i / 8] & (1 << (i % 8))) {
+          append_pod(values[i], &page_);
+        }
+      }
+    }
+    info.data_page_offset = write_page(PARQUET_DATA_PAGE, static_cast<i32>(values.size()), PARQUET_PLAIN, out);
+    info.size = offset_ - begin;
+    return info;
+  }
+
+  void write_schema_element(ThriftCompactWriter* thrift, i32 type, i32 repetition, std::string const& name) {
+    thrift->begin_struct();
+    thrift->field_i32(1, type);
+    thrift->field_i32(3, repetition);
+    thrift->field_string(4, name);
+    if (type == PARQUET_BYTE_ARRAY) {
+      thrift->field_i32(6, PARQUET_UTF8);
+      // LogicalType.STRING
+      thrift->field_struct(10);
+      thrift->field_struct(1);
+      thrift->end_struct();
+      thrift->end_struct();
+    } else if (type == PARQUET_INT64) {
+      // LogicalType.TIMESTAMP(isAdjustedToUTC=false, unit=NANOS)
+      thrift->field_struct(10);
+      thrift->field_struct(8);
+      thrift->field_bool(1, false);
+      thrift->field_struct(2);
+      thrift->field_struct(3);
+      thrift->end_struct();
+      thrift->end_struct();
+      thrift->end_struct();
+      thrift->end_struct();
+    }
+    thrift->end_struct();
+  }
+
+  void write_footer(std::string* out) {
+    std::string footer;
+    ThriftCompactWriter thrift(&footer);
+    thrift.begin_struct();
+    thrift.field_i32(1, 1);
+    const size_t ncolumns = 2 + value_names_.size() + (schema_.location ? 2 : 0);
+    thrift.field_list(2, THRIFT_STRUCT, ncolumns + 1);
+    thrift.begin_struct();
+    thrift.field_string(4, "schema");
+    thrift.field_i32(5, static_cast<i32>(ncolumns));
+    thrift.end_struct();
+    write_schema_element(&thrift, PARQUET_BYTE_ARRAY, PARQUET_REQUIRED, "series");
+    write_schema_element(&thrift, PARQUET_INT64, PARQUET_REQUIRED, "timestamp");
+    for (auto const& name : value_names_) {
+      write_schema_element(&thrift, PARQUET_DOUBLE, PARQUET_OPTIONAL, name);
+    }
+    if (schema_.location) {
+      write_schema_element(&thrift, PARQUET_FLOAT, PARQUET_REQUIRED, "lon");
+      write_schema_element(&thrift, PARQUET_FLOAT, PARQUET_REQUIRED, "lat");
+    }
+    thrift.field_i64(3, num_rows_);
+    thrift.field_list(4, THRIFT_STRUCT, row_groups_.size());
+    for (auto const& group : row_groups_) {
+      thrift.begin_struct();
+      thrift.field_list(1, THRIFT_STRUCT, group.columns.size());
+      for (auto const& column : group.columns) {
+        const bool dict = column.dictionary_page_offset >= 0;
+        thrift.begin_struct();
+        thrift.field_i64(2, dict ? column.dictionary_page_offset : column.data_page_offset);
+        thrift.field_struct(3);
+        thrift.field_i32(1, column.type);
+        thrift.field_list(2, THRIFT_I32, dict ? 3 : 2);
+        thrift.list_i32(PARQUET_PLAIN);
+        thrift.list_i32(PARQUET_RLE);
+        if (dict) {
+          thrift.list_i32(PARQUET_RLE_DICTIONARY);
+        }
+        thrift.field_list(3, THRIFT_BINARY, 1);
+        thrift.binary(column.name);
+        thrift.field_i32(4, 0);  // uncompressed
+        thrift.field_i64(5, column.num_values);
+        thrift.field_i64(6, column.size);
+        thrift.field_i64(7, column.size);
+        thrift.field_i64(9, column.data_page_offset);
+        if (dict) {
+          thrift.field_i64(11, column.dictionary_page_offset);
+        }
+        thrift.end_struct();
+        thrift.end_struct();
+      }
+      thrift.field_i64(2, group.size);
+      thrift.field_i64(3, group.num_rows);
+      thrift.end_struct();
+    }
+    thrift.field_string(6, "stdb");
+    thrift.end_struct();
+    out->append(footer);
+    append_pod<u32>(static_cast<u32>(footer.size()), out);
+    out->append(PARQUET_MAGIC, 4);
+  }
+
+ public:
+  explicit ParquetWriter(ColumnarSchema const& schema)
+      : schema_(schema)
+      , value_names_(value_column_names(schema))
+      , offset_(0)
+      , num_rows_(0)
+  {
+  }
+
+  void write_batch(ColumnBatch const& batch, std::vector<const std::string*> const& dictionary,
+                   std::string* out) override {
+    if (offset_ == 0) {
+      write_header(out);
+    }
+    RowGroupInfo group;
+    group.num_rows = static_cast<i64>(batch.size());
+    i64 begin = offset_;
+    group.columns.push_back(write_series(batch, dictionary, out));
+    group.columns.push_back(write_plain(PARQUET_INT64, "timestamp", batch.timestamps, out));
+    for (u32 i = 0; i < schema_.nvalues; i++) {
+      group.columns.push_back(write_values(batch, i, out));
+    }
+    if (schema_.location) {
+      group.columns.push_back(write_plain(PARQUET_FLOAT, "lon", batch.lon, out));
+      group.columns.push_back(write_plain(PARQUET_FLOAT, "lat", batch.lat, out));
+    }
+    group.size = offset_ - begin;
+    num_rows_ += group.num_rows;
+    row_groups_.push_back(std::move(group));
+  }
+
+  void finish(std::string* out) override {
+    if (offset_ == 0) {
+      write_header(out);
+    }
+    write_footer(out);
+  }
+};
+
+}  // namespace
+
+// /////////// //
+// ColumnBatch //
+// /////////// //
+
+ColumnBatch::ColumnBatch(ColumnarSchema const& schema)
+    : schema(schema)
+    , values(schema.nvalues)
+    , validity(schema.nvalues)
+    , null_count(schema.nvalues, 0)
+{
+}
+
+void ColumnBatch::append(u32 series_index, Timestamp ts, const double* xs, u64 bitmap, Location const& location) {
+  const size_t row = series.size();
+  series.push_back(series_index);
+  timestamps.push_back(static_cast<i64>(ts));
+  for (u32 i = 0; i < schema.nvalues; i++) {
+    if (row % 8 == 0) {
+      validity[i].push_back(0);
+    }
+    if (bitmap & (static_cast<u64>(1) << i)) {
+      values[i].push_back(xs[i]);
+      validity[i].back() |= static_cast<u8>(1 << (row % 8));
+    } else {
+      values[i].push_back(0.0);
+      null_count[i]++;
+    }
+  }
+  if (schema.location) {
+    lon.push_back(location.lon);
+    lat.push_back(location.lat);
+  }
+}
+
+size_t ColumnBatch::size() const {
+  return series.size();
+}
+
+void ColumnBatch::clear() {
+  series.clear();
+  timestamps.clear();
+  for (u32 i = 0; i < schema.nvalues; i++) {
+    values[i].clear();
+    validity[i].clear();
+    null_count[i] = 0;
+  }
+  lon.clear();
+  lat.clear();
+}
+
+std::unique_ptr<ColumnarWriter> make_arrow_writer(ColumnarSchema const& schema) {
+  return std::unique_ptr<ColumnarWriter>(new ArrowStreamWriter(schema));
+}
+
+std::unique_ptr<ColumnarWriter> make_parquet_writer(ColumnarSchema const& schema) {
+  return std::unique_ptr<ColumnarWriter>(new ParquetWriter(schema));
+}
+
+}  // namespace stdb
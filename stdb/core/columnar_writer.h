@@ -0,0 +1,83 @@
+/*!
+ * \file columnar_writer.h
+ */
+#ifndef STDB_CORE_COLUMNAR_WRITER_H_
+#define STDB_CORE_COLUMNAR_WRITER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stdb/common/basic.h"
+
+namespace stdb {
+
+//! Columns of the query results
+struct ColumnarSchema {
+  u32 nvalues;    //! Number of value columns (tuple size)
+  bool location;  //! Add lon/lat columns
+};
+
+/** Batch of rows stored column-wise.
+ * Series column stores indexes in the series names dictionary,
+ * value columns are nullable (tuples can have missing elements).
+ */
+struct ColumnBatch {
+  ColumnarSchema schema;
+  std::vector<u32> series;
+  std::vector<i64> timestamps;
+  std::vector<std::vector<double>> values;
+  std::vector<std::vector<u8>> validity;  //! Bitmap of every value column (LSB first)
+  std::vector<u32> null_count;
+  std::vector<float> lon;
+  std::vector<float> lat;
+
+  explicit ColumnBatch(ColumnarSchema const& schema);
+
+  /** Add row.
+   * @param values is an array of `nvalues` values
+   * @param bitmap has a bit set for every value that is present
+   */
+  void append(u32 series_index, Timestamp ts, const double* values, u64 bitmap, Location const& location);
+
+  size_t size() const;
+
+  void clear();
+};
+
+/** Encodes column batches.
+ * Output is produced incrementally so only one batch is kept in memory.
+ * First batch is preceded by the file (or stream) header.
+ */
+class ColumnarWriter {
+ public:
+  virtual ~ColumnarWriter() = default;
+
+  /** Encode the batch.
+   * @param dictionary contains names of all series seen so far, rows refer to
+   *        the names by index, new names are appended to the end
+   */
+  virtual void write_batch(ColumnBatch const& batch,
+                           std::vector<const std::string*> const& dictionary,
+                           std::string* out) = 0;
+
+  //! Write end of stream (or file footer)
+  virtual void finish(std::string* out) = 0;
+};
+
+/** Arrow IPC streaming format writer.
+ * Series names are sent as a dictionary, every record batch is preceded by
+ * the delta dictionary batch with names that weren't sent before.
+ */
+std::unique_ptr<ColumnarWriter> make_arrow_writer(ColumnarSchema const& schema);
+
+/** Parquet file writer.
+ * Every batch is written as a row group, pages are not compressed.
+ * Series column is dictionary encoded, dictionary page contains only the
+ * names used by the row group.
+ */
+std::unique_ptr<ColumnarWriter> make_parquet_writer(ColumnarSchema const& schema);
+
+}  // namespace stdb
+
+#endif  // STDB_CORE_COLUMNAR_WRITER_H_
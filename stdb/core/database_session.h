@@ -4,9 +4,12 @@
 #ifndef STDB_CORE_DATABASE_SESSION_H_
 #define STDB_CORE_DATABASE_SESSION_H_
 
+#include <string>
+
 #include "stdb/common/basic.h"
 
 #include "stdb/query/internal_cursor.h"
+#include "stdb/query/prepared_query.h"
 
 namespace stdb {
 
@@ -64,6 +67,24 @@ class DatabaseSession {
    * @param query is a string that contains query
    */
   virtual void search(InternalCursor* cursor, const char* query) = 0;
+
+  /**
+   * @brief Register query template (see qp::PreparedQuery)
+   * Same template always gets the same id.
+   * @param query is a json query template
+   * @param id is an output parameter, id of the prepared query
+   * @param error is an output parameter, error message
+   * @return operation status
+   */
+  virtual common::Status prepare(const char* query, u64* id, std::string* error) = 0;
+
+  /**
+   * @brief Execute prepared query
+   * @param cursor is a pointer to internal cursor
+   * @param id is an id returned by `prepare`
+   * @param params are the values of the template slots
+   */
+  virtual void execute(InternalCursor* cursor, u64 id, qp::QueryParameters const& params) = 0;
 };
 
 }  // namespace stdb
@@ -0,0 +1,415 @@
+/*!
+ * \file query_results_formatter.cc
+ */
+#include "stdb/core/query_results_formatter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "stdb/common/datetime.h"
+#include "stdb/query/queryparser.h"
+
+namespace stdb {
+
+namespace {
+enum {
+  RDBUF_SIZE = 0x4000,
+  NAME_BUFFER_SIZE = 0x400,
+  MAX_TUPLE_SIZE = 64,
+};
+
+//! Write decimal representation of the value, return number of characters
+int format_u64(u64 value, char* buf) {
+  char tmp[20];
+  int len = 0;
+  do {
+    tmp[len++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  for (int i = 0; i < len; i++) {
+    buf[i] = tmp[len - 1 - i];
+  }
+  return len;
+}
+
+//! Append CSV field, field is quoted if it contains separators or quotes (RFC 4180)
+void append_csv_field(const char* str, size_t size, std::string* out) {
+  const char* end = str + size;
+  auto special = [](char c) {
+    return c == ',' || c == '"' || c == '\n' || c == '\r';
+  };
+  if (std::find_if(str, end, special) == end) {
+    out->append(str, size);
+    return;
+  }
+  out->push_back('"');
+  for (const char* p = str; p != end; p++) {
+    if (*p == '"') {
+      out->push_back('"');
+    }
+    out->push_back(*p);
+  }
+  out->push_back('"');
+}
+}  // namespace
+
+std::tuple<common::Status, std::string> parse_output_options(const char* query, OutputOptions* options) {
+  boost::property_tree::ptree ptree;
+  common::Status status;
+  std::string error;
+  std::tie(status, error) = qp::QueryParser::parse_json(query, &ptree);
+  if (!status.IsOk()) {
+    return std::make_tuple(status, error);
+  }
+  auto output = ptree.get_child_optional("output");
+  if (!output) {
+    return std::make_tuple(common::Status::Ok(), error);
+  }
+  try {
+    auto format = output->get_optional<std::string>("format");
+    if (format) {
+      if (*format == "resp") {
+        options->format = OutputFormat::RESP;
+      } else if (*format == "csv") {
+        options->format = OutputFormat::CSV;
+      } else if (*format == "arrow") {
+        options->format = OutputFormat::ARROW;
+      } else if (*format == "parquet") {
+        options->format = OutputFormat::PARQUET;
+      } else {
+        return std::make_tuple(common::Status::QueryParsingError(), "unknown output format " + *format);
+      }
+    }
+    auto timestamp = output->get_optional<std::string>("timestamp");
+    if (timestamp) {
+      if (*timestamp != "iso" && *timestamp != "raw") {
+        return std::make_tuple(common::Status::QueryParsingError(), "unknown timestamp format " + *timestamp);
+      }
+      options->iso_timestamps = *timestamp == "iso";
+    }
+    options->dictionary = output->get<bool>("dictionary", options->dictionary);
+    options->location = output->get<bool>("location", options->location);
+    auto batch_size = output->get<int>("batch_size", static_cast<int>(options->batch_size));
+    if (batch_size <= 0) {
+      return std::make_tuple(common::Status::QueryParsingError(), "batch_size should be positive");
+    }
+    options->batch_size = static_cast<u32>(batch_size);
+  } catch (boost::property_tree::ptree_error const& e) {
+    return std::make_tuple(common::Status::QueryParsingError(), std::string("invalid output field, ") + e.what());
+  }
+  return std::make_tuple(common::Status::Ok(), error);
+}
+
+// /////////////// //
+// CursorNameCache //
+// /////////////// //
+
+CursorNameCache::CursorNameCache(DatabaseSession* session)
+    : session_(session)
+    , buffer_(NAME_BUFFER_SIZE)
+{
+}
+
+std::string const& CursorNameCache::get(ParamId id, bool* first_seen) {
+  auto it = names_.find(id);
+  if (it != names_.end()) {
+    *first_seen = false;
+    return it->second;
+  }
+  *first_seen = true;
+  int len = session_->get_series_name(id, buffer_.data(), buffer_.size());
+  if (len < 0) {
+    // Buffer is too small, negative value is the name length
+    buffer_.resize(static_cast<size_t>(-len));
+    len = session_->get_series_name(id, buffer_.data(), buffer_.size());
+  }
+  std::string name;
+  if (len > 0) {
+    name.assign(buffer_.data(), static_cast<size_t>(len));
+  } else {
+    name = std::to_string(id);
+  }
+  return names_.emplace(id, std::move(name)).first->second;
+}
+
+size_t CursorNameCache::size() const {
+  return names_.size();
+}
+
+// ///////////////////// //
+// QueryResultsFormatter //
+// ///////////////////// //
+
+QueryResultsFormatter::QueryResultsFormatter(ExternalCursor* cursor, DatabaseSession* session,
+                                             OutputOptions const& options)
+    : cursor_(cursor)
+    , options_(options)
+    , names_(session)
+    , rdbuf_(RDBUF_SIZE)
+    , rdbuf_pos_(0)
+    , rdbuf_top_(0)
+    , outbuf_pos_(0)
+    , done_(false)
+{
+}
+
+bool QueryResultsFormatter::refill() {
+  rdbuf_pos_ = 0;
+  rdbuf_top_ = cursor_->read(rdbuf_.data(), static_cast<u32>(rdbuf_.size()));
+  if (rdbuf_top_ == 0) {
+    if (cursor_->is_error()) {
+      if (!is_columnar()) {
+        format_error();
+      }
+    } else if (is_columnar()) {
+      finish_columnar();
+    }
+    done_ = true;
+    return false;
+  }
+  return true;
+}
+
+void QueryResultsFormatter::format_error() {
+  const char* message = nullptr;
+  common::Status status;
+  cursor_->is_error(&message, &status);
+  std::string error = message != nullptr && message[0] != '\0' ? message : status.ToString();
+  outbuf_ += '-';
+  outbuf_ += error;
+  outbuf_ += options_.format == OutputFormat::RESP ? "\r\n" : "\n";
+}
+
+void QueryResultsFormatter::format_value(double value) {
+  char buf[32];
+  int len = snprintf(buf, sizeof(buf), "%.17g", value);
+  if (options_.format == OutputFormat::RESP) {
+    outbuf_ += '+';
+    outbuf_.append(buf, static_cast<size_t>(len));
+    outbuf_ += "\r\n";
+  } else {
+    outbuf_ += ',';
+    outbuf_.append(buf, static_cast<size_t>(len));
+  }
+}
+
+void QueryResultsFormatter::format_null() {
+  if (options_.format == OutputFormat::RESP) {
+    outbuf_ += "$-1\r\n";
+  } else {
+    outbuf_ += ',';
+  }
+}
+
+void QueryResultsFormatter::format_sample(Sample const& sample) {
+  const bool resp = options_.format == OutputFormat::RESP;
+  char buf[64];
+  int len;
+
+  // Series
+  bool first_seen;
+  std::string const& name = names_.get(sample.paramid, &first_seen);
+  if (options_.dictionary) {
+    len = format_u64(sample.paramid, buf);
+    if (first_seen) {
+      if (resp) {
+        outbuf_ += "*2\r\n:";
+        outbuf_.append(buf, static_cast<size_t>(len));
+        outbuf_ += "\r\n+";
+        outbuf_ += name;
+        outbuf_ += "\r\n";
+      } else {
+        outbuf_ += '#';
+        outbuf_.append(buf, static_cast<size_t>(len));
+        outbuf_ += ',';
+        append_csv_field(name.data(), name.size(), &outbuf_);
+        outbuf_ += '\n';
+      }
+    }
+    if (resp) {
+      outbuf_ += ':';
+    }
+    outbuf_.append(buf, static_cast<size_t>(len));
+  } else if (resp) {
+    outbuf_ += '+';
+    outbuf_ += name;
+  } else {
+    append_csv_field(name.data(), name.size(), &outbuf_);
+  }
+  outbuf_ += resp ? "\r\n" : ",";
+
+  // Timestamp
+  if (options_.iso_timestamps && !(sample.payload.type & PData::CUSTOM_TIMESTAMP)) {
+    len = DateTimeUtil::to_iso_string(sample.timestamp, buf, sizeof(buf)) - 1;
+    if (resp) {
+      outbuf_ += '+';
+    }
+  } else {
+    len = format_u64(sample.timestamp, buf);
+    if (resp) {
+      outbuf_ += ':';
+    }
+  }
+  if (len > 0) {
+    outbuf_.append(buf, static_cast<size_t>(len));
+  }
+  if (resp) {
+    outbuf_ += "\r\n";
+  }
+
+  // Value
+  const u16 type = sample.payload.type & ~PData::REGULLAR;
+  if ((type & PAYLOAD_TUPLE) == PAYLOAD_TUPLE) {
+    union {
+      double d;
+      u64 u;
+    } bits;
+    bits.d = sample.payload.float64;
+    u32 size = static_cast<u32>(bits.u >> 58);
+    const double* tuple = reinterpret_cast<const double*>(sample.payload.data);
+    if (resp) {
+      len = snprintf(buf, sizeof(buf), "*%u\r\n", size);
+      outbuf_.append(buf, static_cast<size_t>(len));
+    }
+    for (u32 i = 0; i < size; i++) {
+      if (bits.u & (1ull << i)) {
+        format_value(*tuple++);
+      } else {
+        format_null();
+      }
+    }
+  } else if ((type & PAYLOAD_EVENT) == PAYLOAD_EVENT) {
+    size_t size = sample.payload.size > sizeof(Sample) ? sample.payload.size - sizeof(Sample) : 0;
+    if (resp) {
+      // Bulk string, event body can contain any characters
+      len = format_u64(size, buf);
+      outbuf_ += '$';
+      outbuf_.append(buf, static_cast<size_t>(len));
+      outbuf_ += "\r\n";
+      outbuf_.append(sample.payload.data, size);
+      outbuf_ += "\r\n";
+    } else {
+      outbuf_ += ',';
+      append_csv_field(sample.payload.data, size, &outbuf_);
+    }
+  } else if ((type & PAYLOAD_FLOAT) == PAYLOAD_FLOAT) {
+    format_value(sample.payload.float64);
+  } else {
+    format_null();
+  }
+  if (!resp) {
+    outbuf_ += '\n';
+  }
+}
+
+bool QueryResultsFormatter::is_columnar() const {
+  return options_.format == OutputFormat::ARROW || options_.format == OutputFormat::PARQUET;
+}
+
+void QueryResultsFormatter::init_columnar(u32 nvalues) {
+  ColumnarSchema schema = { nvalues, options_.location };
+  if (options_.format == OutputFormat::ARROW) {
+    columnar_ = make_arrow_writer(schema);
+  } else {
+    columnar_ = make_parquet_writer(schema);
+  }
+  batch_.reset(new ColumnBatch(schema));
+}
+
+void QueryResultsFormatter::append_row(Sample const& sample) {
+  double values[MAX_TUPLE_SIZE];
+  u64 bitmap = 0;
+  u32 nvalues = 1;
+  const u16 type = sample.payload.type & ~PData::REGULLAR;
+  if ((type & PAYLOAD_TUPLE) == PAYLOAD_TUPLE) {
+    union {
+      double d;
+      u64 u;
+    } bits;
+    bits.d = sample.payload.float64;
+    nvalues = static_cast<u32>(bits.u >> 58);
+    const double* tuple = reinterpret_cast<const double*>(sample.payload.data);
+    for (u32 i = 0; i < nvalues; i++) {
+      if (bits.u & (1ull << i)) {
+        values[i] = *tuple++;
+        bitmap |= 1ull << i;
+      }
+    }
+  } else if ((type & PAYLOAD_EVENT) != PAYLOAD_EVENT && (type & PAYLOAD_FLOAT) == PAYLOAD_FLOAT) {
+    values[0] = sample.payload.float64;
+    bitmap = 1;
+  }
+  if (!columnar_) {
+    init_columnar(nvalues);
+  }
+  u32 code;
+  auto it = codes_.find(sample.paramid);
+  if (it == codes_.end()) {
+    bool first_seen;
+    dictionary_.push_back(&names_.get(sample.paramid, &first_seen));
+    code = static_cast<u32>(dictionary_.size() - 1);
+    codes_.emplace(sample.paramid, code);
+  } else {
+    code = it->second;
+  }
+  // Tuple elements that don't fit the schema are dropped
+  batch_->append(code, sample.timestamp, values, bitmap, sample.location);
+  if (batch_->size() >= std::max(options_.batch_size, 1u)) {
+    flush_batch();
+  }
+}
+
+void QueryResultsFormatter::flush_batch() {
+  if (batch_->size() != 0) {
+    columnar_->write_batch(*batch_, dictionary_, &outbuf_);
+    batch_->clear();
+  }
+}
+
+void QueryResultsFormatter::finish_columnar() {
+  if (!columnar_) {
+    init_columnar(1);
+  }
+  flush_batch();
+  columnar_->finish(&outbuf_);
+}
+
+size_t QueryResultsFormatter::read_some(char* dest, size_t size) {
+  size_t nbytes = 0;
+  while (nbytes < size) {
+    if (outbuf_pos_ < outbuf_.size()) {
+      size_t n = std::min(size - nbytes, outbuf_.size() - outbuf_pos_);
+      memcpy(dest + nbytes, outbuf_.data() + outbuf_pos_, n);
+      outbuf_pos_ += n;
+      nbytes += n;
+      continue;
+    }
+    outbuf_.clear();
+    outbuf_pos_ = 0;
+    if (done_) {
+      break;
+    }
+    // Format samples until the output buffer has enough data
+    while (outbuf_.size() < size - nbytes) {
+      if (rdbuf_pos_ == rdbuf_top_ && !refill()) {
+        break;
+      }
+      auto sample = reinterpret_cast<const Sample*>(rdbuf_.data() + rdbuf_pos_);
+      if (is_columnar()) {
+        append_row(*sample);
+      } else {
+        format_sample(*sample);
+      }
+      rdbuf_pos_ += std::max(static_cast<u32>(sample->payload.size), static_cast<u32>(sizeof(Sample)));
+    }
+  }
+  return nbytes;
+}
+
+CursorNameCache const& QueryResultsFormatter::get_names() const {
+  return names_;
+}
+
+}  // namespace stdb
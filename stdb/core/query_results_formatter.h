@@ -0,0 +1,133 @@
+/*!
+ * \file query_results_formatter.h
+ */
+#ifndef STDB_CORE_QUERY_RESULTS_FORMATTER_H_
+#define STDB_CORE_QUERY_RESULTS_FORMATTER_H_
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "stdb/core/columnar_writer.h"
+#include "stdb/core/database_session.h"
+#include "stdb/query/external_cursor.h"
+
+namespace stdb {
+
+enum class OutputFormat {
+  RESP,
+  CSV,
+  ARROW,    //! Arrow IPC stream
+  PARQUET,  //! Parquet file
+};
+
+struct OutputOptions {
+  OutputFormat format = OutputFormat::RESP;
+
+  /** Dictionary-encoded series names.
+   * Series name is sent once in a dictionary frame when the series is seen
+   * first time, rows carry the series id instead of the name.
+   * RESP: dictionary frame is `*2\r\n:<id>\r\n+<name>\r\n`, row starts with `:<id>\r\n`.
+   * CSV: dictionary frame is `#<id>,<name>\n`, row starts with `<id>,`.
+   */
+  bool dictionary = false;
+
+  //! Format timestamps as ISO 8601 strings (otherwise as nanoseconds)
+  bool iso_timestamps = true;
+
+  //! Number of rows in the Arrow record batch or Parquet row group
+  u32 batch_size = 0x10000;
+
+  //! Add lon/lat columns to the Arrow or Parquet output
+  bool location = false;
+};
+
+/** Read output options from the `output` field of the query.
+ * Format: `"output": { "format": "resp|csv|arrow|parquet", "timestamp": "iso|raw",
+ * "dictionary": true, "batch_size": 65536, "location": true }`, all fields are optional.
+ * @return status and error message
+ */
+std::tuple<common::Status, std::string> parse_output_options(const char* query, OutputOptions* options);
+
+/** Series names seen by the cursor.
+ * Every name is resolved through the session only once, so the output
+ * doesn't depend on the matcher lookup cost even if the names are
+ * written into every row.
+ */
+class CursorNameCache {
+  DatabaseSession* session_;
+  std::unordered_map<ParamId, std::string> names_;
+  std::vector<char> buffer_;
+
+ public:
+  explicit CursorNameCache(DatabaseSession* session);
+
+  /** Get series name.
+   * @param id is a series id
+   * @param first_seen is set to true if the name was resolved by this call
+   * @return series name (decimal id if the series is not found)
+   */
+  std::string const& get(ParamId id, bool* first_seen);
+
+  size_t size() const;
+};
+
+/** Formats query results.
+ * Reads samples from the cursor and converts them to text (RESP or CSV) or
+ * to columnar format (Arrow IPC stream or Parquet file). Event bodies are
+ * written as RESP bulk strings, CSV fields are quoted when needed. Columnar output is
+ * produced batch by batch so only `batch_size` rows are kept in memory. Column
+ * types are defined by the first sample (tuple size). Events have null values.
+ * If the query fails the columnar output is truncated (no end of stream marker
+ * or footer), the error can be retrieved from the cursor.
+ */
+class QueryResultsFormatter {
+  ExternalCursor* cursor_;
+  OutputOptions options_;
+  CursorNameCache names_;
+  //! Samples read from the cursor
+  std::vector<u8> rdbuf_;
+  u32 rdbuf_pos_;
+  u32 rdbuf_top_;
+  //! Formatted output that wasn't returned yet
+  std::string outbuf_;
+  size_t outbuf_pos_;
+  bool done_;
+  //! Columnar output, created when the first row is added
+  std::unique_ptr<ColumnarWriter> columnar_;
+  std::unique_ptr<ColumnBatch> batch_;
+  //! Series names in order of appearance and their indexes (columnar output)
+  std::vector<const std::string*> dictionary_;
+  std::unordered_map<ParamId, u32> codes_;
+
+  //! Read next portion of samples, return false if there is no more data
+  bool refill();
+
+  void format_error();
+  void format_sample(Sample const& sample);
+  void format_value(double value);
+  void format_null();
+
+  bool is_columnar() const;
+  void init_columnar(u32 nvalues);
+  void append_row(Sample const& sample);
+  void flush_batch();
+  void finish_columnar();
+
+ public:
+  QueryResultsFormatter(ExternalCursor* cursor, DatabaseSession* session, OutputOptions const& options);
+
+  /** Write next portion of the output.
+   * @return number of bytes written to `dest` (0 if all results were returned)
+   */
+  size_t read_some(char* dest, size_t size);
+
+  //! Series names resolved by the formatter
+  CursorNameCache const& get_names() const;
+};
+
+}  // namespace stdb
+
+#endif  // STDB_CORE_QUERY_RESULTS_FORMATTER_H_
@@ -0,0 +1,392 @@
+/*!
+ * \file query_results_formatter_test.cc
+ */
+#include "stdb/core/query_results_formatter.h"
+
+#include <string.h>
+
+#include <map>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+
+//! Session that only resolves series names and counts lookups
+struct MockSession : DatabaseSession {
+  std::map<ParamId, std::string> names;
+  int nlookups = 0;
+
+  common::Status init_series_id(const char*, const char*, const Location&, u64*) override {
+    return common::Status::NotPermitted();
+  }
+  common::Status init_series_id(const char*, const char*, u64*) override {
+    return common::Status::NotPermitted();
+  }
+  int get_series_name(ParamId id, char* buffer, size_t buffer_size) override {
+    nlookups++;
+    auto it = names.find(id);
+    if (it == names.end()) {
+      return 0;
+    }
+    if (it->second.size() > buffer_size) {
+      return -1 * static_cast<int>(it->second.size());
+    }
+    memcpy(buffer, it->second.data(), it->second.size());
+    return static_cast<int>(it->second.size());
+  }
+  int get_series_name_and_location(ParamId, char*, size_t, Location*) override {
+    return 0;
+  }
+  common::Status write(const Sample&) override {
+    return common::Status::NotPermitted();
+  }
+  void query(InternalCursor*, const char*) override {}
+  void suggest(InternalCursor*, const char*) override {}
+  void search(InternalCursor*, const char*) override {}
+  common::Status prepare(const char*, u64*, std::string*) override {
+    return common::Status::NotPermitted();
+  }
+  void execute(InternalCursor*, u64, qp::QueryParameters const&) override {}
+};
+
+//! Cursor that returns prepared samples
+struct MockCursor : ExternalCursor {
+  std::vector<u8> data;
+  size_t pos = 0;
+  std::string error;
+
+  void add(Sample const& sample) {
+    auto p = reinterpret_cast<const u8*>(&sample);
+    data.insert(data.end(), p, p + sample.payload.size);
+  }
+  void add(ParamId id, Timestamp ts, double value) {
+    Sample sample = {};
+    sample.paramid = id;
+    sample.timestamp = ts;
+    sample.payload.type = PAYLOAD_FLOAT;
+    sample.payload.size = sizeof(Sample);
+    sample.payload.float64 = value;
+    add(sample);
+  }
+  u32 read(void* buffer, u32 buffer_size) override {
+    // Return one sample at a time to check buffering
+    if (pos == data.size()) {
+      return 0;
+    }
+    auto sample = reinterpret_cast<const Sample*>(data.data() + pos);
+    u32 size = sample->payload.size;
+    if (size > buffer_size) {
+      return 0;
+    }
+    memcpy(buffer, sample, size);
+    pos += size;
+    return size;
+  }
+  bool is_done() const override {
+    return pos == data.size();
+  }
+  bool is_error(common::Status* status) const override {
+    if (status) {
+      *status = error.empty() ? common::Status::Ok() : common::Status::QueryParsingError();
+    }
+    return !error.empty();
+  }
+  bool is_error(const char** message, common::Status* status) const override {
+    *message = error.c_str();
+    return is_error(status);
+  }
+  void close() override {}
+};
+
+static std::string read_all(QueryResultsFormatter* formatter, size_t chunk) {
+  std::string result;
+  std::vector<char> buf(chunk);
+  while (true) {
+    auto n = formatter->read_some(buf.data(), buf.size());
+    if (n == 0) {
+      break;
+    }
+    result.append(buf.data(), n);
+  }
+  return result;
+}
+
+TEST(TestQueryResultsFormatter, Test_resp) {
+  MockSession session;
+  session.names[1] = "cpu host=a";
+  MockCursor cursor;
+  cursor.add(1, 100, 0.5);
+  cursor.add(1, 200, 1.0);
+  cursor.add(2, 300, 2.0);
+
+  OutputOptions options;
+  options.iso_timestamps = false;
+  QueryResultsFormatter formatter(&cursor, &session, options);
+  // Unknown series is formatted using its id
+  EXPECT_EQ("+cpu host=a\r\n:100\r\n+0.5\r\n"
+            "+cpu host=a\r\n:200\r\n+1\r\n"
+            "+2\r\n:300\r\n+2\r\n",
+            read_all(&formatter, 7));
+  EXPECT_EQ(2, session.nlookups);
+}
+
+TEST(TestQueryResultsFormatter, Test_dictionary) {
+  MockSession session;
+  session.names[1] = "cpu host=a";
+  session.names[2] = "cpu host=b";
+  MockCursor cursor;
+  for (int i = 0; i < 100; i++) {
+    cursor.add(1 + i % 2, 1000 + i, i);
+  }
+  OutputOptions options;
+  options.iso_timestamps = false;
+  options.dictionary = true;
+  QueryResultsFormatter formatter(&cursor, &session, options);
+  auto output = read_all(&formatter, 4096);
+  EXPECT_EQ(2, session.nlookups);
+  EXPECT_EQ(0u, output.find("*2\r\n:1\r\n+cpu host=a\r\n:1\r\n:1000\r\n+0\r\n"
+                            "*2\r\n:2\r\n+cpu host=b\r\n:2\r\n:1001\r\n+1\r\n"
+                            ":1\r\n:1002\r\n+2\r\n"));
+  // Every name is sent only once
+  EXPECT_EQ(output.find("cpu host=a"), output.rfind("cpu host=a"));
+  EXPECT_EQ(output.find("cpu host=b"), output.rfind("cpu host=b"));
+
+  MockCursor csv_cursor;
+  csv_cursor.add(1, 1000, 1.5);
+  csv_cursor.add(1, 2000, 2.5);
+  options.format = OutputFormat::CSV;
+  QueryResultsFormatter csv(&csv_cursor, &session, options);
+  EXPECT_EQ("#1,cpu host=a\n1,1000,1.5\n1,2000,2.5\n", read_all(&csv, 3));
+}
+
+TEST(TestQueryResultsFormatter, Test_csv_tuples_and_events) {
+  MockSession session;
+  session.names[7] = std::string(5000, 'x');
+  MockCursor cursor;
+
+  // Tuple with the second element missing
+  std::vector<u8> buf(sizeof(Sample) + 2 * sizeof(double));
+  Sample* tuple = reinterpret_cast<Sample*>(buf.data());
+  union {
+    double d;
+    u64 u;
+  } bits;
+  bits.u = (3ull << 58) | 5;
+  tuple->paramid = 7;
+  tuple->timestamp = 1;
+  tuple->payload.type = PAYLOAD_TUPLE | PData::REGULLAR;
+  tuple->payload.size = static_cast<u16>(buf.size());
+  tuple->payload.float64 = bits.d;
+  double* values = reinterpret_cast<double*>(tuple->payload.data);
+  values[0] = 1;
+  values[1] = 3;
+  cursor.add(*tuple);
+
+  std::string body = "disk full";
+  std::vector<u8> evbuf(sizeof(Sample) + body.size());
+  Sample* event = reinterpret_cast<Sample*>(evbuf.data());
+  event->paramid = 7;
+  event->timestamp = 2;
+  event->payload.type = PAYLOAD_EVENT;
+  event->payload.size = static_cast<u16>(evbuf.size());
+  memcpy(event->payload.data, body.data(), body.size());
+  cursor.add(*event);
+
+  OutputOptions options;
+  options.format = OutputFormat::CSV;
+  options.iso_timestamps = false;
+  QueryResultsFormatter formatter(&cursor, &session, options);
+  // Long name is resolved using the larger buffer
+  auto name = session.names[7];
+  EXPECT_EQ(name + ",1,1,,3\n" + name + ",2,disk full\n", read_all(&formatter, 100));
+  EXPECT_EQ(1u, formatter.get_names().size());
+}
+
+TEST(TestQueryResultsFormatter, Test_event_escaping) {
+  MockSession session;
+  session.names[7] = "!log host=a,b";
+  MockCursor cursor;
+  std::string body = "line 1\r\nline \"2\", done";
+  std::vector<u8> evbuf(sizeof(Sample) + body.size());
+  Sample* event = reinterpret_cast<Sample*>(evbuf.data());
+  event->paramid = 7;
+  event->timestamp = 2;
+  event->payload.type = PAYLOAD_EVENT;
+  event->payload.size = static_cast<u16>(evbuf.size());
+  memcpy(event->payload.data, body.data(), body.size());
+  cursor.add(*event);
+  cursor.add(*event);
+
+  OutputOptions options;
+  options.iso_timestamps = false;
+  options.format = OutputFormat::RESP;
+  QueryResultsFormatter resp(&cursor, &session, options);
+  std::string expected = "+!log host=a,b\r\n:2\r\n$22\r\n" + body + "\r\n";
+  EXPECT_EQ(expected + expected, read_all(&resp, 100));
+
+  cursor.pos = 0;
+  options.format = OutputFormat::CSV;
+  QueryResultsFormatter csv(&cursor, &session, options);
+  expected = "\"!log host=a,b\",2,\"line 1\r\nline \"\"2\"\", done\"\n";
+  EXPECT_EQ(expected + expected, read_all(&csv, 100));
+
+  // Dictionary entries are quoted too
+  cursor.pos = 0;
+  options.dictionary = true;
+  QueryResultsFormatter dict(&cursor, &session, options);
+  EXPECT_EQ(0u, read_all(&dict, 100).find("#7,\"!log host=a,b\"\n7,2,"));
+}
+
+TEST(TestQueryResultsFormatter, Test_error) {
+  MockSession session;
+  MockCursor cursor;
+  cursor.error = "bad query";
+  QueryResultsFormatter formatter(&cursor, &session, OutputOptions());
+  EXPECT_EQ("-bad query\r\n", read_all(&formatter, 100));
+}
+
+//! Read message header types of the Arrow IPC stream, return false if the stream is malformed
+static bool read_arrow_messages(std::string const& stream, std::vector<int>* headers) {
+  size_t pos = 0;
+  while (pos + 8 <= stream.size()) {
+    i32 marker, length;
+    memcpy(&marker, stream.data() + pos, 4);
+    memcpy(&length, stream.data() + pos + 4, 4);
+    pos += 8;
+    if (marker != -1 || length % 8 != 0 || pos + length > stream.size()) {
+      return false;
+    }
+    if (length == 0) {
+      return pos == stream.size();
+    }
+    // Message table: header_type (slot 1) and bodyLength (slot 3)
+    auto meta = reinterpret_cast<const u8*>(stream.data() + pos);
+    u32 table;
+    i32 vtable_offset;
+    memcpy(&table, meta, 4);
+    memcpy(&vtable_offset, meta + table, 4);
+    const u8* vtable = meta + table - vtable_offset;
+    u16 type_field, body_field;
+    memcpy(&type_field, vtable + 6, 2);
+    memcpy(&body_field, vtable + 10, 2);
+    i64 body_length;
+    memcpy(&body_length, meta + table + body_field, 8);
+    headers->push_back(meta[table + type_field]);
+    pos += length + body_length;
+  }
+  return false;
+}
+
+static void add_tuple(MockCursor* cursor, ParamId id, Timestamp ts, u64 mask, std::vector<double> const& values) {
+  std::vector<u8> buf(sizeof(Sample) + values.size() * sizeof(double));
+  Sample* sample = reinterpret_cast<Sample*>(buf.data());
+  union {
+    double d;
+    u64 u;
+  } bits;
+  bits.u = (3ull << 58) | mask;
+  sample->paramid = id;
+  sample->timestamp = ts;
+  sample->payload.type = PAYLOAD_TUPLE;
+  sample->payload.size = static_cast<u16>(buf.size());
+  sample->payload.float64 = bits.d;
+  memcpy(sample->payload.data, values.data(), values.size() * sizeof(double));
+  cursor->add(*sample);
+}
+
+TEST(TestQueryResultsFormatter, Test_arrow_stream) {
+  MockSession session;
+  session.names[1] = "cpu host=a";
+  session.names[2] = "cpu host=b";
+  session.names[3] = "cpu host=c";
+  MockCursor cursor;
+  for (int i = 0; i < 100; i++) {
+    add_tuple(&cursor, 1 + i % 2, 1000 + i, 5, { 1.0 * i, 2.0 * i });
+  }
+  add_tuple(&cursor, 3, 2000, 7, { 1, 2, 3 });
+
+  OutputOptions options;
+  options.format = OutputFormat::ARROW;
+  options.batch_size = 10;
+  options.location = true;
+  QueryResultsFormatter formatter(&cursor, &session, options);
+  auto output = read_all(&formatter, 1000);
+
+  // Schema, dictionary, 10 record batches, delta dictionary with the new name, last batch
+  std::vector<int> headers;
+  ASSERT_TRUE(read_arrow_messages(output, &headers));
+  std::vector<int> expected = { 1, 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 3 };
+  EXPECT_EQ(expected, headers);
+  EXPECT_NE(std::string::npos, output.find("value_2"));
+  EXPECT_NE(std::string::npos, output.find("lat"));
+  EXPECT_EQ(output.find("cpu host=a"), output.rfind("cpu host=a"));
+  EXPECT_EQ(3, session.nlookups);
+
+  // Empty result is a stream with the schema only
+  MockCursor empty;
+  QueryResultsFormatter empty_formatter(&empty, &session, options);
+  headers.clear();
+  ASSERT_TRUE(read_arrow_messages(read_all(&empty_formatter, 7), &headers));
+  EXPECT_EQ(std::vector<int>{ 1 }, headers);
+}
+
+TEST(TestQueryResultsFormatter, Test_parquet_file) {
+  MockSession session;
+  session.names[1] = "cpu host=a";
+  session.names[2] = "cpu host=b";
+  MockCursor cursor;
+  for (int i = 0; i < 100; i++) {
+    cursor.add(1 + i % 2, 1000 + i, i);
+  }
+  OutputOptions options;
+  options.format = OutputFormat::PARQUET;
+  options.batch_size = 10;
+  QueryResultsFormatter formatter(&cursor, &session, options);
+  auto output = read_all(&formatter, 100);
+
+  ASSERT_LT(12u, output.size());
+  EXPECT_EQ("PAR1", output.substr(0, 4));
+  EXPECT_EQ("PAR1", output.substr(output.size() - 4));
+  u32 footer;
+  memcpy(&footer, output.data() + output.size() - 8, 4);
+  EXPECT_LT(footer + 12, output.size());
+  // Every row group has its own dictionary page
+  size_t count = 0;
+  for (auto pos = output.find("cpu host=a"); pos != std::string::npos; pos = output.find("cpu host=a", pos + 1)) {
+    count++;
+  }
+  EXPECT_EQ(10u, count);
+}
+
+TEST(TestQueryResultsFormatter, Test_columnar_error) {
+  MockSession session;
+  MockCursor cursor;
+  cursor.add(1, 1000, 1);
+  cursor.error = "bad query";
+  OutputOptions options;
+  options.format = OutputFormat::ARROW;
+  QueryResultsFormatter formatter(&cursor, &session, options);
+  // Stream is truncated, there is no end of stream marker
+  std::vector<int> headers;
+  EXPECT_FALSE(read_arrow_messages(read_all(&formatter, 100), &headers));
+}
+
+TEST(TestQueryResultsFormatter, Test_parse_output_options) {
+  OutputOptions options;
+  common::Status status;
+  std::string error;
+  std::tie(status, error) = parse_output_options(
+      R"({"select": "cpu", "output": {"format": "parquet", "timestamp": "raw", "batch_size": 1000, "location": true}})",
+      &options);
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ(OutputFormat::PARQUET, options.format);
+  EXPECT_FALSE(options.iso_timestamps);
+  EXPECT_EQ(1000u, options.batch_size);
+  EXPECT_TRUE(options.location);
+
+  std::tie(status, error) = parse_output_options(R"({"select": "cpu", "output": {"format": "xml"}})", &options);
+  EXPECT_FALSE(status.IsOk());
+  EXPECT_EQ("unknown output format xml", error);
+}
+
+}  // namespace stdb
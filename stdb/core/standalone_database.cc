@@ -13,7 +13,10 @@ namespace stdb {
 StandaloneDatabase::StandaloneDatabase(
     std::shared_ptr<Synchronization> synchronization,
     std::shared_ptr<SyncWaiter> sync_waiter,
-    bool is_moving) : Database(is_moving), sync_waiter_(sync_waiter) {
+    bool is_moving) : Database(is_moving), sync_waiter_(sync_waiter),
+                      geofences_(std::make_shared<GeofenceRegistry>()),
+                      positions_(std::make_shared<LatestPositionIndex>()),
+                      prepared_queries_(std::make_shared<qp::PreparedQueryCache>()) {
   worker_database_.reset(new WorkerDatabase(synchronization, is_moving));
   server_database_.reset(new ServerDatabase(is_moving));
 }
@@ -23,7 +26,10 @@ StandaloneDatabase::StandaloneDatabase(
     const FineTuneParams& params,
     std::shared_ptr<Synchronization> synchronization,
     std::shared_ptr<SyncWaiter> sync_waiter,
-    bool is_moving) : Database(is_moving), sync_waiter_(sync_waiter) {
+    bool is_moving) : Database(is_moving), sync_waiter_(sync_waiter),
+                      geofences_(std::make_shared<GeofenceRegistry>()),
+                      positions_(std::make_shared<LatestPositionIndex>()),
+                      prepared_queries_(std::make_shared<qp::PreparedQueryCache>()) {
   server_database_.reset(new ServerDatabase(server_path, params, is_moving));
   worker_database_.reset(new WorkerDatabase(worker_path, params, synchronization, is_moving));
 }
@@ -6,6 +6,9 @@
 
 #include "stdb/core/server_database.h"
 #include "stdb/core/worker_database.h"
+#include "stdb/index/geofence.h"
+#include "stdb/index/position_index.h"
+#include "stdb/query/prepared_query.h"
 
 namespace stdb {
 
@@ -14,6 +17,12 @@ class StandaloneDatabase : public Database, public std::enable_shared_from_this<
   std::shared_ptr<SyncWaiter> sync_waiter_;
   std::shared_ptr<ServerDatabase> server_database_;
   std::shared_ptr<WorkerDatabase> worker_database_;
+  //! Geofences evaluated on the write path
+  std::shared_ptr<GeofenceRegistry> geofences_;
+  //! Latest positions of the moving series
+  std::shared_ptr<LatestPositionIndex> positions_;
+  //! Query templates registered by the sessions
+  std::shared_ptr<qp::PreparedQueryCache> prepared_queries_;
  
  public:
   // Create empty in-memory database
@@ -32,6 +41,9 @@ class StandaloneDatabase : public Database, public std::enable_shared_from_this<
 
   std::shared_ptr<ServerDatabase> server_database() { return server_database_; }
   std::shared_ptr<WorkerDatabase> worker_database() { return worker_database_; }
+  std::shared_ptr<GeofenceRegistry> geofences() { return geofences_; }
+  std::shared_ptr<LatestPositionIndex> positions() { return positions_; }
+  std::shared_ptr<qp::PreparedQueryCache> prepared_queries() { return prepared_queries_; }
 
   void initialize(const FineTuneParams& params) override;
 
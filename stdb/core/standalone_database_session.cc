@@ -4,6 +4,9 @@
 #include "stdb/core/standalone_database_session.h"
 
 #include "stdb/core/standalone_database.h"
+#include "stdb/query/plan/query_plan_builder.h"
+#include "stdb/query/queryparser.h"
+#include "stdb/query/queryprocessor.h"
 
 namespace stdb {
 
@@ -37,6 +40,10 @@ void StandaloneDatabaseSession::init_ilog() {
 }
 
 common::Status StandaloneDatabaseSession::init_series_id(const char* begin, const char* end, const Location& location, u64* id) {
+  *id = name_cache_.get(begin, end);
+  if (*id) {
+    return common::Status::Ok();
+  }
   const char* ksbegin = nullptr;
   const char* ksend = nullptr;
   char buf[LIMITS_MAX_SNAME];
@@ -48,6 +55,7 @@ common::Status StandaloneDatabaseSession::init_series_id(const char* begin, cons
   }
   *id = local_matcher_.match(ob, ksend);
   if (*id) {
+    name_cache_.put(begin, end, *id);
     return status;
   }
   init_ilog();
@@ -58,10 +66,17 @@ common::Status StandaloneDatabaseSession::init_series_id(const char* begin, cons
     auto worker_database = database_->worker_database();
     status = worker_database->cstore()->create_new_column(*id);
   }
+  if (status.IsOk()) {
+    name_cache_.put(begin, end, *id);
+  }
   return status;
 }
 
 common::Status StandaloneDatabaseSession::init_series_id(const char* begin, const char* end, u64* id) {
+  *id = name_cache_.get(begin, end);
+  if (*id) {
+    return common::Status::Ok();
+  }
   const char* ksbegin = nullptr;
   const char* ksend = nullptr;
   char buf[LIMITS_MAX_SNAME];
@@ -73,6 +88,7 @@ common::Status StandaloneDatabaseSession::init_series_id(const char* begin, cons
   }
   *id = local_matcher_.match(ob, ksend);
   if (*id) {
+    name_cache_.put(begin, end, *id);
     return status;
   }
   init_ilog();
@@ -83,15 +99,33 @@ common::Status StandaloneDatabaseSession::init_series_id(const char* begin, cons
     auto worker_database = database_->worker_database();
     status = worker_database->cstore()->create_new_column(*id);
   }
+  if (status.IsOk()) {
+    name_cache_.put(begin, end, *id);
+  }
   return status;
 }
 
 int StandaloneDatabaseSession::get_series_name(ParamId id, char* buffer, size_t buffer_size) {
+  if (matcher_substitute_) {
+    // Series created by the query
+    auto name = matcher_substitute_->id2str(id);
+    if (name.first == nullptr) {
+      return 0;
+    }
+    if (static_cast<size_t>(name.second) > buffer_size) {
+      return -1 * static_cast<int>(name.second);
+    }
+    memcpy(buffer, name.first, static_cast<size_t>(name.second));
+    return static_cast<int>(name.second);
+  }
   auto name = local_matcher_.id2str(id);
   if (name.first == nullptr) {
     auto server_database = database_->server_database();
     return server_database->get_series_name(id, buffer, buffer_size, &local_matcher_);
   }
+  if (static_cast<size_t>(name.second) > buffer_size) {
+    return -1 * static_cast<int>(name.second);
+  }
   memcpy(buffer, name.first, static_cast<size_t>(name.second));
   return static_cast<int>(name.second);
 }
@@ -127,6 +161,10 @@ common::Status StandaloneDatabaseSession::write(const Sample& sample) {
     case storage::NBTreeAppendResult::FAIL_BAD_VALUE:
       return common::Status::BadArg();
   }
+  if (sample.payload.type & PData::LOCATION_BIT) {
+    database_->positions()->process(sample);
+    database_->geofences()->process(sample);
+  }
   if (ilog_ == nullptr) {
     return common::Status::Ok();
   }
@@ -157,10 +195,141 @@ common::Status StandaloneDatabaseSession::write(const Sample& sample) {
       ilog_->rotate();
     }
   }
+  return common::Status::Ok();
+}
+
+void StandaloneDatabaseSession::set_series_matcher(std::shared_ptr<PlainSeriesMatcher> matcher) {
+  matcher_substitute_ = matcher;
+}
+
+void StandaloneDatabaseSession::clear_series_matcher() {
+  matcher_substitute_ = nullptr;
 }
 
 void StandaloneDatabaseSession::query(InternalCursor* cursor, const char* query) {
+  using namespace qp;
+
+  boost::property_tree::ptree ptree;
+  common::Status status;
+  ErrorMsg error_msg;
+  clear_series_matcher();
+  std::tie(status, ptree, error_msg) = QueryParser::parse_json(query);
+  if (!status.IsOk()) {
+    cursor->set_error(status, error_msg.data());
+    return;
+  }
+  QueryKind kind;
+  std::tie(status, kind, error_msg) = QueryParser::get_query_kind(ptree);
+  if (!status.IsOk()) {
+    cursor->set_error(status, error_msg.data());
+    return;
+  }
+  auto const& matcher = *database_->server_database()->global_matcher();
+  ReshapeRequest req;
+  std::vector<std::shared_ptr<Node>> nodes;
+
+  if (kind == QueryKind::SELECT_META) {
+    std::vector<ParamId> ids;
+    std::tie(status, ids, error_msg) = QueryParser::parse_select_meta_query(ptree, matcher);
+    if (!status.IsOk()) {
+      cursor->set_error(status, error_msg.data());
+      return;
+    }
+    std::tie(status, nodes, error_msg) = QueryParser::parse_processing_topology(ptree, cursor, req);
+    if (!status.IsOk()) {
+      cursor->set_error(status, error_msg.data());
+      return;
+    }
+    MetadataQueryProcessor proc(nodes.front(), std::move(ids));
+    if (proc.start()) {
+      proc.stop();
+    }
+    return;
+  }
+
+  std::tie(status, req, error_msg) = QueryParser::parse_query(ptree, kind, matcher);
+  if (!status.IsOk()) {
+    cursor->set_error(status, error_msg.data());
+    return;
+  }
+  std::tie(status, nodes, error_msg) = QueryParser::parse_processing_topology(ptree, cursor, req);
+  if (!status.IsOk()) {
+    cursor->set_error(status, error_msg.data());
+    return;
+  }
+  execute_request(cursor, kind, req, nodes);
+}
+
+void StandaloneDatabaseSession::execute_request(InternalCursor* cursor,
+                                                qp::QueryKind kind,
+                                                qp::ReshapeRequest const& req,
+                                                std::vector<std::shared_ptr<qp::Node>> const& nodes) {
+  using namespace qp;
+
+  std::unique_ptr<ScanQueryProcessor> proc;
+  try {
+    proc.reset(new ScanQueryProcessor(nodes, kind == QueryKind::GROUP_AGGREGATE));
+  } catch (const NodeException& e) {
+    cursor->set_error(common::Status::QueryParsingError(), e.what());
+    return;
+  }
+  if (req.select.matcher) {
+    set_series_matcher(req.select.matcher);
+  }
+  // Return error if no series was found
+  if (req.select.columns.empty()) {
+    cursor->set_error(common::Status::QueryParsingError());
+    return;
+  }
+  if (req.select.columns.at(0).ids.empty()) {
+    cursor->set_error(common::Status::NotFound());
+    return;
+  }
+  common::Status status;
+  std::unique_ptr<IQueryPlan> query_plan;
+  std::tie(status, query_plan) = QueryPlanBuilder::create(req);
+  if (!status.IsOk()) {
+    cursor->set_error(status);
+    return;
+  }
+  if (proc->start()) {
+    QueryPlanExecutor executor;
+    executor.execute(*database_->worker_database()->cstore(), std::move(query_plan), *proc);
+    proc->stop();
+  }
+}
+
+common::Status StandaloneDatabaseSession::prepare(const char* query, u64* id, std::string* error) {
+  auto const& matcher = *database_->server_database()->global_matcher();
+  common::Status status;
+  std::tie(status, *id, *error) = database_->prepared_queries()->prepare(query, matcher);
+  return status;
+}
 
+void StandaloneDatabaseSession::execute(InternalCursor* cursor, u64 id, qp::QueryParameters const& params) {
+  using namespace qp;
+
+  clear_series_matcher();
+  auto prepared = database_->prepared_queries()->get(id);
+  if (!prepared) {
+    cursor->set_error(common::Status::NotFound(), "Prepared query not found");
+    return;
+  }
+  common::Status status;
+  ErrorMsg error_msg;
+  ReshapeRequest req;
+  std::tie(status, req, error_msg) = prepared->bind(params);
+  if (!status.IsOk()) {
+    cursor->set_error(status, error_msg.data());
+    return;
+  }
+  std::vector<std::shared_ptr<Node>> nodes;
+  std::tie(status, nodes, error_msg) = prepared->bind_processing_topology(params, cursor, req);
+  if (!status.IsOk()) {
+    cursor->set_error(status, error_msg.data());
+    return;
+  }
+  execute_request(cursor, prepared->get_query_kind(), req, nodes);
 }
 
 void StandaloneDatabaseSession::suggest(InternalCursor* cursor, const char* query) {
@@ -5,9 +5,12 @@
 #define STDB_CORE_STANDALONE_DATABASE_SESSION_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "stdb/core/sync_waiter.h"
 #include "stdb/core/database_session.h"
+#include "stdb/index/series_name_cache.h"
 #include "stdb/index/seriesparser.h"
 #include "stdb/storage/column_store.h"
 #include "stdb/storage/input_log.h"
@@ -19,6 +22,10 @@ class StandaloneDatabase;
 class StandaloneDatabaseSession : public DatabaseSession {
  protected:
   PlainSeriesMatcher local_matcher_;
+  //! Raw series name to id mapping, allows to skip canonicalization
+  SeriesNameCache name_cache_;
+  //! Series names produced by the last query (group-by, join), overrides the local matcher
+  std::shared_ptr<PlainSeriesMatcher> matcher_substitute_;
 
   std::shared_ptr<StandaloneDatabase> database_;
   std::shared_ptr<storage::CStoreSession> session_;
@@ -63,6 +70,13 @@ class StandaloneDatabaseSession : public DatabaseSession {
    */
   common::Status write(const Sample& sample) override;
 
+  /**
+   * @brief query implementation
+   * Query is parsed and executed synchronously, results are sent to the
+   * cursor, cursor is completed or receives an error when the query is done.
+   * @param cursor is a pointer to internal cursor
+   * @param query is a string that contains query
+   */
   void query(InternalCursor* cursor, const char* query) override;
 
   /**
@@ -79,8 +93,24 @@ class StandaloneDatabaseSession : public DatabaseSession {
    */
   void search(InternalCursor* cursor, const char* query) override;
 
+  common::Status prepare(const char* query, u64* id, std::string* error) override;
+
+  void execute(InternalCursor* cursor, u64 id, qp::QueryParameters const& params) override;
+
  protected:
   void init_ilog();
+
+  //! Build query plan for the request and send results to the cursor
+  void execute_request(InternalCursor* cursor,
+                       qp::QueryKind kind,
+                       qp::ReshapeRequest const& req,
+                       std::vector<std::shared_ptr<qp::Node>> const& nodes);
+
+  //! Use `matcher` to get names of the series produced by the query
+  void set_series_matcher(std::shared_ptr<PlainSeriesMatcher> matcher);
+
+  //! Use local matcher to get series names
+  void clear_series_matcher();
 };
 
 }  // namespace stdb
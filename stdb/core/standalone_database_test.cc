@@ -3,9 +3,12 @@
  */
 #include "stdb/core/standalone_database.h"
 
+#include <string.h>
+
 #include "gtest/gtest.h"
 
 #include "stdb/common/apr_utils.h"
+#include "stdb/core/cursor.h"
 
 namespace stdb {
 
@@ -42,4 +45,91 @@ TEST(TestStandaloneDatabase, Test2) {
   database.close();
 }
 
+//! Read all samples from the cursor
+static std::vector<Sample> read_all(ExternalCursor* cursor, common::Status* status) {
+  std::vector<Sample> result;
+  std::vector<Sample> buffer(64);
+  while (true) {
+    auto size = cursor->read(buffer.data(), static_cast<u32>(buffer.size() * sizeof(Sample)));
+    if (size == 0) {
+      break;
+    }
+    result.insert(result.end(), buffer.begin(), buffer.begin() + size / sizeof(Sample));
+  }
+  const char* message = nullptr;
+  cursor->is_error(&message, status);
+  cursor->close();
+  return result;
+}
+
+TEST(TestStandaloneDatabase, Test_prepared_query) {
+  std::shared_ptr<Synchronization> sync(new Synchronization());
+  std::shared_ptr<SyncWaiter> sync_waiter(new SyncWaiter());
+  auto database = std::make_shared<StandaloneDatabase>(sync, sync_waiter, true);
+  auto session = database->create_session();
+
+  for (auto name: { "cpu host=a", "cpu host=b" }) {
+    u64 id;
+    ASSERT_TRUE(session->init_series_id(name, name + strlen(name), &id).IsOk());
+    for (Timestamp ts = 0; ts < 100; ts++) {
+      Sample sample = {};
+      sample.paramid = id;
+      sample.timestamp = ts;
+      sample.payload.type = PAYLOAD_FLOAT;
+      sample.payload.size = sizeof(Sample);
+      sample.payload.float64 = static_cast<double>(ts);
+      ASSERT_TRUE(session->write(sample).IsOk());
+    }
+  }
+
+  const char* query = R"({ "select": "cpu", "range": { "from": "$from", "to": "$to" }, "limit": "$limit" })";
+  u64 id = 0;
+  std::string error;
+  auto status = session->prepare(query, &id, &error);
+  ASSERT_TRUE(status.IsOk()) << error;
+  // Same template is registered once
+  u64 same_id = 0;
+  ASSERT_TRUE(session->prepare(query, &same_id, &error).IsOk());
+  EXPECT_EQ(id, same_id);
+
+  qp::QueryParameters params;
+  params.begin = 10;
+  params.end = 20;
+  params.limit = 1000;
+  auto cursor = ConcurrentCursor::make(&DatabaseSession::execute, session.get(), id, params);
+  auto samples = read_all(cursor.get(), &status);
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_EQ(20u, samples.size());
+  for (auto const& sample: samples) {
+    EXPECT_LE(10u, sample.timestamp);
+    EXPECT_GT(20u, sample.timestamp);
+  }
+
+  // Parameters are bound on every execution
+  params.begin = 0;
+  params.end = 100;
+  params.limit = 5;
+  cursor = ConcurrentCursor::make(&DatabaseSession::execute, session.get(), id, params);
+  samples = read_all(cursor.get(), &status);
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_EQ(5u, samples.size());
+
+  // Unbound slot
+  params.limit.reset();
+  cursor = ConcurrentCursor::make(&DatabaseSession::execute, session.get(), id, params);
+  samples = read_all(cursor.get(), &status);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+  EXPECT_TRUE(samples.empty());
+
+  // Unknown query
+  cursor = ConcurrentCursor::make(&DatabaseSession::execute, session.get(), id + 1, params);
+  samples = read_all(cursor.get(), &status);
+  EXPECT_EQ(common::Status::NotFound(), status);
+
+  // Invalid template
+  EXPECT_FALSE(session->prepare(R"({ "select": "cpu", "range": { "from": "$begin", "to": 1 } })",
+                                &id, &error).IsOk());
+  EXPECT_FALSE(error.empty());
+}
+
 }  // namespace stdb
@@ -252,6 +252,15 @@ void WorkerDatabase::run_recovery(
     sync();
   }
   LOG(INFO) << "WAL metadata recovery completed";
+
+  // Secondary indexes are not persisted, they're rebuilt from the stored data
+  if (params.enable_event_index) {
+    cstore_->enable_event_index();
+  }
+  if (params.sax_index_window) {
+    storage::SAXIndexParams sax_params = { params.sax_index_window, params.sax_index_word_length };
+    cstore_->enable_sax_index(sax_params);
+  }
 }
 
 void WorkerDatabase::run_input_log_recovery(storage::ShardedInputLog* ilog, const std::vector<ParamId>& ids2restore,
@@ -127,6 +127,11 @@ common::Status DatabaseManager::init_connection(const proto::DatabaseConfig& dat
   } else {
     fine_tune_params.input_log_path = temp.c_str();
   }
+  fine_tune_params.enable_event_index = database_config.index_config().event_index();
+  fine_tune_params.sax_index_window = database_config.index_config().sax_window();
+  if (database_config.index_config().sax_word_length()) {
+    fine_tune_params.sax_index_word_length = database_config.index_config().sax_word_length();
+  }
 
   std::shared_ptr<DbConnection> conn(new STDBConnection(meta_file.c_str(), fine_tune_params));
   conns_.insert(std::pair<std::string, std::shared_ptr<DbConnection>>(db_name, conn));
@@ -0,0 +1,195 @@
+/**
+ * \file geofence.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/index/geofence.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace stdb {
+
+GeofenceRegistry::GeofenceRegistry()
+    : nfences_(0)
+    , next_subscriber_id_(1)
+    , nsubscribers_(0) {
+}
+
+u64 GeofenceRegistry::add_fence(Polygon const& polygon) {
+  auto min = polygon.get_min();
+  auto max = polygon.get_max();
+  LocationType half_width = (max.lon - min.lon) / 2;
+  LocationType half_height = (max.lat - min.lat) / 2;
+  int exp = 0;
+  std::frexp(std::max(half_width, half_height), &exp);
+  int size_class = exp >> 1;
+
+  common::UniqueLock lock(fences_lock_);
+  fences_.emplace_back(new Polygon(polygon));
+  nfences_++;
+  u64 id = fences_.size();
+  auto& cls = classes_[size_class];
+  if (!cls) {
+    cls.reset(new SizeClass());
+    cls->half_width = 0;
+    cls->half_height = 0;
+  }
+  cls->half_width = std::max(cls->half_width, half_width);
+  cls->half_height = std::max(cls->half_height, half_height);
+  FenceIndex::Point center;
+  center.data[0] = min.lon + half_width;
+  center.data[1] = min.lat + half_height;
+  cls->index.Insert(center, static_cast<i64>(id));
+  return id;
+}
+
+bool GeofenceRegistry::remove_fence(u64 id) {
+  common::UniqueLock lock(fences_lock_);
+  if (id == 0 || id > fences_.size() || !fences_[id - 1]) {
+    return false;
+  }
+  fences_[id - 1].reset();
+  nfences_--;
+  return true;
+}
+
+size_t GeofenceRegistry::size() const {
+  return nfences_.load();
+}
+
+u64 GeofenceRegistry::subscribe(Subscriber const& fn) {
+  std::lock_guard<std::mutex> lock(subscribers_lock_);
+  auto id = next_subscriber_id_++;
+  subscribers_.push_back(std::make_pair(id, fn));
+  nsubscribers_.store(subscribers_.size());
+  return id;
+}
+
+void GeofenceRegistry::unsubscribe(u64 id) {
+  std::lock_guard<std::mutex> lock(subscribers_lock_);
+  auto it = std::remove_if(subscribers_.begin(), subscribers_.end(),
+                           [id](std::pair<u64, Subscriber> const& s) { return s.first == id; });
+  subscribers_.erase(it, subscribers_.end());
+  nsubscribers_.store(subscribers_.size());
+}
+
+void GeofenceRegistry::lookup(Location const& loc, std::vector<u64>* result) const {
+  std::vector<std::pair<FenceIndex::Point, i64>> candidates;
+  common::SharedLock lock(fences_lock_);
+  for (auto const& kv: classes_) {
+    auto const& cls = *kv.second;
+    // Centers of the MBRs that may contain the point
+    FenceIndex::Rect rect;
+    rect.min.data[0] = loc.lon - cls.half_width;
+    rect.min.data[1] = loc.lat - cls.half_height;
+    rect.max.data[0] = loc.lon + cls.half_width;
+    rect.max.data[1] = loc.lat + cls.half_height;
+    candidates.clear();
+    cls.index.RangeQuery(rect, candidates);
+    for (auto const& cand: candidates) {
+      auto const& fence = fences_[static_cast<size_t>(cand.second - 1)];
+      if (!fence) {
+        continue;
+      }
+      auto min = fence->get_min();
+      auto max = fence->get_max();
+      if (loc.lon < min.lon || loc.lon > max.lon || loc.lat < min.lat || loc.lat > max.lat) {
+        continue;
+      }
+      if (fence->contains(loc.lon, loc.lat)) {
+        result->push_back(static_cast<u64>(cand.second));
+      }
+    }
+  }
+  std::sort(result->begin(), result->end());
+}
+
+void GeofenceRegistry::update(ParamId object, Timestamp ts, Location const& loc, std::vector<GeofenceEvent>* events) {
+  std::vector<u64> inside;
+  lookup(loc, &inside);
+
+  auto& shard = shards_[object % NSHARDS];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.objects.find(object);
+  if (it == shard.objects.end()) {
+    if (inside.empty()) {
+      // Don't track objects that never visited any fence
+      return;
+    }
+    it = shard.objects.insert(std::make_pair(object, ObjectState{ ts, {} })).first;
+  } else if (ts < it->second.last) {
+    return;
+  }
+  auto& state = it->second;
+  state.last = ts;
+  auto make_event = [&](GeofenceEvent::Kind kind, u64 fence) {
+    GeofenceEvent ev = { kind, fence, object, ts, loc };
+    events->push_back(ev);
+  };
+  // Both lists are sorted, merge them
+  auto prev = state.fences.begin();
+  auto curr = inside.begin();
+  while (prev != state.fences.end() || curr != inside.end()) {
+    if (curr == inside.end() || (prev != state.fences.end() && *prev < *curr)) {
+      common::SharedLock flock(fences_lock_);
+      if (fences_.at(*prev - 1)) {
+        // Removed fences don't produce exit events
+        make_event(GeofenceEvent::EXIT, *prev);
+      }
+      ++prev;
+    } else if (prev == state.fences.end() || *curr < *prev) {
+      make_event(GeofenceEvent::ENTER, *curr);
+      ++curr;
+    } else {
+      ++prev;
+      ++curr;
+    }
+  }
+  if (inside.empty()) {
+    shard.objects.erase(it);
+  } else {
+    state.fences.swap(inside);
+  }
+}
+
+void GeofenceRegistry::process(Sample const& sample) {
+  if ((sample.payload.type & PData::LOCATION_BIT) == 0 || nfences_.load() == 0) {
+    return;
+  }
+  std::vector<GeofenceEvent> events;
+  update(sample.paramid, sample.timestamp, sample.location, &events);
+  if (events.empty() || nsubscribers_.load() == 0) {
+    return;
+  }
+  std::vector<std::pair<u64, Subscriber>> subscribers;
+  {
+    std::lock_guard<std::mutex> lock(subscribers_lock_);
+    subscribers = subscribers_;
+  }
+  for (auto const& s: subscribers) {
+    s.second(events);
+  }
+}
+
+std::vector<u64> GeofenceRegistry::get_fences(ParamId object) const {
+  auto& shard = shards_[object % NSHARDS];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.objects.find(object);
+  if (it == shard.objects.end()) {
+    return std::vector<u64>();
+  }
+  return it->second.fences;
+}
+
+}  // namespace stdb
@@ -0,0 +1,153 @@
+/**
+ * \file geofence.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Streaming geofence enter/exit detection.
+ * Fences are indexed by their MBRs. The R-tree stores points, so every
+ * fence is stored as a center of its MBR in one of the trees, one tree
+ * per power of four MBR size. The stabbing query "which MBRs contain
+ * (x, y)" becomes a range query [x - w, y - h] - [x + w, y + h] in every
+ * tree (w and h are the largest half-sizes of the MBRs in the tree).
+ * Candidates are verified using MBR and point-in-polygon tests. Every
+ * object keeps a sorted list of fences it's currently inside, events are
+ * produced by comparing it with the new one.
+ */
+#ifndef STDB_INDEX_GEOFENCE_H_
+#define STDB_INDEX_GEOFENCE_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/common/rwlock.h"
+#include "stdb/index/polygon.h"
+#include "stdb/index/rtree.h"
+
+namespace stdb {
+
+struct GeofenceEvent {
+  enum Kind {
+    ENTER,
+    EXIT,
+  };
+  Kind      kind;
+  //! Fence id
+  u64       fence;
+  //! Moving object (series) id
+  ParamId   object;
+  Timestamp timestamp;
+  Location  location;
+};
+
+class GeofenceRegistry {
+ public:
+  //! Receives events produced by one sample
+  typedef std::function<void(std::vector<GeofenceEvent> const&)> Subscriber;
+
+ private:
+  enum {
+    NSHARDS = 64,
+    //! Small nodes are faster for point queries
+    INDEX_BLOCK_SIZE = 256,
+  };
+
+  typedef rtree::RTree<LocationType, 2, INDEX_BLOCK_SIZE> FenceIndex;
+
+  //! Fences of the same size class
+  struct SizeClass {
+    FenceIndex       index;
+    //! Largest MBR half-width and half-height in the class
+    LocationType     half_width;
+    LocationType     half_height;
+  };
+
+  //! Per-object state
+  struct ObjectState {
+    Timestamp        last;
+    //! Sorted list of fences the object is inside
+    std::vector<u64> fences;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<ParamId, ObjectState> objects;
+  };
+
+  //! Fence index, entries of the removed fences are never deleted
+  std::map<int, std::unique_ptr<SizeClass>> classes_;
+  //! Fences, fence id is an index + 1 (nullptr if fence was removed)
+  std::vector<std::unique_ptr<Polygon>> fences_;
+  std::atomic<size_t> nfences_;
+  mutable common::RWLock fences_lock_;
+
+  mutable Shard shards_[NSHARDS];
+
+  std::vector<std::pair<u64, Subscriber>> subscribers_;
+  u64 next_subscriber_id_;
+  std::atomic<size_t> nsubscribers_;
+  std::mutex subscribers_lock_;
+
+  //! Find fences that contain the point, result is sorted
+  void lookup(Location const& loc, std::vector<u64>* result) const;
+
+ public:
+  GeofenceRegistry();
+
+  GeofenceRegistry(GeofenceRegistry const&) = delete;
+  GeofenceRegistry& operator = (GeofenceRegistry const&) = delete;
+
+  /** Register new fence.
+   * @return fence id (never 0)
+   */
+  u64 add_fence(Polygon const& polygon);
+
+  /** Remove fence.
+   * Objects inside the fence don't receive exit events.
+   * @return false if fence doesn't exist
+   */
+  bool remove_fence(u64 id);
+
+  //! Get number of registered fences
+  size_t size() const;
+
+  //! Add subscriber, returns subscription id
+  u64 subscribe(Subscriber const& fn);
+
+  void unsubscribe(u64 id);
+
+  /** Update object position.
+   * Samples that are older than the last processed sample of the same
+   * object are ignored.
+   * @param events is an output parameter, enter/exit events are appended to it
+   */
+  void update(ParamId object, Timestamp ts, Location const& loc, std::vector<GeofenceEvent>* events);
+
+  /** Process sample from the write path.
+   * Does nothing if sample doesn't have location or there is no fences.
+   * Produced events are pushed to subscribers.
+   */
+  void process(Sample const& sample);
+
+  //! Get sorted list of fences the object is currently inside
+  std::vector<u64> get_fences(ParamId object) const;
+};
+
+}  // namespace stdb
+
+#endif  // STDB_INDEX_GEOFENCE_H_
@@ -0,0 +1,140 @@
+/*!
+ * \file geofence_test.cc
+ */
+#include "stdb/index/geofence.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "stdb/common/logging.h"
+
+namespace stdb {
+
+static Location loc(LocationType lon, LocationType lat) {
+  Location l;
+  l.lon = lon;
+  l.lat = lat;
+  return l;
+}
+
+static Polygon square(LocationType x0, LocationType y0, LocationType x1, LocationType y1) {
+  return Polygon({ { loc(x0, y0), loc(x1, y0), loc(x1, y1), loc(x0, y1) } });
+}
+
+static Sample make_sample(ParamId id, Timestamp ts, LocationType lon, LocationType lat) {
+  Sample sample = {};
+  sample.paramid = id;
+  sample.timestamp = ts;
+  sample.location = loc(lon, lat);
+  sample.payload.type = PAYLOAD_LOCATION_FLOAT;
+  sample.payload.size = sizeof(Sample);
+  return sample;
+}
+
+TEST(TestGeofence, Test_enter_exit) {
+  GeofenceRegistry registry;
+  auto a = registry.add_fence(square(0, 0, 10, 10));
+  auto b = registry.add_fence(square(5, 5, 15, 15));
+  EXPECT_EQ(2u, registry.size());
+
+  std::vector<GeofenceEvent> events;
+  registry.update(1, 10, loc(-1, -1), &events);
+  EXPECT_TRUE(events.empty());
+
+  registry.update(1, 20, loc(1, 1), &events);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(GeofenceEvent::ENTER, events[0].kind);
+  EXPECT_EQ(a, events[0].fence);
+  EXPECT_EQ(1u, events[0].object);
+  EXPECT_EQ(20u, events[0].timestamp);
+  events.clear();
+
+  registry.update(1, 30, loc(7, 7), &events);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(GeofenceEvent::ENTER, events[0].kind);
+  EXPECT_EQ(b, events[0].fence);
+  EXPECT_EQ(std::vector<u64>({ a, b }), registry.get_fences(1));
+  events.clear();
+
+  // Late sample is ignored
+  registry.update(1, 25, loc(-1, -1), &events);
+  EXPECT_TRUE(events.empty());
+
+  registry.update(1, 40, loc(12, 12), &events);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(GeofenceEvent::EXIT, events[0].kind);
+  EXPECT_EQ(a, events[0].fence);
+  events.clear();
+
+  registry.update(1, 50, loc(20, 20), &events);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(GeofenceEvent::EXIT, events[0].kind);
+  EXPECT_EQ(b, events[0].fence);
+  EXPECT_TRUE(registry.get_fences(1).empty());
+}
+
+TEST(TestGeofence, Test_remove_fence) {
+  GeofenceRegistry registry;
+  auto a = registry.add_fence(square(0, 0, 10, 10));
+  std::vector<GeofenceEvent> events;
+  registry.update(1, 10, loc(1, 1), &events);
+  ASSERT_EQ(1u, events.size());
+  events.clear();
+  EXPECT_TRUE(registry.remove_fence(a));
+  EXPECT_FALSE(registry.remove_fence(a));
+  EXPECT_EQ(0u, registry.size());
+  registry.update(1, 20, loc(2, 2), &events);
+  registry.update(1, 30, loc(20, 20), &events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST(TestGeofence, Test_subscribers) {
+  GeofenceRegistry registry;
+  registry.add_fence(square(0, 0, 10, 10));
+  std::vector<GeofenceEvent> received;
+  auto sub = registry.subscribe([&](std::vector<GeofenceEvent> const& events) {
+    received.insert(received.end(), events.begin(), events.end());
+  });
+  registry.process(make_sample(1, 10, 1, 1));
+  registry.process(make_sample(2, 10, 1, 1));
+  auto nolocation = make_sample(1, 20, 20, 20);
+  nolocation.payload.type = PAYLOAD_FLOAT;
+  registry.process(nolocation);
+  ASSERT_EQ(2u, received.size());
+  registry.process(make_sample(1, 30, 20, 20));
+  ASSERT_EQ(3u, received.size());
+  EXPECT_EQ(GeofenceEvent::EXIT, received.back().kind);
+  registry.unsubscribe(sub);
+  registry.process(make_sample(2, 30, 20, 20));
+  EXPECT_EQ(3u, received.size());
+}
+
+TEST(TestGeofence, Test_matches_brute_force) {
+  GeofenceRegistry registry;
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> pos(0, 100);
+  std::uniform_real_distribution<float> size(1, 10);
+  std::vector<std::pair<u64, Polygon>> fences;
+  for (int i = 0; i < 1000; i++) {
+    LocationType x = pos(gen), y = pos(gen), w = size(gen), h = size(gen);
+    // Triangles
+    Polygon p({ { loc(x, y), loc(x + w, y), loc(x, y + h) } });
+    fences.push_back(std::make_pair(registry.add_fence(p), p));
+  }
+  std::vector<GeofenceEvent> events;
+  for (Timestamp ts = 0; ts < 1000; ts++) {
+    auto l = loc(pos(gen), pos(gen));
+    registry.update(7, ts, l, &events);
+    std::vector<u64> expected;
+    for (auto const& f: fences) {
+      if (f.second.contains(l.lon, l.lat)) {
+        expected.push_back(f.first);
+      }
+    }
+    ASSERT_EQ(expected, registry.get_fences(7));
+  }
+}
+
+}  // namespace stdb
@@ -458,6 +458,43 @@ bool TagValuePair::check(const char* begin, const char* end) const {
   return false;
 }
 
+TagValueSet::TagValueSet(std::vector<TagValuePair> const& pairs)
+    : pairs_(pairs)
+    , set_(StringTools::create_set(pairs.size()))
+{
+  for (auto const& pair: pairs_) {
+    auto value = pair.get_value();
+    set_.insert(StringTools::StringT(value.first, static_cast<int>(value.second)));
+  }
+}
+
+bool TagValueSet::check(const char* begin, const char* end) const {
+  const char* p = begin;
+  // skip metric name
+  p = skip_space(p, end);
+  if (p == end) {
+    return false;
+  }
+  while(*p != ' ') {
+    p++;
+  }
+  p = skip_space(p, end);
+  if (p == end) {
+    return false;
+  }
+  // Check tags
+  bool error = false;
+  while (!error && p < end) {
+    const char* tag_start = p;
+    const char* tag_end = skip_tag(tag_start, end, &error);
+    if (set_.count(StringTools::StringT(tag_start, static_cast<int>(tag_end - tag_start)))) {
+      return true;
+    }
+    p = skip_space(tag_end, end);
+  }
+  return false;
+}
+
 IndexQueryResultsIterator::IndexQueryResultsIterator(
     CompressedPListConstIterator postinglist, StringPool const* spool)
     : it_(postinglist)
@@ -548,6 +585,26 @@ IndexQueryResults IndexQueryResults::join(IndexQueryResults const& other) const
   return result;
 }
 
+IndexQueryResults IndexQueryResults::join_all(std::vector<IndexQueryResults> const& results) {
+  const StringPool *spool = nullptr;
+  std::vector<u64> ids;
+  for (auto const& res: results) {
+    if (spool == nullptr) {
+      spool = res.spool_;
+    }
+    for (auto it = res.postinglist_.begin(); it != res.postinglist_.end(); ++it) {
+      ids.push_back(*it);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  CompressedPList plist;
+  for (auto id: ids) {
+    plist.add(id);
+  }
+  return IndexQueryResults(std::move(plist), spool);
+}
+
 size_t IndexQueryResults::cardinality() const {
   return postinglist_.cardinality();
 }
@@ -585,21 +642,16 @@ IndexQueryResults IncludeMany2Many::query(IndexBase const& index) const {
   std::vector<TagValuePair> tgv;
   IndexQueryResults final_res;
   bool first = true;
-  for (auto kv: tags_) {
+  for (auto const& kv: tags_) {
     if (kv.second.size() > 0) {
-      std::stringstream pair;
-      pair << kv.first << "=" << kv.second[0];
-      TagValuePair tagval(pair.str());
-      auto results = index.tagvalue_query(tagval);
-      tgv.push_back(tagval);
-      for (size_t ix = 1; ix < kv.second.size(); ix++) {
-        std::stringstream ixpair;
-        ixpair << kv.first << "=" << kv.second[ix];
-        TagValuePair ixtagval(ixpair.str());
-        tgv.push_back(ixtagval);
-        auto res = index.tagvalue_query(ixtagval);
-        results = results.join(res).unique();
+      std::vector<IndexQueryResults> values;
+      values.reserve(kv.second.size());
+      for (auto const& value: kv.second) {
+        TagValuePair tagval(kv.first + "=" + value);
+        values.push_back(index.tagvalue_query(tagval));
+        tgv.push_back(tagval);
       }
+      auto results = IndexQueryResults::join_all(values);
       if (first) {
         final_res = std::move(results);
         first = false;
@@ -614,7 +666,7 @@ IndexQueryResults IncludeMany2Many::query(IndexBase const& index) const {
     return allmetric.filter(metric_);
   }
   final_res = final_res.intersection(allmetric);
-  return final_res.filter(metric_).filter(tgv);
+  return final_res.filter(metric_).filter(TagValueSet(tgv));
 }
 
 IndexQueryResults IncludeIfHasTag::query(IndexBase const& index) const {
@@ -654,28 +706,21 @@ IndexQueryResults JoinByTags::query(IndexBase const& index) const {
   return results.filter(metrics_).filter(pairs_);
 }
 
-SeriesNameTopology::SeriesNameTopology()
-    : index_(StringTools::create_l3_table(1000))
-{
+SeriesNameTopology::SeriesNameTopology() {
 }
 
 void SeriesNameTopology::add_name(StringT name) {
   StringT metric = skip_metric_name(name.first, name.first + name.second);
   StringT tags = std::make_pair(name.first + metric.second, name.second - metric.second);
-  auto it = index_.find(metric);
-  if (it == index_.end()) {
-    auto tagtable = StringTools::create_l2_table_ptr(1024);
-    index_[metric] = std::move(tagtable);
-    it = index_.find(metric);
+  u32 metric_id = metrics_.add(metric);
+  if (metric_id == entries_.size()) {
+    entries_.emplace_back();
   }
+  MetricEntry& entry = entries_[metric_id];
   // Iterate through tags
   const char* p = tags.first;
   const char* end = p + tags.second;
   p = skip_space(p, end);
-  if (p == end) {
-    return;
-  }
-  // Check tags
   bool error = false;
   while (!error && p < end) {
     const char* tag_start = p;
@@ -684,58 +729,72 @@ void SeriesNameTopology::add_name(StringT name) {
     StringT tag;
     StringT val;
     if (!split_pair(tagstr, &tag, &val)) {
-      error = true;
+      break;
     }
-    auto tagtable = it->second;
-    auto tagit = tagtable->find(tag);
-    if (tagit == tagtable->end()) {
-      auto valtab = StringTools::create_set_ptr(1024);
-      // tagtable.insert({tag, valtab});
-      (*tagtable)[tag] = valtab;  // std::move(valtab);
-      tagit = tagtable->find(tag);
+    u32 tag_id = entry.tags.add(tag);
+    if (tag_id == entry.values.size()) {
+      entry.values.emplace_back();
     }
-    auto valueset = tagit->second;
-    valueset->insert(val);
+    entry.values[tag_id].add(val);
     // next
     p = skip_space(tag_end, end);
   }
 }
 
+SeriesNameTopology::MetricEntry const* SeriesNameTopology::find_metric(StringT metric) const {
+  u32 id = metrics_.find(metric);
+  if (id == PrefixTrie::NO_VALUE) {
+    return nullptr;
+  }
+  return &entries_[id];
+}
+
 std::vector<StringT> SeriesNameTopology::list_metric_names() const {
-  std::vector<StringT> res;
-  std::transform(index_.begin(), index_.end(), std::back_inserter(res),
-                 [](std::pair<StringT, StringTools::L2TableTPtr> const& v) {
-                   return v.first;
-                 });
-  return res;
+  return suggest_metric_names(std::make_pair("", 0));
 }
 
 std::vector<StringT> SeriesNameTopology::list_tags(StringT metric) const {
-  std::vector<StringT> res;
-  auto it = index_.find(metric);
-  if (it == index_.end()) {
-    return res;
-  }
-  std::transform(it->second->begin(), it->second->end(), std::back_inserter(res),
-                 [](std::pair<StringT, StringTools::SetTPtr> const& v) {
-                    return v.first;
-                 });
-  return res;
+  return suggest_tags(metric, std::make_pair("", 0));
 }
 
 std::vector<StringT> SeriesNameTopology::list_tag_values(StringT metric, StringT tag) const {
-  std::vector<StringT> res;
-  auto it = index_.find(metric);
-  if (it == index_.end()) {
-    return res;
+  return suggest_tag_values(metric, tag, std::make_pair("", 0));
+}
+
+std::vector<StringT> SeriesNameTopology::suggest_metric_names(StringT prefix, size_t limit) const {
+  return metrics_.suggest(prefix, limit);
+}
+
+std::vector<StringT> SeriesNameTopology::suggest_tags(StringT metric, StringT prefix, size_t limit) const {
+  auto entry = find_metric(metric);
+  if (entry == nullptr) {
+    return std::vector<StringT>();
+  }
+  return entry->tags.suggest(prefix, limit);
+}
+
+std::vector<StringT> SeriesNameTopology::suggest_tag_values(StringT metric, StringT tag, StringT prefix,
+                                                            size_t limit) const {
+  auto entry = find_metric(metric);
+  if (entry == nullptr) {
+    return std::vector<StringT>();
   }
-  auto vit = it->second->find(tag);
-  if (vit == it->second->end()) {
-    return res;
+  u32 tag_id = entry->tags.find(tag);
+  if (tag_id == PrefixTrie::NO_VALUE) {
+    return std::vector<StringT>();
   }
-  const auto& set = vit->second;
-  std::copy(set->begin(), set->end(), std::back_inserter(res));
-  return res;
+  return entry->values[tag_id].suggest(prefix, limit);
+}
+
+size_t SeriesNameTopology::memory_use() const {
+  size_t result = metrics_.memory_use();
+  for (auto const& entry: entries_) {
+    result += entry.tags.memory_use();
+    for (auto const& values: entry.values) {
+      result += values.memory_use();
+    }
+  }
+  return result;
 }
 
 Index::Index()
@@ -758,14 +817,16 @@ size_t Index::memory_use() const {
   size_t sm = metrics_names_.get_size_in_bytes();
   size_t st = tagvalue_pairs_.get_size_in_bytes();
   size_t sp = pool_.mem_used();
-  return sm + st + sp;
+  size_t tp = topology_.memory_use();
+  return sm + st + sp + tp;
 }
 
 size_t Index::index_memory_use() const {
   // TODO: use counting allocator for table_ to provide memory stats
   size_t sm = metrics_names_.get_size_in_bytes();
   size_t st = tagvalue_pairs_.get_size_in_bytes();
-  return sm + st;
+  size_t tp = topology_.memory_use();
+  return sm + st + tp;
 }
 
 size_t Index::pool_memory_use() const {
@@ -784,7 +845,10 @@ std::tuple<common::Status, StringT> Index::append(const char* begin, const char*
   }
   // Check if name is already been added
   auto name = std::make_pair(static_cast<const char*>(buffer), tags_end - buffer);
-  if (table_.count(name) == 0) {
+  // Hash is computed once for the lookup
+  auto hash = StringTools::hash(name);
+  auto it = StringTools::find(table_, name, hash);
+  if (it == table_.end()) {
     // insert value
     auto id = pool_.add(buffer, tags_end);
     if (id == 0) {
@@ -803,7 +867,6 @@ std::tuple<common::Status, StringT> Index::append(const char* begin, const char*
     topology_.add_name(name);
     return std::make_tuple(common::Status::Ok(), name);
   }
-  auto it = table_.find(name);
   return std::make_tuple(common::Status::Ok(), it->first);
 }
 
@@ -30,6 +30,7 @@
 #include "stdb/common/exception.h"
 #include "stdb/common/logging.h"
 #include "stdb/common/status.h"
+#include "stdb/index/prefix_trie.h"
 #include "stdb/index/stringpool.h"
 
 namespace stdb {
@@ -482,6 +483,25 @@ class TagValuePair {
   bool check(const char* begin, const char* end) const;
 };
 
+/**
+ * @brief Set of tag value pairs
+ * Series name matches if it has any of the pairs. Every tag of the series
+ * name is looked up in the hash table so the cost of the check doesn't
+ * depend on the number of pairs.
+ */
+class TagValueSet {
+  std::vector<TagValuePair> pairs_;
+  StringTools::SetT set_;  //! Points to the strings owned by `pairs_`
+
+ public:
+  TagValueSet(std::vector<TagValuePair> const& pairs);
+
+  TagValueSet(TagValueSet const&) = delete;
+  TagValueSet& operator = (TagValueSet const&) = delete;
+
+  bool check(const char* begin, const char* end) const;
+};
+
 /**
  * Iterates through query results.
  * This is a pretty minimal implementation, only one ++ operator
@@ -596,6 +616,9 @@ class IndexQueryResults {
 
   IndexQueryResults join(IndexQueryResults const& other) const;
 
+  //! Union of all results (single pass, unlike the sequence of `join` calls)
+  static IndexQueryResults join_all(std::vector<IndexQueryResults> const& results);
+
   size_t cardinality() const;
 
   IndexQueryResultsIterator begin() const;
@@ -731,13 +754,27 @@ struct JoinByTags : IndexQueryNodeBase {
   virtual IndexQueryResults query(IndexBase const&) const;
 };
 
+/** Metric names, tags and tag values of all series.
+ * Every level is stored in the prefix trie so autocompletion doesn't depend
+ * on the number of series. Counters are equal to the number of series that
+ * have the metric, the tag or the tag value.
+ */
 class SeriesNameTopology {
-  typedef StringTools::L3TableT IndexT;
-  IndexT index_;
+  struct MetricEntry {
+    PrefixTrie tags;
+    //! Tag values (indexed by tag id)
+    std::vector<PrefixTrie> values;
+  };
+  PrefixTrie metrics_;
+  //! Indexed by metric id
+  std::vector<MetricEntry> entries_;
+
+  MetricEntry const* find_metric(StringT metric) const;
 
  public:
   SeriesNameTopology();
 
+  //! Add series name, name should have the same lifetime as the topology
   void add_name(StringT name);
 
   std::vector<StringT> list_metric_names() const;
@@ -745,6 +782,18 @@ class SeriesNameTopology {
   std::vector<StringT> list_tags(StringT metric) const;
 
   std::vector<StringT> list_tag_values(StringT metric, StringT tag) const;
+
+  /** Find metric names that start with `prefix`.
+   * @param limit is a max number of results, if set the most frequent names
+   *        are returned, otherwise all names in lexicographical order
+   */
+  std::vector<StringT> suggest_metric_names(StringT prefix, size_t limit = 0) const;
+
+  std::vector<StringT> suggest_tags(StringT metric, StringT prefix, size_t limit = 0) const;
+
+  std::vector<StringT> suggest_tag_values(StringT metric, StringT tag, StringT prefix, size_t limit = 0) const;
+
+  size_t memory_use() const;
 };
 
 class Index : public IndexBase {
@@ -16,6 +16,8 @@
  */
 #include "stdb/index/invertedindex.h"
 
+#include <set>
+
 #include "gtest/gtest.h"
 
 #include "stdb/index/seriesparser.h"
@@ -465,5 +467,36 @@ TEST(TestIndex, Test_index_4) {
   }
 }
 
+TEST(TestIndex, Test_index_many_values) {
+  SeriesMatcher matcher(10ul);
+  for (int i = 0; i < 1000; i++) {
+    std::string name = "foo host=host_" + std::to_string(i) + " region=r" + std::to_string(i % 4);
+    matcher.add(name.data(), name.data() + name.size());
+  }
+  // Every third host in one region
+  std::map<std::string, std::vector<std::string>> tags;
+  for (int i = 0; i < 1000; i += 3) {
+    tags["host"].push_back("host_" + std::to_string(i));
+  }
+  tags["region"].push_back("r1");
+  // Value that doesn't exist
+  tags["host"].push_back("host_1000");
+
+  IncludeMany2Many query("foo", tags);
+  auto res = matcher.search(query);
+  std::set<std::string> expected;
+  for (int i = 0; i < 1000; i += 3) {
+    if (i % 4 == 1) {
+      expected.insert("foo host=host_" + std::to_string(i) + " region=r1");
+    }
+  }
+  std::set<std::string> actual;
+  for (auto tup: res) {
+    actual.insert(std::string(std::get<0>(tup), std::get<0>(tup) + std::get<1>(tup)));
+  }
+  EXPECT_EQ(expected.size(), res.size());
+  EXPECT_EQ(expected, actual);
+}
+
 }  // namespace stdb
 
@@ -0,0 +1,251 @@
+/**
+ * \file polygon.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/index/polygon.h"
+
+#include <algorithm>
+#include <limits>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace stdb {
+
+namespace {
+
+/** Check if segment (x0, y0) - (x1, y1) intersects the rectangle
+ * (Liang-Barsky clipping).
+ */
+bool segment_intersects_rect(double x0, double y0, double x1, double y1,
+                             double minx, double miny, double maxx, double maxy) {
+  double t0 = 0.0, t1 = 1.0;
+  const double dx = x1 - x0;
+  const double dy = y1 - y0;
+  const double p[] = { -dx, dx, -dy, dy };
+  const double q[] = { x0 - minx, maxx - x0, y0 - miny, maxy - y0 };
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0) {
+      if (q[i] < 0) {
+        return false;
+      }
+      continue;
+    }
+    double t = q[i] / p[i];
+    if (p[i] < 0) {
+      t0 = std::max(t0, t);
+    } else {
+      t1 = std::min(t1, t);
+    }
+    if (t0 > t1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Polygon::Polygon(std::vector<Ring> const& rings) {
+  min_.lon = std::numeric_limits<LocationType>::max();
+  min_.lat = std::numeric_limits<LocationType>::max();
+  max_.lon = std::numeric_limits<LocationType>::lowest();
+  max_.lat = std::numeric_limits<LocationType>::lowest();
+  for (auto const& ring: rings) {
+    for (size_t i = 0; i < ring.size(); i++) {
+      auto const& a = ring[i];
+      auto const& b = ring[(i + 1) % ring.size()];
+      min_.lon = std::min(min_.lon, a.lon);
+      min_.lat = std::min(min_.lat, a.lat);
+      max_.lon = std::max(max_.lon, a.lon);
+      max_.lat = std::max(max_.lat, a.lat);
+      if (a.lon == b.lon && a.lat == b.lat) {
+        // Closing vertex of the GeoJSON ring or duplicate
+        continue;
+      }
+      x0_.push_back(a.lon);
+      y0_.push_back(a.lat);
+      x1_.push_back(b.lon);
+      y1_.push_back(b.lat);
+      slope_.push_back(a.lat == b.lat ? 0 : (b.lon - a.lon) / (b.lat - a.lat));
+    }
+  }
+}
+
+bool Polygon::contains(LocationType x, LocationType y) const {
+  u8 out;
+  contains_scalar(&x, &y, 1, &out);
+  return out != 0;
+}
+
+void Polygon::contains_scalar(const LocationType* xs, const LocationType* ys, size_t size, u8* out) const {
+  const size_t nedges = x0_.size();
+  for (size_t i = 0; i < size; i++) {
+    const LocationType x = xs[i];
+    const LocationType y = ys[i];
+    bool inside = false;
+    if (x >= min_.lon && x <= max_.lon && y >= min_.lat && y <= max_.lat) {
+      for (size_t e = 0; e < nedges; e++) {
+        bool crosses = (y0_[e] > y) != (y1_[e] > y);
+        LocationType xint = x0_[e] + (y - y0_[e]) * slope_[e];
+        if (crosses && x < xint) {
+          inside = !inside;
+        }
+      }
+    }
+    out[i] = inside ? 1 : 0;
+  }
+}
+
+void Polygon::contains(const LocationType* xs, const LocationType* ys, size_t size, u8* out) const {
+  size_t i = 0;
+  const size_t nedges = x0_.size();
+#ifdef __AVX__
+  for (; i + 8 <= size; i += 8) {
+    const __m256 px = _mm256_loadu_ps(xs + i);
+    const __m256 py = _mm256_loadu_ps(ys + i);
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t e = 0; e < nedges; e++) {
+      const __m256 y0 = _mm256_set1_ps(y0_[e]);
+      const __m256 y1 = _mm256_set1_ps(y1_[e]);
+      const __m256 c0 = _mm256_cmp_ps(y0, py, _CMP_GT_OQ);
+      const __m256 c1 = _mm256_cmp_ps(y1, py, _CMP_GT_OQ);
+      const __m256 crosses = _mm256_xor_ps(c0, c1);
+      const __m256 xint = _mm256_add_ps(_mm256_set1_ps(x0_[e]),
+                                        _mm256_mul_ps(_mm256_sub_ps(py, y0), _mm256_set1_ps(slope_[e])));
+      const __m256 left = _mm256_cmp_ps(px, xint, _CMP_LT_OQ);
+      acc = _mm256_xor_ps(acc, _mm256_and_ps(crosses, left));
+    }
+    const __m256 inbox = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(px, _mm256_set1_ps(min_.lon), _CMP_GE_OQ),
+                      _mm256_cmp_ps(px, _mm256_set1_ps(max_.lon), _CMP_LE_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(py, _mm256_set1_ps(min_.lat), _CMP_GE_OQ),
+                      _mm256_cmp_ps(py, _mm256_set1_ps(max_.lat), _CMP_LE_OQ)));
+    int mask = _mm256_movemask_ps(_mm256_and_ps(acc, inbox));
+    for (int k = 0; k < 8; k++) {
+      out[i + k] = static_cast<u8>((mask >> k) & 1);
+    }
+  }
+#elif defined(__SSE2__)
+  for (; i + 4 <= size; i += 4) {
+    const __m128 px = _mm_loadu_ps(xs + i);
+    const __m128 py = _mm_loadu_ps(ys + i);
+    __m128 acc = _mm_setzero_ps();
+    for (size_t e = 0; e < nedges; e++) {
+      const __m128 y0 = _mm_set1_ps(y0_[e]);
+      const __m128 y1 = _mm_set1_ps(y1_[e]);
+      const __m128 c0 = _mm_cmpgt_ps(y0, py);
+      const __m128 c1 = _mm_cmpgt_ps(y1, py);
+      const __m128 crosses = _mm_xor_ps(c0, c1);
+      const __m128 xint = _mm_add_ps(_mm_set1_ps(x0_[e]),
+                                     _mm_mul_ps(_mm_sub_ps(py, y0), _mm_set1_ps(slope_[e])));
+      const __m128 left = _mm_cmplt_ps(px, xint);
+      acc = _mm_xor_ps(acc, _mm_and_ps(crosses, left));
+    }
+    const __m128 inbox = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(px, _mm_set1_ps(min_.lon)), _mm_cmple_ps(px, _mm_set1_ps(max_.lon))),
+        _mm_and_ps(_mm_cmpge_ps(py, _mm_set1_ps(min_.lat)), _mm_cmple_ps(py, _mm_set1_ps(max_.lat))));
+    int mask = _mm_movemask_ps(_mm_and_ps(acc, inbox));
+    for (int k = 0; k < 4; k++) {
+      out[i + k] = static_cast<u8>((mask >> k) & 1);
+    }
+  }
+#endif
+  contains_scalar(xs + i, ys + i, size - i, out + i);
+}
+
+RegionOverlap Polygon::classify(LocationType minx, LocationType miny, LocationType maxx, LocationType maxy) const {
+  if (maxx < min_.lon || minx > max_.lon || maxy < min_.lat || miny > max_.lat) {
+    return RegionOverlap::NO_OVERLAP;
+  }
+  const size_t nedges = x0_.size();
+  for (size_t e = 0; e < nedges; e++) {
+    // Quick check using bounding box of the edge
+    if (std::max(x0_[e], x1_[e]) < minx || std::min(x0_[e], x1_[e]) > maxx ||
+        std::max(y0_[e], y1_[e]) < miny || std::min(y0_[e], y1_[e]) > maxy) {
+      continue;
+    }
+    if (segment_intersects_rect(x0_[e], y0_[e], x1_[e], y1_[e], minx, miny, maxx, maxy)) {
+      return RegionOverlap::PARTIAL_OVERLAP;
+    }
+  }
+  // Boundary doesn't cross the MBR, so the MBR is either completely
+  // inside or completely outside the polygon.
+  return contains(minx, miny) ? RegionOverlap::FULL_OVERLAP : RegionOverlap::NO_OVERLAP;
+}
+
+Location Polygon::get_min() const {
+  return min_;
+}
+
+Location Polygon::get_max() const {
+  return max_;
+}
+
+size_t Polygon::size() const {
+  return x0_.size();
+}
+
+MultiPolygon::MultiPolygon(std::vector<Polygon> const& polygons)
+    : polygons_(polygons) {
+}
+
+void MultiPolygon::add(Polygon const& polygon) {
+  polygons_.push_back(polygon);
+}
+
+bool MultiPolygon::empty() const {
+  return polygons_.empty();
+}
+
+bool MultiPolygon::contains(LocationType x, LocationType y) const {
+  for (auto const& polygon: polygons_) {
+    if (polygon.contains(x, y)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MultiPolygon::contains(const LocationType* xs, const LocationType* ys, size_t size, u8* out) const {
+  std::fill(out, out + size, 0);
+  std::vector<u8> tmp(size);
+  for (auto const& polygon: polygons_) {
+    polygon.contains(xs, ys, size, tmp.data());
+    for (size_t i = 0; i < size; i++) {
+      out[i] |= tmp[i];
+    }
+  }
+}
+
+RegionOverlap MultiPolygon::classify(LocationType minx, LocationType miny, LocationType maxx, LocationType maxy) const {
+  bool partial = false;
+  for (auto const& polygon: polygons_) {
+    switch (polygon.classify(minx, miny, maxx, maxy)) {
+      case RegionOverlap::FULL_OVERLAP:
+        return RegionOverlap::FULL_OVERLAP;
+      case RegionOverlap::PARTIAL_OVERLAP:
+        partial = true;
+        break;
+      case RegionOverlap::NO_OVERLAP:
+        break;
+    }
+  }
+  return partial ? RegionOverlap::PARTIAL_OVERLAP : RegionOverlap::NO_OVERLAP;
+}
+
+}  // namespace stdb
@@ -0,0 +1,107 @@
+/**
+ * \file polygon.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Polygon predicates for geofence queries. Point-in-polygon test uses
+ * even-odd rule and is vectorized across points: every edge is tested
+ * against 4 (SSE2) or 8 (AVX) points at once. Polygon vs MBR
+ * classification is used to prune R-tree nodes.
+ */
+#ifndef STDB_INDEX_POLYGON_H_
+#define STDB_INDEX_POLYGON_H_
+
+#include <vector>
+
+#include "stdb/common/basic.h"
+
+namespace stdb {
+
+//! Relation between region and MBR
+enum class RegionOverlap {
+  FULL_OVERLAP,     //! MBR is inside the region
+  PARTIAL_OVERLAP,  //! MBR crosses the region boundary
+  NO_OVERLAP,       //! MBR is outside the region
+};
+
+/** Polygon with holes.
+ * Consists of one or more closed rings (the last vertex of the ring is
+ * connected to the first one). First ring is an outer boundary, the rest
+ * are holes.
+ */
+class Polygon {
+ public:
+  typedef std::vector<Location> Ring;
+
+ private:
+  // Edges are stored as separate arrays to simplify vectorization
+  std::vector<LocationType> x0_;     //! x of the first vertex
+  std::vector<LocationType> y0_;     //! y of the first vertex
+  std::vector<LocationType> y1_;     //! y of the second vertex
+  std::vector<LocationType> slope_;  //! dx/dy of the edge (0 for horizontal edges)
+  std::vector<LocationType> x1_;     //! x of the second vertex
+  Location min_;
+  Location max_;
+
+ public:
+  explicit Polygon(std::vector<Ring> const& rings);
+
+  //! Test single point
+  bool contains(LocationType x, LocationType y) const;
+
+  /** Test many points.
+   * @param xs is an array of longitudes
+   * @param ys is an array of latitudes
+   * @param size is a size of both arrays
+   * @param out is an output array, out[i] is set to 1 if the point is inside the polygon, 0 otherwise
+   */
+  void contains(const LocationType* xs, const LocationType* ys, size_t size, u8* out) const;
+
+  //! Scalar version of the batch test (used for testing)
+  void contains_scalar(const LocationType* xs, const LocationType* ys, size_t size, u8* out) const;
+
+  //! Classify MBR
+  RegionOverlap classify(LocationType minx, LocationType miny, LocationType maxx, LocationType maxy) const;
+
+  //! Get bounding box
+  Location get_min() const;
+  Location get_max() const;
+
+  //! Get number of edges
+  size_t size() const;
+};
+
+/** Union of polygons.
+ */
+class MultiPolygon {
+  std::vector<Polygon> polygons_;
+
+ public:
+  MultiPolygon() = default;
+
+  explicit MultiPolygon(std::vector<Polygon> const& polygons);
+
+  void add(Polygon const& polygon);
+
+  bool empty() const;
+
+  bool contains(LocationType x, LocationType y) const;
+
+  void contains(const LocationType* xs, const LocationType* ys, size_t size, u8* out) const;
+
+  RegionOverlap classify(LocationType minx, LocationType miny, LocationType maxx, LocationType maxy) const;
+};
+
+}  // namespace stdb
+
+#endif  // STDB_INDEX_POLYGON_H_
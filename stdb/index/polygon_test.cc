@@ -0,0 +1,112 @@
+/*!
+ * \file polygon_test.cc
+ */
+#include "stdb/index/polygon.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "stdb/common/logging.h"
+
+namespace stdb {
+
+static Location loc(LocationType lon, LocationType lat) {
+  Location l;
+  l.lon = lon;
+  l.lat = lat;
+  return l;
+}
+
+static Polygon::Ring square(LocationType x0, LocationType y0, LocationType x1, LocationType y1) {
+  return { loc(x0, y0), loc(x1, y0), loc(x1, y1), loc(x0, y1), loc(x0, y0) };
+}
+
+//! Star-shaped polygon with `n` vertices
+static Polygon::Ring star(size_t n, LocationType cx, LocationType cy, u32 seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> radius(0.5, 1.0);
+  Polygon::Ring ring;
+  for (size_t i = 0; i < n; i++) {
+    double a = 2 * M_PI * i / n;
+    double r = radius(gen);
+    ring.push_back(loc(static_cast<LocationType>(cx + r * std::cos(a)),
+                       static_cast<LocationType>(cy + r * std::sin(a))));
+  }
+  return ring;
+}
+
+TEST(TestPolygon, Test_square_with_hole) {
+  Polygon polygon({ square(0, 0, 10, 10), square(4, 4, 6, 6) });
+  EXPECT_EQ(8u, polygon.size());
+  EXPECT_TRUE(polygon.contains(1, 1));
+  EXPECT_TRUE(polygon.contains(9, 5));
+  EXPECT_FALSE(polygon.contains(5, 5));
+  EXPECT_FALSE(polygon.contains(11, 5));
+  EXPECT_FALSE(polygon.contains(-1, -1));
+}
+
+TEST(TestPolygon, Test_batch_matches_scalar) {
+  Polygon polygon({ star(1000, 0, 0, 1), square(-0.2f, -0.2f, 0.2f, 0.2f) });
+  std::mt19937 gen(2);
+  std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+  const size_t N = 1003;  // not a multiple of the vector width
+  std::vector<LocationType> xs, ys;
+  for (size_t i = 0; i < N; i++) {
+    xs.push_back(dist(gen));
+    ys.push_back(dist(gen));
+  }
+  std::vector<u8> expected(N), actual(N);
+  polygon.contains_scalar(xs.data(), ys.data(), N, expected.data());
+  polygon.contains(xs.data(), ys.data(), N, actual.data());
+  size_t ninside = 0;
+  for (size_t i = 0; i < N; i++) {
+    EXPECT_EQ(expected[i], actual[i]);
+    ninside += actual[i];
+  }
+  EXPECT_GT(ninside, 0u);
+  EXPECT_LT(ninside, N);
+}
+
+TEST(TestPolygon, Test_classify) {
+  Polygon polygon({ square(0, 0, 10, 10), square(4, 4, 6, 6) });
+  EXPECT_EQ(RegionOverlap::FULL_OVERLAP, polygon.classify(1, 1, 2, 2));
+  EXPECT_EQ(RegionOverlap::NO_OVERLAP, polygon.classify(11, 11, 12, 12));
+  // Inside the hole
+  EXPECT_EQ(RegionOverlap::NO_OVERLAP, polygon.classify(4.5f, 4.5f, 5.5f, 5.5f));
+  // Crosses the outer boundary
+  EXPECT_EQ(RegionOverlap::PARTIAL_OVERLAP, polygon.classify(9, 9, 11, 11));
+  // Crosses the hole boundary
+  EXPECT_EQ(RegionOverlap::PARTIAL_OVERLAP, polygon.classify(3, 3, 5, 5));
+  // Contains the whole polygon
+  EXPECT_EQ(RegionOverlap::PARTIAL_OVERLAP, polygon.classify(-1, -1, 11, 11));
+}
+
+TEST(TestPolygon, Test_multipolygon) {
+  MultiPolygon mp;
+  EXPECT_TRUE(mp.empty());
+  mp.add(Polygon({ square(0, 0, 1, 1) }));
+  mp.add(Polygon({ square(2, 2, 3, 3) }));
+  EXPECT_FALSE(mp.empty());
+  EXPECT_TRUE(mp.contains(0.5f, 0.5f));
+  EXPECT_TRUE(mp.contains(2.5f, 2.5f));
+  EXPECT_FALSE(mp.contains(1.5f, 1.5f));
+
+  LocationType xs[] = { 0.5f, 1.5f, 2.5f, 3.5f, 0.1f };
+  LocationType ys[] = { 0.5f, 1.5f, 2.5f, 3.5f, 0.9f };
+  u8 out[5];
+  mp.contains(xs, ys, 5, out);
+  EXPECT_EQ(1, out[0]);
+  EXPECT_EQ(0, out[1]);
+  EXPECT_EQ(1, out[2]);
+  EXPECT_EQ(0, out[3]);
+  EXPECT_EQ(1, out[4]);
+
+  EXPECT_EQ(RegionOverlap::FULL_OVERLAP, mp.classify(2.1f, 2.1f, 2.9f, 2.9f));
+  EXPECT_EQ(RegionOverlap::PARTIAL_OVERLAP, mp.classify(0.5f, 0.5f, 2.5f, 2.5f));
+  EXPECT_EQ(RegionOverlap::NO_OVERLAP, mp.classify(1.2f, 1.2f, 1.8f, 1.8f));
+}
+
+}  // namespace stdb
@@ -0,0 +1,416 @@
+/**
+ * \file position_index.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/index/position_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <unordered_set>
+
+namespace stdb {
+
+namespace {
+
+u64 pack(Location const& loc) {
+  u32 lon, lat;
+  memcpy(&lon, &loc.lon, sizeof(lon));
+  memcpy(&lat, &loc.lat, sizeof(lat));
+  return static_cast<u64>(lon) | (static_cast<u64>(lat) << 32);
+}
+
+Location unpack(u64 bits) {
+  Location loc;
+  u32 lon = static_cast<u32>(bits);
+  u32 lat = static_cast<u32>(bits >> 32);
+  memcpy(&loc.lon, &lon, sizeof(lon));
+  memcpy(&loc.lat, &lat, sizeof(lat));
+  return loc;
+}
+
+template<class Bucket>
+void lock_bucket(Bucket& bucket) {
+  while (bucket.lock.exchange(true, std::memory_order_acquire)) {
+    while (bucket.lock.load(std::memory_order_relaxed)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+template<class Bucket>
+void unlock_bucket(Bucket& bucket) {
+  bucket.lock.store(false, std::memory_order_release);
+}
+
+//! Get array, allocate it if it's not allocated yet
+template<class T>
+T* get_or_allocate(std::atomic<T*>& array, size_t size) {
+  auto ptr = array.load(std::memory_order_acquire);
+  if (ptr == nullptr) {
+    T* fresh = new T[size]();
+    if (array.compare_exchange_strong(ptr, fresh)) {
+      ptr = fresh;
+    } else {
+      // Other thread has allocated the array first
+      delete[] fresh;
+    }
+  }
+  return ptr;
+}
+
+u32 round_up_pow2(u32 value) {
+  u32 result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+LatestPositionIndex::LatestPositionIndex(double cell_size, u32 nbuckets)
+    : cell_size_(cell_size)
+    , mask_(round_up_pow2(std::max(nbuckets, 1u)) - 1)
+    , buckets_(nullptr)
+    , chunks_(nullptr)
+    , size_(0)
+    , min_x_(std::numeric_limits<i32>::max())
+    , max_x_(std::numeric_limits<i32>::min())
+    , min_y_(std::numeric_limits<i32>::max())
+    , max_y_(std::numeric_limits<i32>::min()) {
+}
+
+LatestPositionIndex::~LatestPositionIndex() {
+  auto chunks = chunks_.load();
+  if (chunks) {
+    for (u32 i = 0; i < MAX_CHUNKS; i++) {
+      delete[] chunks[i].load();
+    }
+    delete[] chunks;
+  }
+  delete[] buckets_.load();
+}
+
+ParamId LatestPositionIndex::max_id() {
+  return static_cast<ParamId>(MAX_CHUNKS) * CHUNK_SIZE - 1;
+}
+
+LatestPositionIndex::Slot* LatestPositionIndex::get_slot(ParamId id) const {
+  auto chunk = id >> CHUNK_BITS;
+  if (chunk >= MAX_CHUNKS) {
+    return nullptr;
+  }
+  auto chunks = chunks_.load(std::memory_order_acquire);
+  if (chunks == nullptr) {
+    return nullptr;
+  }
+  auto slots = chunks[chunk].load(std::memory_order_acquire);
+  return slots ? slots + (id & (CHUNK_SIZE - 1)) : nullptr;
+}
+
+LatestPositionIndex::Slot* LatestPositionIndex::get_or_create_slot(ParamId id) {
+  auto chunk = id >> CHUNK_BITS;
+  if (chunk >= MAX_CHUNKS) {
+    return nullptr;
+  }
+  auto chunks = get_or_allocate(chunks_, MAX_CHUNKS);
+  auto slots = get_or_allocate(chunks[chunk], CHUNK_SIZE);
+  return slots + (id & (CHUNK_SIZE - 1));
+}
+
+void LatestPositionIndex::read_slot(Slot const* slot, Location* loc, Timestamp* ts) {
+  while (true) {
+    auto version = slot->version.load(std::memory_order_acquire);
+    if (version & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    *ts = slot->timestamp.load(std::memory_order_relaxed);
+    u64 position = slot->position.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->version.load(std::memory_order_relaxed) == version) {
+      *loc = unpack(position);
+      return;
+    }
+  }
+}
+
+i32 LatestPositionIndex::cell_x(LocationType lon) const {
+  return static_cast<i32>(std::floor(lon / cell_size_));
+}
+
+i32 LatestPositionIndex::cell_y(LocationType lat) const {
+  return static_cast<i32>(std::floor(lat / cell_size_));
+}
+
+u32 LatestPositionIndex::bucket_of(i32 x, i32 y) const {
+  u32 h = static_cast<u32>(x) * 0x9E3779B1u ^ static_cast<u32>(y) * 0x85EBCA77u;
+  h ^= h >> 15;
+  return h & mask_;
+}
+
+void LatestPositionIndex::expand_bounds(i32 x, i32 y) {
+  auto expand = [](std::atomic<i32>& bound, i32 value, bool is_min) {
+    auto current = bound.load(std::memory_order_relaxed);
+    while (is_min ? value < current : value > current) {
+      if (bound.compare_exchange_weak(current, value)) {
+        break;
+      }
+    }
+  };
+  expand(min_x_, x, true);
+  expand(max_x_, x, false);
+  expand(min_y_, y, true);
+  expand(max_y_, y, false);
+}
+
+void LatestPositionIndex::relocate(ParamId id, Slot* slot) {
+  // NOTE: buckets are allocated by `publish`
+  auto buckets = buckets_.load(std::memory_order_acquire);
+  while (true) {
+    Location loc;
+    Timestamp ts;
+    read_slot(slot, &loc, &ts);
+    u32 bucket = bucket_of(cell_x(loc.lon), cell_y(loc.lat)) + 1;
+    u32 old = slot->bucket.load(std::memory_order_seq_cst);
+    if (old == bucket) {
+      return;
+    }
+    // Lock both buckets in the same order to avoid deadlock
+    Bucket* first = old ? &buckets[old - 1] : nullptr;
+    Bucket* second = &buckets[bucket - 1];
+    if (first && first > second) {
+      std::swap(first, second);
+    }
+    if (first) {
+      lock_bucket(*first);
+    }
+    lock_bucket(*second);
+    if (slot->bucket.load(std::memory_order_acquire) == old) {
+      if (old) {
+        auto& ids = buckets[old - 1].ids;
+        auto last = ids.back();
+        ids[slot->offset] = last;
+        get_slot(last)->offset = slot->offset;
+        ids.pop_back();
+      } else {
+        size_++;
+      }
+      auto& ids = buckets[bucket - 1].ids;
+      slot->offset = static_cast<u32>(ids.size());
+      ids.push_back(id);
+      slot->bucket.store(bucket, std::memory_order_seq_cst);
+    }
+    unlock_bucket(*second);
+    if (first) {
+      unlock_bucket(*first);
+    }
+    // Position could be published by another writer while the object was
+    // moved (or the object was moved by another thread), check it again
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+LatestPositionIndex::Slot* LatestPositionIndex::publish(ParamId id, Timestamp ts, Location const& loc) {
+  auto slot = get_or_create_slot(id);
+  if (slot == nullptr) {
+    return nullptr;
+  }
+  get_or_allocate(buckets_, mask_ + 1);
+  // Acquire the seqlock, concurrent writers of the same object are serialized
+  auto version = slot->version.load(std::memory_order_relaxed);
+  while ((version & 1) || !slot->version.compare_exchange_weak(version, version + 1, std::memory_order_acquire)) {
+    if (version & 1) {
+      std::this_thread::yield();
+      version = slot->version.load(std::memory_order_relaxed);
+    }
+  }
+  // Version is zero only if position was never published
+  bool accepted = version == 0 || ts >= slot->timestamp.load(std::memory_order_relaxed);
+  if (accepted) {
+    slot->timestamp.store(ts, std::memory_order_relaxed);
+    slot->position.store(pack(loc), std::memory_order_relaxed);
+  }
+  slot->version.store(version + 2, std::memory_order_release);
+  if (!accepted) {
+    return nullptr;
+  }
+  expand_bounds(cell_x(loc.lon), cell_y(loc.lat));
+  // Order the position store before the bucket load in `relocate`
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return slot;
+}
+
+bool LatestPositionIndex::update(ParamId id, Timestamp ts, Location const& loc) {
+  if (!std::isfinite(loc.lon) || !std::isfinite(loc.lat)) {
+    return false;
+  }
+  auto slot = publish(id, ts, loc);
+  if (slot == nullptr) {
+    return false;
+  }
+  relocate(id, slot);
+  return true;
+}
+
+void LatestPositionIndex::process(Sample const& sample) {
+  if (sample.payload.type & PData::LOCATION_BIT) {
+    update(sample.paramid, sample.timestamp, sample.location);
+  }
+}
+
+bool LatestPositionIndex::get(ParamId id, Location* loc, Timestamp* ts) const {
+  auto slot = get_slot(id);
+  if (slot == nullptr || slot->bucket.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  read_slot(slot, loc, ts);
+  return true;
+}
+
+size_t LatestPositionIndex::size() const {
+  return size_.load();
+}
+
+template<class Fn>
+void LatestPositionIndex::scan(u32 bucket, Timestamp min_timestamp, Fn const& fn) const {
+  auto buckets = buckets_.load(std::memory_order_acquire);
+  if (buckets == nullptr) {
+    return;
+  }
+  auto& b = buckets[bucket];
+  lock_bucket(b);
+  for (auto id: b.ids) {
+    Location loc;
+    Timestamp ts;
+    read_slot(get_slot(id), &loc, &ts);
+    if (ts < min_timestamp) {
+      continue;
+    }
+    fn(id, loc);
+  }
+  unlock_bucket(b);
+}
+
+void LatestPositionIndex::knn(Location const& point, u32 k, Timestamp min_timestamp, std::vector<ParamId>* result) const {
+  result->clear();
+  if (k == 0 || size() == 0) {
+    return;
+  }
+  const i32 min_x = min_x_.load(), max_x = max_x_.load();
+  const i32 min_y = min_y_.load(), max_y = max_y_.load();
+  const i32 cx = cell_x(point.lon);
+  const i32 cy = cell_y(point.lat);
+
+  // Max-heap of the best candidates
+  typedef std::pair<double, ParamId> Candidate;
+  std::vector<Candidate> heap;
+  auto add = [&](ParamId id, Location const& loc) {
+    double dx = static_cast<double>(loc.lon) - point.lon;
+    double dy = static_cast<double>(loc.lat) - point.lat;
+    double dist = dx * dx + dy * dy;
+    if (heap.size() < k) {
+      heap.push_back(std::make_pair(dist, id));
+      std::push_heap(heap.begin(), heap.end());
+    } else if (dist < heap.front().first) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = std::make_pair(dist, id);
+      std::push_heap(heap.begin(), heap.end());
+    }
+  };
+  std::unordered_set<u32> visited;
+  auto visit = [&](i64 x, i64 y) {
+    if (x < min_x || x > max_x || y < min_y || y > max_y) {
+      return;
+    }
+    auto bucket = bucket_of(static_cast<i32>(x), static_cast<i32>(y));
+    if (visited.insert(bucket).second) {
+      scan(bucket, min_timestamp, add);
+    }
+  };
+
+  // Visit cells ring by ring, cells of the ring r + 1 are at least
+  // r * cell_size away from the query point.
+  for (i64 r = 0;; r++) {
+    if (r == 0) {
+      visit(cx, cy);
+    } else {
+      // Only the part of the ring that overlaps occupied cells
+      i64 x0 = std::max<i64>(cx - r, min_x), x1 = std::min<i64>(cx + r, max_x);
+      i64 y0 = std::max<i64>(cy - r + 1, min_y), y1 = std::min<i64>(cy + r - 1, max_y);
+      for (i64 x = x0; x <= x1; x++) {
+        visit(x, cy - r);
+        visit(x, cy + r);
+      }
+      for (i64 y = y0; y <= y1; y++) {
+        visit(cx - r, y);
+        visit(cx + r, y);
+      }
+    }
+    double bound = static_cast<double>(r) * cell_size_;
+    if (heap.size() == k && heap.front().first <= bound * bound) {
+      break;
+    }
+    bool covered = cx - r <= min_x && cx + r >= max_x && cy - r <= min_y && cy + r >= max_y;
+    if (covered || visited.size() > mask_) {
+      break;
+    }
+  }
+  std::sort_heap(heap.begin(), heap.end());
+  for (auto const& c: heap) {
+    result->push_back(c.second);
+  }
+}
+
+void LatestPositionIndex::range(Location const& min, Location const& max, Timestamp min_timestamp, std::vector<ParamId>* result) const {
+  result->clear();
+  if (size() == 0) {
+    return;
+  }
+  i64 x0 = std::max(cell_x(min.lon), min_x_.load());
+  i64 x1 = std::min(cell_x(max.lon), max_x_.load());
+  i64 y0 = std::max(cell_y(min.lat), min_y_.load());
+  i64 y1 = std::min(cell_y(max.lat), max_y_.load());
+  if (x0 > x1 || y0 > y1) {
+    return;
+  }
+  auto add = [&](ParamId id, Location const& loc) {
+    if (loc.lon >= min.lon && loc.lon <= max.lon && loc.lat >= min.lat && loc.lat <= max.lat) {
+      result->push_back(id);
+    }
+  };
+  if ((x1 - x0 + 1) * (y1 - y0 + 1) > mask_) {
+    // Large area, cheaper to scan all buckets
+    for (u32 bucket = 0; bucket <= mask_; bucket++) {
+      scan(bucket, min_timestamp, add);
+    }
+    return;
+  }
+  std::vector<u32> buckets;
+  for (i64 x = x0; x <= x1; x++) {
+    for (i64 y = y0; y <= y1; y++) {
+      buckets.push_back(bucket_of(static_cast<i32>(x), static_cast<i32>(y)));
+    }
+  }
+  std::sort(buckets.begin(), buckets.end());
+  buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+  for (auto bucket: buckets) {
+    scan(bucket, min_timestamp, add);
+  }
+}
+
+}  // namespace stdb
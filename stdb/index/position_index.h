@@ -0,0 +1,150 @@
+/**
+ * \file position_index.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Latest position of the moving objects.
+ * Objects are stored in a uniform grid, every grid cell is hashed into
+ * one of the buckets (buckets can be shared by several cells). Position
+ * and timestamp of the object live in a slot that is addressed by the
+ * series id directly, so an update that doesn't move the object to
+ * another cell is a short seqlock write. Only when the object crosses
+ * the cell boundary it's moved between the buckets under short per-bucket
+ * spinlocks. Queries scan the buckets of the cells that overlap the
+ * search area and check the actual position of every object.
+ */
+#ifndef STDB_INDEX_POSITION_INDEX_H_
+#define STDB_INDEX_POSITION_INDEX_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "stdb/common/basic.h"
+
+namespace stdb {
+
+class LatestPositionIndex {
+  enum {
+    CHUNK_BITS = 12,
+    CHUNK_SIZE = 1 << CHUNK_BITS,
+    MAX_CHUNKS = 1 << 16,
+  };
+
+  struct Slot {
+    //! Seqlock version of the position and timestamp (odd while updated)
+    std::atomic<u32>       version;
+    //! Packed lon and lat
+    std::atomic<u64>       position;
+    std::atomic<Timestamp> timestamp;
+    //! Bucket index + 1, 0 if object is not in the index
+    std::atomic<u32>       bucket;
+    //! Offset inside the bucket, protected by the bucket lock
+    u32                    offset;
+  };
+
+  struct Bucket {
+    std::atomic<bool>      lock;
+    std::vector<ParamId>   ids;
+  };
+
+  //! Grid cell size in coordinate units
+  const double cell_size_;
+  const u32 mask_;
+  //! Buckets and chunk table are allocated on first write
+  std::atomic<Bucket*> buckets_;
+  //! Slots are allocated by chunks on first write
+  std::atomic<std::atomic<Slot*>*> chunks_;
+  std::atomic<size_t> size_;
+  //! Grid cells occupied so far (never shrinks)
+  std::atomic<i32> min_x_, max_x_, min_y_, max_y_;
+
+  Slot* get_slot(ParamId id) const;
+  Slot* get_or_create_slot(ParamId id);
+  //! Read position and timestamp of the slot consistently
+  static void read_slot(Slot const* slot, Location* loc, Timestamp* ts);
+  i32 cell_x(LocationType lon) const;
+  i32 cell_y(LocationType lat) const;
+  u32 bucket_of(i32 x, i32 y) const;
+  void expand_bounds(i32 x, i32 y);
+
+  /** Scan bucket.
+   * Calls `fn(id, location)` for every object that was updated not earlier than
+   * `min_timestamp`.
+   */
+  template<class Fn>
+  void scan(u32 bucket, Timestamp min_timestamp, Fn const& fn) const;
+
+ protected:
+  // Two steps of the `update`, exposed for tests
+
+  /** Store position and timestamp of the object under the seqlock.
+   * @return slot of the object or null if update was ignored
+   */
+  Slot* publish(ParamId id, Timestamp ts, Location const& loc);
+
+  /** Move object to the bucket of its currently published position.
+   * Target bucket is computed from the slot, not from the caller's update,
+   * so concurrent writers of the same object can't leave it in the bucket
+   * of the older position.
+   */
+  void relocate(ParamId id, Slot* slot);
+
+ public:
+  /** C-tor
+   * @param cell_size is a size of the grid cell (in degrees), should be close to
+   *        the typical query radius
+   * @param nbuckets is a number of buckets (rounded up to the power of two)
+   */
+  explicit LatestPositionIndex(double cell_size = 0.01, u32 nbuckets = 1 << 16);
+
+  ~LatestPositionIndex();
+
+  LatestPositionIndex(LatestPositionIndex const&) = delete;
+  LatestPositionIndex& operator = (LatestPositionIndex const&) = delete;
+
+  //! Largest series id that can be stored in the index
+  static ParamId max_id();
+
+  /** Update position of the object.
+   * Updates that are older than the current position are ignored.
+   * @return false if update was ignored
+   */
+  bool update(ParamId id, Timestamp ts, Location const& loc);
+
+  //! Update position from the write path (samples without location are ignored)
+  void process(Sample const& sample);
+
+  //! Get latest position of the object, returns false if it's unknown
+  bool get(ParamId id, Location* loc, Timestamp* ts) const;
+
+  //! Number of objects in the index
+  size_t size() const;
+
+  /** Find `k` nearest objects (by euclidean distance in coordinate space).
+   * @param min_timestamp is a staleness bound, objects that weren't updated
+   *        since then are skipped
+   * @param result is an output parameter, ids are ordered by distance
+   */
+  void knn(Location const& point, u32 k, Timestamp min_timestamp, std::vector<ParamId>* result) const;
+
+  /** Find all objects inside the rectangle.
+   * @param min_timestamp is a staleness bound
+   * @param result is an output parameter
+   */
+  void range(Location const& min, Location const& max, Timestamp min_timestamp, std::vector<ParamId>* result) const;
+};
+
+}  // namespace stdb
+
+#endif  // STDB_INDEX_POSITION_INDEX_H_
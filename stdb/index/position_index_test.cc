@@ -0,0 +1,210 @@
+/*!
+ * \file position_index_test.cc
+ */
+#include "stdb/index/position_index.h"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+
+static Location loc(LocationType lon, LocationType lat) {
+  Location l;
+  l.lon = lon;
+  l.lat = lat;
+  return l;
+}
+
+static double dist2(Location const& a, Location const& b) {
+  double dx = static_cast<double>(a.lon) - b.lon;
+  double dy = static_cast<double>(a.lat) - b.lat;
+  return dx * dx + dy * dy;
+}
+
+TEST(TestPositionIndex, Test_update_and_get) {
+  LatestPositionIndex index(0.01, 16);
+  Location l;
+  Timestamp ts;
+  EXPECT_FALSE(index.get(1, &l, &ts));
+  EXPECT_TRUE(index.update(1, 100, loc(120.0f, 30.0f)));
+  EXPECT_TRUE(index.update(1, 200, loc(120.5f, 30.5f)));
+  // Late update is ignored
+  EXPECT_FALSE(index.update(1, 150, loc(121.0f, 31.0f)));
+  ASSERT_TRUE(index.get(1, &l, &ts));
+  EXPECT_EQ(200u, ts);
+  EXPECT_EQ(120.5f, l.lon);
+  EXPECT_EQ(30.5f, l.lat);
+  EXPECT_EQ(1u, index.size());
+  EXPECT_FALSE(index.update(LatestPositionIndex::max_id() + 1, 1, loc(0, 0)));
+}
+
+TEST(TestPositionIndex, Test_knn_and_range_match_brute_force) {
+  // Few buckets to make sure that collisions are handled
+  LatestPositionIndex index(0.01, 64);
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  const u32 N = 5000;
+  std::vector<Location> positions(N + 1);
+  for (int round = 0; round < 3; round++) {
+    for (u32 id = 1; id <= N; id++) {
+      positions[id] = loc(120.0f + dist(gen), 30.0f + dist(gen));
+      ASSERT_TRUE(index.update(id, static_cast<Timestamp>(round * N + id), positions[id]));
+    }
+  }
+  ASSERT_EQ(N, index.size());
+
+  for (int q = 0; q < 50; q++) {
+    // Some query points are outside of the occupied area
+    auto point = loc(119.8f + 1.4f * dist(gen), 29.8f + 1.4f * dist(gen));
+    std::vector<ParamId> actual;
+    index.knn(point, 20, 0, &actual);
+    std::vector<std::pair<double, ParamId>> all;
+    for (u32 id = 1; id <= N; id++) {
+      all.push_back(std::make_pair(dist2(positions[id], point), id));
+    }
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(20u, actual.size());
+    for (u32 i = 0; i < 20; i++) {
+      EXPECT_EQ(all[i].first, dist2(positions[actual[i]], point));
+    }
+
+    auto min = loc(point.lon - 0.05f, point.lat - 0.03f);
+    auto max = loc(point.lon + 0.05f, point.lat + 0.03f);
+    std::vector<ParamId> expected;
+    for (u32 id = 1; id <= N; id++) {
+      auto const& p = positions[id];
+      if (p.lon >= min.lon && p.lon <= max.lon && p.lat >= min.lat && p.lat <= max.lat) {
+        expected.push_back(id);
+      }
+    }
+    index.range(min, max, 0, &actual);
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  }
+
+  // Whole area
+  std::vector<ParamId> actual;
+  index.range(loc(-180, -90), loc(180, 90), 0, &actual);
+  EXPECT_EQ(N, actual.size());
+  index.knn(loc(0, 0), N + 10, 0, &actual);
+  EXPECT_EQ(N, actual.size());
+}
+
+TEST(TestPositionIndex, Test_staleness_bound) {
+  LatestPositionIndex index;
+  index.update(1, 100, loc(10.0f, 10.0f));
+  index.update(2, 200, loc(10.001f, 10.001f));
+  index.update(3, 300, loc(10.5f, 10.5f));
+  std::vector<ParamId> result;
+  index.knn(loc(10.0f, 10.0f), 2, 0, &result);
+  EXPECT_EQ(std::vector<ParamId>({ 1, 2 }), result);
+  index.knn(loc(10.0f, 10.0f), 2, 150, &result);
+  EXPECT_EQ(std::vector<ParamId>({ 2, 3 }), result);
+  index.range(loc(9, 9), loc(11, 11), 250, &result);
+  EXPECT_EQ(std::vector<ParamId>({ 3 }), result);
+}
+
+TEST(TestPositionIndex, Test_concurrent_updates) {
+  LatestPositionIndex index(0.01, 256);
+  const u32 NTHREADS = 4;
+  const u32 NOBJECTS = 1000;
+  const u32 NUPDATES = 200;
+  std::vector<std::thread> threads;
+  for (u32 t = 0; t < NTHREADS; t++) {
+    threads.emplace_back([&index, t]() {
+      std::mt19937 gen(t);
+      std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+      // Every thread owns its own objects
+      for (u32 i = 0; i < NUPDATES; i++) {
+        for (u32 j = 0; j < NOBJECTS; j++) {
+          ParamId id = 1 + t * NOBJECTS + j;
+          index.update(id, i, loc(dist(gen), dist(gen)));
+        }
+      }
+    });
+  }
+  // Concurrent reader
+  std::vector<ParamId> result;
+  for (int i = 0; i < 100; i++) {
+    index.knn(loc(0.5f, 0.5f), 10, 0, &result);
+    index.range(loc(0.2f, 0.2f), loc(0.3f, 0.3f), 0, &result);
+  }
+  for (auto& th: threads) {
+    th.join();
+  }
+  EXPECT_EQ(NTHREADS * NOBJECTS, index.size());
+  index.range(loc(0, 0), loc(1, 1), 0, &result);
+  EXPECT_EQ(NTHREADS * NOBJECTS, result.size());
+  std::sort(result.begin(), result.end());
+  EXPECT_TRUE(std::unique(result.begin(), result.end()) == result.end());
+}
+
+TEST(TestPositionIndex, Test_position_matches_timestamp) {
+  // Position and timestamp should always be read together
+  LatestPositionIndex index;
+  const Timestamp NUPDATES = 100000;
+  std::vector<std::thread> threads;
+  for (u32 t = 0; t < 2; t++) {
+    threads.emplace_back([&index, t]() {
+      for (Timestamp ts = t; ts < NUPDATES; ts += 2) {
+        index.update(1, ts, loc(static_cast<float>(ts), static_cast<float>(ts % 90)));
+      }
+    });
+  }
+  Location l;
+  Timestamp ts;
+  for (int i = 0; i < 10000; i++) {
+    if (index.get(1, &l, &ts)) {
+      ASSERT_EQ(static_cast<float>(ts), l.lon);
+      ASSERT_EQ(static_cast<float>(ts % 90), l.lat);
+    }
+  }
+  for (auto& th: threads) {
+    th.join();
+  }
+  ASSERT_TRUE(index.get(1, &l, &ts));
+  EXPECT_EQ(NUPDATES - 1, ts);
+  EXPECT_EQ(static_cast<float>(NUPDATES - 1), l.lon);
+}
+
+//! Exposes the steps of the update
+struct PositionIndexProbe : LatestPositionIndex {
+  PositionIndexProbe() : LatestPositionIndex(0.01, 1024) { }
+  using LatestPositionIndex::publish;
+  using LatestPositionIndex::relocate;
+};
+
+TEST(TestPositionIndex, Test_interleaved_writers) {
+  // Older writer relocates the object after the newer one
+  PositionIndexProbe index;
+  ASSERT_TRUE(index.update(1, 100, loc(10.0f, 10.0f)));
+  auto older = index.publish(1, 200, loc(20.0f, 20.0f));
+  auto newer = index.publish(1, 300, loc(30.0f, 30.0f));
+  ASSERT_TRUE(older != nullptr);
+  ASSERT_TRUE(newer != nullptr);
+  index.relocate(1, newer);
+  index.relocate(1, older);
+
+  std::vector<ParamId> result;
+  index.range(loc(29.5f, 29.5f), loc(30.5f, 30.5f), 0, &result);
+  EXPECT_EQ(std::vector<ParamId>({ 1 }), result);
+  index.range(loc(19.5f, 19.5f), loc(20.5f, 20.5f), 0, &result);
+  EXPECT_TRUE(result.empty());
+  index.knn(loc(30.0f, 30.0f), 1, 0, &result);
+  EXPECT_EQ(std::vector<ParamId>({ 1 }), result);
+  EXPECT_EQ(1u, index.size());
+
+  // Update that lost the race is not published
+  EXPECT_TRUE(index.publish(1, 250, loc(25.0f, 25.0f)) == nullptr);
+  Location l;
+  Timestamp ts;
+  ASSERT_TRUE(index.get(1, &l, &ts));
+  EXPECT_EQ(300u, ts);
+  EXPECT_EQ(30.0f, l.lon);
+}
+
+}  // namespace stdb
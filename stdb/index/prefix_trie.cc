@@ -0,0 +1,241 @@
+/**
+ * \file prefix_trie.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/index/prefix_trie.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace stdb {
+
+static const u32 NIL = ~0u;
+
+//! First character of the label (unsigned, children are sorted using this order)
+static inline u8 first_char(const char* label) {
+  return static_cast<u8>(label[0]);
+}
+
+PrefixTrie::PrefixTrie() {
+  // Root node has empty label
+  new_node("", 0, 0);
+}
+
+u32 PrefixTrie::new_node(const char* label, u32 label_len, u32 depth) {
+  Node node;
+  node.label = label;
+  node.label_len = label_len;
+  node.depth = depth;
+  node.first_child = NIL;
+  node.next_sibling = NIL;
+  node.count = 0;
+  node.max_count = 0;
+  node.value_id = NO_VALUE;
+  nodes_.push_back(node);
+  return static_cast<u32>(nodes_.size() - 1);
+}
+
+StringT PrefixTrie::node_value(Node const& node) const {
+  // Label is a part of the string that was added along with the node
+  return std::make_pair(node.label + node.label_len - node.depth, node.depth);
+}
+
+u32 PrefixTrie::add(StringT value, u32 count) {
+  const char* str = value.first;
+  const u32 len = value.second;
+  u32 node = 0;
+  u32 pos = 0;
+  while (pos < len) {
+    // Find child with the same first character
+    u8 ch = static_cast<u8>(str[pos]);
+    u32 prev = NIL;
+    u32 child = nodes_[node].first_child;
+    while (child != NIL && first_char(nodes_[child].label) < ch) {
+      prev = child;
+      child = nodes_[child].next_sibling;
+    }
+    if (child == NIL || first_char(nodes_[child].label) != ch) {
+      // New leaf
+      u32 leaf = new_node(str + pos, len - pos, len);
+      nodes_[leaf].next_sibling = child;
+      if (prev == NIL) {
+        nodes_[node].first_child = leaf;
+      } else {
+        nodes_[prev].next_sibling = leaf;
+      }
+      node = leaf;
+      break;
+    }
+    // Common prefix of the label and the rest of the value
+    Node const& c = nodes_[child];
+    u32 maxk = std::min(c.label_len, len - pos);
+    u32 k = 1;
+    while (k < maxk && c.label[k] == str[pos + k]) {
+      k++;
+    }
+    if (k < c.label_len) {
+      // Split the edge, new node takes the place of the child so
+      // the child keeps its index (and its value id)
+      u32 split = new_node(nodes_[child].label, k, nodes_[child].depth - nodes_[child].label_len + k);
+      Node& s = nodes_[split];
+      Node& old = nodes_[child];
+      s.first_child = child;
+      s.next_sibling = old.next_sibling;
+      s.max_count = old.max_count;
+      old.next_sibling = NIL;
+      old.label += k;
+      old.label_len -= k;
+      if (prev == NIL) {
+        nodes_[node].first_child = split;
+      } else {
+        nodes_[prev].next_sibling = split;
+      }
+      child = split;
+    }
+    node = child;
+    pos += k;
+  }
+  Node& target = nodes_[node];
+  if (target.value_id == NO_VALUE) {
+    target.value_id = static_cast<u32>(values_.size());
+    values_.push_back(node);
+  }
+  target.count += count;
+  const u32 total = target.count;
+  const u32 id = target.value_id;
+
+  // Update subtree maximums along the path
+  node = 0;
+  pos = 0;
+  while (true) {
+    Node& n = nodes_[node];
+    n.max_count = std::max(n.max_count, total);
+    pos += n.label_len;
+    if (pos == len) {
+      break;
+    }
+    u8 ch = static_cast<u8>(str[pos]);
+    node = n.first_child;
+    while (first_char(nodes_[node].label) != ch) {
+      node = nodes_[node].next_sibling;
+    }
+  }
+  return id;
+}
+
+u32 PrefixTrie::find_prefix(StringT prefix) const {
+  const char* str = prefix.first;
+  const u32 len = prefix.second;
+  u32 node = 0;
+  u32 pos = 0;
+  while (pos < len) {
+    u8 ch = static_cast<u8>(str[pos]);
+    u32 child = nodes_[node].first_child;
+    while (child != NIL && first_char(nodes_[child].label) < ch) {
+      child = nodes_[child].next_sibling;
+    }
+    if (child == NIL || first_char(nodes_[child].label) != ch) {
+      return NIL;
+    }
+    Node const& c = nodes_[child];
+    u32 k = std::min(c.label_len, len - pos);
+    if (!std::equal(c.label, c.label + k, str + pos)) {
+      return NIL;
+    }
+    node = child;
+    pos += k;
+  }
+  return node;
+}
+
+u32 PrefixTrie::find(StringT value) const {
+  u32 node = find_prefix(value);
+  if (node == NIL || nodes_[node].depth != value.second) {
+    return NO_VALUE;
+  }
+  return nodes_[node].value_id;
+}
+
+StringT PrefixTrie::get_value(u32 id) const {
+  return node_value(nodes_[values_.at(id)]);
+}
+
+u32 PrefixTrie::get_count(u32 id) const {
+  return nodes_[values_.at(id)].count;
+}
+
+std::vector<StringT> PrefixTrie::suggest(StringT prefix, size_t limit) const {
+  std::vector<StringT> results;
+  u32 start = find_prefix(prefix);
+  if (start == NIL) {
+    return results;
+  }
+  if (limit == 0) {
+    // All values in lexicographical order
+    std::vector<u32> stack = { start };
+    while (!stack.empty()) {
+      u32 node = stack.back();
+      stack.pop_back();
+      Node const& n = nodes_[node];
+      if (n.value_id != NO_VALUE) {
+        results.push_back(node_value(n));
+      }
+      if (node != start && n.next_sibling != NIL) {
+        stack.push_back(n.next_sibling);
+      }
+      if (n.first_child != NIL) {
+        stack.push_back(n.first_child);
+      }
+    }
+    return results;
+  }
+  // Best-first search, subtree is expanded only if it can contain a value
+  // with counter larger than the values that were already found
+  struct Item {
+    u32 key;
+    u32 node;
+    bool value;
+    bool operator < (Item const& other) const {
+      return key < other.key || (key == other.key && value < other.value);
+    }
+  };
+  std::priority_queue<Item> queue;
+  queue.push({ nodes_[start].max_count, start, false });
+  while (!queue.empty() && results.size() < limit) {
+    Item item = queue.top();
+    queue.pop();
+    Node const& n = nodes_[item.node];
+    if (item.value) {
+      results.push_back(node_value(n));
+      continue;
+    }
+    if (n.value_id != NO_VALUE) {
+      queue.push({ n.count, item.node, true });
+    }
+    for (u32 child = n.first_child; child != NIL; child = nodes_[child].next_sibling) {
+      queue.push({ nodes_[child].max_count, child, false });
+    }
+  }
+  return results;
+}
+
+size_t PrefixTrie::size() const {
+  return values_.size();
+}
+
+size_t PrefixTrie::memory_use() const {
+  return nodes_.capacity() * sizeof(Node) + values_.capacity() * sizeof(u32);
+}
+
+}  // namespace stdb
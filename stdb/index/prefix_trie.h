@@ -0,0 +1,92 @@
+/**
+ * \file prefix_trie.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef STDB_INDEX_PREFIX_TRIE_H_
+#define STDB_INDEX_PREFIX_TRIE_H_
+
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/index/stringpool.h"
+
+namespace stdb {
+
+/** Compressed prefix trie (radix tree) for autocompletion.
+ * Every value has a counter (cardinality). Every node stores the largest
+ * counter in its subtree so top-N values by cardinality can be found without
+ * visiting the whole subtree. The trie doesn't copy strings, edge labels
+ * point to the added strings, so the strings should outlive the trie (e.g.
+ * series names stored in the StringPool). Nodes are stored in a single
+ * array and are never removed.
+ */
+class PrefixTrie {
+  struct Node {
+    const char* label;  //! Edge label (points to one of the added strings)
+    u32 label_len;
+    u32 depth;          //! Length of the prefix that ends in this node
+    u32 first_child;    //! Children are sorted by the first character of the label
+    u32 next_sibling;
+    u32 count;          //! Value counter (0 if the node is not a value)
+    u32 max_count;      //! Largest counter in the subtree
+    u32 value_id;       //! Id of the value (NO_VALUE if the node is not a value)
+  };
+  std::vector<Node> nodes_;
+  //! Node of every value
+  std::vector<u32> values_;
+
+  u32 new_node(const char* label, u32 label_len, u32 depth);
+
+  //! Find the node whose prefix starts with `prefix` and has the smallest depth
+  u32 find_prefix(StringT prefix) const;
+
+  StringT node_value(Node const& node) const;
+
+ public:
+  enum {
+    NO_VALUE = ~0u,
+  };
+
+  PrefixTrie();
+
+  /** Add value or increment its counter.
+   * @return id of the value (ids are dense and start from 0)
+   */
+  u32 add(StringT value, u32 count = 1);
+
+  //! Return id of the value or NO_VALUE
+  u32 find(StringT value) const;
+
+  //! Return value by id
+  StringT get_value(u32 id) const;
+
+  //! Return value counter by id
+  u32 get_count(u32 id) const;
+
+  /** Find values that start with `prefix`.
+   * @param limit is a max number of results, if set values are ordered by
+   *        counter (largest first), otherwise all values are returned in
+   *        lexicographical order
+   */
+  std::vector<StringT> suggest(StringT prefix, size_t limit = 0) const;
+
+  //! Number of distinct values
+  size_t size() const;
+
+  size_t memory_use() const;
+};
+
+}  // namespace stdb
+
+#endif  // STDB_INDEX_PREFIX_TRIE_H_
@@ -0,0 +1,159 @@
+/*!
+ * \file prefix_trie_test.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "stdb/index/prefix_trie.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "stdb/index/series_matcher.h"
+
+namespace stdb {
+
+static StringT to_strt(std::string const& s) {
+  return std::make_pair(s.data(), static_cast<u32>(s.size()));
+}
+
+static std::vector<std::string> to_strings(std::vector<StringT> const& values) {
+  std::vector<std::string> result;
+  for (auto const& v: values) {
+    result.push_back(std::string(v.first, v.second));
+  }
+  return result;
+}
+
+TEST(TestPrefixTrie, Test_add_find) {
+  std::vector<std::string> values = { "cpu.user", "cpu", "cpu.system", "mem", "cpu.sys", "", "c" };
+  PrefixTrie trie;
+  for (u32 i = 0; i < values.size(); i++) {
+    EXPECT_EQ(i, trie.add(to_strt(values[i])));
+  }
+  EXPECT_EQ(values.size(), trie.size());
+  for (u32 i = 0; i < values.size(); i++) {
+    EXPECT_EQ(i, trie.find(to_strt(values[i])));
+    EXPECT_EQ(values[i], to_strings({ trie.get_value(i) }).front());
+    EXPECT_EQ(1u, trie.get_count(i));
+  }
+  // Existing value
+  EXPECT_EQ(2u, trie.add(to_strt(values[2]), 5));
+  EXPECT_EQ(6u, trie.get_count(2));
+  EXPECT_EQ(values.size(), trie.size());
+  // Prefixes of the values
+  EXPECT_EQ(PrefixTrie::NO_VALUE, trie.find(to_strt("cpu.")));
+  EXPECT_EQ(PrefixTrie::NO_VALUE, trie.find(to_strt("me")));
+  EXPECT_EQ(PrefixTrie::NO_VALUE, trie.find(to_strt("memory")));
+}
+
+TEST(TestPrefixTrie, Test_suggest_all) {
+  std::vector<std::string> values = { "cpu.user", "cpu", "cpu.system", "mem", "cpu.sys", "disk", "\xff" };
+  PrefixTrie trie;
+  for (auto const& v: values) {
+    trie.add(to_strt(v));
+  }
+  std::vector<std::string> expected = { "cpu", "cpu.sys", "cpu.system", "cpu.user" };
+  EXPECT_EQ(expected, to_strings(trie.suggest(to_strt("cp"))));
+  EXPECT_EQ(expected, to_strings(trie.suggest(to_strt("cpu"))));
+  expected = { "cpu.sys", "cpu.system" };
+  EXPECT_EQ(expected, to_strings(trie.suggest(to_strt("cpu.s"))));
+  EXPECT_TRUE(trie.suggest(to_strt("cpu.x")).empty());
+  EXPECT_TRUE(trie.suggest(to_strt("cpu.systemd")).empty());
+  EXPECT_TRUE(trie.suggest(to_strt("x")).empty());
+  // Empty prefix returns everything in lexicographical (unsigned) order
+  auto all = to_strings(trie.suggest(to_strt("")));
+  auto sorted = values;
+  std::sort(sorted.begin(), sorted.end(), [](std::string const& a, std::string const& b) {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+      return static_cast<u8>(x) < static_cast<u8>(y);
+    });
+  });
+  EXPECT_EQ(sorted, all);
+}
+
+TEST(TestPrefixTrie, Test_suggest_top_n) {
+  // Compare against the brute force solution
+  std::mt19937 rand(42);
+  std::vector<std::string> strings;
+  std::map<std::string, u32> counts;
+  PrefixTrie trie;
+  for (int i = 0; i < 2000; i++) {
+    std::string value = "host_" + std::to_string(rand() % 500);
+    strings.push_back(value);
+  }
+  for (auto const& v: strings) {
+    u32 n = 1 + rand() % 10;
+    trie.add(to_strt(v), n);
+    counts[v] += n;
+  }
+  EXPECT_EQ(counts.size(), trie.size());
+  for (std::string prefix: { "", "host_", "host_1", "host_42", "host_499" }) {
+    for (size_t limit: { 1, 5, 20 }) {
+      auto res = trie.suggest(to_strt(prefix), limit);
+      std::vector<u32> expected;
+      for (auto const& kv: counts) {
+        if (kv.first.compare(0, prefix.size(), prefix) == 0) {
+          expected.push_back(kv.second);
+        }
+      }
+      std::sort(expected.rbegin(), expected.rend());
+      expected.resize(std::min(expected.size(), limit));
+      std::vector<u32> actual;
+      for (auto const& v: res) {
+        std::string str(v.first, v.second);
+        EXPECT_EQ(0, str.compare(0, prefix.size(), prefix));
+        actual.push_back(counts[str]);
+      }
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+TEST(TestPrefixTrie, Test_series_matcher_suggest) {
+  SeriesMatcher matcher(10ul);
+  std::vector<std::string> names = {
+    "cpu.user host=a dc=eu",
+    "cpu.user host=b dc=eu",
+    "cpu.user host=c dc=us",
+    "cpu.system host=a dc=eu",
+    "cpu.system host=b dc=eu",
+    "cpu.idle host=a dc=eu",
+    "mem.free host=a",
+  };
+  for (auto const& name: names) {
+    matcher.add(name.data(), name.data() + name.size());
+  }
+  std::vector<std::string> expected = { "cpu.idle", "cpu.system", "cpu.user" };
+  EXPECT_EQ(expected, to_strings(matcher.suggest_metric("cpu")));
+  expected = { "cpu.user", "cpu.system" };
+  EXPECT_EQ(expected, to_strings(matcher.suggest_metric("cpu", 2)));
+  expected = { "dc", "host" };
+  EXPECT_EQ(expected, to_strings(matcher.suggest_tags("cpu.user", "")));
+  expected = { "host" };
+  EXPECT_EQ(expected, to_strings(matcher.suggest_tags("cpu.user", "h")));
+  EXPECT_TRUE(matcher.suggest_tags("disk", "").empty());
+  expected = { "eu", "us" };
+  EXPECT_EQ(expected, to_strings(matcher.suggest_tag_values("cpu.user", "dc", "")));
+  expected = { "eu" };
+  EXPECT_EQ(expected, to_strings(matcher.suggest_tag_values("cpu.user", "dc", "", 1)));
+  EXPECT_TRUE(matcher.suggest_tag_values("cpu.user", "rack", "").empty());
+  EXPECT_TRUE(matcher.suggest_tag_values("mem.free", "dc", "").empty());
+}
+
+}  // namespace stdb
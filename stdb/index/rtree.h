@@ -17,6 +17,7 @@
 #include "stdb/common/rwlock.h"
 #include "stdb/common/logging.h"
 #include "stdb/common/singleton.h"
+#include "stdb/index/polygon.h"
 
 namespace stdb {
 namespace rtree {
@@ -66,28 +67,21 @@ struct XRect {
 
 template <typename DType, int NDIMS>
 static inline bool Intersect(const XRect<DType, NDIMS>& rect1, const XRect<DType, NDIMS>& rect2) {
+  // Branch-free, the outcome is unpredictable during the tree scan
+  bool result = true;
   for (int i = 0; i < NDIMS; ++i) {
-    if (rect1.max.data[i] < rect2.min.data[i]) {
-      return false;
-    }
-    if (rect1.min.data[i] > rect2.max.data[i]) {
-      return false;
-    }
+    result &= (rect1.max.data[i] >= rect2.min.data[i]) & (rect1.min.data[i] <= rect2.max.data[i]);
   }
-  return true;
+  return result;
 }
 
 template <typename DType, int NDIMS>
 static inline bool Intersect(const XRect<DType, NDIMS>& rect, const XPoint<DType, NDIMS>& p) {
+  bool result = true;
   for (int i = 0; i < NDIMS; ++i) {
-    if (rect.min.data[i] > p.data[i]) {
-      return false;
-    }
-    if (rect.max.data[i] < p.data[i]) {
-      return false;
-    }
+    result &= (rect.min.data[i] <= p.data[i]) & (rect.max.data[i] >= p.data[i]);
   }
-  return true;
+  return result;
 }
 
 template <typename DType, int NDIMS>
@@ -564,17 +558,33 @@ class RTree {
     // @return Return nodeptr and index tuple.
     std::tuple<NodePtr, i32> ChooseSubnode(const Point& point) {
       DType min_distance = std::numeric_limits<DType>::max();
+      DType min_area = std::numeric_limits<DType>::max();
       size_t min_index = 0;
       for (size_t i = 0; i < this->size(); ++i) {
         auto distance = Node::Distance(entry_[i].rect, point);
-        if (distance < min_distance) {
+        if (distance > min_distance) {
+          continue;
+        }
+        // Many subnodes can contain the point, prefer the smallest one
+        // to reduce overlap between nodes
+        auto area = Area(entry_[i].rect);
+        if (distance < min_distance || area < min_area) {
           min_distance = distance;
+          min_area = area;
           min_index = i;
         }
       }
       return std::make_tuple(entry_[min_index].subnode, min_index);
     }
 
+    static DType Area(const Rect& rect) {
+      DType area = 1;
+      for (int i = 0; i < NDIMS; ++i) {
+        area *= rect.max.data[i] - rect.min.data[i];
+      }
+      return area;
+    }
+
     // Make new index node
     static IndexNode MakeNew(u32 level) {
       auto ptr = BlockPool<BLOCK_SIZE>::Get()->Allocate();
@@ -592,7 +602,7 @@ class RTree {
   // @param point The point
   // @param payload The point's payload
   void Insert(const Point& point, i64 payload) {
-    common::WriteLockGuard guard(rwlock_);
+    common::BiasedWriteLockGuard guard(rwlock_);
     if (!root_) {
       auto leaf_node = LeafNode::MakeNew(0);
       leaf_node.Insert(point, payload);
@@ -629,7 +639,7 @@ class RTree {
   // @param point The poin
   // @param result The k nearest point for returning
   void KnnQuery(const Point& point, u32 k, std::vector<i64>& result) {
-    common::ReadLockGuard guard(rwlock_);
+    common::BiasedReadLockGuard guard(rwlock_);
     enum Type {
       kItem = 0,
       kLeaf,
@@ -681,7 +691,7 @@ class RTree {
   // @param rect The range MBR
   // @param result The point in the range for returning. 
   void RangeQuery(const Rect& rect, std::vector<i64>& result, QueryStat& query_stat) {
-    common::ReadLockGuard guard(rwlock_);
+    common::BiasedReadLockGuard guard(rwlock_);
     std::vector<NodePtr> leafs;
     std::queue<NodePtr> q;
     q.push(root_);
@@ -719,6 +729,92 @@ class RTree {
     }
   }
 
+  // Range query that also returns locations of the points
+  // @param rect The range MBR
+  // @param result The points in the range and their payloads
+  void RangeQuery(const Rect& rect, std::vector<std::pair<Point, i64>>& result) const {
+    common::BiasedReadLockGuard guard(rwlock_);
+    if (!root_) {
+      return;
+    }
+    std::vector<NodePtr> stack;
+    stack.push_back(root_);
+    while (!stack.empty()) {
+      auto node = IndexNode(stack.back());
+      stack.pop_back();
+      for (u32 i = 0; i < node.size(); ++i) {
+        if (!Intersect(node.child_rect(i), rect)) {
+          continue;
+        }
+        if (node.level() != 1) {
+          stack.push_back(node.child(i));
+          continue;
+        }
+        auto leaf = LeafNode(node.child(i));
+        for (u32 j = 0; j < leaf.size(); ++j) {
+          auto& p = leaf.point_at(j);
+          if (Intersect(rect, p)) {
+            result.push_back(std::make_pair(p, leaf.payload_at(j)));
+          }
+        }
+      }
+    }
+  }
+
+  // Region query (2D only)
+  // Region should implement `classify(minx, miny, maxx, maxy)` which returns
+  // RegionOverlap and `contains(xs, ys, size, out)` which tests many points.
+  // Subtrees fully inside the region are reported without point tests,
+  // points of the partially covered leaves are tested in batch.
+  // @param region The region
+  // @param result The point in the region for returning.
+  template <class Region>
+  void RegionQuery(const Region& region, std::vector<i64>& result) const {
+    static_assert(NDIMS == 2, "Region query requires 2D tree");
+    common::BiasedReadLockGuard guard(rwlock_);
+    if (!root_) {
+      return;
+    }
+    std::vector<NodePtr> stack;
+    std::vector<DType> xs, ys;
+    std::vector<u8> mask;
+    stack.push_back(root_);
+    while (!stack.empty()) {
+      auto node = IndexNode(stack.back());
+      stack.pop_back();
+      for (u32 i = 0; i < node.size(); ++i) {
+        auto& r = node.child_rect(i);
+        auto overlap = region.classify(r.min.data[0], r.min.data[1], r.max.data[0], r.max.data[1]);
+        if (overlap == RegionOverlap::NO_OVERLAP) {
+          continue;
+        }
+        if (overlap == RegionOverlap::FULL_OVERLAP) {
+          CollectAll(node.child(i), node.level() - 1, result);
+          continue;
+        }
+        if (node.level() != 1) {
+          stack.push_back(node.child(i));
+          continue;
+        }
+        auto leaf = LeafNode(node.child(i));
+        xs.resize(leaf.size());
+        ys.resize(leaf.size());
+        mask.resize(leaf.size());
+        for (u32 j = 0; j < leaf.size(); ++j) {
+          auto& p = leaf.point_at(j);
+          xs[j] = p.data[0];
+          ys[j] = p.data[1];
+        }
+        region.contains(xs.data(), ys.data(), leaf.size(), mask.data());
+        for (u32 j = 0; j < leaf.size(); ++j) {
+          if (mask[j]) {
+            result.push_back(leaf.payload_at(j));
+          }
+        }
+      }
+    }
+  }
+
   // Check the tree is valid.
   void CheckValid() {
     std::queue<NodePtr> q;
@@ -750,7 +846,7 @@ class RTree {
 
   // Return the debug string of RTree.
   std::string DebugString(u32 min_level = 0) {
-    common::ReadLockGuard guard(rwlock_);
+    common::BiasedReadLockGuard guard(rwlock_);
     std::stringstream ss;
     
     ss << "Root:" << (void*)root_;
@@ -784,6 +880,24 @@ class RTree {
   }
 
  protected:
+  // Collect payloads of all points of the subtree
+  // @param ptr The subtree root
+  // @param level The level of the subtree root
+  // @param result The output
+  void CollectAll(NodePtr ptr, u32 level, std::vector<i64>& result) const {
+    if (level == 0) {
+      auto leaf = LeafNode(ptr);
+      for (u32 j = 0; j < leaf.size(); ++j) {
+        result.push_back(leaf.payload_at(j));
+      }
+      return;
+    }
+    auto node = IndexNode(ptr);
+    for (u32 i = 0; i < node.size(); ++i) {
+      CollectAll(node.child(i), level - 1, result);
+    }
+  }
+
   // Update the path's rect
   // @param paths The inserted paths
   // @param index The index 
@@ -880,7 +994,7 @@ class RTree {
  protected:
   NodePtr root_ = nullptr;
   std::mutex mutex_;
-  common::RWLock rwlock_;
+  mutable common::BiasedRWLock rwlock_;
 };
 
 }  // namespace rtree
@@ -3,6 +3,9 @@
  */
 #include "stdb/index/rtree.h"
 
+#include <algorithm>
+#include <random>
+
 #include "gtest/gtest.h"
 
 #include "stdb/common/logging.h"
@@ -103,5 +106,43 @@ TEST(TestRTree, Insert) {
   }
 }
 
+TEST(TestRTree, RegionQuery) {
+  RTree<float, 2, 96> rtree;
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dist(0, 10);
+  std::vector<std::pair<float, float>> points;
+  for (i64 i = 0; i < 5000; i++) {
+    RTree<float, 2, 96>::Point point;
+    point.data[0] = dist(gen);
+    point.data[1] = dist(gen);
+    points.push_back(std::make_pair(point.data[0], point.data[1]));
+    rtree.Insert(point, i);
+  }
+  // Triangle with a square hole
+  Polygon::Ring outer, hole;
+  Location l;
+  l.lon = 1; l.lat = 1; outer.push_back(l);
+  l.lon = 9; l.lat = 1; outer.push_back(l);
+  l.lon = 5; l.lat = 9; outer.push_back(l);
+  l.lon = 4; l.lat = 2; hole.push_back(l);
+  l.lon = 6; l.lat = 2; hole.push_back(l);
+  l.lon = 6; l.lat = 4; hole.push_back(l);
+  l.lon = 4; l.lat = 4; hole.push_back(l);
+  MultiPolygon region;
+  region.add(Polygon({ outer, hole }));
+
+  std::vector<i64> expected;
+  for (i64 i = 0; i < static_cast<i64>(points.size()); i++) {
+    if (region.contains(points[i].first, points[i].second)) {
+      expected.push_back(i);
+    }
+  }
+  std::vector<i64> results;
+  rtree.RegionQuery(region, results);
+  std::sort(results.begin(), results.end());
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(expected, results);
+}
+
 }  // namespace rtree
 }  // namespace stdb
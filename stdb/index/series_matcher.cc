@@ -43,7 +43,14 @@ i64 SeriesMatcher::add(const char* begin, const char* end) {
 i64 SeriesMatcher::add(const char* begin, const char* end, const Location& location) {
   std::lock_guard<std::mutex> guard(mutex);
   locations.push_back(location);
-  return add_impl(begin, end);
+  auto id = add_impl(begin, end);
+  if (id != 0) {
+    rtree::RTree<LocationType, RTREE_NDIMS, RTREE_BLOCK_SIZE>::Point point;
+    point.data[0] = location.lon;
+    point.data[1] = location.lat;
+    rtree_index.Insert(point, id);
+  }
+  return id;
 }
 
 i64 SeriesMatcher::add_impl(const char* begin, const char* end) {
@@ -182,49 +189,51 @@ std::vector<SeriesMatcher::SeriesNameT> SeriesMatcher::search(IndexQueryNodeBase
   return result;
 }
 
-std::vector<StringT> SeriesMatcher::suggest_metric(std::string prefix) const {
-  std::vector<StringT> results;
+std::vector<std::tuple<i64, Location>> SeriesMatcher::search_location(const Location& min, const Location& max) const {
+  rtree::RTree<LocationType, RTREE_NDIMS, RTREE_BLOCK_SIZE>::Rect rect;
+  rect.min.data[0] = min.lon;
+  rect.min.data[1] = min.lat;
+  rect.max.data[0] = max.lon;
+  rect.max.data[1] = max.lat;
+  std::vector<std::pair<rtree::RTree<LocationType, RTREE_NDIMS, RTREE_BLOCK_SIZE>::Point, i64>> points;
+  rtree_index.RangeQuery(rect, points);
+  std::vector<std::tuple<i64, Location>> result;
+  result.reserve(points.size());
+  for (auto const& item: points) {
+    Location location;
+    location.lon = item.first.data[0];
+    location.lat = item.first.data[1];
+    result.push_back(std::make_tuple(item.second, location));
+  }
+  return result;
+}
+
+std::vector<i64> SeriesMatcher::search_region(const MultiPolygon& region) const {
+  std::vector<i64> result;
+  rtree_index.RegionQuery(region, result);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+std::vector<StringT> SeriesMatcher::suggest_metric(std::string prefix, size_t limit) const {
   std::lock_guard<std::mutex> guard(mutex);
-  results = index.get_topology().list_metric_names();
-  auto resit = std::remove_if(results.begin(), results.end(), [prefix](StringT val) {
-    if (val.second < prefix.size()) {
-      return true;
-    }
-    auto eq = std::equal(prefix.begin(), prefix.end(), val.first);
-    return !eq;
-  });
-  results.erase(resit, results.end());
-  return results;
+  return index.get_topology().suggest_metric_names(tostrt(prefix), limit);
 }
 
-std::vector<StringT> SeriesMatcher::suggest_tags(std::string metric, std::string tag_prefix) const {
-  std::vector<StringT> results;
+std::vector<StringT> SeriesMatcher::suggest_tags(std::string metric, std::string tag_prefix, size_t limit) const {
   std::lock_guard<std::mutex> guard(mutex);
-  results = index.get_topology().list_tags(tostrt(metric));
-  auto resit = std::remove_if(results.begin(), results.end(), [tag_prefix](StringT val) {
-    if (val.second < tag_prefix.size()) {
-       return true;
-    }
-    auto eq = std::equal(tag_prefix.begin(), tag_prefix.end(), val.first);
-    return !eq;
-  });
-  results.erase(resit, results.end());
-  return results;
+  return index.get_topology().suggest_tags(tostrt(metric), tostrt(tag_prefix), limit);
 }
 
-std::vector<StringT> SeriesMatcher::suggest_tag_values(std::string metric, std::string tag, std::string value_prefix) const {
-  std::vector<StringT> results;
+std::vector<StringT> SeriesMatcher::suggest_tag_values(std::string metric, std::string tag, std::string value_prefix,
+                                                       size_t limit) const {
   std::lock_guard<std::mutex> guard(mutex);
-  results = index.get_topology().list_tag_values(tostrt(metric), tostrt(tag));
-  auto resit = std::remove_if(results.begin(), results.end(), [value_prefix](StringT val) {
-    if (val.second < value_prefix.size()) {
-      return true;
-    }
-    auto eq = std::equal(value_prefix.begin(), value_prefix.end(), val.first);
-    return !eq;
-  });
-  results.erase(resit, results.end());
-  return results;
+  return index.get_topology().suggest_tag_values(tostrt(metric), tostrt(tag), tostrt(value_prefix), limit);
+}
+
+size_t SeriesMatcher::cardinality() const {
+  std::lock_guard<std::mutex> guard(mutex);
+  return index.cardinality();
 }
 
 size_t SeriesMatcher::memory_use() const {
@@ -26,6 +26,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "stdb/index/polygon.h"
 #include "stdb/index/rtree.h"
 #include "stdb/index/series_matcher_base.h"
 #include "stdb/index/invertedindex.h"
@@ -96,11 +97,32 @@ struct SeriesMatcher : public SeriesMatcherBase {
 
   std::vector<SeriesNameT> search(IndexQueryNodeBase const& query) const;
 
-  std::vector<StringT> suggest_metric(std::string prefix) const;
+  /** Find static objects inside the bounding box.
+   * @param min is a south-west corner of the box
+   * @param max is a north-east corner of the box
+   * @return list of series ids and locations
+   */
+  std::vector<std::tuple<i64, Location>> search_location(const Location& min, const Location& max) const;
+
+  /** Find static objects inside the polygon (or multipolygon).
+   * @param region is a geofence
+   * @return list of series ids
+   */
+  std::vector<i64> search_region(const MultiPolygon& region) const;
+
+  /** Autocomplete metric name.
+   * @param limit is a max number of results, if set the names with the largest
+   *        number of series are returned, otherwise all names are returned
+   */
+  std::vector<StringT> suggest_metric(std::string prefix, size_t limit = 0) const;
+
+  std::vector<StringT> suggest_tags(std::string metric, std::string tag_prefix, size_t limit = 0) const;
 
-  std::vector<StringT> suggest_tags(std::string metric, std::string tag_prefix) const;
+  std::vector<StringT> suggest_tag_values(std::string metric, std::string tag, std::string value_prefix,
+                                          size_t limit = 0) const;
 
-  std::vector<StringT> suggest_tag_values(std::string metric, std::string tag, std::string value_prefix) const;
+  //! Get number of series (changes every time new series is added)
+  size_t cardinality() const;
 
   size_t memory_use() const;
 
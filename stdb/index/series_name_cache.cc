@@ -0,0 +1,75 @@
+/**
+ * \file series_name_cache.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/index/series_name_cache.h"
+
+#include <string.h>
+
+#include "stdb/common/hash.h"
+
+namespace stdb {
+
+SeriesNameCache::SeriesNameCache(size_t capacity)
+    : capacity_(capacity) { }
+
+u64 SeriesNameCache::hash(const char* begin, const char* end) {
+  return common::MurmurHash64A(begin, static_cast<u64>(end - begin));
+}
+
+ParamId SeriesNameCache::get(const char* begin, const char* end) const {
+  auto it = table_.find(hash(begin, end));
+  if (it == table_.end()) {
+    return 0;
+  }
+  const Entry& entry = it->second;
+  auto size = static_cast<size_t>(end - begin);
+  if (entry.size != size || memcmp(arena_.data() + entry.offset, begin, size) != 0) {
+    // hash collision
+    return 0;
+  }
+  return entry.id;
+}
+
+void SeriesNameCache::put(const char* begin, const char* end, ParamId id) {
+  auto size = static_cast<size_t>(end - begin);
+  if (size == 0 || size > LIMITS_MAX_SNAME) {
+    return;
+  }
+  if (arena_.size() + size > capacity_) {
+    clear();
+  }
+  Entry entry = {};
+  entry.offset = static_cast<u32>(arena_.size());
+  entry.size = static_cast<u32>(size);
+  entry.id = id;
+  arena_.insert(arena_.end(), begin, end);
+  // Colliding name replaces the previous one
+  table_[hash(begin, end)] = entry;
+}
+
+void SeriesNameCache::clear() {
+  table_.clear();
+  arena_.clear();
+}
+
+size_t SeriesNameCache::size() const {
+  return table_.size();
+}
+
+size_t SeriesNameCache::mem_used() const {
+  return arena_.size();
+}
+
+}  // namespace stdb
@@ -0,0 +1,75 @@
+/**
+ * \file series_name_cache.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef STDB_INDEX_SERIES_NAME_CACHE_H_
+#define STDB_INDEX_SERIES_NAME_CACHE_H_
+
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+#include "stdb/common/basic.h"
+
+namespace stdb {
+
+/** Per-session cache that maps raw (non canonical) series names to ids.
+ * Clients tend to send the same series name in the same form over and over
+ * again, so the name can be resolved without canonicalization. The cache is
+ * not thread safe and should be owned by a single session.
+ * Every entry stores a copy of the raw name so hash collisions never produce
+ * a wrong id.
+ */
+class SeriesNameCache {
+  struct Entry {
+    u32 offset;  //! Offset of the name inside the arena
+    u32 size;    //! Size of the name
+    ParamId id;  //! Series id
+  };
+
+  tsl::robin_map<u64, Entry> table_;
+  std::vector<char>          arena_;
+  size_t                     capacity_;
+
+ public:
+  /**
+   * @param capacity is a max number of bytes that the cache can hold,
+   *        the cache is cleared when the limit is reached
+   */
+  explicit SeriesNameCache(size_t capacity = LIMITS_MAX_SNAME * 0x400);
+
+  /** Get series id by raw series name.
+   * @return series id or 0 if the name is not cached
+   */
+  ParamId get(const char* begin, const char* end) const;
+
+  //! Add raw series name to the cache
+  void put(const char* begin, const char* end, ParamId id);
+
+  //! Remove all elements
+  void clear();
+
+  //! Get number of cached names
+  size_t size() const;
+
+  //! Get number of bytes used by cached names
+  size_t mem_used() const;
+
+  //! Hash function used by the cache
+  static u64 hash(const char* begin, const char* end);
+};
+
+}  // namespace stdb
+
+#endif  // STDB_INDEX_SERIES_NAME_CACHE_H_
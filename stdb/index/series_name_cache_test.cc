@@ -0,0 +1,57 @@
+/*!
+ * \file series_name_cache_test.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "stdb/index/series_name_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+
+TEST(SeriesNameCache, Test_get_put) {
+  SeriesNameCache cache;
+  std::string foo = "put foo host=1 region=A";
+  std::string bar = "put foo region=A host=1";
+  EXPECT_EQ(0ul, cache.get(foo.data(), foo.data() + foo.size()));
+  cache.put(foo.data(), foo.data() + foo.size(), 1024ul);
+  EXPECT_EQ(1024ul, cache.get(foo.data(), foo.data() + foo.size()));
+  // Raw names are not canonicalized by the cache
+  EXPECT_EQ(0ul, cache.get(bar.data(), bar.data() + bar.size()));
+  cache.put(bar.data(), bar.data() + bar.size(), 1024ul);
+  EXPECT_EQ(1024ul, cache.get(bar.data(), bar.data() + bar.size()));
+  EXPECT_EQ(2ul, cache.size());
+  // Prefix of the cached name shouldn't match
+  EXPECT_EQ(0ul, cache.get(foo.data(), foo.data() + foo.size() - 1));
+}
+
+TEST(SeriesNameCache, Test_capacity) {
+  SeriesNameCache cache(40);
+  std::string foo = "cpu host=1 region=A";
+  std::string bar = "cpu host=2 region=A";
+  std::string buz = "cpu host=3 region=A";
+  cache.put(foo.data(), foo.data() + foo.size(), 1ul);
+  cache.put(bar.data(), bar.data() + bar.size(), 2ul);
+  cache.put(buz.data(), buz.data() + buz.size(), 3ul);
+  EXPECT_EQ(0ul, cache.get(foo.data(), foo.data() + foo.size()));
+  EXPECT_EQ(3ul, cache.get(buz.data(), buz.data() + buz.size()));
+  EXPECT_LE(cache.mem_used(), 40ul);
+  cache.clear();
+  EXPECT_EQ(0ul, cache.size());
+  EXPECT_EQ(0ul, cache.get(buz.data(), buz.data() + buz.size()));
+}
+
+}  // namespace stdb
@@ -19,12 +19,46 @@
 #include <map>
 #include <algorithm>
 #include <regex>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "stdb/common/exception.h"
 #include "stdb/common/logging.h"
+#include "stdb/index/spatial_join.h"
 
 namespace stdb {
 
+static const char ESC_CHAR = '\\';
+
+//! Find first occurrence of `a`, `b` or `c` in [p, end), return end if not found
+static const char* find_first_of(const char* p, const char* end, char a, char b, char c) {
+#ifdef __SSE2__
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  const __m128i vc = _mm_set1_epi8(c);
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+                                           _mm_cmpeq_epi8(chunk, vb)),
+                              _mm_cmpeq_epi8(chunk, vc));
+    int mask = _mm_movemask_epi8(eq);
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+    p += 16;
+  }
+#endif
+  while (p < end && *p != a && *p != b && *p != c) {
+    p++;
+  }
+  return p;
+}
+
 //! Move pointer to the of the whitespace, return this pointer or end on error
 static const char* skip_space(const char* p, const char* end) {
   while (p < end && (*p == ' ' || *p == '\t')) {
@@ -45,18 +79,16 @@ static StringTools::StringT get_tag_name(const char* p, const char* end) {
   return { begin, p - begin };
 }
 
-static const char ESC_CHAR = '\\';
-
 static const char* copy_until(const char* begin, const char* end, const char pattern, char** out) {
   if (begin == end) {
     return begin;
   }
   const char* escape_char = *begin == ESC_CHAR ? begin : nullptr;
-  char* it_out = *out;
-  while (true) {
-    *it_out = *begin;
-    it_out++;
-    begin++;
+  const char* first = begin;
+  begin++;
+  while (begin < end) {
+    // Only the pattern and the escape character are interesting, skip the rest
+    begin = find_first_of(begin, end, pattern, ESC_CHAR, ESC_CHAR);
     if (begin == end) {
       break;
     }
@@ -64,11 +96,14 @@ static const char* copy_until(const char* begin, const char* end, const char pat
       if (std::prev(begin) != escape_char) {
         break;
       }
-    } else if (*begin == ESC_CHAR) {
+    } else {
       escape_char = begin;
     }
+    begin++;
   }
-  *out = it_out;
+  auto size = begin - first;
+  memcpy(*out, first, static_cast<size_t>(size));
+  *out += size;
   return begin;
 }
 
@@ -78,13 +113,14 @@ static const char* skip_tag(const char* begin, const char* end, bool *error) {
   // skip until '='
   const char* p = begin;
   while (p < end) {
-    if (*p == '=') {
+    p = find_first_of(p, end, '=', ' ', ESC_CHAR);
+    if (p == end || *p == '=') {
       break;
     } else if (*p == ' ') {
       if (std::prev(p) != escape_char) {
         break;
       }
-    } else if (*p == ESC_CHAR) {
+    } else {
       escape_char = p;
     }
     p++;
@@ -96,11 +132,14 @@ static const char* skip_tag(const char* begin, const char* end, bool *error) {
   // skip until ' '
   const char* c = p;
   while (c < end) {
-    if (*c == ' ') {
+    c = find_first_of(c, end, ' ', ESC_CHAR, ESC_CHAR);
+    if (c == end) {
+      break;
+    } else if (*c == ' ') {
       if (std::prev(c) != escape_char) {
         break;
       }
-    } else if (*c == ESC_CHAR) {
+    } else {
       escape_char = c;
     }
     c++;
@@ -109,6 +148,31 @@ static const char* skip_tag(const char* begin, const char* end, bool *error) {
   return c;
 }
 
+/** Build sort key from the first 8 bytes of the tag name (bytes before '=').
+ * Bytes are stored in big-endian order so keys can be compared as integers.
+ * Signed char order is preserved and the '=' is treated as the smallest
+ * character, the same way the full comparison does it.
+ */
+static u64 tag_key_prefix(const char* tag, const char* end) {
+  const u64 ONES = 0x0101010101010101ull;
+  const u64 HIGH = 0x8080808080808080ull;
+  u64 word = 0;
+  if (end - tag >= 8) {
+    memcpy(&word, tag, 8);
+  } else {
+    memcpy(&word, tag, static_cast<size_t>(end - tag));
+  }
+  // Find the first '=' (SWAR zero byte search)
+  u64 eq = word ^ (ONES * static_cast<u8>('='));
+  u64 zero = (eq - ONES) & ~eq & HIGH;
+  u64 mask = ~0ull;
+  if (zero != 0) {
+    auto nbytes = static_cast<u32>(__builtin_ctzll(zero)) / 8;
+    mask = nbytes == 0 ? 0ull : (~0ull >> (64 - 8 * nbytes));
+  }
+  return __builtin_bswap64((word ^ HIGH) & mask);
+}
+
 common::Status SeriesParser::to_canonical_form(const char* begin, const char* end,
                                                char* out_begin, char* out_end,
                                                const char** keystr_begin,
@@ -193,8 +257,24 @@ common::Status SeriesParser::to_canonical_form(const char* begin, const char* en
     }
     return true;
   };
-  std::sort(tags, tags + ix_tag, std::ref(sort_pred));  // std::sort can't move from predicate if predicate is a rvalue
-  // nor it can pass predicate by reference
+  // Tags are ordered by the 8-byte key prefix first, full comparison is needed only
+  // if prefixes are equal. Number of tags is small so insertion sort is used.
+  u64 prefix[LIMITS_MAX_TAGS];
+  for (auto i = 0u; i < ix_tag; i++) {
+    prefix[i] = tag_key_prefix(tags[i], end);
+  }
+  for (auto i = 1u; i < ix_tag; i++) {
+    const char* tag = tags[i];
+    u64 key = prefix[i];
+    auto j = i;
+    while (j > 0 && (prefix[j - 1] > key || (prefix[j - 1] == key && sort_pred(tag, tags[j - 1])))) {
+      tags[j] = tags[j - 1];
+      prefix[j] = prefix[j - 1];
+      j--;
+    }
+    tags[j] = tag;
+    prefix[j] = key;
+  }
   // Copy tags to output string
   for (auto i = 0u; i < ix_tag; i++) {
     // insert space
@@ -353,4 +433,139 @@ void GroupByTag::refresh_() {
   }
 }
 
+GroupByLocation::GroupByLocation(const SeriesMatcher& matcher,
+                                 std::vector<ParamId> const& ids,
+                                 Location min,
+                                 Location max,
+                                 double cell_size,
+                                 u32 geohash)
+    : local_matcher_(1ul) {
+  std::vector<ParamId> sorted(ids);
+  std::sort(sorted.begin(), sorted.end());
+  auto items = matcher.search_location(min, max);
+  std::unordered_map<std::string, ParamId> cells;
+  for (auto const& item: items) {
+    auto id = static_cast<ParamId>(std::get<0>(item));
+    if (!std::binary_search(sorted.begin(), sorted.end(), id)) {
+      continue;
+    }
+    auto sname = matcher.id2str(static_cast<i64>(id));
+    std::string name(sname.first, sname.first + sname.second);
+    auto const& loc = std::get<1>(item);
+    std::stringstream str;
+    str << name.substr(0, name.find_first_of(' '));
+    if (geohash != 0) {
+      str << " geohash=" << GroupByLocation::geohash(loc.lon, loc.lat, geohash);
+    } else {
+      // Tags should be ordered
+      str.precision(10);
+      str << " lat=" << std::floor(loc.lat / cell_size) * cell_size
+          << " lon=" << std::floor(loc.lon / cell_size) * cell_size;
+    }
+    auto cell = str.str();
+    auto it = cells.find(cell);
+    if (it == cells.end()) {
+      auto localid = static_cast<ParamId>(local_matcher_.add(cell.data(), cell.data() + cell.size()));
+      it = cells.insert(std::make_pair(cell, localid)).first;
+    }
+    ids_[id] = it->second;
+  }
+}
+
+PlainSeriesMatcher& GroupByLocation::get_series_matcher() {
+  return local_matcher_;
+}
+
+std::unordered_map<ParamId, ParamId> GroupByLocation::get_mapping() const {
+  return ids_;
+}
+
+namespace {
+
+//! Find locations of the series from the list
+std::vector<SpatialJoin::Item> locate(const SeriesMatcher& matcher, std::vector<ParamId> const& ids) {
+  std::vector<ParamId> sorted(ids);
+  std::sort(sorted.begin(), sorted.end());
+  Location min, max;
+  min.lon = -180;
+  min.lat = -90;
+  max.lon = 180;
+  max.lat = 90;
+  std::vector<SpatialJoin::Item> result;
+  for (auto const& item: matcher.search_location(min, max)) {
+    auto id = static_cast<ParamId>(std::get<0>(item));
+    if (std::binary_search(sorted.begin(), sorted.end(), id)) {
+      SpatialJoin::Item it = { id, std::get<1>(item) };
+      result.push_back(it);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+GroupBySpatialJoin::GroupBySpatialJoin(const SeriesMatcher& matcher,
+                                       std::vector<ParamId> const& left,
+                                       std::vector<ParamId> const& right,
+                                       double distance,
+                                       u32 nthreads)
+    : local_matcher_(1ul)
+    , npairs_(0) {
+  auto pairs = SpatialJoin::join(locate(matcher, left), locate(matcher, right), distance, nthreads);
+  npairs_ = pairs.size();
+  std::unordered_map<std::string, ParamId> groups;
+  for (auto const& kv: SpatialJoin::nearest(pairs)) {
+    auto rname = matcher.id2str(static_cast<i64>(kv.first));
+    auto lname = matcher.id2str(static_cast<i64>(kv.second));
+    std::string right_name(rname.first, rname.first + rname.second);
+    std::string left_name(lname.first, lname.first + lname.second);
+    auto pos = left_name.find_first_of(' ');
+    auto group = right_name.substr(0, right_name.find_first_of(' ')) +
+        (pos == std::string::npos ? std::string() : left_name.substr(pos));
+    auto it = groups.find(group);
+    if (it == groups.end()) {
+      auto localid = static_cast<ParamId>(local_matcher_.add(group.data(), group.data() + group.size()));
+      it = groups.insert(std::make_pair(group, localid)).first;
+    }
+    ids_[kv.first] = it->second;
+  }
+}
+
+PlainSeriesMatcher& GroupBySpatialJoin::get_series_matcher() {
+  return local_matcher_;
+}
+
+std::unordered_map<ParamId, ParamId> GroupBySpatialJoin::get_mapping() const {
+  return ids_;
+}
+
+std::string GroupByLocation::geohash(LocationType lon, LocationType lat, u32 precision) {
+  static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+  double lonrange[] = { -180.0, 180.0 };
+  double latrange[] = { -90.0, 90.0 };
+  std::string result;
+  bool even = true;
+  int bit = 0;
+  int ch = 0;
+  while (result.size() < precision) {
+    double* range = even ? lonrange : latrange;
+    double value = even ? lon : lat;
+    double mid = (range[0] + range[1]) / 2;
+    ch <<= 1;
+    if (value >= mid) {
+      ch |= 1;
+      range[0] = mid;
+    } else {
+      range[1] = mid;
+    }
+    even = !even;
+    if (++bit == 5) {
+      result.push_back(BASE32[ch]);
+      bit = 0;
+      ch = 0;
+    }
+  }
+  return result;
+}
+
 }  // namespace stdb
@@ -106,6 +106,71 @@ struct GroupByTag {
   std::unordered_map<ParamId, ParamId> get_mapping() const;
 };
 
+/** Spatial group-by processor. Maps static objects to the cells of the
+ * regular grid (or geohash cells) using their locations from the R-tree
+ * index. Each cell of each metric gets its own local series name, e.g.
+ * `metric geohash=u4pru` or `metric lat=59.9 lon=30.3` (south-west corner
+ * of the cell).
+ */
+struct GroupByLocation {
+  //! Mapping from global parameter ids to local (cell) ids
+  std::unordered_map<ParamId, ParamId> ids_;
+  //! Local string pool. All cell names lives here.
+  PlainSeriesMatcher local_matcher_;
+
+  /** C-tor.
+   * @param matcher is a global series matcher
+   * @param ids is a list of series to group (series without location are skipped)
+   * @param min is a south-west corner of the bounding box
+   * @param max is a north-east corner of the bounding box
+   * @param cell_size is a size of the grid cell in degrees (used if `geohash` is 0)
+   * @param geohash is a geohash precision (number of characters)
+   */
+  GroupByLocation(const SeriesMatcher& matcher,
+                  std::vector<ParamId> const& ids,
+                  Location min,
+                  Location max,
+                  double cell_size,
+                  u32 geohash);
+
+  PlainSeriesMatcher& get_series_matcher();
+  std::unordered_map<ParamId, ParamId> get_mapping() const;
+
+  //! Encode location using geohash with `precision` characters
+  static std::string geohash(LocationType lon, LocationType lat, u32 precision);
+};
+
+/** Spatial join group-by processor. Every series from the right selection
+ * is attached to the closest series from the left selection within the
+ * distance (e.g. traffic sensors to weather stations). Each left series of
+ * each right metric gets its own local series name, e.g.
+ * `traffic.speed station=A` (right metric with tags of the left series).
+ */
+struct GroupBySpatialJoin {
+  //! Mapping from right parameter ids to local ids
+  std::unordered_map<ParamId, ParamId> ids_;
+  //! Local string pool. All group names lives here.
+  PlainSeriesMatcher local_matcher_;
+  //! Number of (left, right) pairs within the distance
+  size_t npairs_;
+
+  /** C-tor.
+   * @param matcher is a global series matcher
+   * @param left is a list of series to group by (series without location are skipped)
+   * @param right is a list of series to group (series without location are skipped)
+   * @param distance is a join distance in meters
+   * @param nthreads is a number of threads used by the join (0 - use all cores)
+   */
+  GroupBySpatialJoin(const SeriesMatcher& matcher,
+                     std::vector<ParamId> const& left,
+                     std::vector<ParamId> const& right,
+                     double distance,
+                     u32 nthreads = 0);
+
+  PlainSeriesMatcher& get_series_matcher();
+  std::unordered_map<ParamId, ParamId> get_mapping() const;
+};
+
 }  // namespace stdb
 
 #endif  // STDB_INDEX_SERIES_PARSER_H_
@@ -180,5 +180,106 @@ TEST(SeriesParser, Test_seriesparser_9) {
   EXPECT_STREQ("\\ host\\ name=foo\\bar\\", keystr.c_str());
 }
 
-}  // namespace stdb
+TEST(SeriesParser, Test_seriesparser_10) {
+  // Long tag names with common prefixes
+  const char* series1 = "cpu.user.percentage   datacenter_location_b=europe\\ west "
+                        "datacenter_location_a=europe\\ east datacenter=eu host_identifier=127.0.0.1";
+  auto len = strlen(series1);
+  char out[0x140];
+  const char* pbegin = nullptr;
+  const char* pend = nullptr;
+  auto status = SeriesParser::to_canonical_form(series1, series1 + len, out, out + len, &pbegin, &pend);
+
+  EXPECT_EQ(common::Status::Ok(), status);
+
+  std::string expected = "cpu.user.percentage datacenter=eu datacenter_location_a=europe\\ east "
+                         "datacenter_location_b=europe\\ west host_identifier=127.0.0.1";
+  std::string actual = std::string(static_cast<const char*>(out), pend);
+  EXPECT_STREQ(expected.c_str(), actual.c_str());
+}
+
+TEST(GroupByLocation, Test_geohash) {
+  EXPECT_EQ("ezs42", GroupByLocation::geohash(-5.6f, 42.6f, 5));
+  EXPECT_EQ("u4pruydq", GroupByLocation::geohash(10.40744f, 57.64911f, 8));
+  EXPECT_EQ("s", GroupByLocation::geohash(0.1f, 0.1f, 1));
+}
 
+TEST(GroupByLocation, Test_grid_mapping) {
+  SeriesMatcher matcher(1ul);
+  std::vector<std::string> names = {
+    "temp sensor=a", "temp sensor=b", "temp sensor=c", "temp sensor=d", "hum sensor=a",
+  };
+  std::vector<Location> locations = {
+    { 30.31f, 59.91f }, { 30.39f, 59.99f }, { 30.41f, 59.91f }, { 37.61f, 55.75f }, { 30.31f, 59.91f },
+  };
+  std::vector<ParamId> ids;
+  for (size_t i = 0; i < names.size(); i++) {
+    auto const& name = names[i];
+    ids.push_back(static_cast<ParamId>(matcher.add(name.data(), name.data() + name.size(), locations[i])));
+  }
+  // Series without location
+  std::string noloc = "temp sensor=e";
+  ids.push_back(static_cast<ParamId>(matcher.add(noloc.data(), noloc.data() + noloc.size())));
+
+  Location min = { -180, -90 }, max = { 180, 90 };
+  GroupByLocation grid(matcher, ids, min, max, 0.1, 0);
+  auto mapping = grid.get_mapping();
+  ASSERT_EQ(5u, mapping.size());
+  EXPECT_EQ(mapping[ids[0]], mapping[ids[1]]);
+  EXPECT_NE(mapping[ids[0]], mapping[ids[2]]);
+  EXPECT_NE(mapping[ids[0]], mapping[ids[3]]);
+  // Different metrics are mapped to different cells
+  EXPECT_NE(mapping[ids[0]], mapping[ids[4]]);
+  EXPECT_EQ(0u, mapping.count(ids[5]));
+  auto sname = grid.get_series_matcher().id2str(static_cast<i64>(mapping[ids[0]]));
+  EXPECT_EQ("temp lat=59.9 lon=30.3", std::string(sname.first, sname.first + sname.second));
+
+  // Bounding box
+  Location bmin = { 30.0f, 59.0f }, bmax = { 31.0f, 60.0f };
+  GroupByLocation geohash(matcher, ids, bmin, bmax, 0, 4);
+  mapping = geohash.get_mapping();
+  EXPECT_EQ(4u, mapping.size());
+  EXPECT_EQ(0u, mapping.count(ids[3]));
+  sname = geohash.get_series_matcher().id2str(static_cast<i64>(mapping[ids[0]]));
+  EXPECT_EQ("temp geohash=" + GroupByLocation::geohash(30.31f, 59.91f, 4),
+            std::string(sname.first, sname.first + sname.second));
+}
+
+TEST(GroupBySpatialJoin, Test_nearest_station) {
+  SeriesMatcher matcher(1ul);
+  auto add = [&](std::string name, Location loc) {
+    return static_cast<ParamId>(matcher.add(name.data(), name.data() + name.size(), loc));
+  };
+  std::vector<ParamId> stations = {
+    add("station name=a", { 30.300f, 59.900f }),
+    add("station name=b", { 30.400f, 59.900f }),
+  };
+  // About 1km east of the station `a`, 4.6km from `b`
+  auto s1 = add("speed sensor=1", { 30.318f, 59.900f });
+  // Between the stations, closer to `b`
+  auto s2 = add("speed sensor=2", { 30.360f, 59.900f });
+  // Far away
+  auto s3 = add("speed sensor=3", { 31.000f, 59.900f });
+  auto f1 = add("flow sensor=1", { 30.301f, 59.900f });
+  std::string noloc = "speed sensor=4";
+  auto s4 = static_cast<ParamId>(matcher.add(noloc.data(), noloc.data() + noloc.size()));
+
+  GroupBySpatialJoin join(matcher, stations, { s1, s2, s3, s4, f1 }, 3500);
+  auto mapping = join.get_mapping();
+  ASSERT_EQ(3u, mapping.size());
+  EXPECT_EQ(0u, mapping.count(s3));
+  EXPECT_EQ(0u, mapping.count(s4));
+  EXPECT_NE(mapping[s1], mapping[s2]);
+  EXPECT_NE(mapping[s1], mapping[f1]);
+  auto name = [&](ParamId id) {
+    auto sname = join.get_series_matcher().id2str(static_cast<i64>(mapping[id]));
+    return std::string(sname.first, sname.first + sname.second);
+  };
+  EXPECT_EQ("speed name=a", name(s1));
+  EXPECT_EQ("speed name=b", name(s2));
+  EXPECT_EQ("flow name=a", name(f1));
+  // s2 is within the distance of both stations
+  EXPECT_EQ(4u, join.npairs_);
+}
+
+}  // namespace stdb
@@ -0,0 +1,202 @@
+/**
+ * \file spatial_join.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/index/spatial_join.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <unordered_map>
+
+#include "stdb/common/geo.h"
+
+namespace stdb {
+
+namespace {
+
+using common::DEG2RAD;
+
+const double METERS_PER_DEGREE = common::EARTH_RADIUS * DEG2RAD;
+//! Number of left objects processed by the thread at once
+const size_t CHUNK_SIZE = 256;
+
+u64 cell_key(i64 x, i64 y) {
+  return (static_cast<u64>(static_cast<u32>(x)) << 32) | static_cast<u32>(y);
+}
+
+}  // namespace
+
+double SpatialJoin::haversine(Location const& a, Location const& b) {
+  return common::haversine(a.lon, a.lat, b.lon, b.lat);
+}
+
+std::vector<SpatialJoin::Pair> SpatialJoin::join(std::vector<Item> const& left,
+                                                 std::vector<Item> const& right,
+                                                 double distance,
+                                                 u32 nthreads) {
+  std::vector<Pair> result;
+  if (left.empty() || right.empty() || !(distance >= 0)) {
+    return result;
+  }
+  // Cell size in degrees of latitude
+  const double cell = std::max(distance / METERS_PER_DEGREE, 1e-6);
+  auto cell_of = [cell](double coord) {
+    return static_cast<i64>(std::floor(coord / cell));
+  };
+  // Columns of the grid wrap around at the antimeridian, column width
+  // is adjusted to fit 360 degrees exactly.
+  const i64 ncols = std::max<i64>(static_cast<i64>(std::ceil(360.0 / cell)), 1);
+  const double col_width = 360.0 / static_cast<double>(ncols);
+  auto col_of = [col_width](double lon) {
+    return static_cast<i64>(std::floor((lon + 180.0) / col_width));
+  };
+  auto wrap = [ncols](i64 x) {
+    x %= ncols;
+    return x < 0 ? x + ncols : x;
+  };
+
+  // Partition right side, objects of the same cell are stored together
+  std::vector<u32> order(right.size());
+  std::vector<u64> keys(right.size());
+  for (u32 i = 0; i < right.size(); i++) {
+    order[i] = i;
+    keys[i] = cell_key(wrap(col_of(right[i].location.lon)), cell_of(right[i].location.lat));
+  }
+  std::sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+    return keys[a] < keys[b];
+  });
+  std::unordered_map<u64, std::pair<u32, u32>> cells;
+  for (u32 i = 0; i < order.size();) {
+    u32 j = i;
+    while (j < order.size() && keys[order[j]] == keys[order[i]]) {
+      j++;
+    }
+    cells[keys[order[i]]] = std::make_pair(i, j);
+    i = j;
+  }
+
+  std::vector<u32> sorted_left(left.size());
+  for (u32 i = 0; i < left.size(); i++) {
+    sorted_left[i] = i;
+  }
+  std::sort(sorted_left.begin(), sorted_left.end(), [&](u32 a, u32 b) {
+    return left[a].id < left[b].id;
+  });
+
+  auto probe = [&](Item const& item, std::vector<Pair>* out) {
+    auto const& loc = item.location;
+    auto begin = out->size();
+    auto check = [&](Item const& other) {
+      double d = haversine(loc, other.location);
+      if (d <= distance) {
+        Pair pair = { item.id, other.id, d };
+        out->push_back(pair);
+      }
+    };
+    // Longitude degrees are shorter away from the equator, use the
+    // latitude that is closest to the pole within the search radius.
+    double lat = std::min(90.0, std::fabs(static_cast<double>(loc.lat)) + cell);
+    double coslat = std::cos(lat * DEG2RAD);
+    double dlon = coslat > 1e-9 ? cell / coslat : 360.0;
+    i64 x0 = col_of(loc.lon - dlon), x1 = col_of(loc.lon + dlon);
+    if (x1 - x0 + 1 >= ncols) {
+      x0 = 0;
+      x1 = ncols - 1;
+    }
+    i64 y0 = cell_of(loc.lat - cell), y1 = cell_of(loc.lat + cell);
+    if (static_cast<double>(x1 - x0 + 1) * static_cast<double>(y1 - y0 + 1) > static_cast<double>(cells.size())) {
+      // Search area is larger than the occupied area
+      for (auto const& other: right) {
+        check(other);
+      }
+    } else {
+      for (i64 x = x0; x <= x1; x++) {
+        for (i64 y = y0; y <= y1; y++) {
+          auto it = cells.find(cell_key(wrap(x), y));
+          if (it == cells.end()) {
+            continue;
+          }
+          for (u32 i = it->second.first; i < it->second.second; i++) {
+            check(right[order[i]]);
+          }
+        }
+      }
+    }
+    std::sort(out->begin() + static_cast<std::ptrdiff_t>(begin), out->end(), [](Pair const& a, Pair const& b) {
+      return a.right < b.right;
+    });
+  };
+
+  const size_t nchunks = (left.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  std::vector<std::vector<Pair>> chunks(nchunks);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    while (true) {
+      size_t ix = next++;
+      if (ix >= nchunks) {
+        break;
+      }
+      auto end = std::min(left.size(), (ix + 1) * CHUNK_SIZE);
+      for (size_t i = ix * CHUNK_SIZE; i < end; i++) {
+        probe(left[sorted_left[i]], &chunks[ix]);
+      }
+    }
+  };
+  if (nthreads == 0) {
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nthreads = static_cast<u32>(std::min(static_cast<size_t>(nthreads), nchunks));
+  std::vector<std::thread> threads;
+  for (u32 i = 1; i < nthreads; i++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto& thread: threads) {
+    thread.join();
+  }
+
+  size_t total = 0;
+  for (auto const& chunk: chunks) {
+    total += chunk.size();
+  }
+  result.reserve(total);
+  for (auto const& chunk: chunks) {
+    result.insert(result.end(), chunk.begin(), chunk.end());
+  }
+  return result;
+}
+
+std::vector<std::pair<ParamId, ParamId>> SpatialJoin::nearest(std::vector<Pair> const& pairs) {
+  std::unordered_map<ParamId, Pair const*> best;
+  for (auto const& pair: pairs) {
+    auto it = best.find(pair.right);
+    if (it == best.end()) {
+      best[pair.right] = &pair;
+    } else if (pair.distance < it->second->distance ||
+               (pair.distance == it->second->distance && pair.left < it->second->left)) {
+      it->second = &pair;
+    }
+  }
+  std::vector<std::pair<ParamId, ParamId>> result;
+  result.reserve(best.size());
+  for (auto const& kv: best) {
+    result.push_back(std::make_pair(kv.first, kv.second->left));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+}  // namespace stdb
@@ -0,0 +1,66 @@
+/**
+ * \file spatial_join.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Distance join of two sets of static objects. Partition based: right
+ * side is hashed into a grid with cell size equal to the join distance,
+ * every left object probes the cells that can contain objects within the
+ * distance. Grid columns wrap around at the antimeridian so objects on
+ * both sides of it are joined. Left side is split between the threads.
+ */
+#ifndef STDB_INDEX_SPATIAL_JOIN_H_
+#define STDB_INDEX_SPATIAL_JOIN_H_
+
+#include <tuple>
+#include <vector>
+
+#include "stdb/common/basic.h"
+
+namespace stdb {
+
+struct SpatialJoin {
+  struct Item {
+    ParamId  id;
+    Location location;
+  };
+
+  struct Pair {
+    ParamId left;
+    ParamId right;
+    //! Distance in meters
+    double  distance;
+  };
+
+  //! Great-circle distance between two points in meters
+  static double haversine(Location const& a, Location const& b);
+
+  /** Find all pairs of objects that are within `distance` meters of each other.
+   * Result is ordered by left id, then by right id.
+   * @param nthreads is a number of threads (0 - use all cores)
+   */
+  static std::vector<Pair> join(std::vector<Item> const& left,
+                                std::vector<Item> const& right,
+                                double distance,
+                                u32 nthreads = 0);
+
+  /** Map every right object to the closest left object within `distance`.
+   * Objects that don't have a pair are not in the result.
+   * @return vector of (right id, left id) pairs ordered by right id
+   */
+  static std::vector<std::pair<ParamId, ParamId>> nearest(std::vector<Pair> const& pairs);
+};
+
+}  // namespace stdb
+
+#endif  // STDB_INDEX_SPATIAL_JOIN_H_
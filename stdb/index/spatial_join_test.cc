@@ -0,0 +1,95 @@
+/*!
+ * \file spatial_join_test.cc
+ */
+#include "stdb/index/spatial_join.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+
+static std::vector<SpatialJoin::Item> make_items(u32 n, ParamId first_id, u32 seed, double lat0) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(0.0, 0.5);
+  std::vector<SpatialJoin::Item> items;
+  for (u32 i = 0; i < n; i++) {
+    SpatialJoin::Item item;
+    item.id = first_id + i;
+    item.location.lon = static_cast<LocationType>(30.0 + dist(gen));
+    item.location.lat = static_cast<LocationType>(lat0 + dist(gen));
+    items.push_back(item);
+  }
+  return items;
+}
+
+TEST(TestSpatialJoin, Test_haversine) {
+  Location a = { 30.0f, 10.0f }, b = { 30.0f, 11.0f };
+  EXPECT_NEAR(111195, SpatialJoin::haversine(a, b), 10);
+}
+
+TEST(TestSpatialJoin, Test_join_matches_brute_force) {
+  // Far from the equator to check that longitude is scaled properly
+  for (double lat0: { 0.0, 70.0 }) {
+    auto left = make_items(500, 1, 1, lat0);
+    auto right = make_items(3000, 10000, 2, lat0);
+    const double distance = 2000;
+    std::vector<std::pair<ParamId, ParamId>> expected;
+    for (auto const& l: left) {
+      for (auto const& r: right) {
+        if (SpatialJoin::haversine(l.location, r.location) <= distance) {
+          expected.push_back(std::make_pair(l.id, r.id));
+        }
+      }
+    }
+    ASSERT_FALSE(expected.empty());
+    for (u32 nthreads: { 1u, 4u }) {
+      auto pairs = SpatialJoin::join(left, right, distance, nthreads);
+      std::vector<std::pair<ParamId, ParamId>> actual;
+      for (auto const& p: pairs) {
+        EXPECT_LE(p.distance, distance);
+        actual.push_back(std::make_pair(p.left, p.right));
+      }
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+TEST(TestSpatialJoin, Test_join_across_antimeridian) {
+  std::vector<SpatialJoin::Item> left = {
+    { 1, { 179.999f, 10.0f } },
+    { 2, { -179.999f, -10.0f } },
+  };
+  std::vector<SpatialJoin::Item> right = {
+    { 10, { -179.999f, 10.0f } },
+    { 11, { 179.999f, -10.0f } },
+    { 12, { 0.0f, 10.0f } },
+  };
+  auto pairs = SpatialJoin::join(left, right, 1000);
+  ASSERT_EQ(2u, pairs.size());
+  EXPECT_EQ(1u, pairs[0].left);
+  EXPECT_EQ(10u, pairs[0].right);
+  EXPECT_EQ(2u, pairs[1].left);
+  EXPECT_EQ(11u, pairs[1].right);
+  EXPECT_NEAR(219, pairs[0].distance, 5);
+}
+
+TEST(TestSpatialJoin, Test_nearest) {
+  std::vector<SpatialJoin::Pair> pairs = {
+    { 1, 10, 500.0 },
+    { 1, 11, 100.0 },
+    { 2, 10, 300.0 },
+    { 2, 11, 100.0 },
+    { 2, 12, 50.0 },
+  };
+  auto nearest = SpatialJoin::nearest(pairs);
+  std::vector<std::pair<ParamId, ParamId>> expected = {
+    { 10, 2 },
+    { 11, 1 },  // tie, smaller left id wins
+    { 12, 2 },
+  };
+  EXPECT_EQ(expected, nearest);
+}
+
+}  // namespace stdb
@@ -16,6 +16,8 @@
 
 #include "stdb/index/stringpool.h"
 
+#include <cstring>
+
 #include <boost/regex.hpp>
 
 #include "stdb/common/logging.h"
@@ -184,18 +186,85 @@ size_t StringPool::mem_used() const {
   return res;
 }
 
+namespace {
+
+// Constants and mixing functions of the wyhash (public domain)
+const u64 WYP[] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+inline void wymum(u64* a, u64* b) {
+  __uint128_t r = *a;
+  r *= *b;
+  *a = static_cast<u64>(r);
+  *b = static_cast<u64>(r >> 64);
+}
+
+inline u64 wymix(u64 a, u64 b) {
+  wymum(&a, &b);
+  return a ^ b;
+}
+
+inline u64 wyr8(const u8* p) {
+  u64 v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+inline u64 wyr4(const u8* p) {
+  u32 v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+inline u64 wyr3(const u8* p, size_t k) {
+  return (static_cast<u64>(p[0]) << 16) | (static_cast<u64>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+u64 wyhash(const void* key, size_t len, u64 seed) {
+  const u8* p = static_cast<const u8*>(key);
+  seed ^= wymix(seed ^ WYP[0], WYP[1]);
+  u64 a, b;
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+      b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = wyr3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      // Three independent lanes
+      u64 see1 = seed, see2 = seed;
+      do {
+        seed = wymix(wyr8(p) ^ WYP[1], wyr8(p + 8) ^ seed);
+        see1 = wymix(wyr8(p + 16) ^ WYP[2], wyr8(p + 24) ^ see1);
+        see2 = wymix(wyr8(p + 32) ^ WYP[3], wyr8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = wymix(wyr8(p) ^ WYP[1], wyr8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = wyr8(p + i - 16);
+    b = wyr8(p + i - 8);
+  }
+  a ^= WYP[1];
+  b ^= seed;
+  wymum(&a, &b);
+  return wymix(a ^ WYP[0] ^ len, b ^ WYP[1]);
+}
+
+}  // namespace
+
 size_t StringTools::hash(StringT str) {
-  // implementation of Dan Bernstein's djb2
-  const char* begin = str.first;
-  int len = str.second;
-  const char* end = begin + len;
-  size_t hash = 5381;
-  size_t c;
-  while (begin < end) {
-    c = static_cast<size_t>(*begin++);
-    hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-  }
-  return hash;
+  return wyhash(str.first, static_cast<size_t>(str.second), 0);
 }
 
 bool StringTools::equal(StringT lhs, StringT rhs) {
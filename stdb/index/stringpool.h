@@ -107,18 +107,43 @@ class StringPool {
 #ifdef USE_STD_HASHMAP
 #define MapClass std::unordered_map
 #define SetClass std::unordered_set
+//! Hash table that keeps hash values of the keys
+template<class K, class V, class H, class E>
+using HashedMapClass = std::unordered_map<K, V, H, E>;
+template<class K, class H, class E>
+using HashedSetClass = std::unordered_set<K, H, E>;
 #else
 #define MapClass tsl::robin_map
 #define SetClass tsl::robin_set
+//! Hash table that keeps hash values of the keys (rehashing doesn't recompute them)
+template<class K, class V, class H, class E>
+using HashedMapClass = tsl::robin_map<K, V, H, E, std::allocator<std::pair<K, V>>, true>;
+template<class K, class H, class E>
+using HashedSetClass = tsl::robin_set<K, H, E, std::allocator<K>, true>;
 #endif
 
 struct StringTools {
   //! Pooled string
   typedef std::pair<const char*, int> StringT;
 
+  /** Compute hash of the string.
+   * The hash function processes 16 bytes per iteration using 64x64->128 bit
+   * multiplication (wyhash construction), all output bits depend on
+   * every input byte.
+   */
   static size_t hash(StringT str);
   static bool equal(StringT lhs, StringT rhs);
 
+  //! Find the key in the table using precomputed hash
+  template<class TableT>
+  static typename TableT::const_iterator find(TableT const& table, StringT key, size_t hash) {
+#ifdef USE_STD_HASHMAP
+    return table.find(key);
+#else
+    return table.find(key, hash);
+#endif
+  }
+
   struct Hash {
     std::size_t operator()(StringT const& str) const noexcept {
       return StringTools::hash(str);
@@ -131,13 +156,13 @@ struct StringTools {
     }
   };
 
-  typedef MapClass<StringT, i64, StringTools::Hash, StringTools::EqualTo>      TableT;
+  typedef HashedMapClass<StringT, i64, StringTools::Hash, StringTools::EqualTo>      TableT;
   typedef std::shared_ptr<TableT> TableTPtr;
-  typedef SetClass<StringT, StringTools::Hash, StringTools::EqualTo>           SetT;
+  typedef HashedSetClass<StringT, StringTools::Hash, StringTools::EqualTo>           SetT;
   typedef std::shared_ptr<SetT> SetTPtr;
-  typedef MapClass<StringT, SetTPtr, StringTools::Hash, StringTools::EqualTo>     L2TableT;
+  typedef HashedMapClass<StringT, SetTPtr, StringTools::Hash, StringTools::EqualTo>     L2TableT;
   typedef std::shared_ptr<L2TableT> L2TableTPtr;
-  typedef MapClass<StringT, L2TableTPtr, StringTools::Hash, StringTools::EqualTo> L3TableT;
+  typedef HashedMapClass<StringT, L2TableTPtr, StringTools::Hash, StringTools::EqualTo> L3TableT;
   typedef std::shared_ptr<L3TableT> L3TableTPtr;
   typedef MapClass<i64, StringT>      InvT;
   // typedef MapClass<i64, std::tuple<StringT, Location>> InvT;
@@ -16,6 +16,10 @@
  */
 #include "stdb/index/stringpool.h"
 
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "stdb/common/logging.h"
@@ -34,6 +38,35 @@ TEST(TestStringPool, Test) {
   EXPECT_STREQ(std::string(result_bar.first, result_bar.first + result_bar.second).c_str(), bar);
 }
 
+TEST(TestStringTools, Test_hash) {
+  // All lengths should be handled and every byte should affect the hash
+  std::string base(100, 'x');
+  std::unordered_set<size_t> hashes;
+  for (size_t len = 0; len <= base.size(); len++) {
+    hashes.insert(StringTools::hash(std::make_pair(base.data(), static_cast<int>(len))));
+  }
+  EXPECT_EQ(base.size() + 1, hashes.size());
+  for (size_t len: { 1, 3, 4, 8, 16, 17, 48, 49, 100 }) {
+    std::string str = base.substr(0, len);
+    auto expected = StringTools::hash(std::make_pair(str.data(), static_cast<int>(len)));
+    for (size_t ix = 0; ix < len; ix++) {
+      std::string other = str;
+      other[ix] = 'y';
+      EXPECT_NE(expected, StringTools::hash(std::make_pair(other.data(), static_cast<int>(len))));
+    }
+  }
+  // Low bits are used by the hash tables, high bits by the sketches
+  std::unordered_set<size_t> low, high;
+  for (int i = 0; i < 4096; i++) {
+    auto tag = "host=" + std::to_string(i);
+    auto h = StringTools::hash(std::make_pair(tag.data(), static_cast<int>(tag.size())));
+    low.insert(h & 0xFFFF);
+    high.insert(h >> 48);
+  }
+  EXPECT_GT(low.size(), 3900u);
+  EXPECT_GT(high.size(), 3900u);
+}
+
 TEST(LegacyStringPool, Test_1) {
   LegacyStringPool spool;
   const char* foo = "host=1 region=A";
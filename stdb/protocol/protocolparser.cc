@@ -8,6 +8,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "stdb/common/datetime.h"
 #include "stdb/common/logging.h"
 #include "stdb/core/storage_api.h"
 
@@ -144,6 +145,18 @@ void ReadBuffer::push(ReadBuffer::BufferT, u32 size) {
   wpos_ += size;
 }
 
+/** Parse timestamp string. Common fixed layouts and raw nanosecond timestamps
+ * are handled by the fast parsers, other formats go through the generic ISO 8601 parser.
+ */
+static common::Status parse_timestamp_string(const char* str, Sample* sample) {
+  try {
+    sample->timestamp = DateTimeUtil::from_iso_string(str);
+  } catch (BadDateTimeFormat const&) {
+    return common::Status::BadArg();
+  }
+  return common::Status::Ok();
+}
+
 // ProtocolParser class //
 RESPProtocolParser::RESPProtocolParser(std::shared_ptr<DbSession> consumer)
     : done_(false)
@@ -175,7 +188,7 @@ bool RESPProtocolParser::parse_timestamp(RESPStream& stream, Sample& sample) {
         return false;
       }
       tsbuf[bytes_read] = '\0';
-      if (Utility::parse_timestamp(tsbuf, &sample).IsOk()) {
+      if (parse_timestamp_string(tsbuf, &sample).IsOk()) {
         break;
       }
       // Fail through on error
@@ -863,11 +876,13 @@ OpenTSDBResponse OpenTSDBProtocolParser::worker() {
           // try to parse as Unix timestamp first
           {
             bool err = false;
-            Byte* endptr;
             const int eix = timestamp_size - timestamp_trailing;
-            pbuf[eix] = '\0';  // timestamp_trailing can't be 0 or less
-            auto result = strtoull(pbuf, &endptr, 10);
-            pbuf[eix] = ' ';
+            Timestamp result = 0;
+            try {
+              result = DateTimeUtil::from_epoch_string(pbuf, static_cast<size_t>(eix), EpochUnit::NANOSECONDS);
+            } catch (BadDateTimeFormat const&) {
+              result = 0;
+            }
             if (result == 0) {
               err = true;
             }
@@ -885,7 +900,9 @@ OpenTSDBResponse OpenTSDBProtocolParser::worker() {
               // This is an extension of the OpenTSDB telnet protocol. If value can't be
               // interpreted as a Unix timestamp or as a nanosecond timestamp,
               // should try to parse it as a ISO-timestamp (because why not?).
-              status = Utility::parse_timestamp(pbuf, &sample);
+              pbuf[eix] = '\0';  // timestamp_trailing can't be 0 or less
+              status = parse_timestamp_string(pbuf, &sample);
+              pbuf[eix] = ' ';
               if (status == common::Status::Ok()) {
                 err = false;
               }
@@ -0,0 +1,426 @@
+/*!
+ * \file json_reader.cc
+ */
+#include "stdb/query/json_reader.h"
+
+#include <cstring>
+
+namespace stdb {
+namespace qp {
+
+static void append_utf8(unsigned codepoint, std::string* out) {
+  if (codepoint < 0x80) {
+    out->push_back(static_cast<char>(codepoint));
+  } else if (codepoint < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  } else if (codepoint < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  }
+}
+
+static bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+JsonReader::JsonReader(const char* begin, const char* end)
+    : cur_(begin)
+    , end_(end)
+    , line_(1)
+    , error_(nullptr)
+{
+}
+
+bool JsonReader::fail(const char* msg) {
+  error_ = msg;
+  return false;
+}
+
+void JsonReader::skip_ws() {
+  while (cur_ < end_) {
+    char c = *cur_;
+    if (c == '\n') {
+      line_++;
+    } else if (c != ' ' && c != '\t' && c != '\r') {
+      break;
+    }
+    cur_++;
+  }
+}
+
+bool JsonReader::expect(const char* word, const char* msg) {
+  // First character is already checked by the caller
+  cur_++;
+  for (const char* p = word + 1; *p; p++) {
+    if (cur_ == end_ || *cur_ != *p) {
+      return fail(msg);
+    }
+    cur_++;
+  }
+  return true;
+}
+
+bool JsonReader::parse_hex_quad(unsigned* codepoint) {
+  unsigned result = 0;
+  for (int i = 0; i < 4; i++) {
+    if (cur_ == end_) {
+      return fail("invalid escape sequence");
+    }
+    char c = *cur_;
+    int value;
+    if (c >= '0' && c <= '9') {
+      value = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      value = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      value = c - 'A' + 10;
+    } else {
+      return fail("invalid escape sequence");
+    }
+    result = result * 16 + static_cast<unsigned>(value);
+    cur_++;
+  }
+  *codepoint = result;
+  return true;
+}
+
+bool JsonReader::parse_escape() {
+  // `cur_` points to the character after the backslash
+  if (cur_ == end_) {
+    return fail("unterminated string");
+  }
+  char c = *cur_++;
+  switch (c) {
+    case '"':  scratch_.push_back('"');  return true;
+    case '\\': scratch_.push_back('\\'); return true;
+    case '/':  scratch_.push_back('/');  return true;
+    case 'b':  scratch_.push_back('\b'); return true;
+    case 'f':  scratch_.push_back('\f'); return true;
+    case 'n':  scratch_.push_back('\n'); return true;
+    case 'r':  scratch_.push_back('\r'); return true;
+    case 't':  scratch_.push_back('\t'); return true;
+    case 'u':
+      break;
+    default:
+      cur_--;
+      return fail("invalid escape sequence");
+  }
+  unsigned codepoint;
+  if (!parse_hex_quad(&codepoint)) {
+    return false;
+  }
+  if ((codepoint & 0xFC00) == 0xDC00) {
+    return fail("invalid codepoint, stray low surrogate");
+  }
+  if ((codepoint & 0xFC00) == 0xD800) {
+    if (cur_ == end_ || *cur_ != '\\') {
+      return fail("invalid codepoint, stray high surrogate");
+    }
+    cur_++;
+    if (cur_ == end_ || *cur_ != 'u') {
+      return fail("expected codepoint reference after high surrogate");
+    }
+    cur_++;
+    unsigned low;
+    if (!parse_hex_quad(&low)) {
+      return false;
+    }
+    if ((low & 0xFC00) != 0xDC00) {
+      return fail("expected low surrogate after high surrogate");
+    }
+    codepoint = 0x10000 + (((codepoint & 0x3FF) << 10) | (low & 0x3FF));
+  }
+  append_utf8(codepoint, &scratch_);
+  return true;
+}
+
+bool JsonReader::parse_utf8() {
+  // `cur_` points to the lead byte of the multibyte sequence, like
+  // json_parser only the number of continuation bytes is validated
+  unsigned char lead = static_cast<unsigned char>(*cur_);
+  int trailing;
+  if (lead < 0xC0) {
+    // Stray continuation byte
+    return fail("invalid code sequence");
+  } else if (lead < 0xE0) {
+    trailing = 1;
+  } else if (lead < 0xF0) {
+    trailing = 2;
+  } else if (lead < 0xF8) {
+    trailing = 3;
+  } else {
+    return fail("invalid code sequence");
+  }
+  cur_++;
+  for (int i = 0; i < trailing; i++) {
+    if (cur_ == end_ || (static_cast<unsigned char>(*cur_) & 0xC0) != 0x80) {
+      return fail("invalid code sequence");
+    }
+    cur_++;
+  }
+  return true;
+}
+
+bool JsonReader::parse_string(const char** str, size_t* size) {
+  // `cur_` points to the opening quote
+  cur_++;
+  const char* run = cur_;
+  bool escaped = false;
+  while (true) {
+    if (cur_ == end_) {
+      return fail("unterminated string");
+    }
+    char c = *cur_;
+    if (c == '"') {
+      break;
+    }
+    if (c == '\\') {
+      if (!escaped) {
+        scratch_.clear();
+        escaped = true;
+      }
+      scratch_.append(run, cur_);
+      cur_++;
+      if (!parse_escape()) {
+        return false;
+      }
+      run = cur_;
+      continue;
+    }
+    if (static_cast<unsigned char>(c) < 0x20) {
+      // Control characters should be escaped
+      return fail("invalid code sequence");
+    }
+    if (static_cast<unsigned char>(c) >= 0x80) {
+      if (!parse_utf8()) {
+        return false;
+      }
+      continue;
+    }
+    cur_++;
+  }
+  if (escaped) {
+    scratch_.append(run, cur_);
+    *str = scratch_.data();
+    *size = scratch_.size();
+  } else {
+    // Zero-copy path, string is referenced in place
+    *str = run;
+    *size = static_cast<size_t>(cur_ - run);
+  }
+  cur_++;
+  return true;
+}
+
+bool JsonReader::parse_number(JsonHandler* handler) {
+  const char* start = cur_;
+  if (*cur_ == '-') {
+    cur_++;
+    if (cur_ == end_ || !is_digit(*cur_)) {
+      return fail("expected digits after -");
+    }
+  }
+  if (*cur_ == '0') {
+    cur_++;
+  } else {
+    while (cur_ < end_ && is_digit(*cur_)) {
+      cur_++;
+    }
+  }
+  if (cur_ < end_ && *cur_ == '.') {
+    cur_++;
+    if (cur_ == end_ || !is_digit(*cur_)) {
+      return fail("need at least one digit after '.'");
+    }
+    while (cur_ < end_ && is_digit(*cur_)) {
+      cur_++;
+    }
+  }
+  if (cur_ < end_ && (*cur_ == 'e' || *cur_ == 'E')) {
+    cur_++;
+    if (cur_ < end_ && (*cur_ == '+' || *cur_ == '-')) {
+      cur_++;
+    }
+    if (cur_ == end_ || !is_digit(*cur_)) {
+      return fail("need at least one digit in exponent");
+    }
+    while (cur_ < end_ && is_digit(*cur_)) {
+      cur_++;
+    }
+  }
+  handler->on_value(JsonType::NUMBER, start, static_cast<size_t>(cur_ - start));
+  return true;
+}
+
+bool JsonReader::parse_value(JsonHandler* handler) {
+  skip_ws();
+  if (cur_ == end_) {
+    return fail("expected value");
+  }
+  const char* str = cur_;
+  size_t size = 0;
+  switch (*cur_) {
+    case '{':
+      if (stack_.size() >= MAX_DEPTH) {
+        return fail("nesting is too deep");
+      }
+      cur_++;
+      stack_.push_back('{');
+      handler->on_begin_object();
+      return true;
+    case '[':
+      if (stack_.size() >= MAX_DEPTH) {
+        return fail("nesting is too deep");
+      }
+      cur_++;
+      stack_.push_back('[');
+      handler->on_begin_array();
+      return true;
+    case '"':
+      if (!parse_string(&str, &size)) {
+        return false;
+      }
+      handler->on_value(JsonType::STRING, str, size);
+      return true;
+    case 't':
+      if (!expect("true", "expected 'true'")) {
+        return false;
+      }
+      handler->on_value(JsonType::BOOLEAN, str, 4);
+      return true;
+    case 'f':
+      if (!expect("false", "expected 'false'")) {
+        return false;
+      }
+      handler->on_value(JsonType::BOOLEAN, str, 5);
+      return true;
+    case 'n':
+      if (!expect("null", "expected 'null'")) {
+        return false;
+      }
+      handler->on_value(JsonType::NULLVALUE, str, 4);
+      return true;
+    default:
+      if (*cur_ == '-' || is_digit(*cur_)) {
+        return parse_number(handler);
+      }
+  }
+  return fail("expected value");
+}
+
+std::tuple<common::Status, size_t, std::string> JsonReader::read(JsonHandler* handler) {
+  // Skip UTF-8 byte order mark
+  if (end_ - cur_ >= 3 && memcmp(cur_, "\xEF\xBB\xBF", 3) == 0) {
+    cur_ += 3;
+  }
+  bool ok = parse_value(handler);
+  // Set right after the container was opened
+  bool first = true;
+  while (ok && !stack_.empty()) {
+    skip_ws();
+    bool object = stack_.back() == '{';
+    char close = object ? '}' : ']';
+    if (first && cur_ < end_ && *cur_ == close) {
+      cur_++;
+    } else if (first || (cur_ < end_ && *cur_ == ',')) {
+      if (!first) {
+        cur_++;
+      }
+      if (object) {
+        skip_ws();
+        const char* key;
+        size_t size;
+        if (cur_ == end_ || *cur_ != '"') {
+          ok = fail("expected key string");
+          break;
+        }
+        if (!parse_string(&key, &size)) {
+          ok = false;
+          break;
+        }
+        handler->on_key(key, size);
+        skip_ws();
+        if (cur_ == end_ || *cur_ != ':') {
+          ok = fail("expected ':'");
+          break;
+        }
+        cur_++;
+      }
+      size_t depth = stack_.size();
+      ok = parse_value(handler);
+      first = stack_.size() > depth;
+      continue;
+    } else if (cur_ < end_ && *cur_ == close) {
+      cur_++;
+    } else {
+      ok = fail(object ? "expected '}' or ','" : "expected ']' or ','");
+      break;
+    }
+    // Container is closed
+    stack_.pop_back();
+    first = false;
+    if (object) {
+      handler->on_end_object();
+    } else {
+      handler->on_end_array();
+    }
+  }
+  if (ok) {
+    skip_ws();
+    if (cur_ != end_) {
+      ok = fail("garbage after data");
+    }
+  }
+  if (!ok) {
+    return std::make_tuple(common::Status::QueryParsingError(), line_, std::string(error_));
+  }
+  return std::make_tuple(common::Status::Ok(), line_, std::string());
+}
+
+JsonPTreeBuilder::JsonPTreeBuilder(boost::property_tree::ptree* root)
+    : root_(root)
+{
+}
+
+boost::property_tree::ptree& JsonPTreeBuilder::new_value() {
+  if (stack_.empty()) {
+    return *root_;
+  }
+  auto it = stack_.back()->push_back(std::make_pair(key_, boost::property_tree::ptree()));
+  key_.clear();
+  return it->second;
+}
+
+void JsonPTreeBuilder::on_begin_object() {
+  stack_.push_back(&new_value());
+}
+
+void JsonPTreeBuilder::on_end_object() {
+  stack_.pop_back();
+}
+
+void JsonPTreeBuilder::on_begin_array() {
+  stack_.push_back(&new_value());
+}
+
+void JsonPTreeBuilder::on_end_array() {
+  stack_.pop_back();
+}
+
+void JsonPTreeBuilder::on_key(const char* str, size_t size) {
+  key_.assign(str, size);
+}
+
+void JsonPTreeBuilder::on_value(JsonType, const char* str, size_t size) {
+  new_value().data().assign(str, size);
+}
+
+}  // namespace qp
+}  // namespace stdb
@@ -0,0 +1,105 @@
+/*!
+ * \file json_reader.h
+ *
+ * Zero-copy SAX-style JSON reader used by the query parser.
+ */
+#ifndef STDB_QUERY_JSON_READER_H_
+#define STDB_QUERY_JSON_READER_H_
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "stdb/common/status.h"
+
+namespace stdb {
+namespace qp {
+
+enum class JsonType {
+  STRING,
+  NUMBER,
+  BOOLEAN,
+  NULLVALUE,
+};
+
+/** Receives JSON events from the JsonReader.
+ * Strings point to the input buffer (or to the internal buffer of the reader
+ * if the string contains escape sequences) and are valid only during the call.
+ * Numbers, booleans and nulls are passed as they appear in the input.
+ */
+struct JsonHandler {
+  virtual ~JsonHandler() = default;
+  virtual void on_begin_object() = 0;
+  virtual void on_end_object() = 0;
+  virtual void on_begin_array() = 0;
+  virtual void on_end_array() = 0;
+  virtual void on_key(const char* str, size_t size) = 0;
+  virtual void on_value(JsonType type, const char* str, size_t size) = 0;
+};
+
+/** JSON tokenizer.
+ * Grammar and error messages are the same as in boost::property_tree::json_parser.
+ * Containers are handled iteratively, but the nesting depth is limited by
+ * MAX_DEPTH because the resulting ptree is destroyed recursively.
+ */
+class JsonReader {
+ public:
+  enum {
+    MAX_DEPTH = 512,
+  };
+
+ private:
+  const char* cur_;
+  const char* end_;
+  size_t line_;
+  const char* error_;
+  //! Buffer for strings with escape sequences
+  std::string scratch_;
+  //! Open containers ('{' or '[')
+  std::vector<char> stack_;
+
+  bool fail(const char* msg);
+  void skip_ws();
+  bool expect(const char* word, const char* msg);
+  bool parse_value(JsonHandler* handler);
+  bool parse_string(const char** str, size_t* size);
+  bool parse_escape();
+  bool parse_hex_quad(unsigned* codepoint);
+  bool parse_utf8();
+  bool parse_number(JsonHandler* handler);
+
+ public:
+  JsonReader(const char* begin, const char* end);
+
+  /** Read the whole document.
+   * @return status, line of the error and the error message
+   */
+  std::tuple<common::Status, size_t, std::string> read(JsonHandler* handler);
+};
+
+//! Builds property tree from the JSON events (same tree as the json_parser::read_json produces)
+class JsonPTreeBuilder : public JsonHandler {
+  boost::property_tree::ptree* root_;
+  std::vector<boost::property_tree::ptree*> stack_;
+  std::string key_;
+
+  boost::property_tree::ptree& new_value();
+
+ public:
+  //! Build the tree in place (ptree is not movable so it's not returned by value)
+  JsonPTreeBuilder(boost::property_tree::ptree* root);
+
+  void on_begin_object() override;
+  void on_end_object() override;
+  void on_begin_array() override;
+  void on_end_array() override;
+  void on_key(const char* str, size_t size) override;
+  void on_value(JsonType type, const char* str, size_t size) override;
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_JSON_READER_H_
@@ -0,0 +1,163 @@
+/*!
+ * \file json_reader_test.cc
+ */
+#include "stdb/query/json_reader.h"
+
+#include <sstream>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+namespace qp {
+
+static boost::property_tree::ptree read_ptree(std::string const& json) {
+  boost::property_tree::ptree ptree;
+  JsonReader reader(json.data(), json.data() + json.size());
+  JsonPTreeBuilder builder(&ptree);
+  common::Status status;
+  size_t line;
+  std::string message;
+  std::tie(status, line, message) = reader.read(&builder);
+  EXPECT_TRUE(status.IsOk()) << message;
+  return ptree;
+}
+
+//! Check that the tree is the same as the one produced by boost
+static void check_same_tree(std::string const& json) {
+  std::stringstream stream(json);
+  boost::property_tree::ptree expected;
+  boost::property_tree::json_parser::read_json(stream, expected);
+  EXPECT_TRUE(expected == read_ptree(json)) << json;
+}
+
+//! Check that the error line and message are the same as produced by boost
+static void check_same_error(std::string const& json) {
+  std::stringstream stream(json);
+  boost::property_tree::ptree ptree;
+  size_t expected_line = 0;
+  std::string expected_message;
+  try {
+    boost::property_tree::json_parser::read_json(stream, ptree);
+  } catch (boost::property_tree::json_parser_error const& e) {
+    expected_line = e.line();
+    expected_message = e.message();
+  }
+  ASSERT_NE(0u, expected_line) << json;
+
+  JsonReader reader(json.data(), json.data() + json.size());
+  JsonPTreeBuilder builder(&ptree);
+  common::Status status;
+  size_t line;
+  std::string message;
+  std::tie(status, line, message) = reader.read(&builder);
+  EXPECT_EQ(common::Status::QueryParsingError(), status) << json;
+  EXPECT_EQ(expected_line, line) << json;
+  EXPECT_EQ(expected_message, message) << json;
+}
+
+TEST(TestJsonReader, Test_same_tree_as_boost) {
+  check_same_tree("{}");
+  check_same_tree("[]");
+  check_same_tree("\"string\"");
+  check_same_tree(R"({ "select": "cpu", "range": { "from": "20200101T000000", "to": 1577836800 } })");
+  check_same_tree(R"({ "aggregate": { "cpu": "max", "mem": "min" }, "limit": 10, "offset": -1.5e+3 })");
+  check_same_tree(R"({ "where": { "host": ["a", "b", "c"] }, "flags": [true, false, null], "nested": [[], [1, [2]], {}] })");
+  check_same_tree(R"({ "dup": 1, "dup": 2, "": "empty key" })");
+  check_same_tree("\n\t{ \"a\" :\r\n [ 0 , 0.25, 1E9 ] }  \n");
+  check_same_tree(R"({ "escaped": "q\"b\\s\/\b\f\n\r\t", "unicode": "\u0041\u00e9\u20ac\ud83d\ude00" })");
+  check_same_tree("{ \"utf8\": \"\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82\" }");
+  check_same_tree("{ \"utf8\": \"\xe2\x82\xac \xf0\x9f\x98\x80\" }");
+  check_same_tree("\xef\xbb\xbf{ \"bom\": 1 }");
+}
+
+TEST(TestJsonReader, Test_same_errors_as_boost) {
+  check_same_error("");
+  check_same_error("   ");
+  check_same_error("{");
+  check_same_error("[");
+  check_same_error("{ \"a\" }");
+  check_same_error("{ \"a\": }");
+  check_same_error("{ \"a\": 1,\n \"b\": 2\n");
+  check_same_error("{ a: 1 }");
+  check_same_error("[1, 2");
+  check_same_error("[1 2]");
+  check_same_error("{}\n{}");
+  check_same_error("{ \"a\": tru }");
+  check_same_error("{ \"a\": nul }");
+  check_same_error("{ \"a\": fals }");
+  check_same_error("{ \"a\": - }");
+  check_same_error("{ \"a\": 1. }");
+  check_same_error("{ \"a\": 1e }");
+  check_same_error("{ \"a\": 01 }");
+  check_same_error("{ \"a\": \"unterminated }");
+  check_same_error("{ \"a\": \"\\x\" }");
+  check_same_error("{ \"a\": \"\\u12\" }");
+  check_same_error("{ \"a\": \"\\udc00\" }");
+  check_same_error("{ \"a\": \"\\ud83d\" }");
+  check_same_error("{ \"a\": \"\\ud83d\\n\" }");
+  check_same_error("{ \"a\": \"\\ud83d\\u0041\" }");
+  check_same_error("{ \"a\": \"tab\there\" }");
+  check_same_error("{ \"a\": \"line\nbreak\" }");
+  check_same_error("{\n\"a\": \"cr\rlf\" }");
+  check_same_error("{ \"a\": \"\xff\xfe\" }");
+  check_same_error("{ \"a\": \"\x80\" }");
+  check_same_error("{ \"a\": \"\xd0\" }");
+  check_same_error("{ \"a\": \"\xe2\x82x\" }");
+  check_same_error("{ \"\x01\": 1 }");
+  check_same_error("\xef\xbb");
+  check_same_error("{\n\"select\": \"cpu\",\n\"range\": {\n\"from\": \"20200101T000000\" \"to\": 1\n}\n}");
+}
+
+TEST(TestJsonReader, Test_zero_copy_strings) {
+  //! Records pointers passed to the handler
+  struct Handler : JsonHandler {
+    std::vector<const char*> strings;
+    void on_begin_object() override {}
+    void on_end_object() override {}
+    void on_begin_array() override {}
+    void on_end_array() override {}
+    void on_key(const char* str, size_t) override { strings.push_back(str); }
+    void on_value(JsonType, const char* str, size_t) override { strings.push_back(str); }
+  };
+  std::string json = R"({ "key": ["value", 42, "esc\naped"] })";
+  JsonReader reader(json.data(), json.data() + json.size());
+  Handler handler;
+  common::Status status;
+  size_t line;
+  std::string message;
+  std::tie(status, line, message) = reader.read(&handler);
+  ASSERT_TRUE(status.IsOk());
+  ASSERT_EQ(4u, handler.strings.size());
+  EXPECT_EQ(json.data() + json.find("key"), handler.strings[0]);
+  EXPECT_EQ(json.data() + json.find("value"), handler.strings[1]);
+  EXPECT_EQ(json.data() + json.find("42"), handler.strings[2]);
+  // String with escape sequence is decoded into the internal buffer
+  EXPECT_NE(json.data() + json.find("esc"), handler.strings[3]);
+}
+
+TEST(TestJsonReader, Test_deep_nesting) {
+  auto read = [](int depth) {
+    std::string json = std::string(depth, '[') + std::string(depth, ']');
+    boost::property_tree::ptree ptree;
+    JsonReader reader(json.data(), json.data() + json.size());
+    JsonPTreeBuilder builder(&ptree);
+    common::Status status;
+    size_t line;
+    std::string message;
+    std::tie(status, line, message) = reader.read(&builder);
+    return std::make_tuple(status, message);
+  };
+  common::Status status;
+  std::string message;
+  std::tie(status, message) = read(JsonReader::MAX_DEPTH);
+  EXPECT_TRUE(status.IsOk()) << message;
+  // Deeply nested ptree can't be destroyed without stack overflow
+  std::tie(status, message) = read(100000);
+  EXPECT_FALSE(status.IsOk());
+  EXPECT_EQ("nesting is too deep", message);
+}
+
+}  // namespace qp
+}  // namespace stdb
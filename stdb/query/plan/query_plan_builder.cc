@@ -3,16 +3,19 @@
  */
 #include "stdb/query/plan/query_plan_builder.h"
 
+#include "stdb/query/plan/similarity_query_plan.h"
 #include "stdb/query/plan/two_step_query_plan.h"
 #include "stdb/query/steps/aggregate_combiner.h"
 #include "stdb/query/steps/aggregate.h"
 #include "stdb/query/steps/aggregate_processing_step.h"
+#include "stdb/query/steps/approximate_aggregate.h"
 #include "stdb/query/steps/chain.h"
 #include "stdb/query/steps/filter_processing_step.h"
 #include "stdb/query/steps/group_aggregate_combiner.h"
 #include "stdb/query/steps/group_aggregate_filter_processing_step.h"
 #include "stdb/query/steps/group_aggregate_processing_step.h"
 #include "stdb/query/steps/join.h"
+#include "stdb/query/steps/m4_aggregate.h"
 #include "stdb/query/steps/materialization_step.h"
 #include "stdb/query/steps/mergeby.h"
 #include "stdb/query/steps/processing_prelude.h"
@@ -357,15 +360,25 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> scan_events_query
   }
 
   std::unique_ptr<ProcessingPrelude> t1stage;
-  if (req.select.event_body_regex.empty()) {
+  if (req.select.event_body_regex.empty() &&
+      req.select.event_keywords.empty() &&
+      req.select.event_prefixes.empty()) {
     // Regex filter is not set
     t1stage.reset(new ScanEventsProcessingStep  (req.select.begin,
                                                  req.select.end,
                                                  req.select.columns.at(0).ids));
   } else {
+    EventPredicate pred;
+    for (auto const& kw: req.select.event_keywords) {
+      pred.add_keyword(kw);
+    }
+    for (auto const& prefix: req.select.event_prefixes) {
+      pred.add_prefix(prefix);
+    }
     t1stage.reset(new ScanEventsProcessingStep  (req.select.begin,
                                                  req.select.end,
                                                  req.select.event_body_regex,
+                                                 pred,
                                                  req.select.columns.at(0).ids));
   }
 
@@ -399,8 +412,10 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> scan_events_query
 static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> aggregate_query_plan(ReshapeRequest const& req) {
   // Hardwired query plan for aggregate query
   // Tier1
-  // - List of aggregate operators
+  // - List of aggregate operators (approximate if approximation is enabled)
   // Tier2
+  // - If approximation is enabled add sampling materializer (series of the
+  //   group-by group are sampled).
   // - If group-by is enabled:
   //   - Transform ids and matcher (generate new names)
   //   - Add merge materialization step (series or time order, depending on the
@@ -416,10 +431,25 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> aggregate_query_p
   }
 
   std::unique_ptr<ProcessingPrelude> t1stage;
-  t1stage.reset(new AggregateProcessingStep(req.select.begin, req.select.end, req.select.columns.at(0).ids));
+  t1stage.reset(new AggregateProcessingStep(req.select.begin,
+                                            req.select.end,
+                                            req.select.columns.at(0).ids,
+                                            req.agg.approx.enabled));
 
   std::unique_ptr<MaterializationStep> t2stage;
-  if (req.group_by.enabled) {
+  if (req.agg.approx.enabled) {
+    // Every series (or every group-by group) is estimated separately
+    std::vector<ParamId> ids = req.select.columns.at(0).ids;
+    if (req.group_by.enabled) {
+      for (auto& id: ids) {
+        auto it = req.group_by.transient_map.find(id);
+        if (it != req.group_by.transient_map.end()) {
+          id = it->second;
+        }
+      }
+    }
+    t2stage.reset(new ApproximateAggregate(std::move(ids), req.agg.func, req.agg.approx));
+  } else if (req.group_by.enabled) {
     std::vector<ParamId> ids;
     for(auto id: req.select.columns.at(0).ids) {
       auto it = req.group_by.transient_map.find(id);
@@ -475,7 +505,8 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> join_query_plan(R
     if (req.group_by.enabled) {
       return std::make_tuple(common::Status::BadArg(), std::move(result));
     } else {
-      t2stage.reset(new Join(req.select.columns.at(0).ids, cardinality, req.order_by, req.select.begin, req.select.end));
+      t2stage.reset(new Join(req.select.columns.at(0).ids, cardinality, req.order_by, req.select.begin, req.select.end,
+                             req.select.join_mode, req.select.join_tolerance));
     }
 
     result.reset(new TwoStepQueryPlan(std::move(t1stage), std::move(t2stage)));
@@ -564,6 +595,13 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> group_aggregate_q
                                                    req.select.columns.at(0).ids));
   }
 
+  GroupAggregateFill fill = {};
+  fill.policy = req.agg.fill;
+  fill.value = req.agg.fill_value;
+  fill.begin = req.select.begin;
+  fill.end = req.select.end;
+  fill.step = req.agg.step;
+
   std::unique_ptr<MaterializationStep> t2stage;
   if (req.group_by.enabled) {
     std::vector<ParamId> ids;
@@ -574,15 +612,17 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> group_aggregate_q
       }
     }
     if (req.order_by == OrderBy::SERIES) {
-      t2stage.reset(new GroupAggregateCombiner<OrderBy::SERIES>(std::move(ids), req.agg.func));
+      t2stage.reset(new GroupAggregateCombiner<OrderBy::SERIES>(std::move(ids), req.agg.func, fill,
+                                                                req.group_by.parallel));
     } else {
-      t2stage.reset(new GroupAggregateCombiner<OrderBy::TIME>(ids, req.agg.func));
+      t2stage.reset(new GroupAggregateCombiner<OrderBy::TIME>(ids, req.agg.func, fill,
+                                                              req.group_by.parallel));
     }
   } else {
     if (req.order_by == OrderBy::SERIES) {
-      t2stage.reset(new SeriesOrderAggregate(req.select.columns.at(0).ids, req.agg.func));
+      t2stage.reset(new SeriesOrderAggregate(req.select.columns.at(0).ids, req.agg.func, fill));
     } else {
-      t2stage.reset(new TimeOrderAggregate(req.select.columns.at(0).ids, req.agg.func));
+      t2stage.reset(new TimeOrderAggregate(req.select.columns.at(0).ids, req.agg.func, fill));
     }
   }
 
@@ -590,7 +630,54 @@ static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> group_aggregate_q
   return std::make_tuple(common::Status::Ok(), std::move(result));
 }
 
+static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> m4_query_plan(ReshapeRequest const& req) {
+  // Every pixel column is a group-aggregate bucket, buckets that cover
+  // whole subtrees are answered using subtree metadata.
+  std::unique_ptr<IQueryPlan> result;
+  if (req.downsample.width == 0 || req.select.columns.size() != 1 || req.group_by.enabled) {
+    return std::make_tuple(common::Status::BadArg(), std::move(result));
+  }
+  u64 step = req.downsample.get_step(req.select.begin, req.select.end);
+  std::unique_ptr<ProcessingPrelude> t1stage;
+  t1stage.reset(new GroupAggregateProcessingStep(req.select.begin,
+                                                 req.select.end,
+                                                 step,
+                                                 req.select.columns.at(0).ids));
+  std::unique_ptr<MaterializationStep> t2stage;
+  t2stage.reset(new M4Aggregate(req.select.columns.at(0).ids, req.order_by));
+  result.reset(new TwoStepQueryPlan(std::move(t1stage), std::move(t2stage)));
+  return std::make_tuple(common::Status::Ok(), std::move(result));
+}
+
+static std::tuple<common::Status, std::unique_ptr<IQueryPlan>> similarity_query_plan(ReshapeRequest const& req) {
+  std::unique_ptr<IQueryPlan> result;
+  if (req.similar.pattern.empty() || req.similar.limit == 0 || req.select.columns.size() != 1) {
+    return std::make_tuple(common::Status::BadArg(), std::move(result));
+  }
+  if (req.select.columns.at(0).ids.empty()) {
+    // Metric or `where` clause doesn't match any series
+    return std::make_tuple(common::Status::NotFound(), std::move(result));
+  }
+  SAXQuery query = {};
+  query.pattern = req.similar.pattern;
+  query.k = req.similar.limit;
+  query.ids = req.select.columns.at(0).ids;
+  std::sort(query.ids.begin(), query.ids.end());
+  query.begin = req.select.begin;
+  query.end = req.select.end;
+  result.reset(new SimilarityQueryPlan(std::move(query)));
+  return std::make_tuple(common::Status::Ok(), std::move(result));
+}
+
 std::tuple<common::Status, std::unique_ptr<IQueryPlan>> QueryPlanBuilder::create(const ReshapeRequest& req) {
+  if (req.similar.enabled) {
+    // Similarity search query
+    return similarity_query_plan(req);
+  }
+  if (req.downsample.method == DownsampleMethod::M4 && !req.agg.enabled && !req.select.events) {
+    // Downsampled select query
+    return m4_query_plan(req);
+  }
   if (req.agg.enabled && req.agg.step == 0) {
     // Aggregate query
     return aggregate_query_plan(req);
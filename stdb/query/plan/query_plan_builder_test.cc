@@ -64,6 +64,32 @@ TEST(TestQueryPlan, Test_make_scan_query) {
   LOG(INFO) << "query plan debug_string:" << to_json(query_plan->debug_info());
 }
 
+TEST(TestQueryPlan, Test_similarity_query_without_series) {
+  init_series_matcher();
+
+  auto create = [](const char* query_json) {
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(query_json);
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_similarity_query(ptree, global_series_matcher);
+    EXPECT_TRUE(status.IsOk());
+    std::unique_ptr<qp::IQueryPlan> query_plan;
+    std::tie(status, query_plan) = qp::QueryPlanBuilder::create(req);
+    return status;
+  };
+  EXPECT_EQ(common::Status::Ok(),
+            create(R"({ "similar": { "metric": "test", "pattern": [1, 2, 3], "limit": 3 } })"));
+  // Empty series list shouldn't be treated as all series
+  EXPECT_EQ(common::Status::NotFound(),
+            create(R"({ "similar": { "metric": "unknown", "pattern": [1, 2, 3], "limit": 3 } })"));
+  EXPECT_EQ(common::Status::NotFound(),
+            create(R"({ "similar": { "metric": "test", "pattern": [1, 2, 3], "limit": 3 },
+                        "where": { "tag1": "42" } })"));
+}
+
 TEST(TestQueryPlan, Test_2) {
   init_series_matcher();
 
@@ -0,0 +1,63 @@
+/*!
+ * \file similarity_query_plan.h
+ */
+#ifndef STDB_QUERY_PLAN_SIMILARITY_QUERY_PLAN_H_
+#define STDB_QUERY_PLAN_SIMILARITY_QUERY_PLAN_H_
+
+#include <algorithm>
+
+#include "stdb/query/plan/query_plan.h"
+
+namespace stdb {
+namespace qp {
+
+/**
+ * Similarity search query plan. Uses similarity index of the column-store
+ * and outputs matched windows ordered by distance. Each sample contains
+ * the series id, timestamp of the first point of the window and distance.
+ */
+struct SimilarityQueryPlan : IQueryPlan {
+  storage::SAXQuery query_;
+  std::vector<storage::SAXMatch> matches_;
+  size_t pos_;
+
+  SimilarityQueryPlan(storage::SAXQuery query)
+      : query_(std::move(query))
+      , pos_(0) { }
+
+  boost::property_tree::ptree debug_info() const override {
+    boost::property_tree::ptree tree;
+    tree.add("name", "SimilarityQueryPlan");
+    tree.add("pattern_size", query_.pattern.size());
+    tree.add("limit", query_.k);
+    return tree;
+  }
+
+  common::Status execute(const storage::ColumnStore& cstore) override {
+    return cstore.similarity_search(query_, &matches_);
+  }
+
+  std::tuple<common::Status, size_t> read(u8 *dest, size_t size) override {
+    size_t outsz = 0;
+    while (pos_ < matches_.size() && size - outsz >= sizeof(Sample)) {
+      auto const& match = matches_[pos_++];
+      Sample sample = {};
+      sample.paramid = match.id;
+      sample.timestamp = match.begin;
+      sample.payload.type = PAYLOAD_FLOAT;
+      sample.payload.size = sizeof(Sample);
+      sample.payload.float64 = match.distance;
+      memcpy(dest + outsz, &sample, sizeof(Sample));
+      outsz += sizeof(Sample);
+    }
+    if (pos_ == matches_.size()) {
+      return std::make_tuple(common::Status::NoData(), outsz);
+    }
+    return std::make_tuple(common::Status::Ok(), outsz);
+  }
+};
+
+}  // namespace qp
+}  // namespaces stdb
+
+#endif  // STDB_QUERY_PLAN_SIMILARITY_QUERY_PLAN_H_
@@ -0,0 +1,236 @@
+/*!
+ * \file prepared_query.cc
+ */
+#include "stdb/query/prepared_query.h"
+
+#include "stdb/common/logging.h"
+
+namespace stdb {
+namespace qp {
+
+PreparedQuery::PreparedQuery(SeriesMatcher const& matcher)
+    : kind_(QueryKind::SELECT)
+    , matcher_(matcher)
+    , begin_slot_(false)
+    , end_slot_(false)
+    , step_slot_(false)
+    , limit_slot_(false)
+    , request_()
+    , cardinality_(0)
+{
+}
+
+std::tuple<common::Status, ErrorMsg> PreparedQuery::init_slots(boost::property_tree::ptree* ptree,
+                                                              std::string const& parent) {
+  for (auto& child: *ptree) {
+    if (!child.second.empty()) {
+      common::Status status;
+      ErrorMsg error;
+      std::tie(status, error) = init_slots(&child.second, child.first);
+      if (!status.IsOk()) {
+        return std::make_tuple(status, error);
+      }
+      continue;
+    }
+    auto const& value = child.second.data();
+    if (value.empty() || value.front() != '$') {
+      continue;
+    }
+    // Only the `range.from`, `range.to`, `step` and top level `limit` fields can
+    // be parameters, `$` in other fields (e.g. in tag values) is a normal character.
+    // Placeholder values should pass validation, the real values are bound later.
+    bool is_range = parent == "range" && (child.first == "from" || child.first == "to");
+    bool is_step = child.first == "step";
+    bool is_limit = parent.empty() && child.first == "limit";
+    if (!is_range && !is_step && !is_limit) {
+      continue;
+    }
+    if (value == "$from" && child.first == "from") {
+      begin_slot_ = true;
+      child.second.put_value("0");
+    } else if (value == "$to" && child.first == "to") {
+      end_slot_ = true;
+      child.second.put_value("1");
+    } else if (value == "$step" && is_step) {
+      step_slot_ = true;
+      child.second.put_value("1s");
+    } else if (value == "$limit" && is_limit) {
+      limit_slot_ = true;
+      child.second.put_value("0");
+    } else {
+      return std::make_tuple(common::Status::QueryParsingError(),
+                             "Unexpected query parameter " + value + " in `" + child.first + "` field");
+    }
+  }
+  return std::make_tuple(common::Status::Ok(), ErrorMsg());
+}
+
+std::tuple<common::Status, std::shared_ptr<PreparedQuery>, ErrorMsg> PreparedQuery::create(
+    const char* query,
+    SeriesMatcher const& matcher) {
+  std::shared_ptr<PreparedQuery> result(new PreparedQuery(matcher));
+  common::Status status;
+  ErrorMsg error;
+  std::tie(status, error) = QueryParser::parse_json(query, &result->ptree_);
+  if (!status.IsOk()) {
+    return std::make_tuple(status, nullptr, error);
+  }
+  std::tie(status, error) = result->init_slots(&result->ptree_, std::string());
+  if (!status.IsOk()) {
+    return std::make_tuple(status, nullptr, error);
+  }
+  std::tie(status, result->kind_, error) = QueryParser::get_query_kind(result->ptree_);
+  if (!status.IsOk()) {
+    return std::make_tuple(status, nullptr, error);
+  }
+  if (result->kind_ == QueryKind::SELECT_META) {
+    return std::make_tuple(common::Status::QueryParsingError(), nullptr, "Metadata query can't be prepared");
+  }
+  // Only the processing topology part of the template is needed to create the nodes
+  for (auto const& field: { "apply", "limit", "offset" }) {
+    auto child = result->ptree_.get_child_optional(field);
+    if (child) {
+      result->topology_.add_child(field, *child);
+    }
+  }
+  result->cardinality_ = matcher.cardinality();
+  std::tie(status, result->request_, error) = QueryParser::parse_query(result->ptree_, result->kind_, matcher);
+  if (!status.IsOk()) {
+    return std::make_tuple(status, nullptr, error);
+  }
+  return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+}
+
+QueryKind PreparedQuery::get_query_kind() const {
+  return kind_;
+}
+
+std::tuple<common::Status, ReshapeRequest, ErrorMsg> PreparedQuery::bind(QueryParameters const& params) {
+  if (begin_slot_ != static_cast<bool>(params.begin) || end_slot_ != static_cast<bool>(params.end)) {
+    return std::make_tuple(common::Status::QueryParsingError(), ReshapeRequest(),
+                           "Parameters `from` and `to` doesn't match the query template");
+  }
+  if (step_slot_ != static_cast<bool>(params.step) || (params.step && *params.step == 0)) {
+    return std::make_tuple(common::Status::QueryParsingError(), ReshapeRequest(),
+                           "Parameter `step` doesn't match the query template");
+  }
+  if (limit_slot_ != static_cast<bool>(params.limit)) {
+    return std::make_tuple(common::Status::QueryParsingError(), ReshapeRequest(),
+                           "Parameter `limit` doesn't match the query template");
+  }
+  ReshapeRequest req;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto cardinality = matcher_.cardinality();
+    if (cardinality != cardinality_) {
+      // New series can match the query, resolve series again
+      common::Status status;
+      ErrorMsg error;
+      ReshapeRequest newreq;
+      std::tie(status, newreq, error) = QueryParser::parse_query(ptree_, kind_, matcher_);
+      if (!status.IsOk()) {
+        return std::make_tuple(status, newreq, error);
+      }
+      request_ = std::move(newreq);
+      cardinality_ = cardinality;
+    }
+    req = request_;
+  }
+  if (params.begin) {
+    req.select.begin = *params.begin;
+  }
+  if (params.end) {
+    req.select.end = *params.end;
+  }
+  if (params.step) {
+    req.agg.step = *params.step;
+  }
+  return std::make_tuple(common::Status::Ok(), req, ErrorMsg());
+}
+
+std::tuple<common::Status, std::vector<std::shared_ptr<Node>>, ErrorMsg> PreparedQuery::bind_processing_topology(
+    QueryParameters const& params,
+    InternalCursor* cursor,
+    ReshapeRequest const& req) const {
+  if (!limit_slot_) {
+    return QueryParser::parse_processing_topology(topology_, cursor, req);
+  }
+  if (!params.limit) {
+    return std::make_tuple(common::Status::QueryParsingError(), std::vector<std::shared_ptr<Node>>(),
+                           "Parameter `limit` is not bound");
+  }
+  auto topology = topology_;
+  topology.put("limit", *params.limit);
+  return QueryParser::parse_processing_topology(topology, cursor, req);
+}
+
+PreparedQueryCache::PreparedQueryCache(size_t capacity)
+    : capacity_(capacity)
+    , next_id_(1)
+{
+}
+
+std::tuple<common::Status, u64, ErrorMsg> PreparedQueryCache::prepare(const char* query,
+                                                                      SeriesMatcher const& matcher) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = ids_.find(query);
+    if (it != ids_.end()) {
+      return std::make_tuple(common::Status::Ok(), it->second, ErrorMsg());
+    }
+  }
+  // Parse outside of the lock, concurrent registration of the same template
+  // is resolved below
+  common::Status status;
+  std::shared_ptr<PreparedQuery> prepared;
+  ErrorMsg error;
+  std::tie(status, prepared, error) = PreparedQuery::create(query, matcher);
+  if (!status.IsOk()) {
+    return std::make_tuple(status, 0ul, error);
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = ids_.find(query);
+  if (it != ids_.end()) {
+    return std::make_tuple(common::Status::Ok(), it->second, ErrorMsg());
+  }
+  if (queries_.size() == capacity_) {
+    auto oldest = queries_.begin();
+    LOG(INFO) << "Evict prepared query " << oldest->first;
+    ids_.erase(templates_[oldest->first]);
+    templates_.erase(oldest->first);
+    queries_.erase(oldest);
+  }
+  auto id = next_id_++;
+  queries_[id] = prepared;
+  ids_[query] = id;
+  templates_[id] = query;
+  return std::make_tuple(common::Status::Ok(), id, ErrorMsg());
+}
+
+std::shared_ptr<PreparedQuery> PreparedQueryCache::get(u64 id) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = queries_.find(id);
+  if (it == queries_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void PreparedQueryCache::remove(u64 id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = templates_.find(id);
+  if (it == templates_.end()) {
+    return;
+  }
+  ids_.erase(it->second);
+  templates_.erase(it);
+  queries_.erase(id);
+}
+
+size_t PreparedQueryCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return queries_.size();
+}
+
+}  // namespace qp
+}  // namespace stdb
@@ -0,0 +1,125 @@
+/*!
+ * \file prepared_query.h
+ */
+#ifndef STDB_QUERY_PREPARED_QUERY_H_
+#define STDB_QUERY_PREPARED_QUERY_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/optional.hpp>
+
+#include "stdb/query/queryparser.h"
+
+namespace stdb {
+namespace qp {
+
+/** Parameters of the prepared query.
+ * Parameter should be set if the query template has the corresponding slot.
+ */
+struct QueryParameters {
+  //! Value of the "$from" slot
+  boost::optional<Timestamp> begin;
+  //! Value of the "$to" slot
+  boost::optional<Timestamp> end;
+  //! Value of the "$step" slot
+  boost::optional<u64> step;
+  //! Value of the "$limit" slot
+  boost::optional<u64> limit;
+};
+
+/** Prepared query.
+ * Query template is a normal json query where some fields are replaced with
+ * parameter slots, e.g.
+ * { "group-aggregate": { "metric": "cpu", "step": "$step", "func": [ "max" ] },
+ *   "range": { "from": "$from", "to": "$to" }, "limit": "$limit" }
+ * The template is parsed once and the resulting request (resolved series ids,
+ * group-by mappings and processing steps) is reused by every execution. Only
+ * the parameters are bound to the cached request. Cached request is rebuilt
+ * if new series were added to the matcher after it was built.
+ */
+class PreparedQuery {
+  //! Query template with slots replaced by placeholder values
+  boost::property_tree::ptree ptree_;
+  //! Processing topology part of the template (`apply`, `limit` and `offset` fields)
+  boost::property_tree::ptree topology_;
+  QueryKind kind_;
+  SeriesMatcher const& matcher_;
+  bool begin_slot_;
+  bool end_slot_;
+  bool step_slot_;
+  bool limit_slot_;
+
+  mutable std::mutex mutex_;
+  //! Cached request
+  ReshapeRequest request_;
+  //! Matcher cardinality at the moment when `request_` was built
+  size_t cardinality_;
+
+  PreparedQuery(SeriesMatcher const& matcher);
+
+  /** Replace parameter slots with placeholder values.
+   * @param parent is a name of the field that contains `ptree` (empty for the top level)
+   */
+  std::tuple<common::Status, ErrorMsg> init_slots(boost::property_tree::ptree* ptree, std::string const& parent);
+
+ public:
+  /** Parse query template.
+   * @param query is a json query template
+   * @param matcher is a global matcher
+   */
+  static std::tuple<common::Status, std::shared_ptr<PreparedQuery>, ErrorMsg> create(const char* query,
+                                                                                     SeriesMatcher const& matcher);
+
+  QueryKind get_query_kind() const;
+
+  /** Bind parameters and return request for the query plan builder.
+   * Series are resolved again only if new series were added to the matcher.
+   */
+  std::tuple<common::Status, ReshapeRequest, ErrorMsg> bind(QueryParameters const& params);
+
+  /** Create processing topology for the request returned by `bind`.
+   * @param params should be the same as the ones passed to `bind`
+   */
+  std::tuple<common::Status, std::vector<std::shared_ptr<Node>>, ErrorMsg> bind_processing_topology(
+      QueryParameters const& params,
+      InternalCursor* cursor,
+      ReshapeRequest const& req) const;
+};
+
+/** Cache of the prepared queries.
+ * Clients register query templates and execute them by id. Same template
+ * always gets the same id. The oldest query is evicted when the cache is full.
+ */
+class PreparedQueryCache {
+  const size_t capacity_;
+  u64 next_id_;
+  mutable std::mutex mutex_;
+  std::map<u64, std::shared_ptr<PreparedQuery>> queries_;
+  std::unordered_map<std::string, u64> ids_;
+  std::map<u64, std::string> templates_;
+
+ public:
+  PreparedQueryCache(size_t capacity = 1024);
+
+  /** Parse query template and add it to the cache.
+   * @return status, id of the prepared query and error message
+   */
+  std::tuple<common::Status, u64, ErrorMsg> prepare(const char* query, SeriesMatcher const& matcher);
+
+  //! Return prepared query or null if it's not in the cache
+  std::shared_ptr<PreparedQuery> get(u64 id) const;
+
+  //! Remove prepared query from the cache
+  void remove(u64 id);
+
+  size_t size() const;
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_PREPARED_QUERY_H_
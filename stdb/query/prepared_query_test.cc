@@ -0,0 +1,176 @@
+/*!
+ * \file prepared_query_test.cc
+ */
+#include "stdb/query/prepared_query.h"
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+namespace qp {
+
+static void add_series(SeriesMatcher* matcher, const char* series) {
+  matcher->add(series, series + strlen(series));
+}
+
+static ParamId match(SeriesMatcher const& matcher, const char* series) {
+  return static_cast<ParamId>(matcher.match(series, series + strlen(series)));
+}
+
+static const char* GROUP_AGGREGATE_TEMPLATE =
+    "{ \"group-aggregate\": { \"metric\": \"test\", \"step\": \"$step\", \"func\": [\"min\", \"max\"] },"
+    "  \"range\": { \"from\": \"$from\", \"to\": \"$to\" },"
+    "  \"where\": { \"tag1\": [\"1\", \"2\", \"4\"] },"
+    "  \"limit\": \"$limit\" }";
+
+TEST(TestPreparedQuery, Test_bind_parameters) {
+  SeriesMatcher matcher;
+  add_series(&matcher, "test tag1=1");
+  add_series(&matcher, "test tag1=2");
+  add_series(&matcher, "test tag1=3");
+
+  common::Status status;
+  std::shared_ptr<PreparedQuery> query;
+  ErrorMsg error;
+  std::tie(status, query, error) = PreparedQuery::create(GROUP_AGGREGATE_TEMPLATE, matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  EXPECT_EQ(QueryKind::GROUP_AGGREGATE, query->get_query_kind());
+
+  QueryParameters params;
+  params.begin = 1000000000ul;
+  params.end = 2000000000ul;
+  params.step = 10000000ul;
+  params.limit = 10ul;
+  ReshapeRequest req;
+  std::tie(status, req, error) = query->bind(params);
+  ASSERT_TRUE(status.IsOk()) << error;
+  EXPECT_EQ(1000000000ul, req.select.begin);
+  EXPECT_EQ(2000000000ul, req.select.end);
+  EXPECT_EQ(10000000ul, req.agg.step);
+  ASSERT_EQ(1u, req.select.columns.size());
+  EXPECT_EQ(2u, req.select.columns[0].ids.size());
+
+  std::vector<std::shared_ptr<Node>> nodes;
+  std::tie(status, nodes, error) = query->bind_processing_topology(params, nullptr, req);
+  ASSERT_TRUE(status.IsOk()) << error;
+  // Limiter and terminal node
+  EXPECT_EQ(2u, nodes.size());
+
+  // Next execution binds another range to the same request
+  params.begin = 3000000000ul;
+  params.end = 2000000000ul;
+  std::tie(status, req, error) = query->bind(params);
+  ASSERT_TRUE(status.IsOk()) << error;
+  EXPECT_EQ(3000000000ul, req.select.begin);
+  EXPECT_EQ(2000000000ul, req.select.end);
+  EXPECT_EQ(2u, req.select.columns[0].ids.size());
+
+  // New matching series invalidates the cached request
+  add_series(&matcher, "test tag1=4");
+  std::tie(status, req, error) = query->bind(params);
+  ASSERT_TRUE(status.IsOk()) << error;
+  EXPECT_EQ(3u, req.select.columns[0].ids.size());
+  EXPECT_EQ(3000000000ul, req.select.begin);
+}
+
+TEST(TestPreparedQuery, Test_bad_parameters) {
+  SeriesMatcher matcher;
+  add_series(&matcher, "test tag1=1");
+
+  common::Status status;
+  std::shared_ptr<PreparedQuery> query;
+  ErrorMsg error;
+  // Unknown slot
+  std::tie(status, query, error) = PreparedQuery::create(
+      "{ \"select\": \"test\", \"range\": { \"from\": \"$begin\", \"to\": \"$to\" } }", matcher);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  // Fixed range, there is nothing to bind
+  std::tie(status, query, error) = PreparedQuery::create(
+      "{ \"select\": \"test\", \"range\": { \"from\": \"1000\", \"to\": \"$to\" } }", matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  QueryParameters params;
+  ReshapeRequest req;
+  std::tie(status, req, error) = query->bind(params);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+  params.end = 5000ul;
+  std::tie(status, req, error) = query->bind(params);
+  ASSERT_TRUE(status.IsOk()) << error;
+  EXPECT_EQ(1000ul, req.select.begin);
+  EXPECT_EQ(5000ul, req.select.end);
+  // Template doesn't have `$step` slot
+  params.step = 1000ul;
+  std::tie(status, req, error) = query->bind(params);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+}
+
+TEST(TestPreparedQuery, Test_dollar_sign_outside_of_slots) {
+  SeriesMatcher matcher;
+  add_series(&matcher, "test host=$web");
+  add_series(&matcher, "test host=db");
+  add_series(&matcher, "$x host=db");
+
+  common::Status status;
+  std::shared_ptr<PreparedQuery> query;
+  ErrorMsg error;
+  // Tag value that starts with `$` is not a slot
+  std::tie(status, query, error) = PreparedQuery::create(
+      "{ \"select\": \"test\", \"range\": { \"from\": \"$from\", \"to\": \"$to\" },"
+      "  \"where\": { \"host\": \"$web\" } }", matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  QueryParameters params;
+  params.begin = 1000ul;
+  params.end = 2000ul;
+  ReshapeRequest req;
+  std::tie(status, req, error) = query->bind(params);
+  ASSERT_TRUE(status.IsOk()) << error;
+  ASSERT_EQ(1u, req.select.columns.size());
+  ASSERT_EQ(1u, req.select.columns[0].ids.size());
+  EXPECT_EQ(match(matcher, "test host=$web"), req.select.columns[0].ids[0]);
+
+  // Metric name
+  std::tie(status, query, error) = PreparedQuery::create(
+      "{ \"select\": \"$x\", \"range\": { \"from\": \"$from\", \"to\": \"$to\" } }", matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  std::tie(status, req, error) = query->bind(params);
+  ASSERT_TRUE(status.IsOk()) << error;
+  ASSERT_EQ(1u, req.select.columns[0].ids.size());
+  EXPECT_EQ(match(matcher, "$x host=db"), req.select.columns[0].ids[0]);
+}
+
+TEST(TestPreparedQuery, Test_prepared_query_cache) {
+  SeriesMatcher matcher;
+  add_series(&matcher, "test tag1=1");
+  PreparedQueryCache cache(2);
+
+  common::Status status;
+  u64 id1, id2, id3;
+  ErrorMsg error;
+  std::tie(status, id1, error) = cache.prepare(GROUP_AGGREGATE_TEMPLATE, matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  u64 same;
+  std::tie(status, same, error) = cache.prepare(GROUP_AGGREGATE_TEMPLATE, matcher);
+  EXPECT_EQ(id1, same);
+  EXPECT_EQ(1u, cache.size());
+
+  std::tie(status, id2, error) = cache.prepare("{ \"select\": \"test\", \"range\": { \"from\": \"$from\", \"to\": \"$to\" } }", matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  std::tie(status, id3, error) = cache.prepare("{ \"aggregate\": { \"test\": \"max\" }, \"range\": { \"from\": \"$from\", \"to\": \"$to\" } }", matcher);
+  ASSERT_TRUE(status.IsOk()) << error;
+  // First query should be evicted
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_FALSE(cache.get(id1));
+  EXPECT_TRUE(cache.get(id2));
+  EXPECT_TRUE(cache.get(id3));
+
+  cache.remove(id2);
+  EXPECT_FALSE(cache.get(id2));
+  EXPECT_EQ(1u, cache.size());
+
+  // Bad template is not cached
+  std::tie(status, id1, error) = cache.prepare("{ \"select\": ", matcher);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+  EXPECT_EQ(1u, cache.size());
+}
+
+}  // namespace qp
+}  // namespace stdb
@@ -0,0 +1,165 @@
+/*!
+ * \file downsample.cc
+ */
+#include "stdb/query/query_processing/downsample.h"
+
+#include <cmath>
+
+namespace stdb {
+namespace qp {
+
+//! Signed difference of two timestamps (series can be read backward)
+static double delta(Timestamp a, Timestamp b) {
+  return static_cast<double>(static_cast<i64>(a - b));
+}
+
+LTTBDownsampler::LTTBDownsampler(u32 width, Timestamp begin, Timestamp end, std::shared_ptr<Node> next)
+    : begin_(begin)
+    , forward_(begin < end)
+    , next_(next)
+{
+  if (width == 0) {
+    throw QueryParserError("`lttb` width should be greater than zero");
+  }
+  Downsample downsample = {};
+  downsample.width = width;
+  step_ = downsample.get_step(begin, end);
+}
+
+LTTBDownsampler::LTTBDownsampler(const boost::property_tree::ptree& ptree, const ReshapeRequest& req, std::shared_ptr<Node> next)
+    : LTTBDownsampler(ptree.get<u32>("width", req.downsample.width), req.select.begin, req.select.end, next)
+{
+}
+
+u64 LTTBDownsampler::get_bin(Timestamp ts) const {
+  if (forward_) {
+    return ts > begin_ ? (ts - begin_) / step_ : 0;
+  }
+  return begin_ > ts ? (begin_ - ts) / step_ : 0;
+}
+
+size_t LTTBDownsampler::select(std::vector<Point> const& bucket, Point const& prev, Point const& next) {
+  // Timestamps are relative to the previous point to keep precision
+  const double nx = delta(next.ts, prev.ts);
+  const double ny = next.value - prev.value;
+  size_t index = 0;
+  double max_area = -1;
+  for (size_t i = 0; i < bucket.size(); i++) {
+    double x = delta(bucket[i].ts, prev.ts);
+    double y = bucket[i].value - prev.value;
+    // Doubled area of the triangle
+    double area = std::fabs(x * ny - nx * y);
+    if (area > max_area) {
+      max_area = area;
+      index = i;
+    }
+  }
+  return index;
+}
+
+LTTBDownsampler::Point LTTBDownsampler::average(std::vector<Point> const& bucket) {
+  // Timestamps are averaged relative to the first one to keep precision
+  double ts = 0;
+  double value = 0;
+  for (auto const& p: bucket) {
+    ts += delta(p.ts, bucket.front().ts);
+    value += p.value;
+  }
+  double n = static_cast<double>(bucket.size());
+  Point result;
+  result.ts = bucket.front().ts + static_cast<Timestamp>(static_cast<i64>(std::llround(ts / n)));
+  result.value = value / n;
+  return result;
+}
+
+bool LTTBDownsampler::emit(ParamId id, Point const& point, State* state) {
+  state->selected = point;
+  Sample sample = {};
+  sample.paramid = id;
+  sample.timestamp = point.ts;
+  sample.payload.type = PAYLOAD_FLOAT;
+  sample.payload.size = sizeof(Sample);
+  sample.payload.float64 = point.value;
+  MutableSample mut(&sample);
+  return next_->put(mut);
+}
+
+bool LTTBDownsampler::flush(ParamId id, State* state) {
+  if (state->next.empty()) {
+    // Only the first value was received
+    return true;
+  }
+  Point last = state->next.back();
+  state->next.pop_back();
+  if (!state->current.empty()) {
+    Point next = state->next.empty() ? last : average(state->next);
+    if (!emit(id, state->current[select(state->current, state->selected, next)], state)) {
+      return false;
+    }
+  }
+  if (!state->next.empty()) {
+    if (!emit(id, state->next[select(state->next, state->selected, last)], state)) {
+      return false;
+    }
+  }
+  state->current.clear();
+  state->next.clear();
+  return emit(id, last, state);
+}
+
+void LTTBDownsampler::complete() {
+  for (auto& kv: table_) {
+    if (!flush(kv.first, &kv.second)) {
+      break;
+    }
+  }
+  table_.clear();
+  next_->complete();
+}
+
+bool LTTBDownsampler::put(MutableSample& mut) {
+  if (mut.size() != 1 || mut[0] == nullptr) {
+    return next_->put(mut);
+  }
+  ParamId id = mut.get_paramid();
+  Point point;
+  point.ts = mut.get_timestamp();
+  point.value = *mut[0];
+  auto it = table_.find(id);
+  if (it == table_.end()) {
+    // The first value is always kept
+    State state = {};
+    state.selected = point;
+    table_.emplace(id, std::move(state));
+    return next_->put(mut);
+  }
+  State& state = it->second;
+  u64 bin = get_bin(point.ts);
+  if (!state.next.empty() && bin != state.bin) {
+    // Bucket `next` is complete, the `current` one can be downsampled
+    if (!state.current.empty()) {
+      auto const& selected = state.current[select(state.current, state.selected, average(state.next))];
+      if (!emit(id, selected, &state)) {
+        return false;
+      }
+    }
+    std::swap(state.current, state.next);
+    state.next.clear();
+  }
+  state.bin = bin;
+  state.next.push_back(point);
+  return true;
+}
+
+void LTTBDownsampler::set_error(common::Status status) {
+  next_->set_error(status);
+}
+
+int LTTBDownsampler::get_requirements() const {
+  return TERMINAL;
+}
+
+static QueryParserToken<LTTBDownsampler> lttb_token("lttb");
+
+}  // namespace qp
+}  // namespace stdb
@@ -0,0 +1,76 @@
+/*!
+ * \file downsample.h
+ *
+ * Visualization-aware downsampling nodes.
+ */
+#ifndef STDB_QUERY_QUERY_PROCESSING_DOWNSAMPLE_H_
+#define STDB_QUERY_QUERY_PROCESSING_DOWNSAMPLE_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../queryprocessor_framework.h"
+
+namespace stdb {
+namespace qp {
+
+/** Largest-Triangle-Three-Buckets downsampling.
+ * Query range is split into `width` buckets (pixel columns) and one value is
+ * selected from every bucket: the one that forms the largest triangle with
+ * the value selected from the previous bucket and the average of the next
+ * bucket. The first and the last value of every series are always kept.
+ * Only two buckets of every series are buffered so the node works with any
+ * output order, but output of different series can be interleaved.
+ * Samples that don't contain a single value are passed through.
+ * Format: { "name": "lttb", "width": 1800 }
+ */
+struct LTTBDownsampler : Node {
+  struct Point {
+    Timestamp ts;
+    double    value;
+  };
+  struct State {
+    Point selected;              //! Last value sent to the next node
+    u64 bin;                     //! Bucket of the `next` values
+    std::vector<Point> current;  //! Bucket that should be downsampled
+    std::vector<Point> next;     //! Bucket that follows the `current` one
+  };
+  std::unordered_map<ParamId, State> table_;
+  Timestamp begin_;
+  u64 step_;
+  bool forward_;
+  std::shared_ptr<Node> next_;
+
+  LTTBDownsampler(u32 width, Timestamp begin, Timestamp end, std::shared_ptr<Node> next);
+
+  LTTBDownsampler(const boost::property_tree::ptree&, const ReshapeRequest&, std::shared_ptr<Node> next);
+
+  //! Return index of the point of the bucket that forms the largest triangle
+  static size_t select(std::vector<Point> const& bucket, Point const& prev, Point const& next);
+
+  //! Average of the bucket
+  static Point average(std::vector<Point> const& bucket);
+
+  virtual void complete();
+
+  virtual bool put(MutableSample& sample);
+
+  virtual void set_error(common::Status status);
+
+  virtual int get_requirements() const;
+
+ private:
+  u64 get_bin(Timestamp ts) const;
+
+  //! Send value to the next node and remember it
+  bool emit(ParamId id, Point const& point, State* state);
+
+  //! Downsample remaining buckets of the series
+  bool flush(ParamId id, State* state);
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_QUERY_PROCESSING_DOWNSAMPLE_H_
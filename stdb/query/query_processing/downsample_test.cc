@@ -0,0 +1,118 @@
+/*!
+ * \file downsample_test.cc
+ */
+#include "stdb/query/query_processing/downsample.h"
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "stdb/query/query_processing/mock_node.h"
+
+namespace stdb {
+namespace qp {
+
+static void put(Node& node, ParamId id, Timestamp ts, double value) {
+  Sample sample = {};
+  sample.paramid = id;
+  sample.timestamp = ts;
+  sample.payload.type = PAYLOAD_FLOAT;
+  sample.payload.size = sizeof(Sample);
+  sample.payload.float64 = value;
+  MutableSample mut(&sample);
+  node.put(mut);
+}
+
+static double signal(Timestamp ts) {
+  // Slow wave with a single spike
+  return ts == 4321 ? 100 : std::sin(static_cast<double>(ts) / 500);
+}
+
+TEST(TestDownsample, Test_lttb_select) {
+  typedef LTTBDownsampler::Point Point;
+  std::vector<Point> bucket = { { 10, 1 }, { 11, 5 }, { 12, 2 } };
+  // Point that deviates most from the line between the neighbours
+  EXPECT_EQ(1u, LTTBDownsampler::select(bucket, Point{ 0, 0 }, Point{ 20, 0 }));
+  auto avg = LTTBDownsampler::average(bucket);
+  EXPECT_EQ(11u, avg.ts);
+  EXPECT_DOUBLE_EQ(8.0 / 3, avg.value);
+  // Timestamps in backward order
+  std::vector<Point> backward = { { 12, 2 }, { 11, 5 }, { 10, 1 } };
+  EXPECT_EQ(11u, LTTBDownsampler::average(backward).ts);
+}
+
+TEST(TestDownsample, Test_lttb_stream) {
+  const u32 width = 100;
+  const Timestamp begin = 0, end = 10000;
+  auto mock = std::make_shared<MockNode>();
+  LTTBDownsampler lttb(width, begin, end, mock);
+  for (Timestamp ts = begin; ts < end; ts++) {
+    put(lttb, 1, ts, signal(ts));
+  }
+  lttb.complete();
+  EXPECT_TRUE(mock->completed);
+  auto const& out = mock->output;
+  // First value, one value per bucket and the last value
+  ASSERT_GE(out.size(), static_cast<size_t>(width));
+  ASSERT_LE(out.size(), static_cast<size_t>(width + 2));
+  EXPECT_EQ(begin, out.front().ts);
+  EXPECT_EQ(end - 1, out.back().ts);
+  bool has_spike = false;
+  for (size_t i = 0; i < out.size(); i++) {
+    EXPECT_EQ(signal(out[i].ts), out[i].value);
+    if (i > 0) {
+      EXPECT_LT(out[i - 1].ts, out[i].ts);
+    }
+    has_spike |= out[i].value == 100;
+  }
+  EXPECT_TRUE(has_spike);
+}
+
+TEST(TestDownsample, Test_lttb_interleaved_series) {
+  const u32 width = 50;
+  auto single = std::make_shared<MockNode>();
+  LTTBDownsampler lttb1(width, 0, 5000, single);
+  for (Timestamp ts = 0; ts < 5000; ts++) {
+    put(lttb1, 1, ts, signal(ts));
+  }
+  lttb1.complete();
+
+  // Output order is by time, each series is downsampled independently
+  auto mock = std::make_shared<MockNode>();
+  LTTBDownsampler lttb2(width, 0, 5000, mock);
+  for (Timestamp ts = 0; ts < 5000; ts++) {
+    put(lttb2, 1, ts, signal(ts));
+    put(lttb2, 2, ts, -signal(ts));
+  }
+  lttb2.complete();
+  std::vector<MockNode::Output> first;
+  size_t nsecond = 0;
+  for (auto const& out: mock->output) {
+    if (out.id == 1) {
+      first.push_back(out);
+    } else {
+      nsecond++;
+    }
+  }
+  ASSERT_EQ(single->output.size(), first.size());
+  EXPECT_EQ(single->output.size(), nsecond);
+  for (size_t i = 0; i < first.size(); i++) {
+    EXPECT_EQ(single->output[i].ts, first[i].ts);
+  }
+}
+
+TEST(TestDownsample, Test_lttb_short_series) {
+  auto mock = std::make_shared<MockNode>();
+  LTTBDownsampler lttb(1000, 0, 1000, mock);
+  put(lttb, 1, 10, 1.0);
+  put(lttb, 2, 10, 1.0);
+  put(lttb, 2, 20, 2.0);
+  lttb.complete();
+  // Series with less values than pixels are not changed
+  ASSERT_EQ(3u, mock->output.size());
+  EXPECT_THROW(LTTBDownsampler(0, 0, 1000, mock), QueryParserError);
+}
+
+}  // namespace qp
+}  // namespace stdb
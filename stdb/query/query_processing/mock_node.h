@@ -0,0 +1,44 @@
+/*!
+ * \file mock_node.h
+ *
+ * Test helper, processing node that records every sample it receives.
+ */
+#ifndef STDB_QUERY_QUERY_PROCESSING_MOCK_NODE_H_
+#define STDB_QUERY_QUERY_PROCESSING_MOCK_NODE_H_
+
+#include <vector>
+
+#include "stdb/query/queryprocessor_framework.h"
+
+namespace stdb {
+namespace qp {
+
+struct MockNode : Node {
+  struct Output {
+    ParamId   id;
+    Timestamp ts;
+    //! First element of the sample
+    double    value;
+    Location  location;
+  };
+  std::vector<Output> output;
+  bool completed = false;
+  common::Status status = common::Status::Ok();
+
+  void complete() override { completed = true; }
+
+  bool put(MutableSample& sample) override {
+    Output out = { sample.get_paramid(), sample.get_timestamp(), *sample[0], sample.payload_.sample.location };
+    output.push_back(out);
+    return true;
+  }
+
+  void set_error(common::Status error) override { status = error; }
+
+  int get_requirements() const override { return 0; }
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_QUERY_PROCESSING_MOCK_NODE_H_
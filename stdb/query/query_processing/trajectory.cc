@@ -0,0 +1,484 @@
+/*!
+ * \file trajectory.cc
+ */
+#include "stdb/query/query_processing/trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#include "stdb/common/geo.h"
+
+namespace stdb {
+namespace qp {
+
+static const double NSEC = 1000000000.0;
+
+using common::DEG2RAD;
+using common::EARTH_RADIUS;
+
+static double haversine(GeoPoint const& a, GeoPoint const& b) {
+  return common::haversine(a.lon, a.lat, b.lon, b.lat);
+}
+
+bool get_position(MutableSample& mut, GeoPoint* point) {
+  auto const& sample = mut.payload_.sample;
+  point->ts = sample.timestamp;
+  if (sample.payload.type & PData::LOCATION_BIT) {
+    point->lon = sample.location.lon;
+    point->lat = sample.location.lat;
+    return true;
+  }
+  if (mut.size() >= 2 && mut[0] && mut[1]) {
+    point->lon = *mut[0];
+    point->lat = *mut[1];
+    return true;
+  }
+  return false;
+}
+
+namespace {
+
+//! Send new sample with location and single value
+bool emit(Node& next, ParamId id, GeoPoint const& at, double value) {
+  Sample sample = {};
+  sample.paramid = id;
+  sample.timestamp = at.ts;
+  sample.location.lon = static_cast<LocationType>(at.lon);
+  sample.location.lat = static_cast<LocationType>(at.lat);
+  sample.payload.type = PAYLOAD_LOCATION_FLOAT;
+  sample.payload.size = sizeof(Sample);
+  sample.payload.float64 = value;
+  MutableSample mut(&sample);
+  return next.put(mut);
+}
+
+//! Replace sample value
+void set_value(MutableSample& mut, double value) {
+  mut.collapse();
+  *mut[0] = value;
+}
+
+/** Equirectangular projection of the trajectory to local plane (in meters).
+ * Good enough for simplification of the small pieces of the track.
+ */
+void project(std::vector<GeoPoint> const& points, std::vector<double>* xs, std::vector<double>* ys) {
+  double lat0 = 0;
+  for (auto const& p: points) {
+    lat0 += p.lat;
+  }
+  lat0 /= static_cast<double>(points.size());
+  const double ky = EARTH_RADIUS * DEG2RAD;
+  const double kx = ky * std::cos(lat0 * DEG2RAD);
+  for (auto const& p: points) {
+    xs->push_back((p.lon - points.front().lon) * kx);
+    ys->push_back((p.lat - points.front().lat) * ky);
+  }
+}
+
+//! Distance from point p to segment a-b
+double segment_distance(double px, double py, double ax, double ay, double bx, double by) {
+  double dx = bx - ax;
+  double dy = by - ay;
+  double len2 = dx * dx + dy * dy;
+  double t = len2 == 0 ? 0 : ((px - ax) * dx + (py - ay) * dy) / len2;
+  t = std::max(0.0, std::min(1.0, t));
+  double x = ax + t * dx - px;
+  double y = ay + t * dy - py;
+  return std::sqrt(x * x + y * y);
+}
+
+double triangle_area(std::vector<double> const& xs, std::vector<double> const& ys, size_t a, size_t b, size_t c) {
+  return std::fabs((xs[b] - xs[a]) * (ys[c] - ys[a]) - (xs[c] - xs[a]) * (ys[b] - ys[a])) / 2;
+}
+
+}  // namespace
+
+void douglas_peucker(std::vector<GeoPoint> const& points, double tolerance, std::vector<u8>* keep) {
+  const size_t n = points.size();
+  keep->assign(n, 0);
+  if (n <= 2) {
+    std::fill(keep->begin(), keep->end(), 1);
+    return;
+  }
+  std::vector<double> xs, ys;
+  project(points, &xs, &ys);
+  (*keep)[0] = 1;
+  (*keep)[n - 1] = 1;
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.push_back(std::make_pair(0, n - 1));
+  while (!stack.empty()) {
+    size_t first, last;
+    std::tie(first, last) = stack.back();
+    stack.pop_back();
+    double max_dist = -1;
+    size_t index = first;
+    for (size_t i = first + 1; i < last; i++) {
+      double d = segment_distance(xs[i], ys[i], xs[first], ys[first], xs[last], ys[last]);
+      if (d > max_dist) {
+        max_dist = d;
+        index = i;
+      }
+    }
+    if (max_dist > tolerance) {
+      (*keep)[index] = 1;
+      stack.push_back(std::make_pair(first, index));
+      stack.push_back(std::make_pair(index, last));
+    }
+  }
+}
+
+void visvalingam(std::vector<GeoPoint> const& points, double tolerance, std::vector<u8>* keep) {
+  const size_t n = points.size();
+  keep->assign(n, 1);
+  if (n <= 2) {
+    return;
+  }
+  std::vector<double> xs, ys;
+  project(points, &xs, &ys);
+  std::vector<size_t> prev(n), next(n);
+  std::vector<double> area(n, 0);
+  typedef std::pair<double, size_t> Item;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+  for (size_t i = 0; i < n; i++) {
+    prev[i] = i - 1;
+    next[i] = i + 1;
+  }
+  for (size_t i = 1; i + 1 < n; i++) {
+    area[i] = triangle_area(xs, ys, i - 1, i, i + 1);
+    heap.push(std::make_pair(area[i], i));
+  }
+  while (!heap.empty()) {
+    auto top = heap.top();
+    heap.pop();
+    size_t i = top.second;
+    if (!(*keep)[i] || top.first != area[i]) {
+      // Point was removed or its area was updated
+      continue;
+    }
+    if (top.first >= tolerance) {
+      break;
+    }
+    (*keep)[i] = 0;
+    size_t p = prev[i];
+    size_t q = next[i];
+    next[p] = q;
+    prev[q] = p;
+    // Area of the neighbours can't be smaller than the area of the removed point
+    if (p != 0) {
+      area[p] = std::max(top.first, triangle_area(xs, ys, prev[p], p, q));
+      heap.push(std::make_pair(area[p], p));
+    }
+    if (q != n - 1) {
+      area[q] = std::max(top.first, triangle_area(xs, ys, p, q, next[q]));
+      heap.push(std::make_pair(area[q], q));
+    }
+  }
+}
+
+// ------------ //
+//   Distance   //
+// ------------ //
+
+TrajectoryDistance::TrajectoryDistance(bool total, std::shared_ptr<Node> next)
+    : total_(total)
+    , next_(next)
+{
+}
+
+TrajectoryDistance::TrajectoryDistance(const boost::property_tree::ptree& ptree, const ReshapeRequest&, std::shared_ptr<Node> next)
+    : total_(ptree.get<bool>("total", false))
+    , next_(next)
+{
+}
+
+void TrajectoryDistance::complete() {
+  if (total_) {
+    for (auto const& kv: table_) {
+      if (!emit(*next_, kv.first, kv.second.last, kv.second.distance)) {
+        break;
+      }
+    }
+  }
+  next_->complete();
+}
+
+bool TrajectoryDistance::put(MutableSample& mut) {
+  GeoPoint point;
+  if (!get_position(mut, &point)) {
+    return next_->put(mut);
+  }
+  auto it = table_.find(mut.get_paramid());
+  if (it == table_.end()) {
+    State state = { point, 0.0 };
+    it = table_.insert(std::make_pair(mut.get_paramid(), state)).first;
+  } else {
+    it->second.distance += haversine(it->second.last, point);
+    it->second.last = point;
+  }
+  if (total_) {
+    return true;
+  }
+  set_value(mut, it->second.distance);
+  return next_->put(mut);
+}
+
+void TrajectoryDistance::set_error(common::Status status) {
+  next_->set_error(status);
+}
+
+int TrajectoryDistance::get_requirements() const {
+  return TERMINAL;
+}
+
+// ------------ //
+//    Speed     //
+// ------------ //
+
+TrajectorySpeed::TrajectorySpeed(bool max, std::shared_ptr<Node> next)
+    : max_(max)
+    , next_(next)
+{
+}
+
+TrajectorySpeed::TrajectorySpeed(const boost::property_tree::ptree& ptree, const ReshapeRequest&, std::shared_ptr<Node> next)
+    : max_(ptree.get<bool>("max", false))
+    , next_(next)
+{
+}
+
+void TrajectorySpeed::complete() {
+  if (max_) {
+    for (auto const& kv: table_) {
+      if (kv.second.max < 0) {
+        continue;
+      }
+      if (!emit(*next_, kv.first, kv.second.max_at, kv.second.max)) {
+        break;
+      }
+    }
+  }
+  next_->complete();
+}
+
+bool TrajectorySpeed::put(MutableSample& mut) {
+  GeoPoint point;
+  if (!get_position(mut, &point)) {
+    return next_->put(mut);
+  }
+  auto it = table_.find(mut.get_paramid());
+  if (it == table_.end()) {
+    State state = { point, point, -1.0 };
+    table_.insert(std::make_pair(mut.get_paramid(), state));
+    return true;
+  }
+  auto& state = it->second;
+  if (point.ts <= state.last.ts) {
+    return true;
+  }
+  double speed = haversine(state.last, point) / (static_cast<double>(point.ts - state.last.ts) / NSEC);
+  state.last = point;
+  if (max_) {
+    if (speed > state.max) {
+      state.max = speed;
+      state.max_at = point;
+    }
+    return true;
+  }
+  set_value(mut, speed);
+  return next_->put(mut);
+}
+
+void TrajectorySpeed::set_error(common::Status status) {
+  next_->set_error(status);
+}
+
+int TrajectorySpeed::get_requirements() const {
+  return TERMINAL;
+}
+
+// ------------ //
+//    Dwell     //
+// ------------ //
+
+DwellDetector::DwellDetector(double radius, Duration duration, std::shared_ptr<Node> next)
+    : radius_(radius)
+    , duration_(duration)
+    , next_(next)
+{
+}
+
+DwellDetector::DwellDetector(const boost::property_tree::ptree& ptree, const ReshapeRequest&, std::shared_ptr<Node> next)
+    : radius_(ptree.get<double>("radius", 50.0))
+    , next_(next)
+{
+  auto duration = ptree.get_optional<std::string>("duration");
+  if (!duration) {
+    QueryParserError err("'duration' field required");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  duration_ = DateTimeUtil::parse_duration(duration->data(), duration->size());
+  if (!(radius_ > 0)) {
+    QueryParserError err("'radius' should be positive");
+    BOOST_THROW_EXCEPTION(err);
+  }
+}
+
+bool DwellDetector::flush(ParamId id, State const& state) {
+  auto duration = state.last - state.anchor.ts;
+  if (duration < duration_ || duration == 0) {
+    return true;
+  }
+  return emit(*next_, id, state.anchor, static_cast<double>(duration) / NSEC);
+}
+
+void DwellDetector::complete() {
+  for (auto const& kv: table_) {
+    if (!flush(kv.first, kv.second)) {
+      break;
+    }
+  }
+  next_->complete();
+}
+
+bool DwellDetector::put(MutableSample& mut) {
+  GeoPoint point;
+  if (!get_position(mut, &point)) {
+    return next_->put(mut);
+  }
+  auto id = mut.get_paramid();
+  auto it = table_.find(id);
+  if (it == table_.end()) {
+    State state = { point, point.ts };
+    table_.insert(std::make_pair(id, state));
+    return true;
+  }
+  auto& state = it->second;
+  if (haversine(state.anchor, point) <= radius_) {
+    state.last = point.ts;
+    return true;
+  }
+  if (!flush(id, state)) {
+    return false;
+  }
+  state.anchor = point;
+  state.last = point.ts;
+  return true;
+}
+
+void DwellDetector::set_error(common::Status status) {
+  next_->set_error(status);
+}
+
+int DwellDetector::get_requirements() const {
+  return TERMINAL;
+}
+
+// ------------ //
+//   Simplify   //
+// ------------ //
+
+Simplify::Simplify(Method method, double tolerance, size_t batch_size, std::shared_ptr<Node> next)
+    : method_(method)
+    , tolerance_(tolerance)
+    , batch_size_(batch_size)
+    , next_(next)
+{
+}
+
+Simplify::Simplify(const boost::property_tree::ptree& ptree, const ReshapeRequest&, std::shared_ptr<Node> next)
+    : tolerance_(ptree.get<double>("tolerance"))
+    , batch_size_(ptree.get<size_t>("batch", 10000))
+    , next_(next)
+{
+  auto method = ptree.get<std::string>("method", "douglas-peucker");
+  if (method == "douglas-peucker") {
+    method_ = Method::DOUGLAS_PEUCKER;
+  } else if (method == "visvalingam") {
+    method_ = Method::VISVALINGAM;
+  } else {
+    QueryParserError err("Unknown simplification method '" + method + "'");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  if (batch_size_ < 3) {
+    QueryParserError err("'batch' should be at least 3");
+    BOOST_THROW_EXCEPTION(err);
+  }
+}
+
+bool Simplify::flush(Batch& batch, bool last) {
+  const size_t n = batch.points.size();
+  if (n == 0) {
+    return true;
+  }
+  std::vector<u8> keep;
+  if (method_ == Method::DOUGLAS_PEUCKER) {
+    douglas_peucker(batch.points, tolerance_, &keep);
+  } else {
+    visvalingam(batch.points, tolerance_, &keep);
+  }
+  // The last point of the intermediate batch is sent with the next batch
+  const size_t end = last ? n : n - 1;
+  for (size_t i = 0; i < end; i++) {
+    if (keep[i]) {
+      MutableSample mut(reinterpret_cast<const Sample*>(batch.raw.data() + batch.offsets[i]));
+      if (!next_->put(mut)) {
+        return false;
+      }
+    }
+  }
+  if (last) {
+    batch.points.clear();
+    batch.raw.clear();
+    batch.offsets.clear();
+  } else {
+    auto point = batch.points.back();
+    std::vector<char> raw(batch.raw.begin() + static_cast<std::ptrdiff_t>(batch.offsets.back()), batch.raw.end());
+    batch.points.assign(1, point);
+    batch.raw.swap(raw);
+    batch.offsets.assign(1, 0);
+  }
+  return true;
+}
+
+void Simplify::complete() {
+  for (auto& kv: table_) {
+    if (!flush(kv.second, true)) {
+      break;
+    }
+  }
+  next_->complete();
+}
+
+bool Simplify::put(MutableSample& mut) {
+  GeoPoint point;
+  if (!get_position(mut, &point)) {
+    return next_->put(mut);
+  }
+  auto& batch = table_[mut.get_paramid()];
+  auto const& sample = mut.payload_.sample;
+  auto size = std::max(sizeof(Sample), static_cast<size_t>(sample.payload.size));
+  batch.points.push_back(point);
+  batch.offsets.push_back(batch.raw.size());
+  batch.raw.insert(batch.raw.end(), mut.payload_.raw, mut.payload_.raw + size);
+  if (batch.points.size() >= batch_size_) {
+    return flush(batch, false);
+  }
+  return true;
+}
+
+void Simplify::set_error(common::Status status) {
+  next_->set_error(status);
+}
+
+int Simplify::get_requirements() const {
+  return TERMINAL;
+}
+
+static QueryParserToken<TrajectoryDistance> distance_token("distance");
+static QueryParserToken<TrajectorySpeed> speed_token("speed");
+static QueryParserToken<DwellDetector> dwell_token("dwell");
+static QueryParserToken<Simplify> simplify_token("simplify");
+
+}  // namespace qp
+}  // namespace stdb
@@ -0,0 +1,186 @@
+/*!
+ * \file trajectory.h
+ *
+ * Trajectory analytics for moving objects. Every node reads position of
+ * the sample from the location (if LOCATION_BIT is set) or from the first
+ * two elements of the tuple (lon, lat), e.g. result of the join query
+ * of the longitude and latitude series. Samples without position are
+ * passed through.
+ */
+#ifndef STDB_QUERY_QUERY_PROCESSING_TRAJECTORY_H_
+#define STDB_QUERY_QUERY_PROCESSING_TRAJECTORY_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "stdb/common/datetime.h"
+
+#include "../queryprocessor_framework.h"
+
+namespace stdb {
+namespace qp {
+
+struct GeoPoint {
+  Timestamp ts;
+  double    lon;
+  double    lat;
+};
+
+//! Extract position of the sample, returns false if sample doesn't have it
+bool get_position(MutableSample& mut, GeoPoint* point);
+
+/** Douglas-Peucker simplification.
+ * @param points is a trajectory
+ * @param tolerance is a max distance (in meters) between the removed point and simplified track
+ * @param keep is an output, keep[i] is set to 1 if points[i] should be kept
+ */
+void douglas_peucker(std::vector<GeoPoint> const& points, double tolerance, std::vector<u8>* keep);
+
+/** Visvalingam-Whyatt simplification.
+ * @param points is a trajectory
+ * @param tolerance is a min effective area (in square meters) of the kept point
+ * @param keep is an output, keep[i] is set to 1 if points[i] should be kept
+ */
+void visvalingam(std::vector<GeoPoint> const& points, double tolerance, std::vector<u8>* keep);
+
+/** Distance travelled by the object (in meters).
+ * Replaces value with running total, or, if "total" is set, outputs only
+ * one sample per series with the total distance when the query completes.
+ * Format: { "name": "distance", "total": true }
+ */
+struct TrajectoryDistance : Node {
+  struct State {
+    GeoPoint last;
+    double   distance;
+  };
+  std::unordered_map<ParamId, State> table_;
+  bool total_;
+  std::shared_ptr<Node> next_;
+
+  TrajectoryDistance(bool total, std::shared_ptr<Node> next);
+
+  TrajectoryDistance(const boost::property_tree::ptree&, const ReshapeRequest&, std::shared_ptr<Node> next);
+
+  virtual void complete();
+
+  virtual bool put(MutableSample& sample);
+
+  virtual void set_error(common::Status status);
+
+  virtual int get_requirements() const;
+};
+
+/** Instantaneous speed (in meters per second).
+ * Replaces value with the speed between the previous and the current
+ * position (first sample of every series is dropped), or, if "max" is set,
+ * outputs only one sample per series with the max speed when the query
+ * completes.
+ * Format: { "name": "speed", "max": true }
+ */
+struct TrajectorySpeed : Node {
+  struct State {
+    GeoPoint last;
+    GeoPoint max_at;
+    double   max;
+  };
+  std::unordered_map<ParamId, State> table_;
+  bool max_;
+  std::shared_ptr<Node> next_;
+
+  TrajectorySpeed(bool max, std::shared_ptr<Node> next);
+
+  TrajectorySpeed(const boost::property_tree::ptree&, const ReshapeRequest&, std::shared_ptr<Node> next);
+
+  virtual void complete();
+
+  virtual bool put(MutableSample& sample);
+
+  virtual void set_error(common::Status status);
+
+  virtual int get_requirements() const;
+};
+
+/** Stop (dwell) detection.
+ * Dwell segment is a sequence of points that stay within `radius` meters
+ * of the first point for at least `duration`. Outputs one sample per
+ * segment: timestamp and location of the first point, value is a segment
+ * duration in seconds. Other samples are dropped.
+ * Format: { "name": "dwell", "radius": 50, "duration": "5m" }
+ */
+struct DwellDetector : Node {
+  struct State {
+    GeoPoint anchor;
+    Timestamp last;
+  };
+  std::unordered_map<ParamId, State> table_;
+  double radius_;
+  Duration duration_;
+  std::shared_ptr<Node> next_;
+
+  DwellDetector(double radius, Duration duration, std::shared_ptr<Node> next);
+
+  DwellDetector(const boost::property_tree::ptree&, const ReshapeRequest&, std::shared_ptr<Node> next);
+
+  //! Output dwell segment if it's long enough
+  bool flush(ParamId id, State const& state);
+
+  virtual void complete();
+
+  virtual bool put(MutableSample& sample);
+
+  virtual void set_error(common::Status status);
+
+  virtual int get_requirements() const;
+};
+
+/** Trajectory simplification.
+ * Points of every series are accumulated in batches of `batch` points, every
+ * batch is simplified and the remaining points are sent to the next node
+ * (the last point of the batch starts the next batch). Output is ordered by
+ * timestamp within the series.
+ * Format: { "name": "simplify", "method": "douglas-peucker" | "visvalingam",
+ *           "tolerance": 10, "batch": 10000 }
+ * Tolerance is a distance in meters for Douglas-Peucker and an area in
+ * square meters for Visvalingam-Whyatt.
+ */
+struct Simplify : Node {
+  enum class Method {
+    DOUGLAS_PEUCKER,
+    VISVALINGAM,
+  };
+
+  struct Batch {
+    std::vector<GeoPoint> points;
+    //! Raw samples
+    std::vector<char>     raw;
+    std::vector<size_t>   offsets;
+  };
+  std::unordered_map<ParamId, Batch> table_;
+  Method method_;
+  double tolerance_;
+  size_t batch_size_;
+  std::shared_ptr<Node> next_;
+
+  Simplify(Method method, double tolerance, size_t batch_size, std::shared_ptr<Node> next);
+
+  Simplify(const boost::property_tree::ptree&, const ReshapeRequest&, std::shared_ptr<Node> next);
+
+  /** Simplify batch and send points to the next node.
+   * @param last is set if the batch is final, otherwise the last point is kept
+   */
+  bool flush(Batch& batch, bool last);
+
+  virtual void complete();
+
+  virtual bool put(MutableSample& sample);
+
+  virtual void set_error(common::Status status);
+
+  virtual int get_requirements() const;
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_QUERY_PROCESSING_TRAJECTORY_H_
@@ -0,0 +1,195 @@
+/*!
+ * \file trajectory_test.cc
+ */
+#include "stdb/query/query_processing/trajectory.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "stdb/query/query_processing/mock_node.h"
+
+namespace stdb {
+namespace qp {
+
+static const Timestamp SEC = 1000000000ull;
+
+static Sample make_sample(ParamId id, Timestamp ts, double lon, double lat) {
+  Sample sample = {};
+  sample.paramid = id;
+  sample.timestamp = ts;
+  sample.location.lon = static_cast<LocationType>(lon);
+  sample.location.lat = static_cast<LocationType>(lat);
+  sample.payload.type = PAYLOAD_LOCATION_FLOAT;
+  sample.payload.size = sizeof(Sample);
+  return sample;
+}
+
+static void put(Node& node, Sample const& sample) {
+  MutableSample mut(&sample);
+  node.put(mut);
+}
+
+TEST(TestTrajectory, Test_distance_and_speed) {
+  auto mock = std::make_shared<MockNode>();
+  TrajectoryDistance distance(false, mock);
+  for (int i = 0; i < 5; i++) {
+    put(distance, make_sample(1, i * 10 * SEC, 30, 10 + i * 0.001));
+  }
+  ASSERT_EQ(5u, mock->output.size());
+  EXPECT_EQ(0, mock->output[0].value);
+  EXPECT_NEAR(4 * 111.195, mock->output[4].value, 0.5);
+
+  mock->output.clear();
+  TrajectoryDistance total(true, mock);
+  for (int i = 0; i < 5; i++) {
+    put(total, make_sample(1, i * 10 * SEC, 30, 10 + i * 0.001));
+    put(total, make_sample(2, i * 10 * SEC, 30, 10));
+  }
+  EXPECT_TRUE(mock->output.empty());
+  total.complete();
+  EXPECT_TRUE(mock->completed);
+  ASSERT_EQ(2u, mock->output.size());
+  for (auto const& out: mock->output) {
+    EXPECT_NEAR(out.id == 1 ? 4 * 111.195 : 0.0, out.value, 0.5);
+  }
+
+  mock->output.clear();
+  TrajectorySpeed speed(false, mock);
+  put(speed, make_sample(1, 0, 30, 10));
+  put(speed, make_sample(1, 10 * SEC, 30, 10.001));
+  put(speed, make_sample(1, 20 * SEC, 30, 10.003));
+  ASSERT_EQ(2u, mock->output.size());
+  EXPECT_NEAR(11.1195, mock->output[0].value, 0.05);
+  EXPECT_NEAR(22.239, mock->output[1].value, 0.05);
+
+  mock->output.clear();
+  TrajectorySpeed max(true, mock);
+  put(max, make_sample(1, 0, 30, 10));
+  put(max, make_sample(1, 10 * SEC, 30, 10.003));
+  put(max, make_sample(1, 20 * SEC, 30, 10.004));
+  max.complete();
+  ASSERT_EQ(1u, mock->output.size());
+  EXPECT_NEAR(33.36, mock->output[0].value, 0.05);
+  EXPECT_EQ(10 * SEC, mock->output[0].ts);
+}
+
+TEST(TestTrajectory, Test_tuple_input) {
+  // Result of the join of lon and lat series
+  char buffer[sizeof(Sample) + 2 * sizeof(double)] = {};
+  Sample& sample = *reinterpret_cast<Sample*>(buffer);
+  sample.paramid = 1;
+  sample.payload.type = PAYLOAD_TUPLE;
+  sample.payload.size = sizeof(buffer);
+  u64 mask = 3ull | (2ull << 58);
+  memcpy(&sample.payload.float64, &mask, sizeof(mask));
+  double* values = reinterpret_cast<double*>(sample.payload.data);
+
+  auto mock = std::make_shared<MockNode>();
+  TrajectoryDistance distance(false, mock);
+  for (int i = 0; i < 3; i++) {
+    sample.timestamp = i * SEC;
+    values[0] = 30;
+    values[1] = 10 + i;
+    put(distance, sample);
+  }
+  ASSERT_EQ(3u, mock->output.size());
+  EXPECT_NEAR(2 * 111195, mock->output[2].value, 20);
+}
+
+TEST(TestTrajectory, Test_dwell) {
+  auto mock = std::make_shared<MockNode>();
+  DwellDetector dwell(50, 60 * SEC, mock);
+  Timestamp ts = 0;
+  // Moving
+  for (int i = 0; i < 10; i++, ts += SEC) {
+    put(dwell, make_sample(1, ts, 30, 10 + i * 0.001));
+  }
+  // Stop for 5 minutes, small GPS noise
+  Timestamp stop = ts;
+  for (int i = 0; i < 300; i++, ts += SEC) {
+    put(dwell, make_sample(1, ts, 30 + (i % 2) * 0.0001, 10.01));
+  }
+  // Short stop (30 seconds)
+  for (int i = 0; i < 30; i++, ts += SEC) {
+    put(dwell, make_sample(1, ts, 31, 11));
+  }
+  // Moving again
+  for (int i = 0; i < 10; i++, ts += SEC) {
+    put(dwell, make_sample(1, ts, 32, 12 + i * 0.001));
+  }
+  dwell.complete();
+  ASSERT_EQ(1u, mock->output.size());
+  EXPECT_EQ(stop, mock->output[0].ts);
+  EXPECT_NEAR(299, mock->output[0].value, 1e-9);
+  EXPECT_NEAR(10.01, mock->output[0].location.lat, 1e-5);
+}
+
+TEST(TestTrajectory, Test_simplification) {
+  // Straight line with a single spike
+  std::vector<GeoPoint> points;
+  for (int i = 0; i < 100; i++) {
+    GeoPoint p = { static_cast<Timestamp>(i), 30 + i * 0.0001, 10 + (i == 50 ? 0.001 : 0) };
+    points.push_back(p);
+  }
+  std::vector<u8> keep;
+  douglas_peucker(points, 10, &keep);
+  std::vector<size_t> kept;
+  for (size_t i = 0; i < keep.size(); i++) {
+    if (keep[i]) {
+      kept.push_back(i);
+    }
+  }
+  EXPECT_EQ(std::vector<size_t>({ 0, 49, 50, 51, 99 }), kept);
+
+  visvalingam(points, 10, &keep);
+  kept.clear();
+  for (size_t i = 0; i < keep.size(); i++) {
+    if (keep[i]) {
+      kept.push_back(i);
+    }
+  }
+  EXPECT_EQ(std::vector<size_t>({ 0, 49, 50, 51, 99 }), kept);
+}
+
+TEST(TestTrajectory, Test_simplify_node_batches) {
+  std::mt19937 gen(1);
+  std::normal_distribution<double> noise(0, 0.00001);
+  for (auto method: { Simplify::Method::DOUGLAS_PEUCKER, Simplify::Method::VISVALINGAM }) {
+    auto mock = std::make_shared<MockNode>();
+    // Tolerance is a distance for Douglas-Peucker and an area for Visvalingam-Whyatt
+    double tolerance = method == Simplify::Method::DOUGLAS_PEUCKER ? 20 : 5000;
+    Simplify simplify(method, tolerance, 1000, mock);
+    const int N = 10000;
+    for (int i = 0; i < N; i++) {
+      // Two objects moving along the circle
+      double a = 2 * M_PI * i / N;
+      put(simplify, make_sample(1, i * SEC, 30 + 0.1 * std::cos(a) + noise(gen), 10 + 0.1 * std::sin(a)));
+      put(simplify, make_sample(2, i * SEC, 31 + 0.1 * std::cos(a), 11 + 0.1 * std::sin(a) + noise(gen)));
+    }
+    simplify.complete();
+    size_t n1 = 0, n2 = 0;
+    Timestamp last1 = 0, last2 = 0;
+    for (auto const& out: mock->output) {
+      auto& last = out.id == 1 ? last1 : last2;
+      auto& n = out.id == 1 ? n1 : n2;
+      if (n) {
+        EXPECT_LT(last, out.ts);
+      }
+      last = out.ts;
+      n++;
+    }
+    EXPECT_EQ(static_cast<Timestamp>(N - 1) * SEC, last1);
+    EXPECT_EQ(static_cast<Timestamp>(N - 1) * SEC, last2);
+    // Output is much smaller than the input
+    EXPECT_LT(n1, N / 20u);
+    EXPECT_LT(n2, N / 20u);
+    EXPECT_GT(n1, 10u);
+  }
+}
+
+}  // namespace qp
+}  // namespace stdb
@@ -0,0 +1,115 @@
+/*!
+ * \file within.cc
+ */
+#include "stdb/query/query_processing/within.h"
+
+namespace stdb {
+namespace qp {
+
+namespace {
+
+Location parse_position(const boost::property_tree::ptree& position) {
+  std::vector<double> coords;
+  for (auto const& kv: position) {
+    coords.push_back(kv.second.get_value<double>());
+  }
+  if (coords.size() < 2) {
+    QueryParserError err("GeoJSON position should contain longitude and latitude");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  Location loc;
+  loc.lon = static_cast<LocationType>(coords[0]);
+  loc.lat = static_cast<LocationType>(coords[1]);
+  return loc;
+}
+
+//! Parse GeoJSON polygon coordinates (array of rings)
+Polygon parse_polygon(const boost::property_tree::ptree& rings) {
+  std::vector<Polygon::Ring> result;
+  for (auto const& ring: rings) {
+    Polygon::Ring points;
+    for (auto const& position: ring.second) {
+      points.push_back(parse_position(position.second));
+    }
+    if (points.size() < 3) {
+      QueryParserError err("GeoJSON linear ring should contain at least three positions");
+      BOOST_THROW_EXCEPTION(err);
+    }
+    result.push_back(std::move(points));
+  }
+  if (result.empty()) {
+    QueryParserError err("GeoJSON polygon is empty");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  return Polygon(result);
+}
+
+}  // namespace
+
+Within::Within(MultiPolygon const& region, std::shared_ptr<Node> next)
+    : region_(region)
+    , next_(next)
+{
+}
+
+Within::Within(const boost::property_tree::ptree& ptree, const ReshapeRequest&, std::shared_ptr<Node> next)
+    : next_(next)
+{
+  auto geometry = ptree.get_child_optional("geometry");
+  if (!geometry) {
+    QueryParserError err("'geometry' field required");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  region_ = parse_geometry(*geometry);
+}
+
+MultiPolygon Within::parse_geometry(const boost::property_tree::ptree& geometry) {
+  auto type = geometry.get<std::string>("type", "");
+  auto coords = geometry.get_child_optional("coordinates");
+  if (!coords) {
+    QueryParserError err("GeoJSON geometry should have 'coordinates' field");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  MultiPolygon result;
+  if (type == "Polygon") {
+    result.add(parse_polygon(*coords));
+  } else if (type == "MultiPolygon") {
+    for (auto const& polygon: *coords) {
+      result.add(parse_polygon(polygon.second));
+    }
+  } else {
+    QueryParserError err("Unsupported GeoJSON geometry type '" + type + "'");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  if (result.empty()) {
+    QueryParserError err("GeoJSON geometry is empty");
+    BOOST_THROW_EXCEPTION(err);
+  }
+  return result;
+}
+
+void Within::complete() {
+  next_->complete();
+}
+
+bool Within::put(MutableSample& mut) {
+  auto const& sample = mut.payload_.sample;
+  if ((sample.payload.type & PData::LOCATION_BIT) != 0 &&
+      !region_.contains(sample.location.lon, sample.location.lat)) {
+    return true;
+  }
+  return next_->put(mut);
+}
+
+void Within::set_error(common::Status status) {
+  next_->set_error(status);
+}
+
+int Within::get_requirements() const {
+  return TERMINAL;
+}
+
+static QueryParserToken<Within> within_token("within");
+
+}  // namespace qp
+}  // namespace stdb
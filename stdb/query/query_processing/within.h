@@ -0,0 +1,46 @@
+/*!
+ * \file within.h
+ */
+#ifndef STDB_QUERY_QUERY_PROCESSING_WITHIN_H_
+#define STDB_QUERY_QUERY_PROCESSING_WITHIN_H_
+
+#include <memory>
+
+#include "stdb/index/polygon.h"
+
+#include "../queryprocessor_framework.h"
+
+namespace stdb {
+namespace qp {
+
+/** Geofence filter for moving objects.
+ * Drops samples with location outside of the region. Samples without
+ * location are passed through.
+ * Format: { "name": "within", "geometry": { "type": "Polygon", "coordinates": [...] } }
+ */
+struct Within : Node {
+  MultiPolygon          region_;
+  std::shared_ptr<Node> next_;
+
+  Within(MultiPolygon const& region, std::shared_ptr<Node> next);
+
+  Within(const boost::property_tree::ptree&, const ReshapeRequest&, std::shared_ptr<Node> next);
+
+  /** Parse GeoJSON geometry object ("Polygon" or "MultiPolygon").
+   * Throws QueryParserError if geometry is invalid.
+   */
+  static MultiPolygon parse_geometry(const boost::property_tree::ptree& geometry);
+
+  virtual void complete();
+
+  virtual bool put(MutableSample& sample);
+
+  virtual void set_error(common::Status status);
+
+  virtual int get_requirements() const;
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_QUERY_PROCESSING_WITHIN_H_
@@ -13,7 +13,10 @@
 #include <array>
 
 #include "stdb/common/datetime.h"
+#include "stdb/query/json_reader.h"
+#include "stdb/query/query_processing/downsample.h"
 #include "stdb/query/query_processing/limiter.h"
+#include "stdb/query/query_processing/within.h"
 
 namespace stdb {
 namespace qp {
@@ -328,8 +331,16 @@ static std::tuple<common::Status, std::string, ErrorMsg> parse_select_events_stm
   return std::make_tuple(common::Status::QueryParsingError(), "", "Query object doesn't have a 'select-events' field");
 }
 
+/** Parse regex of the `select-events` filter, format:
+ * { "filter": "regex", ... }
+ * or
+ * { "filter": { "regex": "regex", "keywords": [ ... ], "prefix": [ ... ] }, ... }
+ */
 static std::tuple<common::Status, std::string, ErrorMsg> parse_select_events_filter_field(boost::property_tree::ptree const& ptree) {
   auto flt = ptree.get_child_optional("filter");
+  if (flt && !flt->empty()) {
+    flt = flt->get_child_optional("regex");
+  }
   if (flt && flt->empty()) {
     // select query
     auto str = flt->get_value<std::string>("");
@@ -345,12 +356,61 @@ static std::tuple<common::Status, std::string, ErrorMsg> parse_select_events_fil
   return std::make_tuple(common::Status::Ok(), "", "");
 }
 
+/** Parse keywords and prefixes of the `select-events` filter, format:
+ * { "filter": { "keywords": [ "error", "timeout" ], "prefix": [ "conn" ] }, ... }
+ * Single string can be used instead of the list.
+ */
+static std::tuple<common::Status, std::vector<std::string>, std::vector<std::string>, ErrorMsg>
+parse_select_events_keywords(boost::property_tree::ptree const& ptree) {
+  std::vector<std::string> keywords, prefixes;
+  auto flt = ptree.get_child_optional("filter");
+  if (!flt || flt->empty()) {
+    return std::make_tuple(common::Status::Ok(), keywords, prefixes, ErrorMsg());
+  }
+  auto read_list = [](boost::optional<boost::property_tree::ptree const&> node, std::vector<std::string>* out) {
+    if (!node) {
+      return true;
+    }
+    if (node->empty()) {
+      auto str = node->get_value<std::string>("");
+      if (str.empty()) {
+        return false;
+      }
+      out->push_back(str);
+      return true;
+    }
+    for (auto const& item: *node) {
+      auto str = item.second.get_value<std::string>("");
+      if (str.empty()) {
+        return false;
+      }
+      out->push_back(str);
+    }
+    return true;
+  };
+  if (!read_list(flt->get_child_optional("keywords"), &keywords)) {
+    return std::make_tuple(common::Status::QueryParsingError(), keywords, prefixes, "Invalid 'keywords' field");
+  }
+  if (!read_list(flt->get_child_optional("prefix"), &prefixes)) {
+    return std::make_tuple(common::Status::QueryParsingError(), keywords, prefixes, "Invalid 'prefix' field");
+  }
+  return std::make_tuple(common::Status::Ok(), keywords, prefixes, ErrorMsg());
+}
+
 /** Parse `join` statement, format:
  * { "join": [ "metric1", "metric2", ... ], ... }
+ * or
+ * { "join": { "metrics": [ "metric1", "metric2", ... ], "mode": "as-of", "tolerance": "10s" }, ... }
  */
 static std::tuple<common::Status, std::vector<std::string>, ErrorMsg>
 parse_join_stmt(boost::property_tree::ptree const& ptree) {
   auto join = ptree.get_child_optional("join");
+  if (join) {
+    auto metrics = join->get_child_optional("metrics");
+    if (metrics) {
+      join = metrics;
+    }
+  }
   // value is a list of metric names in proper order
   std::vector<std::string> result;
   if (join) {
@@ -374,6 +434,51 @@ parse_join_stmt(boost::property_tree::ptree const& ptree) {
   return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
 }
 
+/** Parse `mode` and `tolerance` fields of the `join` statement, format:
+ * { "join": { "metrics": [ ... ], "mode": "as-of", "tolerance": "10s" }, ... }
+ * Mode can be `exact` (default) or `as-of`.
+ */
+static std::tuple<common::Status, JoinMode, u64, ErrorMsg>
+parse_join_mode(boost::property_tree::ptree const& ptree) {
+  JoinMode mode = JoinMode::EXACT;
+  u64 tolerance = 0;
+  auto join = ptree.get_child_optional("join");
+  if (!join || !join->get_child_optional("metrics")) {
+    return std::make_tuple(common::Status::Ok(), mode, tolerance, ErrorMsg());
+  }
+  for (auto item: *join) {
+    if (item.first == "metrics") {
+      continue;
+    } else if (item.first == "mode") {
+      auto value = item.second.get_value<std::string>();
+      if (value == "as-of") {
+        mode = JoinMode::ASOF;
+      } else if (value != "exact") {
+        LOG(ERROR) << "Invalid join mode " << value;
+        return std::make_tuple(common::Status::QueryParsingError(), mode, tolerance,
+                               "Unexpected `mode` field value `" + value + "` in `join` statement");
+      }
+    } else if (item.first == "tolerance") {
+      auto value = item.second.get_value<std::string>();
+      try {
+        tolerance = DateTimeUtil::parse_duration(value.data(), value.size());
+      } catch (const BadDateTimeFormat& e) {
+        LOG(ERROR) << "Can't parse time-duration: " + value;
+        return std::make_tuple(common::Status::QueryParsingError(), mode, tolerance,
+                               "can't parse time-duration: " + value);
+      }
+    } else {
+      return std::make_tuple(common::Status::QueryParsingError(), mode, tolerance,
+                             "Unexpected field `" + item.first + "` in `join` statement");
+    }
+  }
+  if (tolerance != 0 && mode != JoinMode::ASOF) {
+    return std::make_tuple(common::Status::QueryParsingError(), mode, tolerance,
+                           "`tolerance` can only be used with `as-of` join");
+  }
+  return std::make_tuple(common::Status::Ok(), mode, tolerance, ErrorMsg());
+}
+
 /** Parse `aggregate` statement, format:
  * { "aggregate": { "metric": "func" }, ... }
  */
@@ -410,11 +515,37 @@ struct GroupAggregate {
   std::vector<std::string> metric;
   std::vector<AggregationFunction> func;
   Duration step;
+  FillPolicy fill = FillPolicy::NONE;
+  double fill_value = 0;
 };
 
+/** Parse `fill` field of the `group-aggregate` statement. Field can
+ * contain policy name ("none", "null", "previous", "linear") or number
+ * (empty buckets will be filled with this number).
+ */
+static std::tuple<common::Status, FillPolicy, double> parse_fill_policy(const std::string& value) {
+  static const std::map<std::string, FillPolicy> policies = {
+    { "none", FillPolicy::NONE },
+    { "null", FillPolicy::NULL_VALUE },
+    { "previous", FillPolicy::PREVIOUS },
+    { "linear", FillPolicy::LINEAR },
+  };
+  auto it = policies.find(value);
+  if (it != policies.end()) {
+    return std::make_tuple(common::Status::Ok(), it->second, 0.0);
+  }
+  try {
+    double x = boost::lexical_cast<double>(value);
+    return std::make_tuple(common::Status::Ok(), FillPolicy::CONSTANT, x);
+  } catch (boost::bad_lexical_cast const&) {
+    return std::make_tuple(common::Status::QueryParsingError(), FillPolicy::NONE, 0.0);
+  }
+}
+
 /** Parse `group-aggregate` statement, format:
  * { "group-aggregate": { "step": "30s", "metric": "name", "func": ["cnt", "avg"] }, ... }
  * { "group-aggregate": { "step": "30s", "metric": ["foo", "bar"], "func": ["cnt", "avg"] }, ... }
+ * { "group-aggregate": { "step": "30s", "metric": "name", "func": "avg", "fill": "linear" }, ... }
  * @return status, metric name, functions array, step (as timestamp)
  */
 static std::tuple<common::Status, GroupAggregate, ErrorMsg> parse_group_aggregate_stmt(boost::property_tree::ptree const& ptree,
@@ -422,6 +553,7 @@ static std::tuple<common::Status, GroupAggregate, ErrorMsg> parse_group_aggregat
   bool components[] = {
     false, false, false
   };
+  bool fill_error = false;
   GroupAggregate result;
   std::stringstream error_fmt;
   auto aggregate = ptree.get_child_optional(field_name);
@@ -533,12 +665,25 @@ static std::tuple<common::Status, GroupAggregate, ErrorMsg> parse_group_aggregat
           }
           components[2] = n;
         }
+      } else if (tag_name == "fill") {
+        common::Status status = common::Status::QueryParsingError();
+        if (value) {
+          std::tie(status, result.fill, result.fill_value) = parse_fill_policy(*value);
+        }
+        if (status != common::Status::Ok()) {
+          LOG(ERROR) << "Invalid fill policy in `" + field_name + "` statement";
+          error_fmt << "invalid fill policy in `" << field_name << "` statement";
+          fill_error = true;
+          break;
+        }
       }
     }
   }
   bool complete = components[0] && components[1] && components[2];
   std::stringstream fullerr;
-  if (complete) {
+  if (fill_error) {
+    fullerr << "Can't validate `" << field_name << "` statement, " << error_fmt.str();
+  } else if (complete) {
     return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
   } else if (components[0] == false) {
     LOG(ERROR) << "Can't validate `" + field_name + "` statement, `step` field required";
@@ -575,6 +720,65 @@ static std::tuple<common::Status, OrderBy, ErrorMsg> parse_orderby(boost::proper
   return std::make_tuple(common::Status::Ok(), OrderBy::TIME, ErrorMsg());
 }
 
+/** Parse `downsample` statement, format:
+ * { "downsample": { "width": 1800, "algorithm": "m4" }, ... }
+ * Width is a number of pixel columns, algorithm is "m4" (default) or "lttb".
+ */
+static std::tuple<common::Status, Downsample, ErrorMsg> parse_downsample(boost::property_tree::ptree const& ptree) {
+  Downsample result = {};
+  auto downsample = ptree.get_child_optional("downsample");
+  if (!downsample) {
+    return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+  }
+  auto width = downsample->get_optional<u32>("width");
+  if (!width || *width == 0) {
+    LOG(ERROR) << "Invalid `downsample` statement, `width` field required";
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "Query object has invalid `downsample` field, positive `width` expected");
+  }
+  result.width = *width;
+  auto algorithm = downsample->get<std::string>("algorithm", "m4");
+  if (algorithm == "m4") {
+    result.method = DownsampleMethod::M4;
+  } else if (algorithm == "lttb") {
+    result.method = DownsampleMethod::LTTB;
+  } else {
+    LOG(ERROR) << "Invalid `downsample` statement, unknown algorithm " + algorithm;
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "Query object has invalid `downsample` field, unknown algorithm `" + algorithm + "`");
+  }
+  return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+}
+
+/** Parse `approximate` statement, format:
+ * { "approximate": { "error": 0.01, "confidence": 0.95, "budget": 100 }, ... }
+ * Error is a target relative error, budget is a time limit in milliseconds,
+ * all fields are optional.
+ */
+static std::tuple<common::Status, AggregateApproximation, ErrorMsg> parse_approximate(boost::property_tree::ptree const& ptree) {
+  AggregateApproximation result = {};
+  auto approx = ptree.get_child_optional("approximate");
+  if (!approx) {
+    return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+  }
+  try {
+    result.error = approx->get<double>("error", 0.01);
+    result.confidence = approx->get<double>("confidence", 0.95);
+    result.budget = approx->get<u32>("budget", 0);
+  } catch (boost::property_tree::ptree_error const& e) {
+    LOG(ERROR) << "Invalid `approximate` statement: " << e.what();
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "Query object has invalid `approximate` field");
+  }
+  if (!(result.error > 0 && result.error < 1) || !(result.confidence > 0 && result.confidence < 1)) {
+    LOG(ERROR) << "Invalid `approximate` statement, error and confidence should be in (0, 1) range";
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "Query object has invalid `approximate` field, `error` and `confidence` should be in (0, 1) range");
+  }
+  result.enabled = true;
+  return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+}
+
 /** Parse `group-by` statement, format:
  *  { ..., "group-by": [ "tag1", "tag2" ] }
  *  or
@@ -610,6 +814,126 @@ static std::tuple<common::Status, std::vector<std::string>, GroupByOpType, Error
   return std::make_tuple(common::Status::Ok(), tags, op, ErrorMsg());
 }
 
+//! Spatial group-by parameters
+struct GroupByLocationStmt {
+  bool     enabled;
+  Location min;
+  Location max;
+  //! Grid cell size in degrees
+  double   cell_size;
+  //! Geohash precision
+  u32      geohash;
+};
+
+/** Parse `group-by-location` statement, format:
+ *  { ..., "group-by-location": { "cell": 0.01, "bbox": [ lon0, lat0, lon1, lat1 ] } }
+ *  or
+ *  { ..., "group-by-location": { "geohash": 6 } }
+ *  Bounding box is optional.
+ */
+static std::tuple<common::Status, GroupByLocationStmt, ErrorMsg> parse_groupby_location(boost::property_tree::ptree const& ptree) {
+  GroupByLocationStmt result = {};
+  result.min.lon = -180;
+  result.min.lat = -90;
+  result.max.lon = 180;
+  result.max.lat = 90;
+  auto groupby = ptree.get_child_optional("group-by-location");
+  if (!groupby) {
+    return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+  }
+  result.enabled = true;
+  for (auto const& kv: *groupby) {
+    if (kv.first == "cell") {
+      auto cell = kv.second.get_value_optional<double>();
+      if (!cell || !(*cell > 0)) {
+        return std::make_tuple(common::Status::QueryParsingError(), result,
+                               "Invalid `cell` field in `group-by-location` statement");
+      }
+      result.cell_size = *cell;
+    } else if (kv.first == "geohash") {
+      auto precision = kv.second.get_value_optional<u32>();
+      if (!precision || *precision == 0 || *precision > 12) {
+        return std::make_tuple(common::Status::QueryParsingError(), result,
+                               "Invalid `geohash` field in `group-by-location` statement");
+      }
+      result.geohash = *precision;
+    } else if (kv.first == "bbox") {
+      std::vector<double> coords;
+      for (auto const& child: kv.second) {
+        auto value = child.second.get_value_optional<double>();
+        if (!value) {
+          return std::make_tuple(common::Status::QueryParsingError(), result,
+                                 "Invalid `bbox` field in `group-by-location` statement");
+        }
+        coords.push_back(*value);
+      }
+      if (coords.size() != 4 || coords[0] > coords[2] || coords[1] > coords[3]) {
+        return std::make_tuple(common::Status::QueryParsingError(), result,
+                               "Invalid `bbox` field in `group-by-location` statement");
+      }
+      result.min.lon = static_cast<LocationType>(coords[0]);
+      result.min.lat = static_cast<LocationType>(coords[1]);
+      result.max.lon = static_cast<LocationType>(coords[2]);
+      result.max.lat = static_cast<LocationType>(coords[3]);
+    } else {
+      return std::make_tuple(common::Status::QueryParsingError(), result,
+                             "Unexpected field `" + kv.first + "` in `group-by-location` statement");
+    }
+  }
+  if ((result.cell_size > 0) == (result.geohash != 0)) {
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "Either `cell` or `geohash` should be set in `group-by-location` statement");
+  }
+  return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+}
+
+//! Spatial join parameters
+struct SpatialJoinStmt {
+  bool                     enabled;
+  std::vector<std::string> metric;
+  //! Join distance in meters
+  double                   distance;
+};
+
+/** Parse `spatial-join` statement, format:
+ *  { ..., "spatial-join": { "metric": "station", "where": { ... }, "distance": 2000 } }
+ *  Series selected by the query are grouped by the closest series selected by
+ *  the `spatial-join` statement. The `where` field is optional.
+ */
+static std::tuple<common::Status, SpatialJoinStmt, ErrorMsg> parse_spatial_join(boost::property_tree::ptree const& ptree) {
+  SpatialJoinStmt result = {};
+  auto join = ptree.get_child_optional("spatial-join");
+  if (!join) {
+    return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+  }
+  result.enabled = true;
+  for (auto const& kv: *join) {
+    if (kv.first == "metric") {
+      auto metric = kv.second.get_value<std::string>();
+      if (metric.empty()) {
+        return std::make_tuple(common::Status::QueryParsingError(), result,
+                               "Invalid `metric` field in `spatial-join` statement");
+      }
+      result.metric.push_back(metric);
+    } else if (kv.first == "distance") {
+      auto distance = kv.second.get_value_optional<double>();
+      if (!distance || !(*distance > 0)) {
+        return std::make_tuple(common::Status::QueryParsingError(), result,
+                               "Invalid `distance` field in `spatial-join` statement");
+      }
+      result.distance = *distance;
+    } else if (kv.first != "where" && kv.first != "within") {
+      return std::make_tuple(common::Status::QueryParsingError(), result,
+                             "Unexpected field `" + kv.first + "` in `spatial-join` statement");
+    }
+  }
+  if (result.metric.empty() || result.distance == 0) {
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "Both `metric` and `distance` should be set in `spatial-join` statement");
+  }
+  return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+}
+
 /** Parse `limit` and `offset` statements, format:
  * { "limit": 10, "offset": 200, ... }
  */
@@ -680,6 +1004,40 @@ static std::tuple<common::Status, Timestamp, Timestamp, ErrorMsg> parse_range_ti
   return std::make_tuple(common::Status::Ok(), begin, end, ErrorMsg());
 }
 
+/** Parse `within` statement and keep only series located inside the region, format:
+ * "within": { "type": "Polygon", "coordinates": [ [ [lon, lat], ... ], ... ] }
+ * or
+ * "within": { "type": "MultiPolygon", "coordinates": [ [ [ [lon, lat], ... ] ], ... ] }
+ */
+static std::tuple<common::Status, std::vector<ParamId>, ErrorMsg> filter_within(boost::property_tree::ptree const& ptree,
+                                                                                std::vector<ParamId>&& ids,
+                                                                                SeriesMatcher const& matcher) {
+  auto within = ptree.get_child_optional("within");
+  if (!within) {
+    return std::make_tuple(common::Status::Ok(), std::move(ids), ErrorMsg());
+  }
+  MultiPolygon region;
+  try {
+    region = qp::Within::parse_geometry(*within);
+  } catch (const boost::property_tree::ptree_error& e) {
+    auto err = ErrorMsg("Query object has invalid `within` field ") + e.what();
+    LOG(ERROR) << err;
+    return std::make_tuple(common::Status::QueryParsingError(), std::move(ids), err);
+  } catch (const QueryParserError& e) {
+    auto err = ErrorMsg("Query object has invalid `within` field ") + e.what();
+    LOG(ERROR) << err;
+    return std::make_tuple(common::Status::QueryParsingError(), std::move(ids), err);
+  }
+  auto inside = matcher.search_region(region);
+  std::vector<ParamId> output;
+  for (auto id: ids) {
+    if (std::binary_search(inside.begin(), inside.end(), static_cast<i64>(id))) {
+      output.push_back(id);
+    }
+  }
+  return std::make_tuple(common::Status::Ok(), std::move(output), ErrorMsg());
+}
+
 /** Parse `where` statement, format:
  * "where": { "tag": [ "value1", "value2" ], ... },
  * or
@@ -736,6 +1094,13 @@ static std::tuple<common::Status, std::vector<ParamId>, ErrorMsg> parse_where_cl
     SeriesRetreiver retreiver;
     std::tie(status, output) = retreiver.extract_ids(matcher);
   }
+  if (status.IsOk()) {
+    ErrorMsg error;
+    std::tie(status, output, error) = filter_within(ptree, std::move(output), matcher);
+    if (!status.IsOk()) {
+      return std::make_tuple(status, output, error);
+    }
+  }
   return std::make_tuple(status, output, ErrorMsg());
 }
 
@@ -861,27 +1226,29 @@ parse_filter(boost::property_tree::ptree const& ptree, std::vector<std::string>
 // QueryParser class //
 // ///////////////// //
 std::tuple<common::Status, boost::property_tree::ptree, ErrorMsg> QueryParser::parse_json(const char* query) {
-  //! C-string to streambuf adapter
-  struct MemStreambuf : std::streambuf {
-    MemStreambuf(const char* buf) {
-      char* p = const_cast<char*>(buf);
-      setg(p, p, p+strlen(p));
-    }
-  };
-
   boost::property_tree::ptree ptree;
-  MemStreambuf strbuf(query);
-  std::istream stream(&strbuf);
-  try {
-    boost::property_tree::json_parser::read_json(stream, ptree);
-  } catch (boost::property_tree::json_parser_error const& e) {
+  common::Status status;
+  ErrorMsg error;
+  std::tie(status, error) = parse_json(query, &ptree);
+  return std::make_tuple(status, ptree, error);
+}
+
+std::tuple<common::Status, ErrorMsg> QueryParser::parse_json(const char* query, boost::property_tree::ptree* ptree) {
+  JsonReader reader(query, query + strlen(query));
+  JsonPTreeBuilder builder(ptree);
+  common::Status status;
+  size_t line;
+  std::string message;
+  std::tie(status, line, message) = reader.read(&builder);
+  if (!status.IsOk()) {
     // Error, bad query
     std::stringstream error;
-    error << "JSON parsing error at line " << std::to_string(e.line()) << ", " << e.message();
+    error << "JSON parsing error at line " << std::to_string(line) << ", " << message;
     LOG(ERROR) << error.str();
-    return std::make_tuple(common::Status::QueryParsingError(), ptree, error.str());
+    ptree->clear();
+    return std::make_tuple(common::Status::QueryParsingError(), error.str());
   }
-  return std::make_tuple(common::Status::Ok(), ptree, ErrorMsg());
+  return std::make_tuple(common::Status::Ok(), ErrorMsg());
 }
 
 std::tuple<common::Status, QueryKind, ErrorMsg> QueryParser::get_query_kind(boost::property_tree::ptree const& ptree) {
@@ -909,14 +1276,41 @@ std::tuple<common::Status, QueryKind, ErrorMsg> QueryParser::get_query_kind(boos
       return std::make_tuple(common::Status::Ok(), QueryKind::GROUP_AGGREGATE_JOIN, ErrorMsg());
     } else if (item.first == "select-events") {
       return std::make_tuple(common::Status::Ok(), QueryKind::SELECT_EVENTS, ErrorMsg());
+    } else if (item.first == "similar") {
+      return std::make_tuple(common::Status::Ok(), QueryKind::SIMILAR, ErrorMsg());
     }
   }
   static const char* error_message = "Query object type is undefined. "
       "One of the following fields should be added: "
-      "select, aggregate, join, group-aggregate";
+      "select, aggregate, join, group-aggregate, similar";
   return std::make_tuple(common::Status::QueryParsingError(), QueryKind::SELECT, error_message);
 }
 
+std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_query(
+    boost::property_tree::ptree const& ptree,
+    QueryKind kind,
+    SeriesMatcher const& matcher) {
+  switch (kind) {
+    case QueryKind::SELECT:
+      return parse_select_query(ptree, matcher);
+    case QueryKind::SELECT_EVENTS:
+      return parse_select_events_query(ptree, matcher);
+    case QueryKind::AGGREGATE:
+      return parse_aggregate_query(ptree, matcher);
+    case QueryKind::JOIN:
+      return parse_join_query(ptree, matcher);
+    case QueryKind::GROUP_AGGREGATE:
+      return parse_group_aggregate_query(ptree, matcher);
+    case QueryKind::GROUP_AGGREGATE_JOIN:
+      return parse_group_aggregate_join_query(ptree, matcher);
+    case QueryKind::SIMILAR:
+      return parse_similarity_query(ptree, matcher);
+    case QueryKind::SELECT_META:
+      break;
+  };
+  return std::make_tuple(common::Status::QueryParsingError(), ReshapeRequest(), "Unsupported query kind");
+}
+
 std::tuple<common::Status, ErrorMsg> validate_query(boost::property_tree::ptree const& ptree) {
   static const std::vector<std::string> UNIQUE_STMTS = {
     "select",
@@ -925,6 +1319,7 @@ std::tuple<common::Status, ErrorMsg> validate_query(boost::property_tree::ptree
     "group-aggregate",
     "group-aggregate-join",
     "select-events",
+    "similar",
   };
   static const std::set<std::string> ALLOWED_STMTS = {
     "select",
@@ -935,6 +1330,9 @@ std::tuple<common::Status, ErrorMsg> validate_query(boost::property_tree::ptree
     "group-by",
     "group-by-tag",
     "pivot-by-tag",
+    "group-by-location",
+    "spatial-join",
+    "within",
     "limit",
     "offset",
     "range",
@@ -945,6 +1343,9 @@ std::tuple<common::Status, ErrorMsg> validate_query(boost::property_tree::ptree
     "eval",
     "filter",
     "select-events",
+    "similar",
+    "downsample",
+    "approximate",
   };
   std::set<std::string> keywords;
   for (const auto& item: ptree) {
@@ -1117,6 +1518,17 @@ QueryParser::parse_search_query(boost::property_tree::ptree const& ptree,
  *      "tag": "host"
  * }
  * ```
+ *
+ * Optional `limit` field can be used with any suggest query. If it's set only
+ * the most frequently used values are returned (ordered by the number of series).
+ * ```json
+ * {
+ *      "select": "tag-values",
+ *      "metric": "df.used",
+ *      "tag": "host",
+ *      "limit": 10
+ * }
+ * ```
  */
 
 enum class SuggestQueryKind {
@@ -1132,6 +1544,7 @@ static std::tuple<common::Status, ErrorMsg> validate_suggest_query(boost::proper
     "metric",
     "tag",
     "starts-with",
+    "limit",
     "output"
   };
   for (const auto& item: ptree) {
@@ -1212,13 +1625,14 @@ QueryParser::parse_suggest_query(boost::property_tree::ptree const& ptree, Serie
   SuggestQueryKind kind;
   std::tie(kind, status, error) = get_suggest_query_type(ptree);
   std::string starts_with = get_starts_with(ptree);
+  auto limit = parse_limit_offset(ptree).first;
   std::vector<StringT> results;
   std::string metric_name;
   std::string tag_name;
   switch (kind) {
     case SuggestQueryKind::SUGGEST_METRIC_NAMES:
       // This should work for empty 'starts_with' values. Method should return all metric names.
-      results = matcher.suggest_metric(starts_with);
+      results = matcher.suggest_metric(starts_with, limit);
       break;
     case SuggestQueryKind::SUGGEST_TAG_NAMES:
       std::tie(status, metric_name) = get_property("metric", ptree);
@@ -1226,7 +1640,7 @@ QueryParser::parse_suggest_query(boost::property_tree::ptree const& ptree, Serie
         LOG(ERROR) << "Metric name expected";
         return std::make_tuple(common::Status::QueryParsingError(), substitute, ids, "Metric name expected");
       }
-      results = matcher.suggest_tags(metric_name, starts_with);
+      results = matcher.suggest_tags(metric_name, starts_with, limit);
       break;
     case SuggestQueryKind::SUGGEST_TAG_VALUES:
       std::tie(status, metric_name) = get_property("metric", ptree);
@@ -1239,7 +1653,7 @@ QueryParser::parse_suggest_query(boost::property_tree::ptree const& ptree, Serie
         LOG(ERROR) << "Tag name expected";
         return std::make_tuple(common::Status::QueryParsingError(), substitute, ids, "Tag name expected");
       }
-      results = matcher.suggest_tag_values(metric_name, tag_name, starts_with);
+      results = matcher.suggest_tag_values(metric_name, tag_name, starts_with, limit);
       break;
     case SuggestQueryKind::SUGGEST_ERROR:
       return std::make_tuple(common::Status::QueryParsingError(), substitute, ids, error);
@@ -1332,6 +1746,24 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_select_q
     return std::make_tuple(status, result, error);
   }
 
+  std::tie(status, result.downsample, error) = parse_downsample(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+  if (result.downsample.method == DownsampleMethod::M4) {
+    // M4 is computed by the storage using group-aggregate operators
+    if (result.group_by.enabled) {
+      return std::make_tuple(common::Status::QueryParsingError(), result,
+                             "`downsample` with `m4` algorithm can't be combined with `group-by-tag`/`pivot-by-tag`");
+    }
+    for (auto const& flt: result.select.filters) {
+      if (flt.enabled) {
+        return std::make_tuple(common::Status::QueryParsingError(), result,
+                               "`downsample` with `m4` algorithm can't be combined with `filter`");
+      }
+    }
+  }
+
   return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
 }
 
@@ -1366,6 +1798,10 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_select_e
   if (!flt.empty()) {
     result.select.event_body_regex = flt;
   }
+  std::tie(status, result.select.event_keywords, result.select.event_prefixes, error) = parse_select_events_keywords(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
 
   // Group-by statement
   GroupByOpType op;
@@ -1536,9 +1972,26 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_aggregat
     return std::make_tuple(status, result, error);
   }
 
+  // Approximate mode
+  AggregateApproximation approx;
+  std::tie(status, approx, error) = parse_approximate(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+  if (approx.enabled) {
+    for (auto f: func) {
+      if (f != AggregationFunction::CNT && f != AggregationFunction::SUM && f != AggregationFunction::MEAN) {
+        return std::make_tuple(common::Status::QueryParsingError(),
+                               result,
+                               "Aggregation function `" + Aggregation::to_string(f) + "` can't be approximated");
+      }
+    }
+  }
+
   // Initialize request
   result.agg.enabled = true;
   result.agg.func = id2func;
+  result.agg.approx = approx;
 
   result.select.begin = ts_begin;
   result.select.end = ts_end;
@@ -1599,12 +2052,11 @@ init_matcher_in_group_aggregate(
 
 static std::tuple<common::Status, ErrorMsg>
 init_matcher_in_group_aggregate(
-    ReshapeRequest*                         req,
-    std::shared_ptr<GroupByTag>             groupbytag,
-    std::vector<AggregationFunction> const& func_names) {
+    ReshapeRequest*                             req,
+    PlainSeriesMatcher const&                   gbtmatcher,
+    std::unordered_map<ParamId, ParamId> const& gbtmap,
+    std::vector<AggregationFunction> const&     func_names) {
   auto matcher = std::make_shared<PlainSeriesMatcher>();
-  auto& gbtmatcher = groupbytag->get_series_matcher();
-  const auto& gbtmap = groupbytag->get_mapping();
   std::vector<ParamId> ids;
   for (auto kv: gbtmap) {
     ids.push_back(kv.second);
@@ -1682,6 +2134,24 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_group_ag
     std::vector<std::string> fnames;
     groupbytag.reset(new GroupByTag(matcher, gagg.metric, fnames, tags, op));
   }
+  GroupByLocationStmt gbloc;
+  std::tie(status, gbloc, error) = parse_groupby_location(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+  if (gbloc.enabled && groupbytag) {
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "`group-by-location` can't be combined with `group-by-tag`/`pivot-by-tag`");
+  }
+  SpatialJoinStmt sjoin;
+  std::tie(status, sjoin, error) = parse_spatial_join(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+  if (sjoin.enabled && (gbloc.enabled || groupbytag)) {
+    return std::make_tuple(common::Status::QueryParsingError(), result,
+                           "`spatial-join` can't be combined with other group-by statements");
+  }
 
   // Where statement
   std::vector<ParamId> ids;
@@ -1719,6 +2189,8 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_group_ag
   result.agg.enabled = true;
   result.agg.func = gagg.func;
   result.agg.step = gagg.step;
+  result.agg.fill = gagg.fill;
+  result.agg.fill_value = gagg.fill_value;
 
   result.select.begin = ts_begin;
   result.select.end = ts_end;
@@ -1731,7 +2203,10 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_group_ag
 
   if (groupbytag) {
     result.group_by.enabled = true;
-    std::tie(status, error) = init_matcher_in_group_aggregate(&result, groupbytag, gagg.func);
+    std::tie(status, error) = init_matcher_in_group_aggregate(&result,
+                                                              groupbytag->get_series_matcher(),
+                                                              groupbytag->get_mapping(),
+                                                              gagg.func);
     if (status != common::Status::Ok()) {
       return std::make_tuple(status, result, error);
     }
@@ -1739,6 +2214,56 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_group_ag
     if (result.group_by.transient_map.empty()) {
       return std::make_tuple(common::Status::NoData(), result, "Group-by statement doesn't match any series");
     }
+  } else if (sjoin.enabled) {
+    std::vector<ParamId> left;
+    std::tie(status, left, error) = parse_where_clause(ptree.get_child("spatial-join"), sjoin.metric, matcher);
+    if (status != common::Status::Ok()) {
+      return std::make_tuple(status, result, error);
+    }
+    // Every selected series is attached to the closest series of the
+    // `spatial-join` selection, every group is combined independently.
+    GroupBySpatialJoin groupbyjoin(matcher, left, ids, sjoin.distance);
+    result.group_by.enabled = true;
+    result.group_by.parallel = true;
+    result.group_by.transient_map = groupbyjoin.get_mapping();
+    if (result.group_by.transient_map.empty()) {
+      return std::make_tuple(common::Status::NoData(), result, "Spatial-join statement doesn't match any series");
+    }
+    auto& selected = result.select.columns.at(0).ids;
+    auto it = std::remove_if(selected.begin(), selected.end(), [&](ParamId id) {
+      return result.group_by.transient_map.count(id) == 0;
+    });
+    selected.erase(it, selected.end());
+    std::tie(status, error) = init_matcher_in_group_aggregate(&result,
+                                                              groupbyjoin.get_series_matcher(),
+                                                              result.group_by.transient_map,
+                                                              gagg.func);
+    if (status != common::Status::Ok()) {
+      return std::make_tuple(status, result, error);
+    }
+  } else if (gbloc.enabled) {
+    // Series are mapped to cells using locations from the R-tree index,
+    // every cell is combined independently.
+    GroupByLocation groupbyloc(matcher, ids, gbloc.min, gbloc.max, gbloc.cell_size, gbloc.geohash);
+    result.group_by.enabled = true;
+    result.group_by.parallel = true;
+    result.group_by.transient_map = groupbyloc.get_mapping();
+    if (result.group_by.transient_map.empty()) {
+      return std::make_tuple(common::Status::NoData(), result, "Group-by-location statement doesn't match any series");
+    }
+    // Series without location can't be mapped to any cell
+    auto& selected = result.select.columns.at(0).ids;
+    auto it = std::remove_if(selected.begin(), selected.end(), [&](ParamId id) {
+      return result.group_by.transient_map.count(id) == 0;
+    });
+    selected.erase(it, selected.end());
+    std::tie(status, error) = init_matcher_in_group_aggregate(&result,
+                                                              groupbyloc.get_series_matcher(),
+                                                              result.group_by.transient_map,
+                                                              gagg.func);
+    if (status != common::Status::Ok()) {
+      return std::make_tuple(status, result, error);
+    }
   }
   else {
     std::tie(status, error) = init_matcher_in_group_aggregate(&result, matcher, gagg.func);
@@ -1925,6 +2450,11 @@ std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_join_que
     return std::make_tuple(status, result, error);
   }
 
+  std::tie(status, result.select.join_mode, result.select.join_tolerance, error) = parse_join_mode(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+
   // Order-by statment
   OrderBy order;
   std::tie(status, order, error) = parse_orderby(ptree);
@@ -2043,6 +2573,103 @@ make_sampler(boost::property_tree::ptree const& ptree,
   }
 }
 
+/** Parse `similar` statement, format:
+ * { "similar": { "metric": "cpu", "pattern": [1, 2, 3, 2, 1], "limit": 10 }, ... }
+ * @return status, metric name, similarity parameters
+ */
+static std::tuple<common::Status, std::string, Similarity, ErrorMsg> parse_similar_stmt(boost::property_tree::ptree const& ptree) {
+  Similarity result = {};
+  result.enabled = true;
+  result.limit = 10;
+  std::string metric;
+  auto similar = ptree.get_child_optional("similar");
+  if (!similar) {
+    return std::make_tuple(common::Status::QueryParsingError(), metric, result, "Can't parse `similar` field");
+  }
+  for (auto const& kv: *similar) {
+    if (kv.first == "metric") {
+      metric = kv.second.get_value<std::string>();
+    } else if (kv.first == "pattern") {
+      for (auto const& child: kv.second) {
+        auto value = child.second.get_value<std::string>();
+        try {
+          result.pattern.push_back(boost::lexical_cast<double>(value));
+        } catch (boost::bad_lexical_cast const&) {
+          LOG(ERROR) << "Can't parse pattern value `" + value + "`";
+          return std::make_tuple(common::Status::QueryParsingError(), metric, result,
+                                 "Can't parse pattern value `" + value + "`");
+        }
+      }
+    } else if (kv.first == "limit") {
+      auto limit = kv.second.get_value_optional<u32>();
+      if (!limit || *limit == 0) {
+        LOG(ERROR) << "Invalid `limit` field in `similar` statement";
+        return std::make_tuple(common::Status::QueryParsingError(), metric, result,
+                               "Invalid `limit` field in `similar` statement");
+      }
+      result.limit = *limit;
+    } else {
+      LOG(ERROR) << "Unexpected field `" + kv.first + "` in `similar` statement";
+      return std::make_tuple(common::Status::QueryParsingError(), metric, result,
+                             "Unexpected field `" + kv.first + "` in `similar` statement");
+    }
+  }
+  if (metric.empty()) {
+    return std::make_tuple(common::Status::QueryParsingError(), metric, result,
+                           "Can't validate `similar` statement, `metric` field required");
+  }
+  if (result.pattern.empty()) {
+    return std::make_tuple(common::Status::QueryParsingError(), metric, result,
+                           "Can't validate `similar` statement, `pattern` field required");
+  }
+  return std::make_tuple(common::Status::Ok(), metric, result, ErrorMsg());
+}
+
+std::tuple<common::Status, ReshapeRequest, ErrorMsg> QueryParser::parse_similarity_query(
+    boost::property_tree::ptree const& ptree,
+    SeriesMatcher const& matcher) {
+  ReshapeRequest result = {};
+  result.select.global_matcher = &matcher;
+
+  ErrorMsg error;
+  common::Status status;
+  std::tie(status, error) = validate_query(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+
+  LOG(INFO) << "Parsing query:";
+  LOG(INFO) << to_json(ptree, true).c_str();
+
+  std::string metric;
+  std::tie(status, metric, result.similar, error) = parse_similar_stmt(ptree);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+
+  // Where statement
+  std::vector<ParamId> ids;
+  std::tie(status, ids, error) = parse_where_clause(ptree, { metric }, matcher);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+
+  // Range is optional
+  Timestamp ts_begin, ts_end;
+  std::tie(status, ts_begin, ts_end, error) = parse_range_timestamp(ptree, true);
+  if (status != common::Status::Ok()) {
+    return std::make_tuple(status, result, error);
+  }
+
+  result.agg.enabled = false;
+  result.select.begin = ts_begin;
+  result.select.end = ts_end;
+  result.select.columns.push_back(Column{ids});
+  result.order_by = OrderBy::SERIES;
+  result.group_by.enabled = false;
+  return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
+}
+
 std::tuple<common::Status, std::vector<std::shared_ptr<Node>>, ErrorMsg> QueryParser::parse_processing_topology(
     boost::property_tree::ptree const& ptree,
     InternalCursor* cursor,
@@ -2075,6 +2702,18 @@ std::tuple<common::Status, std::vector<std::shared_ptr<Node>>, ErrorMsg> QueryPa
     prev = node;
   }
 
+  if (req.downsample.method == DownsampleMethod::LTTB) {
+    // Downsampling is done before any other processing step
+    std::shared_ptr<Node> node;
+    try {
+      node = std::make_shared<LTTBDownsampler>(req.downsample.width, req.select.begin, req.select.end, prev);
+    } catch (const QueryParserError& e) {
+      return std::make_tuple(common::Status::QueryParsingError(), result, ErrorMsg(e.what()));
+    }
+    result.insert(result.begin(), node);
+    prev = node;
+  }
+
   result.push_back(terminal);
   return std::make_tuple(common::Status::Ok(), result, ErrorMsg());
 }
@@ -22,6 +22,7 @@ enum class QueryKind {
   GROUP_AGGREGATE,
   GROUP_AGGREGATE_JOIN,
   SELECT_EVENTS,
+  SIMILAR,
 };
 
 extern std::string to_json(boost::property_tree::ptree const& ptree, bool pretty_print = true);
@@ -61,10 +62,25 @@ struct QueryParser {
 
   static std::tuple<common::Status, boost::property_tree::ptree, ErrorMsg> parse_json(const char* query);
 
+  /** Parse json query into the existing property tree.
+   * Same as above but the tree is not copied (ptree is not movable).
+   */
+  static std::tuple<common::Status, ErrorMsg> parse_json(const char* query, boost::property_tree::ptree* ptree);
+
   /** Determain type of query.
   */
   static std::tuple<common::Status, QueryKind, ErrorMsg> get_query_kind(boost::property_tree::ptree const& ptree);
 
+  /** Parse query of any kind that produces reshape request (every kind except
+   * the metadata query).
+   * @param ptree contains query
+   * @param kind is a query kind returned by `get_query_kind`
+   * @param matcher is a global matcher
+   */
+  static std::tuple<common::Status, ReshapeRequest, ErrorMsg> parse_query(boost::property_tree::ptree const& ptree,
+                                                                          QueryKind kind,
+                                                                          SeriesMatcher const& matcher);
+
   /** Parse query and produce reshape request.
    * @param ptree contains query
    * @returns status and ReshapeRequest
@@ -126,6 +142,15 @@ struct QueryParser {
   static std::tuple<common::Status, ReshapeRequest, ErrorMsg> parse_group_aggregate_join_query(boost::property_tree::ptree const& ptree,
                                                                                                SeriesMatcher const& matcher);
 
+  /**
+   * Parse similarity search query
+   * @param ptree is a json query
+   * @param matcher is a series matcher
+   * @return status and request object
+   */
+  static std::tuple<common::Status, ReshapeRequest, ErrorMsg> parse_similarity_query(boost::property_tree::ptree const& ptree,
+                                                                                     SeriesMatcher const& matcher);
+
   /** Parse stream processing pipeline.
    * @param ptree contains query
    * @returns vector of Nodes in proper order
@@ -9,6 +9,7 @@
 
 #include "stdb/common/datetime.h"
 #include "stdb/index/seriesparser.h"
+#include "stdb/query/queryprocessor.h"
 
 namespace stdb {
 namespace qp {
@@ -226,5 +227,416 @@ TEST(TestQueryParser, Test_select_events_query) {
   EXPECT_EQ(common::Status::NotFound(), status);
 }
 
+TEST(TestQueryParser, Test_select_events_keyword_filter) {
+  SeriesMatcher matcher;
+  const char* series = "!log host=a";
+  matcher.add(series, series + strlen(series));
+
+  auto parse = [&](const char* filter) {
+    std::stringstream str;
+    str << "{ \"select-events\": \"!log\",";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << "  \"filter\": " << filter << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_select_events_query(ptree, matcher);
+    return std::make_tuple(status, req);
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  std::tie(status, req) = parse("\"time.*out\"");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ("time.*out", req.select.event_body_regex);
+  EXPECT_TRUE(req.select.event_keywords.empty());
+
+  std::tie(status, req) = parse("{ \"keywords\": [\"error\", \"timeout\"], \"prefix\": \"conn\", \"regex\": \"code=5\\\\d\\\\d\" }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ("code=5\\d\\d", req.select.event_body_regex);
+  EXPECT_EQ(std::vector<std::string>({ "error", "timeout" }), req.select.event_keywords);
+  EXPECT_EQ(std::vector<std::string>({ "conn" }), req.select.event_prefixes);
+
+  std::tie(status, req) = parse("{ \"keywords\": \"error\" }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.select.event_body_regex.empty());
+  EXPECT_EQ(std::vector<std::string>({ "error" }), req.select.event_keywords);
+
+  std::tie(status, req) = parse("{ \"regex\": \"[\" }");
+  EXPECT_EQ(common::Status::BadArg(), status);
+}
+
+static std::string make_join_query(Timestamp begin, Timestamp end, const char* mode, const char* tolerance) {
+  std::stringstream str;
+  str << "{ \"join\": { \"metrics\": [\"test\", \"test\"], \"mode\": \"" << mode << "\"";
+  if (tolerance) {
+    str << ", \"tolerance\": \"" << tolerance << "\"";
+  }
+  str << "},";
+  str << "  \"range\": { \"from\": " << "\"" << DateTimeUtil::to_iso_string(begin) << "\"";
+  str << ", \"to\": " << "\"" << DateTimeUtil::to_iso_string(end) << "\"" << "},";
+  str << "  \"where\": " << "[ { \"tag1\" : \"1\" }, { \"tag1\": \"2\" } ]";
+  str << "}";
+  return str.str();
+}
+
+TEST(TestQueryParser, Test_asof_join_query) {
+  init_series_matcher();
+
+  std::string query_json = make_join_query(1136214245999999999ul, 1136215245999999999ul, "as-of", "10s");
+  common::Status status;
+  boost::property_tree::ptree ptree;
+  ErrorMsg error_msg;
+  std::tie(status, ptree, error_msg) = QueryParser::parse_json(query_json.c_str());
+  EXPECT_TRUE(status.IsOk());
+
+  QueryKind query_kind;
+  std::tie(status, query_kind, error_msg) = QueryParser::get_query_kind(ptree);
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_EQ(qp::QueryKind::JOIN, query_kind);
+
+  ReshapeRequest req;
+  std::tie(status, req, error_msg) = QueryParser::parse_join_query(ptree, global_series_matcher);
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_EQ(2, req.select.columns.size());
+  EXPECT_TRUE(req.select.join_mode == JoinMode::ASOF);
+  EXPECT_EQ(10000000000ul, req.select.join_tolerance);
+
+  // Tolerance requires as-of mode
+  query_json = make_join_query(1136214245999999999ul, 1136215245999999999ul, "exact", "10s");
+  std::tie(status, ptree, error_msg) = QueryParser::parse_json(query_json.c_str());
+  EXPECT_TRUE(status.IsOk());
+  std::tie(status, req, error_msg) = QueryParser::parse_join_query(ptree, global_series_matcher);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  query_json = make_join_query(1136214245999999999ul, 1136215245999999999ul, "nearest", nullptr);
+  std::tie(status, ptree, error_msg) = QueryParser::parse_json(query_json.c_str());
+  EXPECT_TRUE(status.IsOk());
+  std::tie(status, req, error_msg) = QueryParser::parse_join_query(ptree, global_series_matcher);
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+}
+
+static std::string make_group_aggregate_query(Timestamp begin, Timestamp end, const char* fill) {
+  std::stringstream str;
+  str << "{ \"group-aggregate\": { \"metric\": \"test\", \"step\": \"1s\", \"func\": [\"min\", \"max\"]";
+  str << ", \"fill\": \"" << fill << "\" },";
+  str << "  \"range\": { \"from\": " << "\"" << DateTimeUtil::to_iso_string(begin) << "\"";
+  str << ", \"to\": " << "\"" << DateTimeUtil::to_iso_string(end) << "\"" << "},";
+  str << "  \"where\": " << "[ { \"tag1\" : \"1\" }, { \"tag1\": \"2\" } ]";
+  str << "}";
+  return str.str();
+}
+
+TEST(TestQueryParser, Test_group_aggregate_fill_query) {
+  init_series_matcher();
+
+  auto parse = [](const char* fill) {
+    std::string query_json = make_group_aggregate_query(1136214245999999999ul, 1136215245999999999ul, fill);
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(query_json.c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_group_aggregate_query(ptree, global_series_matcher);
+    return std::make_tuple(status, req);
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  std::tie(status, req) = parse("linear");
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.agg.fill == FillPolicy::LINEAR);
+
+  std::tie(status, req) = parse("previous");
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.agg.fill == FillPolicy::PREVIOUS);
+
+  std::tie(status, req) = parse("null");
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.agg.fill == FillPolicy::NULL_VALUE);
+
+  std::tie(status, req) = parse("-1.5");
+  EXPECT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.agg.fill == FillPolicy::CONSTANT);
+  EXPECT_EQ(-1.5, req.agg.fill_value);
+
+  std::tie(status, req) = parse("cubic");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+}
+
+TEST(TestQueryParser, Test_group_aggregate_by_location_query) {
+  SeriesMatcher matcher;
+  std::vector<std::string> names = { "temp sensor=1", "temp sensor=2", "temp sensor=3", "temp sensor=4" };
+  std::vector<Location> locations = { { 30.31f, 59.91f }, { 30.32f, 59.92f }, { 37.61f, 55.75f }, { 37.62f, 55.76f } };
+  std::vector<i64> ids;
+  for (size_t i = 0; i < names.size(); i++) {
+    ids.push_back(matcher.add(names[i].data(), names[i].data() + names[i].size(), locations[i]));
+  }
+
+  auto parse = [&](const char* groupby) {
+    std::stringstream str;
+    str << "{ \"group-aggregate\": { \"metric\": \"temp\", \"step\": \"1s\", \"func\": \"mean\" },";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << "  \"group-by-location\": " << groupby << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_group_aggregate_query(ptree, matcher);
+    return std::make_tuple(status, req);
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  std::tie(status, req) = parse("{ \"cell\": 0.1 }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.group_by.enabled);
+  EXPECT_TRUE(req.group_by.parallel);
+  ASSERT_EQ(4u, req.group_by.transient_map.size());
+  EXPECT_EQ(req.group_by.transient_map[ids[0]], req.group_by.transient_map[ids[1]]);
+  EXPECT_EQ(req.group_by.transient_map[ids[2]], req.group_by.transient_map[ids[3]]);
+  EXPECT_NE(req.group_by.transient_map[ids[0]], req.group_by.transient_map[ids[2]]);
+  auto sname = req.select.matcher->id2str(static_cast<i64>(req.group_by.transient_map[ids[0]]));
+  EXPECT_EQ("temp:mean lat=59.9 lon=30.3", std::string(sname.first, sname.first + sname.second));
+
+  std::tie(status, req) = parse("{ \"geohash\": 3, \"bbox\": [ 30, 59, 31, 60 ] }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ(2u, req.group_by.transient_map.size());
+  EXPECT_EQ(2u, req.select.columns.at(0).ids.size());
+
+  std::tie(status, req) = parse("{ \"cell\": 0.1, \"geohash\": 3 }");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  std::tie(status, req) = parse("{ \"cell\": 0.1, \"bbox\": [ 0, 0, 1, 1 ] }");
+  EXPECT_EQ(common::Status::NoData(), status);
+}
+
+TEST(TestQueryParser, Test_group_aggregate_spatial_join_query) {
+  SeriesMatcher matcher;
+  std::vector<std::string> names = {
+    "station name=a city=spb", "station name=b city=msk",
+    "speed sensor=1", "speed sensor=2", "speed sensor=3", "speed sensor=4",
+  };
+  std::vector<Location> locations = {
+    { 30.30f, 59.90f }, { 37.60f, 55.75f },
+    { 30.31f, 59.90f }, { 30.29f, 59.91f }, { 37.61f, 55.75f }, { 33.00f, 57.00f },
+  };
+  std::vector<i64> ids;
+  for (size_t i = 0; i < names.size(); i++) {
+    ids.push_back(matcher.add(names[i].data(), names[i].data() + names[i].size(), locations[i]));
+  }
+
+  auto parse = [&](const char* join) {
+    std::stringstream str;
+    str << "{ \"group-aggregate\": { \"metric\": \"speed\", \"step\": \"1s\", \"func\": \"mean\" },";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << "  \"spatial-join\": " << join << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_group_aggregate_query(ptree, matcher);
+    return std::make_tuple(status, req);
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  std::tie(status, req) = parse("{ \"metric\": \"station\", \"distance\": 2000 }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.group_by.enabled);
+  EXPECT_TRUE(req.group_by.parallel);
+  ASSERT_EQ(3u, req.group_by.transient_map.size());
+  EXPECT_EQ(req.group_by.transient_map[ids[2]], req.group_by.transient_map[ids[3]]);
+  EXPECT_NE(req.group_by.transient_map[ids[2]], req.group_by.transient_map[ids[4]]);
+  // Sensor without station nearby is not selected
+  EXPECT_EQ(3u, req.select.columns.at(0).ids.size());
+  auto sname = req.select.matcher->id2str(static_cast<i64>(req.group_by.transient_map[ids[2]]));
+  EXPECT_EQ("speed:mean city=spb name=a", std::string(sname.first, sname.first + sname.second));
+
+  std::tie(status, req) = parse("{ \"metric\": \"station\", \"where\": { \"city\": \"msk\" }, \"distance\": 2000 }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ(1u, req.group_by.transient_map.size());
+  EXPECT_EQ(1u, req.group_by.transient_map.count(static_cast<ParamId>(ids[4])));
+
+  std::tie(status, req) = parse("{ \"metric\": \"station\" }");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  std::tie(status, req) = parse("{ \"metric\": \"station\", \"distance\": 10 }");
+  EXPECT_EQ(common::Status::NoData(), status);
+}
+
+TEST(TestQueryParser, Test_select_within_query) {
+  SeriesMatcher matcher;
+  std::vector<std::string> names = { "temp sensor=1", "temp sensor=2", "temp sensor=3", "temp sensor=4" };
+  std::vector<Location> locations = { { 30.31f, 59.91f }, { 30.32f, 59.92f }, { 37.61f, 55.75f }, { 30.5f, 59.5f } };
+  std::vector<i64> ids;
+  for (size_t i = 0; i < names.size(); i++) {
+    ids.push_back(matcher.add(names[i].data(), names[i].data() + names[i].size(), locations[i]));
+  }
+
+  auto parse = [&](const char* within) {
+    std::stringstream str;
+    str << "{ \"select\": \"temp\",";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << "  \"within\": " << within << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_select_query(ptree, matcher);
+    return std::make_tuple(status, req);
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  // Triangle that doesn't contain the 4th sensor
+  std::tie(status, req) = parse("{ \"type\": \"Polygon\", \"coordinates\": "
+                                "[ [ [30, 59.8], [31, 59.8], [30, 60.5], [30, 59.8] ] ] }");
+  ASSERT_TRUE(status.IsOk());
+  std::vector<ParamId> expected = { static_cast<ParamId>(ids[0]), static_cast<ParamId>(ids[1]) };
+  EXPECT_EQ(expected, req.select.columns.at(0).ids);
+
+  std::tie(status, req) = parse("{ \"type\": \"MultiPolygon\", \"coordinates\": "
+                                "[ [ [ [30, 59.8], [31, 59.8], [30, 60.5] ] ], "
+                                "  [ [ [37, 55], [38, 55], [38, 56], [37, 56] ] ] ] }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ(3u, req.select.columns.at(0).ids.size());
+
+  std::tie(status, req) = parse("{ \"type\": \"Point\", \"coordinates\": [30, 59] }");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  std::tie(status, req) = parse("{ \"type\": \"Polygon\", \"coordinates\": [ [ [30, 59], [31, 59] ] ] }");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+}
+
+TEST(TestQueryParser, Test_within_processing_topology) {
+  init_series_matcher();
+
+  auto build = [](const char* apply) {
+    std::stringstream str;
+    str << "{ \"select\": \"test\",";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << "  \"apply\": " << apply << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_select_query(ptree, global_series_matcher);
+    EXPECT_TRUE(status.IsOk());
+    std::vector<std::shared_ptr<Node>> nodes;
+    std::tie(status, nodes, error_msg) = QueryParser::parse_processing_topology(ptree, nullptr, req);
+    EXPECT_TRUE(status.IsOk()) << error_msg;
+    EXPECT_EQ(3u, nodes.size());
+    std::unique_ptr<ScanQueryProcessor> proc;
+    EXPECT_NO_THROW(proc.reset(new ScanQueryProcessor(nodes, false)));
+  };
+  const char* within = "{ \"name\": \"within\", \"geometry\": { \"type\": \"Polygon\", \"coordinates\": "
+                       "[ [ [30, 59.8], [31, 59.8], [30, 60.5] ] ] } }";
+  const char* scale = "{ \"name\": \"scale\", \"weights\": [ 2 ] }";
+  build((std::string("[ ") + within + ", " + scale + " ]").c_str());
+  build((std::string("[ ") + scale + ", " + within + " ]").c_str());
+}
+
+TEST(TestQueryParser, Test_select_downsample_query) {
+  init_series_matcher();
+
+  auto parse = [](const char* downsample, const char* extra) {
+    std::stringstream str;
+    str << "{ \"select\": \"test\",";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << extra;
+    str << "  \"downsample\": " << downsample << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_select_query(ptree, global_series_matcher);
+    std::vector<std::shared_ptr<Node>> nodes;
+    if (status.IsOk()) {
+      std::tie(status, nodes, error_msg) = QueryParser::parse_processing_topology(ptree, nullptr, req);
+    }
+    return std::make_tuple(status, req, nodes.size());
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  size_t nnodes;
+  std::tie(status, req, nnodes) = parse("{ \"width\": 1800 }", "");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.downsample.method == DownsampleMethod::M4);
+  EXPECT_EQ(1800u, req.downsample.width);
+  EXPECT_EQ(2000000000u, req.downsample.get_step(req.select.begin, req.select.end));
+  EXPECT_EQ(1u, nnodes);
+
+  // LTTB is done by the processing node
+  std::tie(status, req, nnodes) = parse("{ \"width\": 1800, \"algorithm\": \"lttb\" }",
+                                        "\"pivot-by-tag\": [ \"tag1\" ],");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.downsample.method == DownsampleMethod::LTTB);
+  EXPECT_EQ(2u, nnodes);
+
+  std::tie(status, req, nnodes) = parse("{ \"width\": 1800 }", "\"pivot-by-tag\": [ \"tag1\" ],");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  std::tie(status, req, nnodes) = parse("{ \"width\": 0 }", "");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  std::tie(status, req, nnodes) = parse("{ \"width\": 100, \"algorithm\": \"random\" }", "");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+}
+
+TEST(TestQueryParser, Test_approximate_aggregate_query) {
+  init_series_matcher();
+
+  auto parse = [](const char* func, const char* approximate) {
+    std::stringstream str;
+    str << "{ \"aggregate\": { \"test\": \"" << func << "\" },";
+    str << "  \"range\": { \"from\": \"20060102T150405\", \"to\": \"20060102T160405\" },";
+    str << "  \"approximate\": " << approximate << "}";
+    common::Status status;
+    boost::property_tree::ptree ptree;
+    ErrorMsg error_msg;
+    std::tie(status, ptree, error_msg) = QueryParser::parse_json(str.str().c_str());
+    EXPECT_TRUE(status.IsOk());
+    ReshapeRequest req;
+    std::tie(status, req, error_msg) = QueryParser::parse_aggregate_query(ptree, global_series_matcher);
+    return std::make_tuple(status, req);
+  };
+
+  common::Status status;
+  ReshapeRequest req;
+  std::tie(status, req) = parse("sum", "{ \"error\": 0.05, \"budget\": 100 }");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(req.agg.approx.enabled);
+  EXPECT_EQ(0.05, req.agg.approx.error);
+  EXPECT_EQ(0.95, req.agg.approx.confidence);
+  EXPECT_EQ(100u, req.agg.approx.budget);
+
+  std::tie(status, req) = parse("mean", "{}");
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_EQ(0.01, req.agg.approx.error);
+
+  // Only count, sum and mean can be extrapolated
+  std::tie(status, req) = parse("max", "{}");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+
+  std::tie(status, req) = parse("count", "{ \"confidence\": 1.5 }");
+  EXPECT_EQ(common::Status::QueryParsingError(), status);
+}
+
 }  // namespace qp
 }  // namespace stdb
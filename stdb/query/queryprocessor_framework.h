@@ -4,6 +4,7 @@
 #ifndef STDB_QUERY_QUERYPROCESSING_FRAMEWORK_H_
 #define STDB_QUERY_QUERYPROCESSING_FRAMEWORK_H_
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 
@@ -42,11 +43,16 @@ namespace qp {
  * It is possible to add processing steps via IQueryProcessor.
  */
 using AggregationFunction = storage::AggregationFunction;
+using FillPolicy = storage::FillPolicy;
+using AggregateApproximation = storage::AggregateApproximation;
 
 struct Aggregation {
   bool enabled;
   std::vector<AggregationFunction> func;
   u64 step;  // 0 if group by time disabled
+  FillPolicy fill;  // gap filling policy (group-aggregate only)
+  double fill_value;  // constant for FillPolicy::CONSTANT
+  AggregateApproximation approx;  // approximate mode (aggregate only)
 
   static std::string to_string(AggregationFunction f) {
     switch(f) {
@@ -128,6 +134,12 @@ struct Filter {
   double    le;
 };
 
+//! Join mode
+enum class JoinMode {
+  EXACT = 0,  //! Only values with identical timestamps are joined
+  ASOF,       //! Values of the first column are joined with the last preceding values of other columns
+};
+
 //! Set of ids returned by the query (defined by select and where clauses)
 struct Selection {
   //! Set of columns returned by the query (1 columns - select statement, N columns - join statement)
@@ -138,6 +150,13 @@ struct Selection {
   Timestamp                  end;
   bool                        events;
   std::string       event_body_regex;
+  //! Keywords and prefixes of the event filter (served by the event index)
+  std::vector<std::string> event_keywords;
+  std::vector<std::string> event_prefixes;
+  //! Join mode (used by Join-statement)
+  JoinMode                 join_mode;
+  //! Max distance between joined values in as-of mode (0 if unlimited)
+  u64                 join_tolerance;
 
   //! This matcher should be used by Join-statement
   std::shared_ptr<PlainSeriesMatcher>  matcher;
@@ -153,6 +172,8 @@ struct Selection {
 struct GroupBy {
   bool enabled;
   std::unordered_map<ParamId, ParamId> transient_map;
+  //! Combine groups in parallel (set by spatial group-by)
+  bool parallel;
 };
 
 //! Output order
@@ -161,12 +182,43 @@ enum class OrderBy {
   TIME,
 };
 
+//! Similarity search parameters
+struct Similarity {
+  bool enabled;
+  //! Pattern to search
+  std::vector<double> pattern;
+  //! Max number of matches
+  u32 limit;
+};
+
+//! Visualization-aware downsampling method
+enum class DownsampleMethod {
+  NONE = 0,
+  M4,    //! First, min, max and last value of every pixel column
+  LTTB,  //! Largest-Triangle-Three-Buckets, one value per pixel column
+};
+
+//! Downsampling parameters (select query only)
+struct Downsample {
+  DownsampleMethod method;
+  //! Number of pixel columns
+  u32 width;
+
+  //! Duration of the pixel column
+  u64 get_step(Timestamp begin, Timestamp end) const {
+    u64 range = begin < end ? end - begin : begin - end;
+    return width == 0 ? range : std::max<u64>(1, (range + width - 1) / width);
+  }
+};
+
 //! Reshape request defines what should be sent to query processor
 struct ReshapeRequest {
   Aggregation  agg;
   Selection select;
   GroupBy group_by;
   OrderBy order_by;
+  Similarity similar;
+  Downsample downsample;
 };
 
 
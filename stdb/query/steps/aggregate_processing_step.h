@@ -14,12 +14,14 @@ struct AggregateProcessingStep : ProcessingPrelude {
   Timestamp begin_;
   Timestamp end_;
   std::vector<ParamId> ids_;
+  bool approximate_;
 
   template<class T>
-  AggregateProcessingStep(Timestamp begin, Timestamp end, T&& t) :
+  AggregateProcessingStep(Timestamp begin, Timestamp end, T&& t, bool approximate = false) :
       begin_(begin),
       end_(end),
-      ids_(std::forward<T>(t)) { }
+      ids_(std::forward<T>(t)),
+      approximate_(approximate) { }
 
   boost::property_tree::ptree debug_info() const override {
     boost::property_tree::ptree tree;
@@ -28,6 +30,9 @@ struct AggregateProcessingStep : ProcessingPrelude {
   }
 
   virtual common::Status apply(const ColumnStore& cstore) {
+    if (approximate_) {
+      return cstore.approximate_aggregate(ids_, begin_, end_, &agglist_);
+    }
     return cstore.aggregate(ids_, begin_, end_, &agglist_);
   }
 
@@ -0,0 +1,60 @@
+/*!
+ * \file approximate_aggregate.h
+ */
+#ifndef STDB_QUERY_STEPS_APPROXIMATE_AGGREGATE_H_
+#define STDB_QUERY_STEPS_APPROXIMATE_AGGREGATE_H_
+
+#include "stdb/query/steps/materialization_step.h"
+
+namespace stdb {
+namespace qp {
+
+/**
+ * Approximate aggregate materializer.
+ * Accepts list of ids (operators with the same id form a group) and
+ * list of aggregate operators. Series of every group are sampled and the
+ * result is reported as a tuple (estimate, lower bound, upper bound).
+ */
+struct ApproximateAggregate : MaterializationStep {
+  std::vector<ParamId> ids_;
+  std::vector<AggregationFunction> fn_;
+  AggregateApproximation approx_;
+  std::unique_ptr<ColumnMaterializer> mat_;
+
+  template <class IdVec, class FuncVec>
+  ApproximateAggregate(IdVec&& vec, FuncVec&& fn, AggregateApproximation const& approx) :
+      ids_(std::forward<IdVec>(vec)),
+      fn_(std::forward<FuncVec>(fn)),
+      approx_(approx) { }
+
+  boost::property_tree::ptree debug_info() const override {
+    boost::property_tree::ptree tree;
+    tree.add("name", "ApproximateAggregate");
+    tree.add("error", approx_.error);
+    tree.add("confidence", approx_.confidence);
+    return tree;
+  }
+
+  common::Status apply(ProcessingPrelude *prelude) {
+    std::vector<std::unique_ptr<AggregateOperator>> iters;
+    auto status = prelude->extract_result(&iters);
+    if (status != common::Status::Ok()) {
+      return status;
+    }
+    mat_.reset(new ApproximateAggregateMaterializer(ids_, std::move(iters), fn_, approx_));
+    return common::Status::Ok();
+  }
+
+  common::Status extract_result(std::unique_ptr<ColumnMaterializer> *dest) {
+    if (!mat_) {
+      return common::Status::NoData();
+    }
+    *dest = std::move(mat_);
+    return common::Status::Ok();
+  }
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_STEPS_APPROXIMATE_AGGREGATE_H_
@@ -17,9 +17,10 @@ struct GroupAggregateCombiner_Initializer<OrderBy::SERIES> {
   static std::unique_ptr<ColumnMaterializer> make_materializer(
       std::vector<ParamId>&& ids,
       std::vector<std::unique_ptr<AggregateOperator>>&& agglist,
-      const std::vector<AggregationFunction>& fn) {
+      const std::vector<AggregationFunction>& fn,
+      const GroupAggregateFill& fill) {
     std::unique_ptr<ColumnMaterializer> mat;
-    mat.reset(new SeriesOrderAggregateMaterializer(std::move(ids), std::move(agglist), fn));
+    mat.reset(new SeriesOrderAggregateMaterializer(std::move(ids), std::move(agglist), fn, fill));
     return mat;
   }
 };
@@ -29,11 +30,12 @@ struct GroupAggregateCombiner_Initializer<OrderBy::TIME> {
   static std::unique_ptr<ColumnMaterializer> make_materializer(
       std::vector<ParamId>&& ids,
       std::vector<std::unique_ptr<AggregateOperator>>&& agglist,
-      const std::vector<AggregationFunction>& fn) {
+      const std::vector<AggregationFunction>& fn,
+      const GroupAggregateFill& fill) {
     std::vector<ParamId> tmpids(ids);
     std::vector<std::unique_ptr<AggregateOperator>> tmpiters(std::move(agglist));
     std::unique_ptr<ColumnMaterializer> mat;
-    mat.reset(new TimeOrderAggregateMaterializer(tmpids, tmpiters, fn));
+    mat.reset(new TimeOrderAggregateMaterializer(tmpids, tmpiters, fn, fill));
     return mat;
   }
 };
@@ -43,17 +45,25 @@ struct GroupAggregateCombiner_Initializer<OrderBy::TIME> {
  * Accepts list of ids (shouldn't be different) and list of aggregate
  * operators. Maps each id to operator and then combines operators
  * with the same id (to implement group-aggregate + group/pivot-by-tag).
+ * If `parallel` is set all groups are read eagerly using all cores
+ * (used when many series are combined into each group, e.g. spatial
+ * group-by), otherwise groups are combined lazily.
  */
 template <OrderBy order>
 struct GroupAggregateCombiner : MaterializationStep {
   std::vector<ParamId> ids_;
   std::vector<AggregationFunction> fn_;
+  GroupAggregateFill fill_;
+  bool parallel_;
   std::unique_ptr<ColumnMaterializer> mat_;
 
   template<class IdVec, class FuncVec>
-  GroupAggregateCombiner(IdVec&& vec, FuncVec&& fn) :
+  GroupAggregateCombiner(IdVec&& vec, FuncVec&& fn, const GroupAggregateFill& fill = GroupAggregateFill(),
+                         bool parallel = false) :
       ids_(std::forward<IdVec>(vec)),
-      fn_(std::forward<FuncVec>(fn)) { }
+      fn_(std::forward<FuncVec>(fn)),
+      fill_(fill),
+      parallel_(parallel) { }
 
   boost::property_tree::ptree debug_info() const override {
     boost::property_tree::ptree tree;
@@ -75,15 +85,28 @@ struct GroupAggregateCombiner : MaterializationStep {
       groupings[id].push_back(std::move(it));
     }
     std::vector<ParamId> ids;
-    for (auto& kv: groupings) {
-      auto& vec = kv.second;
-      ids.push_back(kv.first);
-      std::unique_ptr<FanInAggregateOperator> it(new FanInAggregateOperator(std::move(vec)));
-      agglist.push_back(std::move(it));
+    if (parallel_) {
+      std::vector<std::vector<std::unique_ptr<AggregateOperator>>> groups;
+      for (auto& kv: groupings) {
+        ids.push_back(kv.first);
+        groups.push_back(std::move(kv.second));
+      }
+      std::tie(status, agglist) = combine_group_aggregates(std::move(groups), 0);
+      if (status != common::Status::Ok()) {
+        return status;
+      }
+    } else {
+      for (auto& kv: groupings) {
+        auto& vec = kv.second;
+        ids.push_back(kv.first);
+        std::unique_ptr<FanInAggregateOperator> it(new FanInAggregateOperator(std::move(vec)));
+        agglist.push_back(std::move(it));
+      }
     }
     mat_ = GroupAggregateCombiner_Initializer<order>::make_materializer(std::move(ids),
                                                                         std::move(agglist),
-                                                                        fn_);
+                                                                        fn_,
+                                                                        fill_);
     return common::Status::Ok();
   }
 
@@ -22,19 +22,28 @@ struct Join : MaterializationStep {
   OrderBy order_;
   Timestamp begin_;
   Timestamp end_;
+  JoinMode mode_;
+  Timestamp tolerance_;
   std::unique_ptr<ColumnMaterializer> mat_;
 
   template<class IdVec>
-  Join(IdVec&& vec, int cardinality, OrderBy order, Timestamp begin, Timestamp end) :
+  Join(IdVec&& vec, int cardinality, OrderBy order, Timestamp begin, Timestamp end,
+       JoinMode mode = JoinMode::EXACT, Timestamp tolerance = 0) :
       ids_(std::forward<IdVec>(vec)),
       cardinality_(cardinality),
       order_(order),
       begin_(begin),
-      end_(end) { }
+      end_(end),
+      mode_(mode),
+      tolerance_(tolerance) { }
 
   boost::property_tree::ptree debug_info() const override {
     boost::property_tree::ptree tree;
     tree.add("name", "Join");
+    if (mode_ == JoinMode::ASOF) {
+      tree.add("mode", "as-of");
+      tree.add("tolerance", tolerance_);
+    }
     return tree;
   }
 
@@ -59,7 +68,11 @@ struct Join : MaterializationStep {
         ids.push_back(ix);
       }
       std::unique_ptr<ColumnMaterializer> it;
-      it.reset(new JoinMaterializer(std::move(ids), std::move(joined), ids_.at(i)));
+      if (mode_ == JoinMode::ASOF) {
+        it.reset(new AsOfJoinMaterializer(std::move(joined), ids_.at(i), tolerance_));
+      } else {
+        it.reset(new JoinMaterializer(std::move(ids), std::move(joined), ids_.at(i)));
+      }
       iters.push_back(std::move(it));
     }
     if (order_ == OrderBy::SERIES) {
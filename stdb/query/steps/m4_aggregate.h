@@ -0,0 +1,58 @@
+/*!
+ * \file m4_aggregate.h
+ */
+#ifndef STDB_QUERY_STEPS_M4_AGGREGATE_H_
+#define STDB_QUERY_STEPS_M4_AGGREGATE_H_
+
+#include "stdb/query/steps/materialization_step.h"
+
+namespace stdb {
+namespace qp {
+
+/**
+ * Converts group-aggregate operators (one bucket per pixel column) to
+ * M4 downsampled series
+ */
+struct M4Aggregate : MaterializationStep {
+  std::vector<ParamId> ids_;
+  OrderBy order_;
+  std::unique_ptr<ColumnMaterializer> mat_;
+
+  template <class IdVec>
+  M4Aggregate(IdVec&& vec, OrderBy order) :
+      ids_(std::forward<IdVec>(vec)),
+      order_(order) { }
+
+  boost::property_tree::ptree debug_info() const override {
+    boost::property_tree::ptree tree;
+    tree.add("name", "M4Aggregate");
+    return tree;
+  }
+
+  common::Status apply(ProcessingPrelude *prelude) {
+    std::vector<std::unique_ptr<AggregateOperator>> iters;
+    auto status = prelude->extract_result(&iters);
+    if (status != common::Status::Ok()) {
+      return status;
+    }
+    if (order_ == OrderBy::SERIES) {
+      mat_.reset(new M4Materializer(std::move(ids_), std::move(iters)));
+    } else {
+      mat_.reset(new TimeOrderM4Materializer(ids_, iters));
+    }
+    return common::Status::Ok();
+  }
+
+  common::Status extract_result(std::unique_ptr<ColumnMaterializer> *dest) {
+    if (!mat_) {
+      return common::Status::NoData();
+    }
+    *dest = std::move(mat_);
+    return common::Status::Ok();
+  }
+};
+
+}  // namespace qp
+}  // namespace stdb
+
+#endif  // STDB_QUERY_STEPS_M4_AGGREGATE_H_
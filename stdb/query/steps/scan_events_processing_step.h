@@ -15,6 +15,7 @@ struct ScanEventsProcessingStep : ProcessingPrelude {
   Timestamp end_;
   std::vector<ParamId> ids_;
   std::string regex_;
+  EventPredicate pred_;
 
   //! C-tor (1), create scan without filter
   template<class T>
@@ -31,6 +32,16 @@ struct ScanEventsProcessingStep : ProcessingPrelude {
       ids_(std::forward<T>(t)),
       regex_(exp) { }
 
+  //! C-tor (3), create scan with keyword filter and optional regex
+  template<class T>
+  ScanEventsProcessingStep(Timestamp begin, Timestamp end, const std::string& exp,
+                           EventPredicate const& pred, T&& t) :
+      begin_(begin),
+      end_(end),
+      ids_(std::forward<T>(t)),
+      regex_(exp),
+      pred_(pred) { }
+
   boost::property_tree::ptree debug_info() const override {
     boost::property_tree::ptree tree;
     tree.add("name", "ScanEventsProcessingStep");
@@ -38,6 +49,9 @@ struct ScanEventsProcessingStep : ProcessingPrelude {
   }
 
   virtual common::Status apply(const ColumnStore& cstore) {
+    if (!pred_.empty()) {
+      return cstore.filter_events(ids_, begin_, end_, regex_, pred_, &scanlist_);
+    }
     if (!regex_.empty()) {
       return cstore.filter_events(ids_, begin_, end_, regex_, &scanlist_);
     }
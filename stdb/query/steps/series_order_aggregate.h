@@ -15,12 +15,14 @@ namespace qp {
 struct SeriesOrderAggregate : MaterializationStep {
   std::vector<ParamId> ids_;
   std::vector<AggregationFunction> fn_;
+  GroupAggregateFill fill_;
   std::unique_ptr<ColumnMaterializer> mat_;
 
   template <class IdVec, class FnVec>
-  SeriesOrderAggregate(IdVec&& vec, FnVec&& fn) :
+  SeriesOrderAggregate(IdVec&& vec, FnVec&& fn, const GroupAggregateFill& fill = GroupAggregateFill()) :
       ids_(std::forward<IdVec>(vec)),
-      fn_(std::forward<FnVec>(fn)) { }
+      fn_(std::forward<FnVec>(fn)),
+      fill_(fill) { }
 
   boost::property_tree::ptree debug_info() const override {
     boost::property_tree::ptree tree;
@@ -34,7 +36,7 @@ struct SeriesOrderAggregate : MaterializationStep {
     if (status != common::Status::Ok()) {
       return status;
     }
-    mat_.reset(new SeriesOrderAggregateMaterializer(std::move(ids_), std::move(iters), fn_));
+    mat_.reset(new SeriesOrderAggregateMaterializer(std::move(ids_), std::move(iters), fn_, fill_));
     return common::Status::Ok();
   }
 
@@ -12,12 +12,14 @@ namespace qp {
 struct TimeOrderAggregate : MaterializationStep {
   std::vector<ParamId> ids_;
   std::vector<AggregationFunction> fn_;
+  GroupAggregateFill fill_;
   std::unique_ptr<ColumnMaterializer> mat_;
 
   template<class IdVec, class FnVec>
-  TimeOrderAggregate(IdVec&& vec, FnVec&& fn) :
+  TimeOrderAggregate(IdVec&& vec, FnVec&& fn, const GroupAggregateFill& fill = GroupAggregateFill()) :
       ids_(std::forward<IdVec>(vec)),
-      fn_(std::forward<FnVec>(fn)) { }
+      fn_(std::forward<FnVec>(fn)),
+      fill_(fill) { }
 
   boost::property_tree::ptree debug_info() const {
     boost::property_tree::ptree tree;
@@ -31,7 +33,7 @@ struct TimeOrderAggregate : MaterializationStep {
     if (status != common::Status::Ok()) {
       return status;
     }
-    mat_.reset(new TimeOrderAggregateMaterializer(ids_, iters, fn_));
+    mat_.reset(new TimeOrderAggregateMaterializer(ids_, iters, fn_, fill_));
     return common::Status::Ok();
   }
 
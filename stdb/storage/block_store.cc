@@ -282,25 +282,67 @@ static u32 crc32c(const u8* data, size_t size) {
   return impl(0, data, size);
 }
 
-u32 FileStorage::checksum(u8 const* data, size_t size) const {
-  return crc32c(data, size);
+static void crc32c(u8 const* const* data, const size_t* sizes, u32* out, size_t n) {
+  static common::crc32c_batch_impl_t impl = common::chose_crc32c_batch_implementation();
+  impl(reinterpret_cast<const void* const*>(data), sizes, out, n);
 }
 
-u32 FileStorage::checksum(const IOVecBlock& block, size_t offset, size_t size) const {
+/** Compute crc32c of the iovec block.
+ * Full components are checksummed by the batch kernel independently,
+ * the results are combined and the last component is appended to the
+ * combined crc.
+ */
+static u32 crc32c(const IOVecBlock& block, size_t offset, size_t size) {
   static common::crc32c_impl_t impl = common::chose_crc32c_implementation();
-  u32 crc32 = 0;
+  static const u32 component_op = common::crc32c_combine_gen(IOVecBlock::COMPONENT_SIZE);
+  u8 const* data[IOVecBlock::NCOMPONENTS];
+  size_t sizes[IOVecBlock::NCOMPONENTS];
+  u32 crcs[IOVecBlock::NCOMPONENTS];
+  size_t n = 0;
   for (int i = 0; i < IOVecBlock::NCOMPONENTS; i++) {
     if (block.get_size(i) < offset || block.get_size(i) == 0 || size == 0) {
       break;
     }
     size_t sz = std::min(block.get_size(i) - offset, size);
-    crc32 = impl(crc32, block.get_cdata(i) + offset, sz);
+    data[n] = block.get_cdata(i) + offset;
+    sizes[n] = sz;
+    n++;
     size -= sz;
     offset = 0;
   }
+  // Number of leading components that can be combined
+  size_t nfull = 0;
+  while (nfull + 1 < n && sizes[nfull] == IOVecBlock::COMPONENT_SIZE) {
+    nfull++;
+  }
+  u32 crc32 = 0;
+  if (nfull > 1) {
+    crc32c(data, sizes, crcs, nfull);
+    crc32 = crcs[0];
+    for (size_t i = 1; i < nfull; i++) {
+      crc32 = common::crc32c_combine_op(crc32, crcs[i], component_op);
+    }
+  } else {
+    nfull = 0;
+  }
+  for (size_t i = nfull; i < n; i++) {
+    crc32 = impl(crc32, data[i], sizes[i]);
+  }
   return crc32;
 }
 
+u32 FileStorage::checksum(u8 const* data, size_t size) const {
+  return crc32c(data, size);
+}
+
+u32 FileStorage::checksum(const IOVecBlock& block, size_t offset, size_t size) const {
+  return crc32c(block, offset, size);
+}
+
+void FileStorage::checksum(u8 const* const* data, const size_t* sizes, u32* out, size_t n) const {
+  crc32c(data, sizes, out, n);
+}
+
 FixedSizeFileStorage::FixedSizeFileStorage(std::shared_ptr<VolumeRegistry> meta)
     : FileStorage::FileStorage(meta) { }
 
@@ -489,18 +531,11 @@ u32 MemStore::checksum(u8 const* data, size_t size) const {
 }
 
 u32 MemStore::checksum(const IOVecBlock& block, size_t offset , size_t size) const {
-  static common::crc32c_impl_t impl = common::chose_crc32c_implementation();
-  u32 crc32 = 0;
-  for (int i = 0; i < IOVecBlock::NCOMPONENTS; i++) {
-    if (block.get_size(i) < offset || block.get_size(i) == 0 || size == 0) {
-      break;
-    }
-    size_t sz = std::min(block.get_size(i) - offset, size);
-    crc32 = impl(crc32, block.get_cdata(i) + offset, sz);
-    size -= sz;
-    offset = 0;
-  }
-  return crc32;
+  return crc32c(block, offset, size);
+}
+
+void MemStore::checksum(u8 const* const* data, const size_t* sizes, u32* out, size_t n) const {
+  crc32c(data, sizes, out, n);
 }
 
 std::tuple<common::Status, std::unique_ptr<IOVecBlock>> MemStore::read_iovec_block(LogicAddr addr) {
@@ -86,6 +86,14 @@ struct BlockStore {
   //! Compute checksum of the iovec block
   virtual u32 checksum(const IOVecBlock& block, size_t offset, size_t size) const = 0;
 
+  /** Compute checksums of many memory regions at once.
+   * @param data is an array of pointers to memory regions
+   * @param sizes is an array of region sizes
+   * @param out is an array of checksums (output)
+   * @param n is a number of regions
+   */
+  virtual void checksum(u8 const* const* data, const size_t* sizes, u32* out, size_t n) const = 0;
+
   virtual BlockStoreStats get_stats() const = 0;
 
   virtual PerVolumeStats get_volume_stats() const = 0;
@@ -133,6 +141,8 @@ class FileStorage : public BlockStore {
 
   virtual u32 checksum(const IOVecBlock& block, size_t offset, size_t size) const;
 
+  virtual void checksum(u8 const* const* data, const size_t* sizes, u32* out, size_t n) const;
+
   virtual BlockStoreStats get_stats() const;
 
   virtual PerVolumeStats get_volume_stats() const;
@@ -210,6 +220,7 @@ struct MemStore : BlockStore, std::enable_shared_from_this<MemStore> {
   virtual bool exists(LogicAddr addr) const;
   virtual u32 checksum(const IOVecBlock &block, size_t offset, size_t size) const;
   virtual u32 checksum(const u8* data, size_t size) const;
+  virtual void checksum(u8 const* const* data, const size_t* sizes, u32* out, size_t n) const;
   virtual BlockStoreStats get_stats() const;
   virtual PerVolumeStats get_volume_stats() const;
   virtual LogicAddr get_top_address() const;
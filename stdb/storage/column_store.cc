@@ -12,7 +12,8 @@ namespace stdb {
 namespace storage {
 
 ColumnStore::ColumnStore(std::shared_ptr<BlockStore> bstore)
-    : blockstore_(bstore) { }
+    : blockstore_(bstore)
+    , event_index_ptr_(nullptr) { }
 
 std::tuple<common::Status, std::vector<ParamId>> ColumnStore::open_or_restore(
     std::unordered_map<ParamId, std::vector<LogicAddr>> const& mapping,
@@ -31,6 +32,13 @@ std::tuple<common::Status, std::vector<ParamId>> ColumnStore::open_or_restore(
     auto tree = std::make_shared<NBTreeExtentsList>(id, rescue_points, blockstore_);
 
     std::lock_guard<std::mutex> tl(table_lock_);
+    if (sax_index_) {
+      tree->set_leaf_listener(sax_index_);
+    }
+    if (event_index_) {
+      // Stored events are not indexed
+      event_index_->reset(id);
+    }
     if (columns_.count(id)) {
       LOG(ERROR) << "Can't open/repair " + std::to_string(id) + " (already exists)";
       return std::make_tuple(common::Status::BadArg(), std::vector<ParamId>());
@@ -107,6 +115,9 @@ common::Status ColumnStore::create_new_column(ParamId id) {
     return common::Status::BadArg();
   } else {
     auto tree = std::make_shared<NBTreeExtentsList>(id, empty, blockstore_);
+    if (sax_index_) {
+      tree->set_leaf_listener(sax_index_);
+    }
     columns_[id] = std::move(tree);
     columns_[id]->force_init();
     return common::Status::Ok();
@@ -124,6 +135,135 @@ size_t ColumnStore::_get_uncommitted_memory() const {
   return total_size;
 }
 
+void ColumnStore::enable_sax_index(SAXIndexParams const& params) {
+  std::vector<std::shared_ptr<NBTreeExtentsList>> trees;
+  auto index = std::make_shared<SAXIndex>(params);
+  {
+    std::lock_guard<std::mutex> guard(table_lock_);
+    sax_index_ = index;
+    for (auto const& kv: columns_) {
+      if (!kv.second->is_initialized()) {
+        kv.second->force_init();
+      }
+      kv.second->set_leaf_listener(index);
+      trees.push_back(kv.second);
+    }
+  }
+  // Backfill without the table lock. Index drops values that are older than
+  // the last indexed value of the series, so if the leaf is committed
+  // concurrently the older windows that are not backfilled yet are lost.
+  std::vector<Timestamp> ts(0x1000);
+  std::vector<double> xs(0x1000);
+  for (auto const& tree: trees) {
+    if (tree->is_event_column()) {
+      continue;
+    }
+    auto it = tree->search(0, std::numeric_limits<Timestamp>::max());
+    while (true) {
+      common::Status status;
+      size_t size;
+      std::tie(status, size) = it->read(ts.data(), xs.data(), ts.size());
+      index->append(tree->get_id(), ts.data(), xs.data(), size);
+      if (!status.IsOk() || size == 0) {
+        break;
+      }
+    }
+  }
+  LOG(INFO) << "Similarity index enabled, " << index->size() << " windows indexed";
+}
+
+void ColumnStore::enable_event_index() {
+  std::vector<std::shared_ptr<NBTreeExtentsList>> trees;
+  EventIndex* index = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(table_lock_);
+    if (event_index_) {
+      return;
+    }
+    event_index_.reset(new EventIndex());
+    index = event_index_.get();
+    for (auto const& kv: columns_) {
+      if (!kv.second->is_initialized()) {
+        kv.second->force_init();
+      }
+      trees.push_back(kv.second);
+    }
+    event_index_ptr_.store(index);
+  }
+  // Backfill without the table lock. Events that are written concurrently
+  // can be added out of order, such events are not indexed and will be
+  // scanned by every query.
+  std::vector<Timestamp> ts(0x100);
+  std::vector<std::string> xs(0x100);
+  for (auto const& tree: trees) {
+    if (!tree->is_event_column()) {
+      // Numeric values can't be decoded as events
+      continue;
+    }
+    auto it = tree->search_binary(0, std::numeric_limits<Timestamp>::max());
+    while (true) {
+      common::Status status;
+      size_t size;
+      std::tie(status, size) = it->read(ts.data(), xs.data(), ts.size());
+      for (size_t i = 0; i < size; i++) {
+        index->add(tree->get_id(), ts[i], xs[i].data(), xs[i].size());
+      }
+      if (!status.IsOk() || size == 0) {
+        break;
+      }
+    }
+  }
+  LOG(INFO) << "Event index enabled, " << index->size() << " events indexed";
+}
+
+EventIndex* ColumnStore::get_event_index() const {
+  return event_index_ptr_.load();
+}
+
+common::Status ColumnStore::similarity_search(SAXQuery const& query, std::vector<SAXMatch>* dest) const {
+  std::shared_ptr<SAXIndex> index;
+  {
+    std::lock_guard<std::mutex> guard(table_lock_);
+    index = sax_index_;
+  }
+  if (!index) {
+    return common::Status::NotFound();
+  }
+  auto fetch = [this](ParamId id, Timestamp begin, Timestamp end, std::vector<double>* out) {
+    std::shared_ptr<NBTreeExtentsList> tree;
+    {
+      std::lock_guard<std::mutex> guard(table_lock_);
+      auto it = columns_.find(id);
+      if (it == columns_.end()) {
+        return common::Status::NotFound();
+      }
+      if (!it->second->is_initialized()) {
+        it->second->force_init();
+      }
+      tree = it->second;
+    }
+    auto iter = tree->search(begin, end + 1);
+    std::vector<Timestamp> ts(0x100);
+    std::vector<double> xs(0x100);
+    while (true) {
+      common::Status status;
+      size_t size;
+      std::tie(status, size) = iter->read(ts.data(), xs.data(), ts.size());
+      out->insert(out->end(), xs.begin(), xs.begin() + size);
+      if (status.Code() == common::Status::kNoData || size == 0) {
+        break;
+      }
+      if (!status.IsOk()) {
+        return status;
+      }
+    }
+    return common::Status::Ok();
+  };
+  common::Status status;
+  std::tie(status, *dest) = index->search(query, fetch);
+  return status;
+}
+
 NBTreeAppendResult ColumnStore::write(
     Sample const& sample,
     std::vector<LogicAddr>* rescue_points,
@@ -140,6 +280,10 @@ NBTreeAppendResult ColumnStore::write(
       u32 sz = sample.payload.size - sizeof(Sample);
       u8 const* pdata = reinterpret_cast<u8 const*>(sample.payload.data);
       res = tree->append(sample.timestamp, pdata, sz);
+      auto index = get_event_index();
+      if (index != nullptr && (res == NBTreeAppendResult::OK || res == NBTreeAppendResult::OK_FLUSH_NEEDED)) {
+        index->add(id, sample.timestamp, sample.payload.data, sz);
+      }
     }
     if (res == NBTreeAppendResult::OK_FLUSH_NEEDED) {
       auto tmp = tree->get_roots();
@@ -191,6 +335,10 @@ NBTreeAppendResult CStoreSession::write(Sample const& sample, std::vector<LogicA
     auto it = cache_.find(sample.paramid);
     if (it != cache_.end()) {
       auto res = it->second->append(sample.timestamp, pdata, sz);
+      auto index = cstore_->get_event_index();
+      if (index != nullptr && (res == NBTreeAppendResult::OK || res == NBTreeAppendResult::OK_FLUSH_NEEDED)) {
+        index->add(sample.paramid, sample.timestamp, sample.payload.data, sz);
+      }
       if (res == NBTreeAppendResult::OK_FLUSH_NEEDED) {
         auto tmp = it->second->get_roots();
         rescue_points->swap(tmp);
@@ -24,6 +24,7 @@
  * synchronization). This code assumes that each connection works with its own
  * set of time-series. If this isn't the case - performance penalty will be introduced.
  */
+#include <atomic>
 #include <condition_variable>
 #include <unordered_map>
 #include <mutex>
@@ -32,7 +33,9 @@
 #include "stdb/common/basic.h"
 #include "stdb/common/status.h"
 #include "stdb/storage/block_store.h"
+#include "stdb/storage/event_index.h"
 #include "stdb/storage/nbtree.h"
+#include "stdb/storage/sax_index.h"
 
 namespace stdb {
 namespace storage {
@@ -55,6 +58,11 @@ class ColumnStore : public std::enable_shared_from_this<ColumnStore> {
   mutable std::mutex table_lock_;
   //! Syncronization for watcher thread
   std::condition_variable cvar_;
+  //! Similarity search index (optional)
+  std::shared_ptr<SAXIndex> sax_index_;
+  //! Event token index (optional), can't be disabled once enabled
+  std::unique_ptr<EventIndex> event_index_;
+  std::atomic<EventIndex*> event_index_ptr_;
 
  public:
   ColumnStore(std::shared_ptr<BlockStore> bstore);
@@ -101,6 +109,26 @@ class ColumnStore : public std::enable_shared_from_this<ColumnStore> {
 
   size_t _get_uncommitted_memory() const;
 
+  /** Enable similarity search index.
+   * Data that is already stored is added to the index, new data is added
+   * when leaf nodes are committed.
+   */
+  void enable_sax_index(SAXIndexParams const& params);
+
+  /** Find top-k windows that are similar to the pattern.
+   * @return NotFound if similarity index is not enabled
+   */
+  common::Status similarity_search(SAXQuery const& query, std::vector<SAXMatch>* dest) const;
+
+  /** Enable token index for event columns.
+   * Events that are already stored are added to the index, new events are
+   * added on write.
+   */
+  void enable_event_index();
+
+  //! Get event index (nullptr if not enabled)
+  EventIndex* get_event_index() const;
+
   //! For debug reports
   std::unordered_map<ParamId, std::shared_ptr<NBTreeExtentsList>> _get_columns() {
     return columns_;
@@ -159,6 +187,27 @@ class ColumnStore : public std::enable_shared_from_this<ColumnStore> {
                    });
   }
 
+  /** Filter events using keyword predicate and regex (regex is not used if empty).
+   * Event index is used to skip events that can't match the predicate if enabled.
+   */
+  common::Status filter_events(std::vector<ParamId> const& ids,
+                               Timestamp begin,
+                               Timestamp end,
+                               const std::string& expr,
+                               EventPredicate const& pred,
+                               std::vector<std::unique_ptr<BinaryDataOperator>>* dest) const {
+    auto index = get_event_index();
+    if (index == nullptr || !EventIndex::indexable(pred)) {
+      return iterate(ids, dest, [begin, end, &expr, &pred](const NBTreeExtentsList& elist) {
+                     return std::make_tuple(common::Status::Ok(), elist.filter_binary(begin, end, expr, pred));
+                     });
+    }
+    return iterate(ids, dest, [begin, end, &expr, &pred, index](const NBTreeExtentsList& elist) {
+                   auto ranges = index->candidates(elist.get_id(), begin, end, pred);
+                   return std::make_tuple(common::Status::Ok(), elist.filter_binary(begin, end, ranges, expr, pred));
+                   });
+  }
+
   common::Status filter(std::vector<ParamId> const& ids,
                         Timestamp begin,
                         Timestamp end,
@@ -187,6 +236,16 @@ class ColumnStore : public std::enable_shared_from_this<ColumnStore> {
                    });
   }
 
+  //! Estimate aggregates without reading leaf nodes, see NBTreeExtentsList::approximate_aggregate
+  common::Status approximate_aggregate(std::vector<ParamId> const& ids,
+                                       Timestamp begin,
+                                       Timestamp end,
+                                       std::vector<std::unique_ptr<AggregateOperator>>* dest) const {
+    return iterate(ids, dest, [begin, end](const NBTreeExtentsList& elist) {
+                   return std::make_tuple(common::Status::Ok(), elist.approximate_aggregate(begin, end));
+                   });
+  }
+
   common::Status group_aggregate(std::vector<ParamId> const& ids,
                                  Timestamp begin,
                                  Timestamp end,
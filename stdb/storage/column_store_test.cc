@@ -2,6 +2,8 @@
  * \file column_store_test.cc
  */
 #include <iostream>
+#include <map>
+#include <set>
 
 #include <apr.h>
 #include <sqlite3.h>
@@ -665,6 +667,69 @@ TEST(TestNBtree, Test_column_store_join_1) {
   test_join(100, 1100);
 }
 
+void test_asof_join(Timestamp begin, Timestamp end) {
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  std::vector<ParamId> col1 = {
+    10,11,12,13,14,15,16,17,18,19
+  };
+  std::vector<ParamId> col2 = {
+    20,21,22,23,24,25,26,27,28,29
+  };
+  std::vector<Timestamp> timestamps;
+  for (Timestamp ix = begin; ix < end; ix++) {
+    timestamps.push_back(ix);
+  }
+  for (auto id: col1) {
+    fill_data_in(cstore, session, id, begin, end);
+  }
+  // Second column is sampled at every other timestamp
+  for (auto id: col2) {
+    cstore->create_new_column(id);
+    Sample sample;
+    sample.paramid = id;
+    sample.payload.type = PAYLOAD_FLOAT;
+    std::vector<u64> rpoints;
+    for (Timestamp ix = begin; ix < end; ix += 2) {
+      sample.payload.float64 = ix*0.1;
+      sample.timestamp = ix;
+      session->write(sample, &rpoints);
+    }
+  }
+
+  TupleQueryProcessorMock mock(2);
+  ReshapeRequest req = {};
+  req.agg.enabled = false;
+  req.group_by.enabled = false;
+  req.order_by = OrderBy::SERIES;
+  req.select.begin = begin;
+  req.select.end = end;
+  req.select.join_mode = JoinMode::ASOF;
+  req.select.columns.push_back({col1});
+  req.select.columns.push_back({col2});
+
+  execute(cstore, &mock, req);
+
+  EXPECT_TRUE(mock.error == common::Status::Ok());
+  u32 ix = 0;
+  for (auto id: col1) {
+    for (auto ts: timestamps) {
+      EXPECT_TRUE(mock.paramids.at(ix) == id);
+      EXPECT_TRUE(mock.timestamps.at(ix) == ts);
+      double col0 = mock.columns[0][ix];
+      double col1 = mock.columns[1][ix];
+      EXPECT_LE(fabs(ts*0.1 - col0), 10E-10);
+      EXPECT_LE(fabs((ts - (ts - begin) % 2)*0.1 - col1), 10E-10);
+      ix++;
+    }
+  }
+  EXPECT_EQ(ix, mock.timestamps.size());
+}
+
+TEST(TestNBtree, Test_column_store_asof_join_1) {
+  test_asof_join(100, 1100);
+}
+
 void test_group_aggregate(Timestamp begin, Timestamp end) {
   auto cstore = create_cstore();
   auto session = create_session(cstore);
@@ -761,6 +826,214 @@ TEST(TestNBtree, Test_column_store_group_aggregate_2) {
   test_group_aggregate(1000, 11000);
 }
 
+void test_group_aggregate_fill(Timestamp begin, Timestamp end, OrderBy order, FillPolicy fill) {
+  const Timestamp step = 100;
+  const Timestamp gap_begin = begin + 3*step;
+  const Timestamp gap_end = begin + 6*step;
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  std::vector<ParamId> col = {
+    10,11,12,13,14,15,16,17,18,19
+  };
+  // Buckets 3, 4 and 5 are empty
+  for (auto id: col) {
+    cstore->create_new_column(id);
+    Sample sample;
+    sample.paramid = id;
+    sample.payload.type = PAYLOAD_FLOAT;
+    std::vector<u64> rpoints;
+    for (Timestamp ix = begin; ix < end; ix++) {
+      if (ix >= gap_begin && ix < gap_end) {
+        continue;
+      }
+      sample.payload.float64 = ix*0.1;
+      sample.timestamp = ix;
+      session->write(sample, &rpoints);
+    }
+  }
+
+  TupleQueryProcessorMock mock(1);
+  ReshapeRequest req = {};
+  req.agg.enabled = true;
+  req.agg.step = step;
+  req.agg.func = { AggregationFunction::MIN };
+  req.agg.fill = fill;
+  req.agg.fill_value = -1.0;
+  req.group_by.enabled = false;
+  req.order_by = order;
+  req.select.begin = begin;
+  req.select.end = end;
+  req.select.columns.push_back({col});
+
+  execute(cstore, &mock, req);
+
+  EXPECT_TRUE(mock.error == common::Status::Ok());
+  auto expected_value = [&](Timestamp ts) {
+    if (ts < gap_begin || ts >= gap_end) {
+      return ts*0.1;
+    }
+    switch (fill) {
+      case FillPolicy::PREVIOUS:
+        return (gap_begin - step)*0.1;
+      case FillPolicy::CONSTANT:
+        return -1.0;
+      default:
+        // Linear interpolation between the surrounding buckets
+        return ts*0.1;
+    };
+  };
+  u32 nbuckets = static_cast<u32>((end - begin) / step);
+  ASSERT_EQ(nbuckets * col.size(), mock.timestamps.size());
+  for (u32 ix = 0; ix < mock.timestamps.size(); ix++) {
+    u32 bucket = order == OrderBy::SERIES ? ix % nbuckets : ix / static_cast<u32>(col.size());
+    u32 series = order == OrderBy::SERIES ? ix / nbuckets : ix % static_cast<u32>(col.size());
+    Timestamp ts = begin + bucket*step;
+    EXPECT_EQ(col.at(series), mock.paramids.at(ix));
+    EXPECT_EQ(ts, mock.timestamps.at(ix));
+    EXPECT_LE(fabs(expected_value(ts) - mock.columns[0][ix]), 10E-10);
+  }
+}
+
+TEST(TestNBtree, Test_column_store_group_aggregate_fill_1) {
+  test_group_aggregate_fill(100, 1100, OrderBy::SERIES, FillPolicy::LINEAR);
+}
+
+TEST(TestNBtree, Test_column_store_group_aggregate_fill_2) {
+  test_group_aggregate_fill(100, 1100, OrderBy::SERIES, FillPolicy::PREVIOUS);
+}
+
+TEST(TestNBtree, Test_column_store_group_aggregate_fill_3) {
+  test_group_aggregate_fill(1000, 11000, OrderBy::TIME, FillPolicy::CONSTANT);
+}
+
+//! Parallel group combiner should produce the same output as the lazy one
+void test_group_aggregate_parallel(Timestamp begin, Timestamp end, OrderBy order) {
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  std::vector<ParamId> ids;
+  std::unordered_map<ParamId, ParamId> translation_table;
+  for (ParamId id = 10; id < 40; id++) {
+    ids.push_back(id);
+    translation_table[id] = 100 + id % 3;
+    // Series cover different ranges
+    fill_data_in(cstore, session, id, begin + id, end - id);
+  }
+  auto query = [&](bool parallel) {
+    std::unique_ptr<TupleQueryProcessorMock> mock(new TupleQueryProcessorMock(2));
+    ReshapeRequest req = {};
+    req.agg.enabled = true;
+    req.agg.step = 10;
+    req.agg.func = { AggregationFunction::SUM, AggregationFunction::MAX };
+    req.group_by.enabled = true;
+    req.group_by.parallel = parallel;
+    req.group_by.transient_map = translation_table;
+    req.order_by = order;
+    req.select.begin = begin;
+    req.select.end = end;
+    req.select.columns.push_back({ids});
+    execute(cstore, mock.get(), req);
+    EXPECT_TRUE(mock->error == common::Status::Ok());
+    return mock;
+  };
+  auto expected = query(false);
+  auto actual = query(true);
+  ASSERT_EQ(expected->paramids.size(), actual->paramids.size());
+  EXPECT_NE(0u, actual->paramids.size());
+  EXPECT_EQ(expected->paramids, actual->paramids);
+  EXPECT_EQ(expected->timestamps, actual->timestamps);
+  for (size_t i = 0; i < 2; i++) {
+    for (size_t j = 0; j < expected->columns[i].size(); j++) {
+      EXPECT_NEAR(expected->columns[i][j], actual->columns[i][j], 10E-7);
+    }
+  }
+}
+
+TEST(TestNBtree, Test_column_store_group_aggregate_parallel_1) {
+  test_group_aggregate_parallel(100, 1100, OrderBy::SERIES);
+}
+
+TEST(TestNBtree, Test_column_store_group_aggregate_parallel_2) {
+  test_group_aggregate_parallel(1000, 11000, OrderBy::TIME);
+}
+
+void test_m4_downsample(Timestamp begin, Timestamp end, u32 width, OrderBy order) {
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  std::vector<ParamId> col = {
+    10,11,12,13,14,15,16,17,18,19
+  };
+  // All values are distinct so min and max are unique
+  auto value = [](Timestamp ts, ParamId id) {
+    return static_cast<double>((ts * 7919 + id) % 10007);
+  };
+  for (auto id: col) {
+    cstore->create_new_column(id);
+    Sample sample;
+    sample.paramid = id;
+    sample.payload.type = PAYLOAD_FLOAT;
+    std::vector<u64> rpoints;
+    for (Timestamp ix = begin; ix < end; ix++) {
+      sample.payload.float64 = value(ix, id);
+      sample.timestamp = ix;
+      session->write(sample, &rpoints);
+    }
+  }
+
+  QueryProcessorMock mock;
+  ReshapeRequest req = {};
+  req.agg.enabled = false;
+  req.group_by.enabled = false;
+  req.order_by = order;
+  req.select.begin = begin;
+  req.select.end = end;
+  req.select.columns.push_back({col});
+  req.downsample.method = DownsampleMethod::M4;
+  req.downsample.width = width;
+
+  execute(cstore, &mock, req);
+  EXPECT_TRUE(mock.error == common::Status::Ok());
+
+  // Brute force M4
+  const Timestamp step = req.downsample.get_step(begin, end);
+  std::map<ParamId, std::vector<Timestamp>> expected;
+  for (auto id: col) {
+    for (Timestamp bucket = begin; bucket < end; bucket += step) {
+      Timestamp last = std::min(end, bucket + step) - 1;
+      Timestamp mints = bucket, maxts = bucket;
+      for (Timestamp ts = bucket; ts <= last; ts++) {
+        if (value(ts, id) < value(mints, id)) {
+          mints = ts;
+        }
+        if (value(ts, id) > value(maxts, id)) {
+          maxts = ts;
+        }
+      }
+      std::set<Timestamp> points = { bucket, mints, maxts, last };
+      expected[id].insert(expected[id].end(), points.begin(), points.end());
+    }
+  }
+  std::map<ParamId, std::vector<Timestamp>> actual;
+  Timestamp prev = 0;
+  for (auto const& sample: mock.samples) {
+    EXPECT_EQ(value(sample.timestamp, sample.paramid), sample.payload.float64);
+    actual[sample.paramid].push_back(sample.timestamp);
+    if (order == OrderBy::TIME) {
+      EXPECT_LE(prev, sample.timestamp);
+      prev = sample.timestamp;
+    }
+  }
+  EXPECT_TRUE(expected == actual);
+  EXPECT_LE(mock.samples.size(), col.size() * width * 4);
+}
+
+TEST(TestNBtree, Test_column_store_m4_downsample_1) {
+  test_m4_downsample(100, 10100, 37, OrderBy::SERIES);
+}
+
+TEST(TestNBtree, Test_column_store_m4_downsample_2) {
+  test_m4_downsample(1000, 51000, 20, OrderBy::TIME);
+}
+
 //! Tests aggregate query in conjunction with group-by clause
 void test_aggregate_and_group_by(Timestamp begin, Timestamp end) {
   auto cstore = create_cstore();
@@ -827,6 +1100,117 @@ TEST(TestNBtree, Test_column_store_aggregate_group_by_3) {
   test_aggregate_and_group_by(1000, 11000);
 }
 
+void test_approximate_aggregate(Timestamp begin, Timestamp end) {
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  std::vector<ParamId> ids = { 10, 11, 12 };
+  for (auto id: ids) {
+    fill_data_in(cstore, session, id, begin, end);
+  }
+  // Query range cuts leaf nodes on both sides
+  Timestamp qbegin = begin + (end - begin) / 3 + 7;
+  Timestamp qend = end - (end - begin) / 5 - 3;
+  double cnt = qend - qbegin;
+  double sum = 0.1 * (qbegin + qend - 1) * cnt / 2;
+
+  TupleQueryProcessorMock mock(3);
+  ReshapeRequest req = {};
+  req.agg.enabled = true;
+  req.agg.func = { AggregationFunction::CNT, AggregationFunction::SUM, AggregationFunction::MEAN };
+  req.agg.approx = { true, 0.01, 0.95, 0 };
+  req.order_by = OrderBy::SERIES;
+  req.select.begin = qbegin;
+  req.select.end = qend;
+  req.select.columns.push_back({ids});
+
+  execute(cstore, &mock, req);
+
+  ASSERT_TRUE(mock.error == common::Status::Ok());
+  ASSERT_EQ(3u, mock.paramids.size());
+  std::vector<double> expected = { cnt, sum, sum / cnt };
+  for (u32 i = 0; i < 3; i++) {
+    EXPECT_EQ(ids[i], mock.paramids[i]);
+    EXPECT_LE(fabs(mock.columns[0][i] - expected[i]) / expected[i], 0.01);
+    // Every series was read, no sampling error
+    EXPECT_EQ(mock.columns[0][i], mock.columns[1][i]);
+    EXPECT_EQ(mock.columns[0][i], mock.columns[2][i]);
+  }
+}
+
+TEST(TestNBtree, Test_column_store_approximate_aggregate_1) {
+  test_approximate_aggregate(100, 1100);
+}
+
+TEST(TestNBtree, Test_column_store_approximate_aggregate_2) {
+  test_approximate_aggregate(1000, 101000);
+}
+
+void test_approximate_aggregate_group_by(double error, bool sampled) {
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  const Timestamp begin = 1000, end = 2000;
+  std::vector<ParamId> ids;
+  double sum = 0;
+  for (ParamId id = 1000; id < 1400; id++) {
+    cstore->create_new_column(id);
+    Sample sample;
+    sample.paramid = id;
+    sample.payload.type = PAYLOAD_FLOAT;
+    std::vector<u64> rpoints;
+    for (Timestamp ts = begin; ts < end; ts++) {
+      sample.timestamp = ts;
+      sample.payload.float64 = static_cast<double>(id % 13) + ts * 0.001;
+      session->write(sample, &rpoints);
+      sum += sample.payload.float64;
+    }
+    ids.push_back(id);
+  }
+  TupleQueryProcessorMock mock(3);
+  ReshapeRequest req = {};
+  req.agg.enabled = true;
+  req.agg.func.resize(ids.size(), AggregationFunction::SUM);
+  req.agg.approx = { true, error, 0.99, 0 };
+  req.order_by = OrderBy::SERIES;
+  req.select.begin = begin;
+  req.select.end = end;
+  req.select.columns.push_back({ids});
+  req.group_by.enabled = true;
+  req.select.matcher = std::make_shared<PlainSeriesMatcher>(1);
+  req.select.matcher->_add("total", 100);
+  for (auto id: ids) {
+    req.group_by.transient_map[id] = 100;
+  }
+
+  execute(cstore, &mock, req);
+
+  ASSERT_TRUE(mock.error == common::Status::Ok());
+  ASSERT_EQ(1u, mock.paramids.size());
+  EXPECT_EQ(100u, mock.paramids[0]);
+  double value = mock.columns[0][0];
+  double lower = mock.columns[1][0];
+  double upper = mock.columns[2][0];
+  if (sampled) {
+    EXPECT_LT(lower, value);
+    EXPECT_GT(upper, value);
+    EXPECT_LE((upper - value) / value, error);
+    EXPECT_LE(lower, sum);
+    EXPECT_GE(upper, sum);
+  } else {
+    EXPECT_EQ(lower, value);
+    EXPECT_EQ(upper, value);
+    EXPECT_LE(fabs(value - sum) / sum, 10E-10);
+  }
+}
+
+TEST(TestNBtree, Test_column_store_approximate_aggregate_group_by_1) {
+  test_approximate_aggregate_group_by(0.05, true);
+}
+
+TEST(TestNBtree, Test_column_store_approximate_aggregate_group_by_2) {
+  // Target error can't be reached without reading every series
+  test_approximate_aggregate_group_by(10E-10, false);
+}
+
 static double fill_data2(std::shared_ptr<ColumnStore> cstore,
                          std::unique_ptr<CStoreSession>& session,
                          ParamId id,
@@ -1381,5 +1765,106 @@ TEST(TestNBtree, Test_restored_column_safety_2) {
   test_restored_column_safety(1000, 11000);
 }
 
+
+static void write_event(CStoreSession* session, ParamId id, Timestamp ts, std::string const& body) {
+  std::vector<char> buf(sizeof(Sample) + body.size());
+  Sample* sample = reinterpret_cast<Sample*>(buf.data());
+  sample->paramid = id;
+  sample->timestamp = ts;
+  sample->payload.type = PAYLOAD_EVENT;
+  sample->payload.size = static_cast<u16>(sizeof(Sample) + body.size());
+  memcpy(sample->payload.data, body.data(), body.size());
+  std::vector<LogicAddr> rpoints;
+  session->write(*sample, &rpoints);
+}
+
+static std::vector<std::pair<Timestamp, std::string>> read_events(BinaryDataOperator* op) {
+  std::vector<std::pair<Timestamp, std::string>> result;
+  Timestamp ts[64];
+  std::string xs[64];
+  while (true) {
+    common::Status status;
+    size_t size;
+    std::tie(status, size) = op->read(ts, xs, 64);
+    for (size_t i = 0; i < size; i++) {
+      result.push_back(std::make_pair(ts[i], xs[i]));
+    }
+    if (!status.IsOk() || size == 0) {
+      break;
+    }
+  }
+  return result;
+}
+
+TEST(TestColumnStore, Test_column_store_event_index) {
+  auto cstore = create_cstore();
+  auto session = create_session(cstore);
+  cstore->create_new_column(1024);
+  const char* levels[] = { "INFO", "WARN", "ERROR" };
+  // Events from the first pass are indexed by backfill
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass == 1) {
+      cstore->enable_event_index();
+    }
+    for (int i = 0; i < 30000; i++) {
+      Timestamp ts = static_cast<Timestamp>((pass * 30000 + i + 1) * 1000 + i % 7);
+      std::string body = std::string(levels[i % 3]) + " request " + std::to_string(i);
+      if (i % 997 == 0) {
+        body += " Timeout conn";
+      }
+      write_event(session.get(), 1024, ts, body);
+    }
+  }
+  EXPECT_EQ(60000u, cstore->get_event_index()->size());
+
+  EventPredicate pred;
+  pred.add_keyword("timeout");
+  Timestamp ranges[][2] = {
+    { 0, 70000000 },
+    { 70000000, 500 },
+    { 20000000, 40000000 },
+  };
+  for (auto const& range: ranges) {
+    std::vector<std::unique_ptr<BinaryDataOperator>> expected, actual;
+    ASSERT_TRUE(cstore->filter_events({ 1024 }, range[0], range[1], "Timeout", &expected).IsOk());
+    ASSERT_TRUE(cstore->filter_events({ 1024 }, range[0], range[1], "", pred, &actual).IsOk());
+    auto xs = read_events(expected.at(0).get());
+    EXPECT_FALSE(xs.empty());
+    EXPECT_TRUE(xs == read_events(actual.at(0).get()));
+  }
+
+  // Regex is applied to the events selected by the predicate
+  std::vector<std::unique_ptr<BinaryDataOperator>> dest;
+  ASSERT_TRUE(cstore->filter_events({ 1024 }, 0, 70000000, "ERROR", pred, &dest).IsOk());
+  auto xs = read_events(dest.at(0).get());
+  EXPECT_FALSE(xs.empty());
+  for (auto const& kv: xs) {
+    EXPECT_EQ(0u, kv.second.find("ERROR"));
+    EXPECT_NE(std::string::npos, kv.second.find("Timeout"));
+  }
+}
+
+TEST(TestColumnStore, Test_event_index_backfill_skips_numeric_columns) {
+  auto bstore = BlockStoreBuilder::create_memstore();
+  std::shared_ptr<ColumnStore> cstore(new ColumnStore(bstore));
+  auto session = create_session(cstore);
+  // Event series have negative ids
+  const ParamId event_id = static_cast<ParamId>(-1024);
+  fill_data_in(cstore, session, 1, 1000, 20000);
+  cstore->create_new_column(event_id);
+  for (int i = 0; i < 1000; i++) {
+    write_event(session.get(), event_id, static_cast<Timestamp>((i + 1) * 1000), "event " + std::to_string(i));
+  }
+  fill_data_in(cstore, session, 2, 1000, 20000);
+  session.reset();
+  auto mapping = cstore->close();
+
+  // Reopened trees don't know that they contain events, only the id is checked
+  cstore.reset(new ColumnStore(bstore));
+  cstore->open_or_restore(mapping);
+  cstore->enable_event_index();
+  EXPECT_EQ(1000u, cstore->get_event_index()->size());
+}
+
 }  // namespace storage
 }  // namespace stdb
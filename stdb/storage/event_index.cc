@@ -0,0 +1,427 @@
+/**
+ * \file event_index.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/storage/event_index.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "stdb/common/hash.h"
+
+namespace stdb {
+namespace storage {
+
+namespace {
+
+const u64 KEYWORD_SEED = 0;
+const u64 PREFIX_SEED = 0x9e3779b97f4a7c15ull;
+
+bool is_token_char(char c) {
+  auto u = static_cast<unsigned char>(c);
+  return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_' || u >= 0x80;
+}
+
+char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+//! Intersection of the sorted lists
+void intersect(std::vector<u32> const& other, std::vector<u32>* inout) {
+  std::vector<u32> result;
+  std::set_intersection(inout->begin(), inout->end(), other.begin(), other.end(), std::back_inserter(result));
+  inout->swap(result);
+}
+
+//! Candidate range with ordinal numbers of the first and last events
+struct Candidate {
+  Timestamp begin;
+  Timestamp end;
+  u64       first;
+  u64       last;
+};
+
+}  // namespace
+
+// ---------------
+// EventPredicate
+// ---------------
+
+void EventPredicate::add_keyword(std::string const& keyword) {
+  EventIndex::tokenize(keyword.data(), keyword.size(), &keywords);
+}
+
+void EventPredicate::add_prefix(std::string const& prefix) {
+  // All tokens except the last one should match completely
+  std::vector<std::string> tokens;
+  EventIndex::tokenize(prefix.data(), prefix.size(), &tokens);
+  if (tokens.empty()) {
+    return;
+  }
+  bool last_is_complete = !prefix.empty() && !is_token_char(prefix.back());
+  for (size_t i = 0; i + 1 < tokens.size(); i++) {
+    keywords.push_back(tokens[i]);
+  }
+  if (last_is_complete) {
+    keywords.push_back(tokens.back());
+  } else {
+    prefixes.push_back(tokens.back());
+  }
+}
+
+bool EventPredicate::empty() const {
+  return keywords.empty() && prefixes.empty();
+}
+
+bool EventPredicate::match(const char* body, size_t size) const {
+  if (empty()) {
+    return true;
+  }
+  std::vector<std::string> tokens;
+  EventIndex::tokenize(body, size, &tokens);
+  for (auto const& kw: keywords) {
+    if (std::find(tokens.begin(), tokens.end(), kw) == tokens.end()) {
+      return false;
+    }
+  }
+  for (auto const& prefix: prefixes) {
+    auto it = std::find_if(tokens.begin(), tokens.end(), [&prefix](std::string const& token) {
+      return token.compare(0, prefix.size(), prefix) == 0;
+    });
+    if (it == tokens.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----
+// Bloom
+// -----
+
+void EventIndex::Bloom::build(std::vector<u64> const& keys) {
+  size_t nbits = std::max(static_cast<size_t>(64), keys.size() * BITS_PER_KEY);
+  bits.assign((nbits + 63) / 64, 0);
+  nbits = bits.size() * 64;
+  for (auto key: keys) {
+    u64 h = key;
+    u64 delta = (key >> 33) | (key << 31) | 1;
+    for (int i = 0; i < NPROBES; i++) {
+      auto bit = h % nbits;
+      bits[bit / 64] |= 1ull << (bit % 64);
+      h += delta;
+    }
+  }
+}
+
+bool EventIndex::Bloom::contains(u64 key) const {
+  u64 nbits = bits.size() * 64;
+  u64 h = key;
+  u64 delta = (key >> 33) | (key << 31) | 1;
+  for (int i = 0; i < NPROBES; i++) {
+    auto bit = h % nbits;
+    if ((bits[bit / 64] & (1ull << (bit % 64))) == 0) {
+      return false;
+    }
+    h += delta;
+  }
+  return true;
+}
+
+// ----------
+// EventIndex
+// ----------
+
+EventIndex::EventIndex()
+    : size_(0) { }
+
+void EventIndex::tokenize(const char* body, size_t size, std::vector<std::string>* out) {
+  size_t i = 0;
+  while (i < size) {
+    while (i < size && !is_token_char(body[i])) {
+      i++;
+    }
+    if (i == size) {
+      break;
+    }
+    std::string token;
+    while (i < size && is_token_char(body[i])) {
+      token.push_back(to_lower(body[i]));
+      i++;
+    }
+    out->push_back(std::move(token));
+  }
+}
+
+u64 EventIndex::keyword_key(const char* token, size_t size) {
+  return common::MurmurHash64A(token, size, KEYWORD_SEED);
+}
+
+u64 EventIndex::prefix_key(const char* token, size_t size) {
+  return common::MurmurHash64A(token, size, PREFIX_SEED);
+}
+
+bool EventIndex::indexable(EventPredicate const& pred) {
+  if (pred.empty()) {
+    return false;
+  }
+  for (auto const& prefix: pred.prefixes) {
+    if (prefix.size() < MIN_PREFIX) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void EventIndex::add(ParamId id, Timestamp ts, const char* body, size_t size) {
+  std::vector<std::string> tokens;
+  tokenize(body, size, &tokens);
+  std::vector<u64> keys;
+  for (auto const& token: tokens) {
+    keys.push_back(keyword_key(token.data(), token.size()));
+    auto maxlen = std::min(token.size(), static_cast<size_t>(MAX_PREFIX));
+    for (size_t len = MIN_PREFIX; len <= maxlen; len++) {
+      keys.push_back(prefix_key(token.data(), len));
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  common::UniqueLock lock(lock_);
+  auto& series = series_[id];
+  if (series.gap_open) {
+    series.gap_open = false;
+    series.has_gap = ts > series.gap_begin;
+    series.gap_end = ts - 1;
+  }
+  if (series.has_last && ts <= series.last) {
+    if (ts == series.last) {
+      return;
+    }
+    // Out of order event, it will be scanned by every query
+    if (series.has_gap) {
+      series.gap_begin = std::min(series.gap_begin, ts);
+      series.gap_end = std::max(series.gap_end, ts);
+    } else {
+      series.has_gap = true;
+      series.gap_begin = series.gap_end = ts;
+    }
+    return;
+  }
+  series.has_last = true;
+  series.last = ts;
+  auto pos = static_cast<u32>(series.ts.size());
+  series.ts.push_back(ts);
+  for (auto key: keys) {
+    series.postings[key].push_back(pos);
+    series.superkeys.insert(key);
+  }
+  size_++;
+  if (series.ts.size() == BLOCK_SIZE) {
+    seal(&series);
+  }
+}
+
+void EventIndex::seal(Series* series) {
+  Block block;
+  block.begin = series->ts.front();
+  block.end = series->ts.back();
+  block.first = series->first;
+  std::vector<u64> keys;
+  keys.reserve(series->postings.size());
+  for (auto const& kv: series->postings) {
+    keys.push_back(kv.first);
+  }
+  block.bloom.build(keys);
+  series->blocks.push_back(std::move(block));
+  series->first += series->ts.size();
+  series->ts.clear();
+  series->postings.clear();
+  if (series->blocks.size() % SUPERBLOCK_SIZE == 0) {
+    std::vector<u64> superkeys(series->superkeys.begin(), series->superkeys.end());
+    Bloom bloom;
+    bloom.build(superkeys);
+    series->superblocks.push_back(std::move(bloom));
+    series->superkeys.clear();
+  }
+}
+
+void EventIndex::reset(ParamId id) {
+  common::UniqueLock lock(lock_);
+  auto& series = series_[id];
+  series.has_gap = true;
+  series.gap_open = true;
+  series.gap_begin = 0;
+  series.gap_end = std::numeric_limits<Timestamp>::max();
+}
+
+std::vector<EventIndex::Range> EventIndex::candidates(ParamId id,
+                                                      Timestamp begin,
+                                                      Timestamp end,
+                                                      EventPredicate const& pred) const {
+  Timestamp lo = std::min(begin, end);
+  Timestamp hi = std::max(begin, end);
+  std::vector<Range> result;
+  if (!indexable(pred)) {
+    result.push_back(std::make_pair(lo, hi));
+    return result;
+  }
+  std::vector<u64> keys;
+  for (auto const& kw: pred.keywords) {
+    keys.push_back(keyword_key(kw.data(), kw.size()));
+  }
+  for (auto const& prefix: pred.prefixes) {
+    keys.push_back(prefix_key(prefix.data(), std::min(prefix.size(), static_cast<size_t>(MAX_PREFIX))));
+  }
+  auto contains_all = [&keys](Bloom const& bloom) {
+    for (auto key: keys) {
+      if (!bloom.contains(key)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  common::SharedLock lock(lock_);
+  auto it = series_.find(id);
+  if (it == series_.end()) {
+    return result;
+  }
+  auto const& series = it->second;
+  std::vector<Candidate> cand;
+
+  // Sealed blocks
+  auto const& blocks = series.blocks;
+  for (size_t ix = 0; ix < blocks.size();) {
+    auto sbix = ix / SUPERBLOCK_SIZE;
+    if (ix % SUPERBLOCK_SIZE == 0 && sbix < series.superblocks.size()) {
+      auto last = ix + SUPERBLOCK_SIZE - 1;
+      if (blocks[ix].begin > hi) {
+        break;
+      }
+      if (blocks[last].end < lo || !contains_all(series.superblocks[sbix])) {
+        ix += SUPERBLOCK_SIZE;
+        continue;
+      }
+    }
+    auto const& block = blocks[ix];
+    if (block.begin > hi) {
+      break;
+    }
+    if (block.end >= lo && contains_all(block.bloom)) {
+      u64 next = ix + 1 < blocks.size() ? blocks[ix + 1].first : series.first;
+      Candidate c = { std::max(block.begin, lo), std::min(block.end, hi), block.first, next - 1 };
+      cand.push_back(c);
+    }
+    ix++;
+  }
+
+  // Open block
+  if (!series.ts.empty() && series.ts.front() <= hi && series.ts.back() >= lo) {
+    std::vector<std::vector<u32> const*> lists;
+    for (auto key: keys) {
+      auto pit = series.postings.find(key);
+      if (pit == series.postings.end()) {
+        lists.clear();
+        break;
+      }
+      lists.push_back(&pit->second);
+    }
+    if (!lists.empty()) {
+      std::sort(lists.begin(), lists.end(), [](std::vector<u32> const* a, std::vector<u32> const* b) {
+        return a->size() < b->size();
+      });
+      std::vector<u32> pos = *lists.front();
+      for (size_t i = 1; i < lists.size() && !pos.empty(); i++) {
+        intersect(*lists[i], &pos);
+      }
+      for (auto p: pos) {
+        auto ts = series.ts[p];
+        if (ts < lo || ts > hi) {
+          continue;
+        }
+        Candidate c = { ts, ts, series.first + p, series.first + p };
+        cand.push_back(c);
+      }
+    }
+  }
+
+  // Merge ranges of adjacent events
+  std::vector<Candidate> merged;
+  for (auto const& c: cand) {
+    if (!merged.empty() && merged.back().last + 1 == c.first) {
+      merged.back().end = c.end;
+      merged.back().last = c.last;
+    } else {
+      merged.push_back(c);
+    }
+  }
+  if (merged.size() > MAX_RANGES) {
+    // Too many small ranges, merge the ones that are separated by the
+    // smallest number of events
+    std::vector<std::pair<u64, size_t>> gaps;
+    for (size_t i = 1; i < merged.size(); i++) {
+      gaps.push_back(std::make_pair(merged[i].first - merged[i - 1].last, i));
+    }
+    auto nmerge = merged.size() - MAX_RANGES;
+    std::nth_element(gaps.begin(), gaps.begin() + static_cast<std::ptrdiff_t>(nmerge - 1), gaps.end());
+    std::vector<bool> join(merged.size(), false);
+    for (size_t i = 0; i < nmerge; i++) {
+      join[gaps[i].second] = true;
+    }
+    std::vector<Candidate> tmp;
+    for (size_t i = 0; i < merged.size(); i++) {
+      if (join[i]) {
+        tmp.back().end = merged[i].end;
+        tmp.back().last = merged[i].last;
+      } else {
+        tmp.push_back(merged[i]);
+      }
+    }
+    merged.swap(tmp);
+  }
+
+  for (auto const& c: merged) {
+    result.push_back(std::make_pair(c.begin, c.end));
+  }
+  if (series.has_gap) {
+    auto gap_end = series.gap_open ? std::numeric_limits<Timestamp>::max() : series.gap_end;
+    auto b = std::max(series.gap_begin, lo);
+    auto e = std::min(gap_end, hi);
+    if (b <= e) {
+      // Gap can overlap with the indexed ranges
+      std::vector<Range> tmp;
+      auto gap = std::make_pair(b, e);
+      auto pos = std::lower_bound(result.begin(), result.end(), gap);
+      result.insert(pos, gap);
+      for (auto const& r: result) {
+        if (!tmp.empty() && r.first <= tmp.back().second) {
+          tmp.back().second = std::max(tmp.back().second, r.second);
+        } else {
+          tmp.push_back(r);
+        }
+      }
+      result.swap(tmp);
+    }
+  }
+  return result;
+}
+
+size_t EventIndex::size() const {
+  common::SharedLock lock(lock_);
+  return size_;
+}
+
+}  // namespace storage
+}  // namespace stdb
@@ -0,0 +1,170 @@
+/**
+ * \file event_index.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Token index for event columns.
+ * Event bodies are split into lowercase alphanumeric tokens. Every token
+ * produces a keyword key and a set of prefix keys (prefixes of length
+ * MIN_PREFIX..MAX_PREFIX). Events of the series are grouped into blocks
+ * of BLOCK_SIZE events, the most recent (open) block stores exact postings
+ * lists, sealed blocks store only bloom filters. Every SUPERBLOCK_SIZE
+ * sealed blocks are summarized by the larger bloom filter, so the query
+ * can skip the whole group of blocks at once.
+ * Index returns time ranges that can contain matching events, the result
+ * should be verified using EventPredicate::match.
+ */
+#ifndef STDB_STORAGE_EVENT_INDEX_H_
+#define STDB_STORAGE_EVENT_INDEX_H_
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/common/rwlock.h"
+
+namespace stdb {
+namespace storage {
+
+/** Keyword and prefix predicate.
+ * Event matches if it contains all keywords as tokens and, for every prefix,
+ * at least one token that starts with the prefix. Empty predicate matches
+ * every event.
+ */
+struct EventPredicate {
+  std::vector<std::string> keywords;
+  std::vector<std::string> prefixes;
+
+  //! Add keyword (normalized, keyword with several tokens adds all of them)
+  void add_keyword(std::string const& keyword);
+
+  //! Add prefix (normalized)
+  void add_prefix(std::string const& prefix);
+
+  bool empty() const;
+
+  //! Check event body
+  bool match(const char* body, size_t size) const;
+};
+
+class EventIndex {
+ public:
+  enum {
+    //! Number of events in the block
+    BLOCK_SIZE = 1024,
+    //! Number of blocks in the superblock
+    SUPERBLOCK_SIZE = 32,
+    //! Shortest indexed prefix
+    MIN_PREFIX = 2,
+    //! Longest indexed prefix
+    MAX_PREFIX = 6,
+    //! Bloom filter size
+    BITS_PER_KEY = 10,
+    //! Number of bloom filter probes
+    NPROBES = 4,
+    //! Max number of ranges returned by `candidates` per series
+    MAX_RANGES = 1024,
+  };
+
+  //! Time range of the events [first, second] (both ends are inclusive)
+  typedef std::pair<Timestamp, Timestamp> Range;
+
+ private:
+  struct Bloom {
+    std::vector<u64> bits;
+
+    void build(std::vector<u64> const& keys);
+    bool contains(u64 key) const;
+  };
+
+  struct Block {
+    Timestamp begin;
+    Timestamp end;
+    //! Ordinal number of the first event of the block
+    u64       first;
+    Bloom     bloom;
+  };
+
+  struct Series {
+    //! Sealed blocks
+    std::vector<Block> blocks;
+    //! Superblock i covers blocks [i*SUPERBLOCK_SIZE, (i + 1)*SUPERBLOCK_SIZE)
+    std::vector<Bloom> superblocks;
+    //! Unique keys of the current superblock
+    std::unordered_set<u64> superkeys;
+    //! Open block (timestamps and postings lists with offsets)
+    std::vector<Timestamp> ts;
+    std::unordered_map<u64, std::vector<u32>> postings;
+    //! Ordinal number of the first event of the open block
+    u64       first = 0;
+    bool      has_last = false;
+    Timestamp last = 0;
+    //! Events from this range are not indexed and always returned as candidates
+    bool      has_gap = false;
+    Timestamp gap_begin = 0;
+    Timestamp gap_end = 0;
+    //! Gap ends right before the next indexed event
+    bool      gap_open = false;
+  };
+
+  std::unordered_map<ParamId, Series> series_;
+  size_t size_;
+  mutable common::RWLock lock_;
+
+  //! Seal open block of the series (lock should be held)
+  void seal(Series* series);
+
+ public:
+  EventIndex();
+
+  /** Add event to the index.
+   * Events of the series should be added in timestamp order. Event with the same
+   * timestamp as the previous one is ignored (so the same data can be added twice
+   * during backfill), older events are not indexed and become candidates of
+   * every query.
+   */
+  void add(ParamId id, Timestamp ts, const char* body, size_t size);
+
+  /** Mark all previously written events of the series as not indexed.
+   * Should be used when series data is opened after the index was created.
+   */
+  void reset(ParamId id);
+
+  /** Find time ranges that can contain matching events.
+   * @param begin is a beginning of the query range
+   * @param end is an end of the query range (`begin` > `end` for backward queries)
+   * @return ordered list of non-overlapping ranges (in forward order)
+   */
+  std::vector<Range> candidates(ParamId id, Timestamp begin, Timestamp end, EventPredicate const& pred) const;
+
+  //! Check that predicate can be served by the index
+  static bool indexable(EventPredicate const& pred);
+
+  //! Get number of indexed events
+  size_t size() const;
+
+  //! Split body into lowercase tokens
+  static void tokenize(const char* body, size_t size, std::vector<std::string>* out);
+
+  static u64 keyword_key(const char* token, size_t size);
+
+  static u64 prefix_key(const char* token, size_t size);
+};
+
+}  // namespace storage
+}  // namespace stdb
+
+#endif  // STDB_STORAGE_EVENT_INDEX_H_
@@ -0,0 +1,182 @@
+/*!
+ * \file event_index_test.cc
+ */
+#include "stdb/storage/event_index.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+namespace storage {
+
+typedef std::vector<std::pair<Timestamp, std::string>> Events;
+
+static Events generate_log(size_t nevents, u32 seed) {
+  const char* levels[] = { "INFO", "INFO", "INFO", "WARN", "ERROR" };
+  const char* components[] = { "http", "db", "cache", "scheduler" };
+  std::mt19937 gen(seed);
+  Events events;
+  for (size_t i = 0; i < nevents; i++) {
+    std::string body = levels[gen() % 5];
+    body += " [";
+    body += components[gen() % 4];
+    body += "] request_id=" + std::to_string(gen() % 100000);
+    if (gen() % 20000 == 0) {
+      body += " Timeout while connecting";
+    }
+    events.push_back(std::make_pair(static_cast<Timestamp>(1000 * (i + 1)), body));
+  }
+  return events;
+}
+
+static bool covered(std::vector<EventIndex::Range> const& ranges, Timestamp ts) {
+  for (auto const& r: ranges) {
+    if (r.first <= ts && ts <= r.second) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//! Check that every matching event is covered and return number of covered events
+static size_t check_candidates(EventIndex const& index, ParamId id, Events const& events,
+                               Timestamp begin, Timestamp end, EventPredicate const& pred) {
+  auto ranges = index.candidates(id, begin, end, pred);
+  for (size_t i = 1; i < ranges.size(); i++) {
+    EXPECT_LT(ranges[i - 1].second, ranges[i].first);
+  }
+  size_t ncovered = 0;
+  for (auto const& kv: events) {
+    if (kv.first < std::min(begin, end) || kv.first > std::max(begin, end)) {
+      continue;
+    }
+    bool match = pred.match(kv.second.data(), kv.second.size());
+    bool cover = covered(ranges, kv.first);
+    if (match) {
+      EXPECT_TRUE(cover) << kv.second;
+    }
+    ncovered += cover;
+  }
+  return ncovered;
+}
+
+TEST(TestEventIndex, Test_tokenize_and_match) {
+  std::vector<std::string> tokens;
+  std::string body = "ERROR [http] Connection-Timeout, code=504";
+  EventIndex::tokenize(body.data(), body.size(), &tokens);
+  EXPECT_EQ(std::vector<std::string>({ "error", "http", "connection", "timeout", "code", "504" }), tokens);
+
+  EventPredicate pred;
+  pred.add_keyword("Timeout");
+  EXPECT_TRUE(pred.match(body.data(), body.size()));
+  pred.add_prefix("conn");
+  EXPECT_TRUE(pred.match(body.data(), body.size()));
+  pred.add_prefix("db");
+  EXPECT_FALSE(pred.match(body.data(), body.size()));
+
+  // Keyword should match the whole token
+  EventPredicate partial;
+  partial.add_keyword("time");
+  EXPECT_FALSE(partial.match(body.data(), body.size()));
+
+  // Prefix with several tokens
+  EventPredicate multi;
+  multi.add_prefix("connection-time");
+  EXPECT_EQ(std::vector<std::string>({ "connection" }), multi.keywords);
+  EXPECT_EQ(std::vector<std::string>({ "time" }), multi.prefixes);
+  EXPECT_TRUE(multi.match(body.data(), body.size()));
+}
+
+TEST(TestEventIndex, Test_candidates_cover_all_matches) {
+  // Several superblocks and an open block
+  auto events = generate_log(80000, 1);
+  EventIndex index;
+  for (auto const& kv: events) {
+    index.add(42, kv.first, kv.second.data(), kv.second.size());
+  }
+  EXPECT_EQ(events.size(), index.size());
+
+  EventPredicate timeout;
+  timeout.add_keyword("timeout");
+  auto n = check_candidates(index, 42, events, 0, 100000000, timeout);
+  // Rare keyword, most of the blocks should be skipped
+  EXPECT_LT(n, events.size() / 4);
+
+  EventPredicate error_db;
+  error_db.add_keyword("error");
+  error_db.add_prefix("da");
+  check_candidates(index, 42, events, 0, 100000000, error_db);
+  // Keyword that doesn't exist
+  EventPredicate missing;
+  missing.add_keyword("segfault");
+  EXPECT_EQ(0u, check_candidates(index, 42, events, 0, 100000000, missing));
+  // Subrange and backward direction
+  check_candidates(index, 42, events, 20000000, 70000000, timeout);
+  check_candidates(index, 42, events, 79500000, 12345000, timeout);
+
+  // Short prefix can't be served by the index
+  EventPredicate short_prefix;
+  short_prefix.add_prefix("t");
+  EXPECT_FALSE(EventIndex::indexable(short_prefix));
+  EXPECT_EQ(events.size(), check_candidates(index, 42, events, 0, 100000000, short_prefix));
+
+  // Unknown series doesn't have events
+  EXPECT_TRUE(index.candidates(43, 0, 100000000, timeout).empty());
+}
+
+TEST(TestEventIndex, Test_exact_postings_in_open_block) {
+  EventIndex index;
+  Events events = {
+    { 1000, "INFO started" },
+    { 2000, "ERROR disk full" },
+    { 3000, "ERROR disk full" },
+    { 4000, "INFO ok" },
+    { 5000, "ERROR network" },
+  };
+  for (auto const& kv: events) {
+    index.add(1, kv.first, kv.second.data(), kv.second.size());
+  }
+  EventPredicate pred;
+  pred.add_keyword("error");
+  auto ranges = index.candidates(1, 0, 10000, pred);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(std::make_pair(Timestamp(2000), Timestamp(3000)), ranges[0]);
+  EXPECT_EQ(std::make_pair(Timestamp(5000), Timestamp(5000)), ranges[1]);
+
+  pred.add_prefix("net");
+  ranges = index.candidates(1, 0, 10000, pred);
+  ASSERT_EQ(1u, ranges.size());
+  EXPECT_EQ(std::make_pair(Timestamp(5000), Timestamp(5000)), ranges[0]);
+}
+
+TEST(TestEventIndex, Test_unindexed_events) {
+  EventIndex index;
+  std::string info = "INFO ok";
+  std::string error = "ERROR fail";
+  EventPredicate pred;
+  pred.add_keyword("error");
+
+  // Data written before the index was enabled
+  index.reset(1);
+  index.add(1, 5000, info.data(), info.size());
+  index.add(1, 6000, error.data(), error.size());
+  auto ranges = index.candidates(1, 0, 10000, pred);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(std::make_pair(Timestamp(0), Timestamp(4999)), ranges[0]);
+  EXPECT_EQ(std::make_pair(Timestamp(6000), Timestamp(6000)), ranges[1]);
+
+  // Duplicate is ignored, late event is always scanned
+  index.add(1, 6000, error.data(), error.size());
+  index.add(1, 7000, info.data(), info.size());
+  index.add(1, 5500, info.data(), info.size());
+  EXPECT_EQ(3u, index.size());
+  ranges = index.candidates(1, 0, 10000, pred);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(std::make_pair(Timestamp(0), Timestamp(5500)), ranges[0]);
+}
+
+}  // namespace storage
+}  // namespace stdb
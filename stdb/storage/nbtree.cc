@@ -27,6 +27,7 @@
 
 #include "operators/scan.h"
 #include "operators/aggregate.h"
+#include "operators/kernels.h"
 
 namespace stdb {
 namespace storage {
@@ -125,6 +126,38 @@ static std::tuple<common::Status, std::unique_ptr<IOVecBlock>> read_and_check(st
 }
 
 
+//! Read many blocks from blockstore, checksums are verified using the batch API.
+static std::vector<std::tuple<common::Status, std::unique_ptr<IOVecBlock>>> read_and_check_all(
+    std::shared_ptr<BlockStore> bstore, const std::vector<LogicAddr>& addrs) {
+  std::vector<std::tuple<common::Status, std::unique_ptr<IOVecBlock>>> result;
+  std::vector<u8 const*> data;
+  std::vector<size_t> sizes;
+  std::vector<size_t> index;
+  for (auto addr: addrs) {
+    common::Status status;
+    std::unique_ptr<IOVecBlock> block;
+    std::tie(status, block) = bstore->read_iovec_block(addr);
+    if (status.IsOk() && block->get_size(0) == STDB_BLOCK_SIZE) {
+      SubtreeRef const* subtree = block->get_cheader<SubtreeRef>();
+      data.push_back(block->get_cdata(0) + sizeof(SubtreeRef));
+      sizes.push_back(subtree->payload_size);
+      index.push_back(result.size());
+    }
+    result.push_back(std::make_tuple(status, std::move(block)));
+  }
+  std::vector<u32> crcs(data.size(), 0);
+  bstore->checksum(data.data(), sizes.data(), crcs.data(), data.size());
+  for (size_t i = 0; i < index.size(); i++) {
+    auto& item = result.at(index[i]);
+    SubtreeRef const* subtree = std::get<1>(item)->get_cheader<SubtreeRef>();
+    if (crcs[i] != subtree->checksum) {
+      LOG(ERROR) << "Invalid checksum (addr: " << addrs.at(index[i]) << ", level: " << subtree->level << ")";
+      std::get<0>(item) = common::Status::BadData("");
+    }
+  }
+  return result;
+}
+
 //! Read block from blockstore with all the checks. Panic on error!
 static std::unique_ptr<IOVecBlock> read_iovec_block_from_bstore(std::shared_ptr<BlockStore> bstore, LogicAddr curr) {
   common::Status status;
@@ -260,6 +293,11 @@ struct NBTreeLeafIterator : RealValuedOperator {
       return;
     }
     status_ = node.read_all(&tsbuf_, &xsbuf_);
+    if (status_.IsOk() && tsbuf_.empty()) {
+      // Empty leaf of the reopened tree
+      status_ = common::Status::NoData("");
+      return;
+    }
     if (status_.IsOk()) {
       if (begin_ < end_) {
         // FWD direction
@@ -377,47 +415,40 @@ struct NBTreeLeafFilter : RealValuedOperator {
       status_ = common::Status::NoData("");
       return;
     }
+    RangeOverlap overlap = filter_.get_overlap(*node.get_leafmeta());
+    if (overlap == RangeOverlap::NO_OVERLAP) {
+      // Leaf metadata shows that no value can pass the filter
+      status_ = common::Status::NoData("");
+      return;
+    }
     std::vector<Timestamp> tss;
     std::vector<double>        xss;
     status_ = node.read_all(&tss, &xss);
-    ssize_t from = 0, to = 0;
     if (status_.IsOk()) {
+      // Find the [from, to) range of the leaf that should be returned
+      size_t from = 0, to = 0;
       if (begin_ < end_) {
         // FWD direction
-        auto it_begin = std::lower_bound(tss.begin(), tss.end(), begin_);
-        if (it_begin != tss.end()) {
-          from = std::distance(tss.begin(), it_begin);
-        } else {
-          from = 0;
-          assert(tss.front() > begin_);
-        }
-
-        auto it_end = std::lower_bound(tss.begin(), tss.end(), end_);
-        to = std::distance(tss.begin(), it_end);
-
-        for (ssize_t ix = from; ix < to; ix++){
-          if (filter_.match(xss[ix])) {
-            tsbuf_.push_back(tss[ix]);
-            xsbuf_.push_back(xss[ix]);
-          }
-        }
+        from = std::distance(tss.begin(), std::lower_bound(tss.begin(), tss.end(), begin_));
+        to = std::distance(tss.begin(), std::lower_bound(tss.begin(), tss.end(), end_));
       } else {
-        // BWD direction
-        auto it_begin = std::lower_bound(tss.begin(), tss.end(), begin_);
-        if (it_begin != tss.end()) {
-          from = std::distance(tss.begin(), it_begin);
-        } else {
-          from = tss.size() - 1;
+        // BWD direction, begin_ is included and end_ is excluded
+        from = std::distance(tss.begin(), std::upper_bound(tss.begin(), tss.end(), end_));
+        to = std::distance(tss.begin(), std::upper_bound(tss.begin(), tss.end(), begin_));
+      }
+      if (from < to) {
+        tsbuf_.assign(tss.begin() + from, tss.begin() + to);
+        xsbuf_.assign(xss.begin() + from, xss.begin() + to);
+        if (overlap == RangeOverlap::PARTIAL_OVERLAP) {
+          // Filter in place, all values of the leaf pass the filter if the overlap is full
+          size_t n = get_filter_kernel()(filter_, tsbuf_.data(), xsbuf_.data(), tsbuf_.size(),
+                                         tsbuf_.data(), xsbuf_.data());
+          tsbuf_.resize(n);
+          xsbuf_.resize(n);
         }
-
-        auto it_end = std::upper_bound(tss.begin(), tss.end(), end_);
-        to = std::distance(tss.begin(), it_end);
-
-        for (ssize_t ix = from; ix >= to; ix--){
-          if (filter_.match(xss[ix])) {
-            tsbuf_.push_back(tss[ix]);
-            xsbuf_.push_back(xss[ix]);
-          }
+        if (begin_ > end_) {
+          std::reverse(tsbuf_.begin(), tsbuf_.end());
+          std::reverse(xsbuf_.begin(), xsbuf_.end());
         }
       }
     }
@@ -921,6 +952,8 @@ ValueAggregator::Direction ValueAggregator::get_direction() {
  */
 class NBTreeSBlockAggregatorImpl : public NBTreeSBlockIteratorBase<AggregationResult> {
   bool &leftmost_leaf_found_;
+  //! Leaf nodes are not read, their aggregates are extrapolated from subtree refs
+  bool approximate_;
 
  public:
   template<class SuperblockT>
@@ -928,17 +961,21 @@ class NBTreeSBlockAggregatorImpl : public NBTreeSBlockIteratorBase<AggregationRe
                              SuperblockT const& sblock,
                              Timestamp begin,
                              Timestamp end,
-                             bool &leftmost_leaf_found)
+                             bool &leftmost_leaf_found,
+                             bool approximate)
       : NBTreeSBlockIteratorBase<AggregationResult>(bstore, sblock, begin, end)
-        , leftmost_leaf_found_(leftmost_leaf_found) { }
+        , leftmost_leaf_found_(leftmost_leaf_found)
+        , approximate_(approximate) { }
 
   NBTreeSBlockAggregatorImpl(std::shared_ptr<BlockStore> bstore,
                              LogicAddr addr,
                              Timestamp begin,
                              Timestamp end,
-                             bool& leftmost_leaf_found)
+                             bool& leftmost_leaf_found,
+                             bool approximate)
       : NBTreeSBlockIteratorBase<AggregationResult>(bstore, addr, begin, end)
-        , leftmost_leaf_found_(leftmost_leaf_found) { }
+        , leftmost_leaf_found_(leftmost_leaf_found)
+        , approximate_(approximate) { }
 
   virtual std::tuple<common::Status, std::unique_ptr<AggregateOperator>> make_leaf_iterator(const SubtreeRef &ref) override;
   virtual std::tuple<common::Status, std::unique_ptr<AggregateOperator>> make_superblock_iterator(const SubtreeRef &ref) override;
@@ -993,11 +1030,40 @@ std::tuple<common::Status, size_t> NBTreeSBlockAggregatorImpl::read(Timestamp *d
   return std::make_tuple(status, size);
 }
 
+/** Estimate aggregates of the part of the subtree that belongs to [begin, end) range.
+ * Values are assumed to be spread uniformly in time. Count and sum are scaled by
+ * the fraction of the subtree's time range that overlaps with the search range,
+ * other components are taken from the whole subtree.
+ */
+static AggregationResult extrapolate_subtree(SubtreeRef const& ref, Timestamp begin, Timestamp end) {
+  AggregationResult agg = INIT_AGGRES;
+  agg.copy_from(ref);
+  if (begin <= ref.begin && ref.end < end) {
+    return agg;
+  }
+  Timestamp lo = std::max(begin, ref.begin);
+  Timestamp hi = std::min(end - 1, ref.end);
+  double frac = (static_cast<double>(hi - lo) + 1.0) / (static_cast<double>(ref.end - ref.begin) + 1.0);
+  agg.cnt *= frac;
+  agg.sum *= frac;
+  agg._begin = lo;
+  agg._end = hi;
+  return agg;
+}
+
 std::tuple<common::Status, std::unique_ptr<AggregateOperator>> NBTreeSBlockAggregatorImpl::make_leaf_iterator(SubtreeRef const& ref) {
   if (!bstore_->exists(ref.addr)) {
     TIter empty;
     return std::make_tuple(common::Status::Unavailable(""), std::move(empty));
   }
+  if (approximate_) {
+    // Leaf exists, so the refs that follow it are up to date and can be used
+    // without reading the nodes.
+    leftmost_leaf_found_ = true;
+    std::unique_ptr<AggregateOperator> result;
+    result.reset(new ValueAggregator(ref.end, extrapolate_subtree(ref, begin_, end_), get_direction()));
+    return std::make_tuple(common::Status::Ok(), std::move(result));
+  }
   common::Status status;
   std::unique_ptr<IOVecBlock> block;
   std::tie(status, block) = read_and_check(bstore_, ref.addr);
@@ -1027,7 +1093,7 @@ std::tuple<common::Status, std::unique_ptr<AggregateOperator>> NBTreeSBlockAggre
     agg.copy_from(ref);
     result.reset(new ValueAggregator(ref.end, agg, get_direction()));
   } else {
-    result.reset(new NBTreeSBlockAggregatorImpl(bstore_, ref.addr, begin_, end_, leftmost_leaf_found_));
+    result.reset(new NBTreeSBlockAggregatorImpl(bstore_, ref.addr, begin_, end_, leftmost_leaf_found_, approximate_));
   }
   return std::make_tuple(common::Status::Ok(), std::move(result));
 }
@@ -1040,18 +1106,20 @@ struct NBTreeSBlockAggregator : SeriesOperator<AggregationResult> {
   NBTreeSBlockAggregator(std::shared_ptr<BlockStore> bstore,
                          SuperblockT const& sblock,
                          Timestamp begin,
-                         Timestamp end)
+                         Timestamp end,
+                         bool approximate = false)
      : leftmost_leaf_found_(std::min(begin, end) == STDB_MIN_TIMESTAMP && std::max(begin, end) == STDB_MAX_TIMESTAMP)
-       , impl_(bstore, sblock, std::min(begin, end), std::max(begin, end), leftmost_leaf_found_)
+       , impl_(bstore, sblock, std::min(begin, end), std::max(begin, end), leftmost_leaf_found_, approximate)
   {
   }
 
   NBTreeSBlockAggregator(std::shared_ptr<BlockStore> bstore,
                          LogicAddr addr,
                          Timestamp begin,
-                         Timestamp end)
+                         Timestamp end,
+                         bool approximate = false)
       : leftmost_leaf_found_(std::min(begin, end) == STDB_MIN_TIMESTAMP && std::max(begin, end) == STDB_MAX_TIMESTAMP)
-        , impl_(bstore, addr, std::min(begin, end), std::max(begin, end), leftmost_leaf_found_)
+        , impl_(bstore, addr, std::min(begin, end), std::max(begin, end), leftmost_leaf_found_, approximate)
   {
   }
   
@@ -1152,33 +1220,19 @@ std::tuple<common::Status, size_t> NBTreeLeafGroupAggregator::read(Timestamp *de
       return std::make_tuple(common::Status::NoData(""), 0);
     }
     assert(out_size == size_hint);
-    int valcnt = 0;
-    AggregationResult outval = INIT_AGGRES;
     const bool forward = begin_ < end_;
-    u64 bin = 0;
-    for (size_t ix = 0; ix < out_size; ix++) {
-      Timestamp normts = forward ? ts[ix] - begin_ : begin_ - ts[ix];
-      if (valcnt == 0) {
-        bin = normts / step_;
-      } else if (normts / step_ != bin) {
-        bin = normts / step_;
-        destxs[outix] = outval;
-        destts[outix] = outval._begin;
-        outix++;
-        outval = INIT_AGGRES;
-      }
-      valcnt++;
-      outval.add(ts[ix], xs[ix], forward);
+    std::vector<u32> bounds(out_size);
+    auto nbuckets = split_buckets(ts.data(), out_size, begin_, step_, forward, bounds.data());
+    size_t first = 0;
+    for (size_t i = 0; i < nbuckets; i++) {
+      AggregationResult outval = INIT_AGGRES;
+      outval.do_the_math(ts.data() + first, xs.data() + first, bounds[i] - first, !forward);
       // Check invariant
-      auto delta = outval._end - outval._begin;
-      if (delta > step_) {
-        assert(delta <= step_);
-      }
-    }
-    if (outval.cnt > 0) {
+      assert(outval._end - outval._begin <= step_);
       destxs[outix] = outval;
       destts[outix] = outval._begin;
       outix++;
+      first = bounds[i];
     }
   }
   assert(outix <= size);
@@ -1629,13 +1683,26 @@ class BinaryDataIterator : public BinaryDataOperator {
 
 class BinaryDataFilter : public BinaryDataOperator {
   std::unique_ptr<BinaryDataOperator> it_;
+  bool has_regex_;
   std::regex regex_;
+  EventPredicate pred_;
 
  public:
   BinaryDataFilter(std::unique_ptr<BinaryDataOperator> base, const std::string& regex)
       : it_(std::move(base))
+        , has_regex_(true)
         , regex_(regex.data(), std::regex_constants::ECMAScript) { }
 
+  //! Keyword predicate is checked first, regex (if not empty) only for matching events
+  BinaryDataFilter(std::unique_ptr<BinaryDataOperator> base, const std::string& regex, EventPredicate const& pred)
+      : it_(std::move(base))
+        , has_regex_(!regex.empty())
+        , pred_(pred) {
+    if (has_regex_) {
+      regex_ = std::regex(regex.data(), std::regex_constants::ECMAScript);
+    }
+  }
+
   virtual std::tuple<common::Status, size_t> read(Timestamp *destts, std::string *destxs, size_t size) {
     Timestamp ts;
     std::string   xs;
@@ -1652,7 +1719,7 @@ class BinaryDataFilter : public BinaryDataOperator {
         }
       }
       if (len == 1) {
-        if (std::regex_search(xs, regex_)) {
+        if (pred_.match(xs.data(), xs.size()) && (!has_regex_ || std::regex_search(xs, regex_))) {
           outlen++;
           *destts++ = ts;
           *destxs++ = xs;
@@ -1808,6 +1875,10 @@ LogicAddr IOVecLeaf::get_addr() const {
   return block_->get_addr();
 }
 
+std::unique_ptr<IOVecBlock> IOVecLeaf::copy_block() const {
+  return clone(block_);
+}
+
 LogicAddr IOVecLeaf::get_prev_addr() const {
   // Should be set correctly no metter how IOVecLeaf was created.
   return prev_;
@@ -2129,6 +2200,14 @@ std::unique_ptr<AggregateOperator> IOVecSuperblock::aggregate(Timestamp begin,
   return result;
 }
 
+std::unique_ptr<AggregateOperator> IOVecSuperblock::approximate_aggregate(Timestamp begin,
+                                                                          Timestamp end,
+                                                                          std::shared_ptr<BlockStore> bstore) const {
+  std::unique_ptr<AggregateOperator> result;
+  result.reset(new NBTreeSBlockAggregator(bstore, *this, begin, end, true));
+  return result;
+}
+
 std::unique_ptr<AggregateOperator> IOVecSuperblock::candlesticks(Timestamp begin,
                                                                  Timestamp end,
                                                                  std::shared_ptr<BlockStore> bstore,
@@ -2233,6 +2312,7 @@ struct NBTreeLeafExtent : NBTreeExtent {
                                                      Timestamp end,
                                                      const ValueFilter& filter) const override;
   virtual std::unique_ptr<AggregateOperator> aggregate(Timestamp begin, Timestamp end) const override;
+  virtual std::unique_ptr<AggregateOperator> approximate_aggregate(Timestamp begin, Timestamp end) const override;
   virtual std::unique_ptr<AggregateOperator> candlesticks(Timestamp begin, Timestamp end, NBTreeCandlestickHint hint) const override;
   virtual std::unique_ptr<AggregateOperator> group_aggregate(Timestamp begin, Timestamp end, u64 step) const override;
   virtual bool is_dirty() const override;
@@ -2388,6 +2468,7 @@ std::tuple<bool, LogicAddr> NBTreeLeafExtent::commit(bool final) {
     if (!final || roots_collection->_get_roots().size() > next_level) {
       parent_saved = roots_collection->append(payload);
     }
+    roots_collection->on_leaf_commit(*leaf_);
   } else {
     // Invariant broken.
     // Roots collection was destroyed before write process
@@ -2425,6 +2506,11 @@ std::unique_ptr<AggregateOperator> NBTreeLeafExtent::aggregate(Timestamp begin,
   return leaf_->aggregate(begin, end);
 }
 
+std::unique_ptr<AggregateOperator> NBTreeLeafExtent::approximate_aggregate(Timestamp begin, Timestamp end) const {
+  // Leaf extent is stored in memory, exact aggregate is cheap
+  return leaf_->aggregate(begin, end);
+}
+
 std::unique_ptr<AggregateOperator> NBTreeLeafExtent::candlesticks(Timestamp begin, Timestamp end, NBTreeCandlestickHint hint) const {
   return leaf_->candlesticks(begin, end, hint);
 }
@@ -2528,6 +2614,7 @@ struct NBTreeSBlockExtent : NBTreeExtent {
                                                      Timestamp end,
                                                      const ValueFilter& filter) const override;
   virtual std::unique_ptr<AggregateOperator> aggregate(Timestamp begin, Timestamp end) const override;
+  virtual std::unique_ptr<AggregateOperator> approximate_aggregate(Timestamp begin, Timestamp end) const override;
   virtual std::unique_ptr<AggregateOperator> candlesticks(Timestamp begin, Timestamp end, NBTreeCandlestickHint hint) const override;
   virtual std::unique_ptr<AggregateOperator> group_aggregate(Timestamp begin, Timestamp end, u64 step) const override;
   virtual bool is_dirty() const override;
@@ -2716,6 +2803,10 @@ std::unique_ptr<AggregateOperator> NBTreeSBlockExtent::aggregate(Timestamp begin
   return curr_->aggregate(begin, end, bstore_);
 }
 
+std::unique_ptr<AggregateOperator> NBTreeSBlockExtent::approximate_aggregate(Timestamp begin, Timestamp end) const {
+  return curr_->approximate_aggregate(begin, end, bstore_);
+}
+
 std::unique_ptr<AggregateOperator> NBTreeSBlockExtent::candlesticks(Timestamp begin, Timestamp end, NBTreeCandlestickHint hint) const {
   return curr_->candlesticks(begin, end, bstore_, hint);
 }
@@ -2745,6 +2836,11 @@ static void check_superblock_consistency(std::shared_ptr<BlockStore> bstore,
   std::vector<LogicAddr> nodes2follow;
   // Check nodes.
   size_t nelements = sblock->nelements();
+  std::vector<LogicAddr> addrs;
+  for (size_t i = 0; i < nelements; i++) {
+    addrs.push_back(refs[i].addr);
+  }
+  auto blocks = read_and_check_all(bstore, addrs);
   int nerrors = 0;
   for (size_t i = 0; i < nelements; i++) {
     if (check_backrefs) {
@@ -2763,9 +2859,9 @@ static void check_superblock_consistency(std::shared_ptr<BlockStore> bstore,
         nerrors++;
       }
     }
-    // Try to read block and check stats
+    // Check stats of the block
     std::unique_ptr<IOVecBlock> block;
-    std::tie(status, block) = read_and_check(bstore, refs[i].addr);
+    std::tie(status, block) = std::move(blocks[i]);
     if (status.Code() == common::Status::kUnavailable) {
       // block was deleted due to retention.
       LOG(INFO) << "Block " + std::to_string(refs[i].addr);
@@ -2874,7 +2970,8 @@ NBTreeExtentsList::NBTreeExtentsList(ParamId id, std::vector<LogicAddr> addresse
     , last_(0ull)
     , rescue_points_(std::move(addresses))
     , initialized_(false)
-    , write_count_(0ul) {
+    , write_count_(0ul)
+    , has_events_(false) {
   if (rescue_points_.size() >= std::numeric_limits<u16>::max()) {
     LOG(FATAL) << "Tree depth is too large";
   }
@@ -2895,7 +2992,7 @@ std::tuple<size_t, size_t> NBTreeExtentsList::bytes_used() const {
 }
 
 void NBTreeExtentsList::force_init() {
-  common::UniqueLock lock(lock_);
+  common::BiasedUniqueLock lock(lock_);
   if (!initialized_) {
     init();
   }
@@ -2914,7 +3011,7 @@ size_t NBTreeExtentsList::_get_uncommitted_size() const {
 }
 
 bool NBTreeExtentsList::is_initialized() const {
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   return initialized_;
 }
 
@@ -2930,38 +3027,47 @@ std::vector<NBTreeExtent const*> NBTreeExtentsList::get_extents() const {
 }
 
 NBTreeAppendResult NBTreeExtentsList::append(Timestamp ts, double value, bool allow_duplicate_timestamps) {
-  common::UniqueLock lock(lock_);  // NOTE: NBTreeExtentsList::append(subtree) can be called from here
-  //       recursively (maybe even many times).
-  if (!initialized_) {
-    init();
-  }
-  if (allow_duplicate_timestamps ? ts < last_ : ts <= last_) {
-    return NBTreeAppendResult::FAIL_LATE_WRITE;
-  }
-  last_ = ts;
-  write_count_++;
-  if (extents_.size() == 0) {
-    // create first leaf node
-    std::unique_ptr<NBTreeExtent> leaf;
-    leaf.reset(new NBTreeLeafExtent(bstore_, shared_from_this(), id_, EMPTY_ADDR));
-    extents_.push_back(std::move(leaf));
-    rescue_points_.push_back(EMPTY_ADDR);
-  }
   auto result = NBTreeAppendResult::OK;
-  bool parent_saved = false;
-  LogicAddr addr = EMPTY_ADDR;
-  std::tie(parent_saved, addr) = extents_.front()->append(ts, value);
-  if (addr != EMPTY_ADDR) {
-    // We need to clear the rescue point since the address is already
-    // persisted.
-    // addr = parent_saved ? EMPTY_ADDR : addr;
-    if (rescue_points_.size() > 0) {
-      rescue_points_.at(0) = addr;
-    } else {
-      rescue_points_.push_back(addr);
+  std::vector<std::unique_ptr<IOVecBlock>> leaves;
+  std::shared_ptr<NBTreeLeafListener> listener;
+  {
+    common::BiasedUniqueLock lock(lock_);  // NOTE: NBTreeExtentsList::append(subtree) can be called from here
+    //       recursively (maybe even many times).
+    if (!initialized_) {
+      init();
+    }
+    if (allow_duplicate_timestamps ? ts < last_ : ts <= last_) {
+      return NBTreeAppendResult::FAIL_LATE_WRITE;
+    }
+    last_ = ts;
+    write_count_++;
+    if (extents_.size() == 0) {
+      // create first leaf node
+      std::unique_ptr<NBTreeExtent> leaf;
+      leaf.reset(new NBTreeLeafExtent(bstore_, shared_from_this(), id_, EMPTY_ADDR));
+      extents_.push_back(std::move(leaf));
+      rescue_points_.push_back(EMPTY_ADDR);
+    }
+    bool parent_saved = false;
+    LogicAddr addr = EMPTY_ADDR;
+    std::tie(parent_saved, addr) = extents_.front()->append(ts, value);
+    if (addr != EMPTY_ADDR) {
+      // We need to clear the rescue point since the address is already
+      // persisted.
+      // addr = parent_saved ? EMPTY_ADDR : addr;
+      if (rescue_points_.size() > 0) {
+        rescue_points_.at(0) = addr;
+      } else {
+        rescue_points_.push_back(addr);
+      }
+      result = NBTreeAppendResult::OK_FLUSH_NEEDED;
+    }
+    if (!pending_leaves_.empty()) {
+      std::swap(leaves, pending_leaves_);
+      listener = listener_;
     }
-    result = NBTreeAppendResult::OK_FLUSH_NEEDED;
   }
+  notify_listener(listener, std::move(leaves));
   return result;
 }
 
@@ -2981,6 +3087,7 @@ NBTreeAppendResult NBTreeExtentsList::append(Timestamp ts, const u8* blob, u32 s
   if (size == 0 || size > STDB_LIMITS_MAX_EVENT_LEN) {
     return NBTreeAppendResult::FAIL_BAD_VALUE;
   }
+  has_events_ = true;
   Timestamp basets = (ts / 1000) * 1000;
   u32 tsrem = static_cast<u32>(ts - basets);  // Invariant: (ts - basets) < 1000
   double head;
@@ -3011,6 +3118,38 @@ NBTreeAppendResult NBTreeExtentsList::append(Timestamp ts, const u8* blob, u32 s
   return outres;
 }
 
+void NBTreeExtentsList::set_leaf_listener(std::shared_ptr<NBTreeLeafListener> listener) {
+  common::BiasedUniqueLock lock(lock_);
+  listener_ = std::move(listener);
+}
+
+void NBTreeExtentsList::on_leaf_commit(IOVecLeaf const& leaf) {
+  // NOTE: called from leaf commit, lock is already held. The node is only
+  // copied here, it is decoded and indexed by `notify_listener` outside of the lock.
+  if (!listener_ || is_event_column()) {
+    return;
+  }
+  pending_leaves_.push_back(leaf.copy_block());
+}
+
+void NBTreeExtentsList::notify_listener(std::shared_ptr<NBTreeLeafListener> const& listener,
+                                        std::vector<std::unique_ptr<IOVecBlock>> leaves) const {
+  if (!listener) {
+    return;
+  }
+  for (auto& block: leaves) {
+    std::vector<Timestamp> ts;
+    std::vector<double> xs;
+    IOVecLeaf leaf(std::move(block));
+    auto status = leaf.read_all(&ts, &xs);
+    if (!status.IsOk()) {
+      LOG(ERROR) << "Can't read committed leaf node, id=" << id_ << ", " << status.ToString();
+      continue;
+    }
+    listener->on_leaf_commit(id_, ts, xs);
+  }
+}
+
 bool NBTreeExtentsList::append(const SubtreeRef &pl) {
   // NOTE: this method should be called by extents which
   //       is called by another `append` overload recursively
@@ -3267,7 +3406,7 @@ std::unique_ptr<RealValuedOperator> NBTreeExtentsList::search(Timestamp begin, T
   if (!initialized_) {
     const_cast<NBTreeExtentsList*>(this)->force_init();
   }
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   std::vector<std::unique_ptr<RealValuedOperator>> iterators;
   if (extents_.empty()) {
     iterators.emplace_back(new EmptyIterator(begin, end));
@@ -3294,7 +3433,7 @@ std::unique_ptr<BinaryDataOperator> NBTreeExtentsList::search_binary(Timestamp b
   if (!initialized_) {
     const_cast<NBTreeExtentsList*>(this)->force_init();
   }
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   std::vector<std::unique_ptr<RealValuedOperator>> iterators;
   if (extents_.empty()) {
     iterators.emplace_back(new EmptyIterator(begin, end));
@@ -3326,13 +3465,64 @@ std::unique_ptr<BinaryDataOperator> NBTreeExtentsList::filter_binary(Timestamp b
   return op;
 }
 
+std::unique_ptr<BinaryDataOperator> NBTreeExtentsList::filter_binary(Timestamp begin,
+                                                                     Timestamp end,
+                                                                     const std::string& regex,
+                                                                     EventPredicate const& pred) const {
+  auto it = search_binary(begin, end);
+  std::unique_ptr<BinaryDataOperator> op;
+  op.reset(new BinaryDataFilter(std::move(it), regex, pred));
+  return op;
+}
+
+std::unique_ptr<BinaryDataOperator> NBTreeExtentsList::filter_binary(Timestamp begin,
+                                                                     Timestamp end,
+                                                                     std::vector<EventIndex::Range> const& ranges,
+                                                                     const std::string& regex,
+                                                                     EventPredicate const& pred) const {
+  // Event with timestamp `ts` is stored as a header element with timestamp
+  // `ts / 1000 * 1000` followed by the body elements (less than 1000).
+  std::vector<std::unique_ptr<RealValuedOperator>> iterators;
+  if (begin < end) {
+    for (auto const& range: ranges) {
+      Timestamp first = std::max(begin, range.first / 1000 * 1000);
+      Timestamp last = std::min(end, range.second / 1000 * 1000 + 1000);
+      if (first < last) {
+        iterators.push_back(search(first, last));
+      }
+    }
+  } else {
+    for (auto it = ranges.rbegin(); it != ranges.rend(); it++) {
+      Timestamp first = std::max(end + 1, it->first / 1000 * 1000);
+      Timestamp last = std::min(begin, it->second / 1000 * 1000 + 999);
+      if (first <= last) {
+        iterators.push_back(search(last, first - 1));
+      }
+    }
+  }
+  if (iterators.empty()) {
+    iterators.emplace_back(new EmptyIterator(begin, end));
+  }
+  std::unique_ptr<BinaryDataOperator> it;
+  if (iterators.size() == 1) {
+    it.reset(new BinaryDataIterator(std::move(iterators.front())));
+  } else {
+    std::unique_ptr<RealValuedOperator> concat;
+    concat.reset(new ChainOperator(std::move(iterators)));
+    it.reset(new BinaryDataIterator(std::move(concat)));
+  }
+  std::unique_ptr<BinaryDataOperator> op;
+  op.reset(new BinaryDataFilter(std::move(it), regex, pred));
+  return op;
+}
+
 std::unique_ptr<RealValuedOperator> NBTreeExtentsList::filter(Timestamp begin,
                                                               Timestamp end,
                                                               const ValueFilter& filter) const {
   if (!initialized_) {
     const_cast<NBTreeExtentsList*>(this)->force_init();
   }
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   std::vector<std::unique_ptr<RealValuedOperator>> iterators;
   if (extents_.empty()) {
     iterators.emplace_back(new EmptyIterator(begin, end));
@@ -3359,7 +3549,7 @@ std::unique_ptr<AggregateOperator> NBTreeExtentsList::aggregate(Timestamp begin,
   if (!initialized_) {
     const_cast<NBTreeExtentsList*>(this)->force_init();
   }
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   std::vector<std::unique_ptr<AggregateOperator>> iterators;
   if (extents_.empty()) {
     iterators.emplace_back(new EmptyAggregator(begin, end));
@@ -3382,11 +3572,38 @@ std::unique_ptr<AggregateOperator> NBTreeExtentsList::aggregate(Timestamp begin,
   return concat;
 }
 
+std::unique_ptr<AggregateOperator> NBTreeExtentsList::approximate_aggregate(Timestamp begin, Timestamp end) const {
+  if (!initialized_) {
+    const_cast<NBTreeExtentsList*>(this)->force_init();
+  }
+  common::BiasedSharedLock lock(lock_);
+  std::vector<std::unique_ptr<AggregateOperator>> iterators;
+  if (extents_.empty()) {
+    iterators.emplace_back(new EmptyAggregator(begin, end));
+  } else {
+    if (begin < end) {
+      for (auto it = extents_.rbegin(); it != extents_.rend(); it++) {
+        iterators.push_back((*it)->approximate_aggregate(begin, end));
+      }
+    } else {
+      for (auto const& root: extents_) {
+        iterators.push_back(root->approximate_aggregate(begin, end));
+      }
+    }
+  }
+  if (iterators.size() == 1) {
+    return std::move(iterators.front());
+  }
+  std::unique_ptr<AggregateOperator> concat;
+  concat.reset(new CombineAggregateOperator(std::move(iterators)));
+  return concat;
+}
+
 std::unique_ptr<AggregateOperator> NBTreeExtentsList::group_aggregate(Timestamp begin, Timestamp end, Timestamp step) const {
   if (!initialized_) {
     const_cast<NBTreeExtentsList*>(this)->force_init();
   }
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   std::vector<std::unique_ptr<AggregateOperator>> iterators;
   if (extents_.empty()) {
     iterators.emplace_back(new EmptyAggregator(begin, end));
@@ -3420,7 +3637,7 @@ std::unique_ptr<AggregateOperator> NBTreeExtentsList::candlesticks(Timestamp beg
   if (!initialized_) {
     const_cast<NBTreeExtentsList*>(this)->force_init();
   }
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   std::vector<std::unique_ptr<AggregateOperator>> iterators;
   if (extents_.empty()) {
     iterators.emplace_back(new EmptyAggregator(begin, end));
@@ -3446,7 +3663,16 @@ std::unique_ptr<AggregateOperator> NBTreeExtentsList::candlesticks(Timestamp beg
 
 
 std::vector<LogicAddr> NBTreeExtentsList::close() {
-  common::UniqueLock lock(lock_);
+  std::vector<std::unique_ptr<IOVecBlock>> leaves;
+  std::shared_ptr<NBTreeLeafListener> listener;
+  std::vector<LogicAddr> result = close_locked(&leaves, &listener);
+  notify_listener(listener, std::move(leaves));
+  return result;
+}
+
+std::vector<LogicAddr> NBTreeExtentsList::close_locked(std::vector<std::unique_ptr<IOVecBlock>>* leaves,
+                                                       std::shared_ptr<NBTreeLeafListener>* listener) {
+  common::BiasedUniqueLock lock(lock_);
   if (initialized_) {
     if (write_count_) {
       LOG(INFO) << std::to_string(id_) << " Going to close the tree.";
@@ -3478,13 +3704,15 @@ std::vector<LogicAddr> NBTreeExtentsList::close() {
   // This node is not initialized now but can be restored from `rescue_points_` list.
   extents_.clear();
   initialized_ = false;
+  std::swap(*leaves, pending_leaves_);
+  *listener = listener_;
   // roots should be a list of EMPTY_ADDR values followed by
   // the address of the root node [E, E, E.., rootaddr].
   return rescue_points_;
 }
 
 std::vector<LogicAddr> NBTreeExtentsList::get_roots() const {
-  common::SharedLock lock(lock_);
+  common::BiasedSharedLock lock(lock_);
   return rescue_points_;
 }
 
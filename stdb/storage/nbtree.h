@@ -79,6 +79,7 @@
 #include "stdb/storage/nbtree_def.h"
 #include "stdb/storage/block_store.h"
 #include "stdb/storage/compression.h"
+#include "stdb/storage/event_index.h"
 #include "stdb/storage/operators/operator.h"
 
 namespace stdb {
@@ -98,6 +99,15 @@ struct SuperblockAppender {
   virtual bool top(LogicAddr* outaddr) const = 0;
 };
 
+/** Receives content of the leaf nodes committed by the NB-tree.
+ * Can be used to maintain secondary indexes. Called from the write path
+ * after the tree lock is released.
+ */
+struct NBTreeLeafListener {
+  virtual ~NBTreeLeafListener() = default;
+  virtual void on_leaf_commit(ParamId id, std::vector<Timestamp> const& ts, std::vector<double> const& xs) = 0;
+};
+
 class NBTreeSuperblock;
 class IOVecSuperblock;
 
@@ -172,6 +182,9 @@ class IOVecLeaf {
   //! Return address of the node itself (or EMPTY_ADDR if not saved yet)
   LogicAddr get_addr() const;
 
+  //! Copy serialized node (the node should be committed)
+  std::unique_ptr<IOVecBlock> copy_block() const;
+
   /** Read all elements from the leaf node.
    * @param timestamps Destination for timestamps.
    * @param values Destination for values.
@@ -294,6 +307,11 @@ class IOVecSuperblock : public SuperblockAppender {
                                                Timestamp end,
                                                std::shared_ptr<BlockStore> bstore) const;
 
+  //! Same as `aggregate` but leaf nodes are not read, see NBTreeExtentsList::approximate_aggregate
+  std::unique_ptr<AggregateOperator> approximate_aggregate(Timestamp begin,
+                                                           Timestamp end,
+                                                           std::shared_ptr<BlockStore> bstore) const;
+
   std::unique_ptr<AggregateOperator> candlesticks(Timestamp begin,
                                                   Timestamp end,
                                                   std::shared_ptr<BlockStore> bstore,
@@ -359,6 +377,9 @@ struct NBTreeExtent {
   //! Return iterator that will return single aggregated value.
   virtual std::unique_ptr<AggregateOperator> aggregate(Timestamp begin, Timestamp end) const = 0;
 
+  //! Return iterator that will return single estimated aggregate value.
+  virtual std::unique_ptr<AggregateOperator> approximate_aggregate(Timestamp begin, Timestamp end) const = 0;
+
   virtual std::unique_ptr<AggregateOperator> candlesticks(Timestamp begin, Timestamp end, NBTreeCandlestickHint hint) const = 0;
 
   //! Return group-aggregate query results iterator
@@ -400,12 +421,25 @@ class NBTreeExtentsList : public std::enable_shared_from_this<NBTreeExtentsList>
   bool initialized_;
   //! Number of write operations performed on object
   u64 write_count_;
-  mutable common::RWLock lock_;
+  //! Set if tree contains events (listener is not notified)
+  bool has_events_;
+  std::shared_ptr<NBTreeLeafListener> listener_;
+  //! Committed leaf nodes that weren't passed to the listener yet
+  std::vector<std::unique_ptr<IOVecBlock>> pending_leaves_;
+  mutable common::BiasedRWLock lock_;
 
   void open();
   void repair();
   void init();
 
+  //! Close the tree, take the pending leaf nodes
+  std::vector<LogicAddr> close_locked(std::vector<std::unique_ptr<IOVecBlock>>* leaves,
+                                      std::shared_ptr<NBTreeLeafListener>* listener);
+
+  //! Pass committed leaf nodes to the listener (should be called without the lock)
+  void notify_listener(std::shared_ptr<NBTreeLeafListener> const& listener,
+                       std::vector<std::unique_ptr<IOVecBlock>> leaves) const;
+
  public:
   /** C-tor
    * @param addresses List of root addresses in blockstore or list of resque points.
@@ -430,6 +464,23 @@ class NBTreeExtentsList : public std::enable_shared_from_this<NBTreeExtentsList>
 
   NBTreeAppendResult append(Timestamp ts, const u8 *blob, u32 size);
 
+  //! Set listener that will receive every committed leaf node of the tree
+  void set_leaf_listener(std::shared_ptr<NBTreeLeafListener> listener);
+
+  /** Notify listener about committed leaf node.
+   * Should be used only by NB-tree itself (from leaf-commit function).
+   * The node is queued and passed to the listener when the lock is released.
+   */
+  void on_leaf_commit(IOVecLeaf const& leaf);
+
+  /** Check if tree contains events.
+   * Event series have negative ids (see SeriesMatcher), `has_events_` covers
+   * trees that were written by the current process.
+   */
+  bool is_event_column() const {
+    return has_events_ || static_cast<i64>(id_) < 0;
+  }
+
   /**
    * @brief search function
    * @param begin is a start of the search interval
@@ -440,6 +491,24 @@ class NBTreeExtentsList : public std::enable_shared_from_this<NBTreeExtentsList>
   std::unique_ptr<BinaryDataOperator> search_binary(Timestamp begin, Timestamp end) const;
   std::unique_ptr<BinaryDataOperator> filter_binary(Timestamp begin, Timestamp end, const std::string& regex) const;
 
+  /**
+   * @brief filter events using keyword predicate and regex (regex is not used if empty)
+   */
+  std::unique_ptr<BinaryDataOperator> filter_binary(Timestamp begin,
+                                                    Timestamp end,
+                                                    const std::string& regex,
+                                                    EventPredicate const& pred) const;
+
+  /**
+   * @brief filter events using keyword predicate and regex, only events from `ranges` are read
+   * @param ranges is a list of candidate ranges produced by the EventIndex
+   */
+  std::unique_ptr<BinaryDataOperator> filter_binary(Timestamp begin,
+                                                    Timestamp end,
+                                                    std::vector<EventIndex::Range> const& ranges,
+                                                    const std::string& regex,
+                                                    EventPredicate const& pred) const;
+
   /**
    * @brief search function
    * @param begin is a start of the search interval
@@ -456,6 +525,18 @@ class NBTreeExtentsList : public std::enable_shared_from_this<NBTreeExtentsList>
    */
   std::unique_ptr<AggregateOperator> aggregate(Timestamp begin, Timestamp end) const;
 
+  /**
+   * @brief estimate aggregate of all values in search interval
+   * Only superblocks are read. Leaf nodes inside the interval are replaced
+   * with their subtree refs, leaf nodes on the edges of the interval are
+   * extrapolated (count and sum are scaled by the time overlap). The result
+   * is accurate for count, sum and mean only.
+   * @param begin is a start of the search interval
+   * @param end is a next after the last element of the search interval
+   * @return iterator that produces single value
+   */
+  std::unique_ptr<AggregateOperator> approximate_aggregate(Timestamp begin, Timestamp end) const;
+
   std::unique_ptr<AggregateOperator> candlesticks(Timestamp begin, Timestamp end, NBTreeCandlestickHint hint) const;
 
   /**
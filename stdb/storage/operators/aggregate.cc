@@ -4,7 +4,14 @@
 #include "stdb/storage/operators/aggregate.h"
 #include "stdb/storage/tuples.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <thread>
 
 namespace stdb {
 namespace storage {
@@ -128,6 +135,159 @@ AggregateOperator::Direction FanInAggregateOperator::get_direction() {
   return dir_;
 }
 
+BufferedAggregateOperator::BufferedAggregateOperator(std::vector<Timestamp>&& ts,
+                                                     std::vector<AggregationResult>&& xs,
+                                                     Direction dir)
+    : ts_(std::move(ts))
+    , xs_(std::move(xs))
+    , dir_(dir)
+    , pos_(0) {
+  assert(ts_.size() == xs_.size());
+}
+
+std::tuple<common::Status, size_t> BufferedAggregateOperator::read(Timestamp *destts, AggregationResult *destval, size_t size) {
+  if (size == 0) {
+    return std::make_tuple(common::Status::BadArg(), 0);
+  }
+  size_t n = std::min(size, ts_.size() - pos_);
+  std::copy(ts_.begin() + pos_, ts_.begin() + pos_ + n, destts);
+  std::copy(xs_.begin() + pos_, xs_.begin() + pos_ + n, destval);
+  pos_ += n;
+  if (pos_ == ts_.size()) {
+    return std::make_tuple(common::Status::NoData(), n);
+  }
+  return std::make_tuple(common::Status::Ok(), n);
+}
+
+AggregateOperator::Direction BufferedAggregateOperator::get_direction() {
+  return dir_;
+}
+
+namespace {
+
+/** Read all operators of the group and merge their outputs.
+ * Every operator returns buckets in order so the outputs are merged
+ * one by one using linear merge.
+ */
+common::Status merge_group(std::vector<std::unique_ptr<AggregateOperator>>& group,
+                           AggregateOperator::Direction dir,
+                           std::vector<Timestamp>* outts,
+                           std::vector<AggregationResult>* outxs) {
+  const size_t SZBUF = 1024;
+  const bool forward = dir == AggregateOperator::Direction::FORWARD;
+  std::vector<Timestamp> rdts(SZBUF);
+  std::vector<AggregationResult> rdxs(SZBUF);
+  std::vector<Timestamp> sts, mts;
+  std::vector<AggregationResult> sxs, mxs;
+  for (auto& it: group) {
+    sts.clear();
+    sxs.clear();
+    while (true) {
+      common::Status status;
+      size_t n;
+      std::tie(status, n) = it->read(rdts.data(), rdxs.data(), SZBUF);
+      sts.insert(sts.end(), rdts.begin(), rdts.begin() + n);
+      sxs.insert(sxs.end(), rdxs.begin(), rdxs.begin() + n);
+      if (status.Code() == common::Status::kNoData || (status.IsOk() && n == 0)) {
+        break;
+      }
+      if (!status.IsOk()) {
+        return status;
+      }
+    }
+    it.reset();
+    if (outts->empty()) {
+      std::swap(*outts, sts);
+      std::swap(*outxs, sxs);
+      continue;
+    }
+    mts.clear();
+    mxs.clear();
+    size_t i = 0, j = 0;
+    while (i < outts->size() || j < sts.size()) {
+      bool take_out, take_s;
+      if (i == outts->size()) {
+        take_out = false;
+        take_s = true;
+      } else if (j == sts.size()) {
+        take_out = true;
+        take_s = false;
+      } else {
+        Timestamp a = outts->at(i), b = sts[j];
+        take_out = a == b || (forward ? a < b : a > b);
+        take_s = a == b || !take_out;
+      }
+      if (take_out && take_s) {
+        AggregationResult xs = outxs->at(i);
+        xs.combine(sxs[j]);
+        mts.push_back(outts->at(i));
+        mxs.push_back(xs);
+        i++;
+        j++;
+      } else if (take_out) {
+        mts.push_back(outts->at(i));
+        mxs.push_back(outxs->at(i));
+        i++;
+      } else {
+        mts.push_back(sts[j]);
+        mxs.push_back(sxs[j]);
+        j++;
+      }
+    }
+    std::swap(*outts, mts);
+    std::swap(*outxs, mxs);
+  }
+  return common::Status::Ok();
+}
+
+}  // namespace
+
+std::tuple<common::Status, std::vector<std::unique_ptr<AggregateOperator>>>
+    combine_group_aggregates(std::vector<std::vector<std::unique_ptr<AggregateOperator>>>&& groups,
+                             u32 nthreads) {
+  std::vector<std::unique_ptr<AggregateOperator>> result;
+  std::vector<AggregateOperator::Direction> dirs(groups.size(), AggregateOperator::Direction::FORWARD);
+  for (size_t i = 0; i < groups.size(); i++) {
+    if (!groups[i].empty()) {
+      dirs[i] = groups[i].front()->get_direction();
+    }
+  }
+  std::vector<std::vector<Timestamp>> outts(groups.size());
+  std::vector<std::vector<AggregationResult>> outxs(groups.size());
+  std::vector<common::Status> statuses(groups.size(), common::Status::Ok());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    while (true) {
+      size_t ix = next++;
+      if (ix >= groups.size()) {
+        break;
+      }
+      statuses[ix] = merge_group(groups[ix], dirs[ix], &outts[ix], &outxs[ix]);
+    }
+  };
+  if (nthreads == 0) {
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nthreads = static_cast<u32>(std::min(static_cast<size_t>(nthreads), groups.size()));
+  std::vector<std::thread> threads;
+  for (u32 i = 1; i < nthreads; i++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  for (auto const& status: statuses) {
+    if (!status.IsOk()) {
+      return std::make_tuple(status, std::move(result));
+    }
+  }
+  for (size_t i = 0; i < groups.size(); i++) {
+    result.emplace_back(new BufferedAggregateOperator(std::move(outts[i]), std::move(outxs[i]), dirs[i]));
+  }
+  return std::make_tuple(common::Status::Ok(), std::move(result));
+}
+
 bool CombineGroupAggregateOperator::can_read() const {
   return rdpos_ < rdbuf_.size();
 }
@@ -362,7 +522,178 @@ std::tuple<common::Status, size_t> AggregateMaterializer::read(u8* dest, size_t
 }
 
 
+SeriesOrderAggregateMaterializer::SeriesOrderAggregateMaterializer(
+    std::vector<ParamId>&& ids,
+    std::vector<std::unique_ptr<AggregateOperator>>&& it,
+    const std::vector<AggregationFunction>& components,
+    const GroupAggregateFill& fill)
+    : iters_(std::move(it))
+    , ids_(std::move(ids))
+    , tuple_(components)
+    , pos_(0)
+    , fill_(fill)
+    , nbins_(0)
+    , bin_(0)
+    , exhausted_(false)
+    , pending_(false)
+    , pending_bin_(0)
+    , pending_val_(INIT_AGGRES)
+    , has_prev_(false)
+    , prev_bin_(0)
+    , rdpos_(0)
+    , rdsize_(0) {
+  if (fill_.policy != FillPolicy::NONE && fill_.step != 0) {
+    auto range = fill_.begin < fill_.end ? fill_.end - fill_.begin : fill_.begin - fill_.end;
+    nbins_ = (range + fill_.step - 1) / fill_.step;
+    prev_.resize(tuple_.size());
+    next_.resize(tuple_.size());
+    rdts_.resize(RDBUF_SIZE);
+    rdval_.resize(RDBUF_SIZE, INIT_AGGRES);
+  } else {
+    fill_.policy = FillPolicy::NONE;
+  }
+}
+
+u64 SeriesOrderAggregateMaterializer::get_bin(Timestamp ts) const {
+  return fill_.begin < fill_.end ? (ts - fill_.begin) / fill_.step
+                                 : (fill_.begin - ts) / fill_.step;
+}
+
+Timestamp SeriesOrderAggregateMaterializer::get_bin_timestamp(u64 bin) const {
+  return fill_.begin < fill_.end ? fill_.begin + bin * fill_.step
+                                 : fill_.begin - bin * fill_.step;
+}
+
+double* SeriesOrderAggregateMaterializer::write_tuple(u8* dest, u64 bin) {
+  double* tup;
+  Sample* sample;
+  std::tie(sample, tup)   = cast(dest);
+  sample->payload.type    = PAYLOAD_TUPLE | PData::REGULLAR;
+  sample->payload.size    = static_cast<u16>(get_tuple_size(tuple_));
+  sample->paramid         = ids_[pos_];
+  sample->timestamp       = get_bin_timestamp(bin);
+  sample->payload.float64 = get_flags(tuple_);
+  return tup;
+}
+
+size_t SeriesOrderAggregateMaterializer::write_gap(u8* dest, u64 bin) {
+  const size_t sample_size = get_tuple_size(tuple_);
+  switch (fill_.policy) {
+    case FillPolicy::PREVIOUS:
+      if (has_prev_) {
+        std::copy(prev_.begin(), prev_.end(), write_tuple(dest, bin));
+        return sample_size;
+      }
+      break;
+    case FillPolicy::LINEAR:
+      if (has_prev_ && pending_) {
+        // `next_` contains the tuple of the pending bucket
+        double* tup = write_tuple(dest, bin);
+        double frac = static_cast<double>(bin - prev_bin_) / static_cast<double>(pending_bin_ - prev_bin_);
+        for (size_t i = 0; i < tuple_.size(); i++) {
+          tup[i] = prev_[i] + (next_[i] - prev_[i]) * frac;
+        }
+        return sample_size;
+      }
+      break;
+    case FillPolicy::CONSTANT: {
+      double* tup = write_tuple(dest, bin);
+      std::fill(tup, tup + tuple_.size(), fill_.value);
+      return sample_size;
+    }
+    case FillPolicy::NULL_VALUE:
+    case FillPolicy::NONE:
+      break;
+  };
+  // Tuple with empty bitmap
+  Sample* sample = reinterpret_cast<Sample*>(dest);
+  union {
+    double d;
+    u64 u;
+  } bits;
+  bits.u = static_cast<u64>(tuple_.size()) << 58;
+  sample->payload.type    = PAYLOAD_TUPLE | PData::REGULLAR;
+  sample->payload.size    = static_cast<u16>(sizeof(Sample));
+  sample->paramid         = ids_[pos_];
+  sample->timestamp       = get_bin_timestamp(bin);
+  sample->payload.float64 = bits.d;
+  return sizeof(Sample);
+}
+
+void SeriesOrderAggregateMaterializer::next_series() {
+  pos_++;
+  bin_ = 0;
+  exhausted_ = false;
+  pending_ = false;
+  has_prev_ = false;
+  rdpos_ = 0;
+  rdsize_ = 0;
+}
+
+std::tuple<common::Status, size_t> SeriesOrderAggregateMaterializer::read_filled(u8 *dest, size_t dest_size) {
+  const size_t sample_size = get_tuple_size(tuple_);
+  size_t outsz = 0;
+  while (pos_ < iters_.size()) {
+    if (rdpos_ == rdsize_ && !exhausted_) {
+      common::Status status;
+      std::tie(status, rdsize_) = iters_[pos_]->read(rdts_.data(), rdval_.data(), rdts_.size());
+      rdpos_ = 0;
+      if (status.Code() == common::Status::kNoData || rdsize_ == 0) {
+        exhausted_ = true;
+      } else if (!status.IsOk()) {
+        return std::make_tuple(status, outsz);
+      }
+    }
+    if (rdpos_ < rdsize_) {
+      u64 bin = get_bin(rdts_[rdpos_]);
+      if (!pending_) {
+        pending_ = true;
+        pending_bin_ = bin;
+        pending_val_ = rdval_[rdpos_++];
+        continue;
+      } else if (bin == pending_bin_) {
+        // Parts of the same bucket (e.g. produced by different series in group-by)
+        pending_val_.combine(rdval_[rdpos_++]);
+        continue;
+      }
+    } else if (!exhausted_) {
+      continue;
+    }
+    // Bucket `pending_bin_` is complete or the series is done
+    u64 target = nbins_;
+    if (pending_) {
+      target = pending_bin_;
+      set_tuple(next_.data(), tuple_, pending_val_);
+    }
+    while (bin_ < target) {
+      if (dest_size - outsz < sample_size) {
+        return std::make_tuple(common::Status::Ok(), outsz);
+      }
+      outsz += write_gap(dest + outsz, bin_);
+      bin_++;
+    }
+    if (!pending_) {
+      next_series();
+      continue;
+    }
+    if (dest_size - outsz < sample_size) {
+      return std::make_tuple(common::Status::Ok(), outsz);
+    }
+    std::copy(next_.begin(), next_.end(), write_tuple(dest + outsz, pending_bin_));
+    outsz += sample_size;
+    std::swap(prev_, next_);
+    prev_bin_ = pending_bin_;
+    has_prev_ = true;
+    bin_ = std::max(bin_, pending_bin_ + 1);
+    pending_ = false;
+  }
+  return std::make_tuple(common::Status::NoData(), outsz);
+}
+
 std::tuple<common::Status, size_t> SeriesOrderAggregateMaterializer::read(u8 *dest, size_t dest_size) {
+  if (fill_.policy != FillPolicy::NONE) {
+    return read_filled(dest, dest_size);
+  }
   common::Status status = common::Status::NoData();
   size_t ressz = 0;  // current size
   size_t accsz = 0;  // accumulated size
@@ -412,5 +743,248 @@ std::tuple<common::Status, size_t> SeriesOrderAggregateMaterializer::read(u8 *de
   return std::make_tuple(status, accsz * sample_size);
 }
 
+M4Materializer::M4Materializer(std::vector<ParamId>&& ids,
+                               std::vector<std::unique_ptr<AggregateOperator>>&& it)
+    : iters_(std::move(it))
+    , ids_(std::move(ids))
+    , pos_(0)
+    , forward_(true)
+    , exhausted_(false)
+    , rdts_(RDBUF_SIZE)
+    , rdval_(RDBUF_SIZE, INIT_AGGRES)
+    , rdpos_(0)
+    , rdsize_(0) {
+  if (!iters_.empty()) {
+    forward_ = iters_.front()->get_direction() == AggregateOperator::Direction::FORWARD;
+  }
+}
+
+size_t M4Materializer::write_bucket(u8* dest, AggregationResult const& bucket) {
+  std::pair<Timestamp, double> points[] = {
+    std::make_pair(bucket._begin, bucket.first),
+    std::make_pair(bucket.mints, bucket.min),
+    std::make_pair(bucket.maxts, bucket.max),
+    std::make_pair(bucket._end, bucket.last),
+  };
+  // First and last points are already in place, only min and max can be out of order
+  if (points[1].first > points[2].first) {
+    std::swap(points[1], points[2]);
+  }
+  size_t outsz = 0;
+  Timestamp prev = 0;
+  for (int i = 0; i < 4; i++) {
+    auto const& point = points[forward_ ? i : 3 - i];
+    if (outsz != 0 && point.first == prev) {
+      continue;
+    }
+    prev = point.first;
+    Sample sample = {};
+    sample.paramid = ids_[pos_];
+    sample.timestamp = point.first;
+    sample.payload.type = PAYLOAD_FLOAT;
+    sample.payload.size = sizeof(Sample);
+    sample.payload.float64 = point.second;
+    memcpy(dest + outsz, &sample, sizeof(Sample));
+    outsz += sizeof(Sample);
+  }
+  return outsz;
+}
+
+std::tuple<common::Status, size_t> M4Materializer::read(u8 *dest, size_t dest_size) {
+  size_t outsz = 0;
+  while (pos_ < iters_.size()) {
+    if (rdpos_ == rdsize_) {
+      if (exhausted_) {
+        pos_++;
+        exhausted_ = false;
+        continue;
+      }
+      common::Status status;
+      std::tie(status, rdsize_) = iters_[pos_]->read(rdts_.data(), rdval_.data(), rdts_.size());
+      rdpos_ = 0;
+      if (status.Code() == common::Status::kNoData || rdsize_ == 0) {
+        exhausted_ = true;
+      } else if (!status.IsOk()) {
+        return std::make_tuple(status, outsz);
+      }
+      continue;
+    }
+    if (dest_size - outsz < 4 * sizeof(Sample)) {
+      return std::make_tuple(common::Status::Ok(), outsz);
+    }
+    outsz += write_bucket(dest + outsz, rdval_[rdpos_++]);
+  }
+  return std::make_tuple(common::Status::NoData(), outsz);
+}
+
+// ////////////////////////////////////// //
+//    ApproximateAggregateMaterializer    //
+// ////////////////////////////////////// //
+
+void ApproximateAggregateMaterializer::Moments::add(double c, double y) {
+  n += 1;
+  cnt += c;
+  cnt2 += c * c;
+  sum += y;
+  sum2 += y * y;
+  prod += c * y;
+}
+
+ApproximateAggregateMaterializer::ApproximateAggregateMaterializer(
+    std::vector<ParamId> const& ids,
+    std::vector<std::unique_ptr<AggregateOperator>>&& it,
+    std::vector<AggregationFunction> const& func,
+    AggregateApproximation const& approx)
+    : iters_(std::move(it))
+    , approx_(approx)
+    , z_(normal_quantile(approx.confidence))
+    , started_(false)
+    , pos_(0)
+{
+  // Groups are reported in id order (same as in AggregateCombiner)
+  std::map<ParamId, std::vector<u32>> groups;
+  std::map<ParamId, AggregationFunction> functions;
+  for (u32 i = 0; i < ids.size(); i++) {
+    groups[ids[i]].push_back(i);
+    functions[ids[i]] = func.at(i);
+  }
+  for (auto& kv: groups) {
+    // Series of the group are read in random (but reproducible) order
+    std::mt19937 rand(static_cast<u32>(kv.first));
+    std::shuffle(kv.second.begin(), kv.second.end(), rand);
+    ids_.push_back(kv.first);
+    groups_.push_back(std::move(kv.second));
+    func_.push_back(functions[kv.first]);
+  }
+}
+
+double ApproximateAggregateMaterializer::normal_quantile(double confidence) {
+  // Rational approximation from Abramowitz & Stegun (26.2.23), |error| < 4.5e-4
+  double p = (1.0 - confidence) / 2.0;
+  double t = std::sqrt(-2.0 * std::log(p));
+  return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+             (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+ApproximateAggregateMaterializer::Estimate ApproximateAggregateMaterializer::estimate(
+    Moments const& m, size_t total, AggregationFunction func, double z)
+{
+  const double n = m.n;
+  const double N = static_cast<double>(total);
+  const double cnt_mean = m.cnt / n;
+  const double sum_mean = m.sum / n;
+  double value = 0;
+  double var = 0;
+  switch (func) {
+    case AggregationFunction::CNT:
+      value = N * cnt_mean;
+      var = N * N * (m.cnt2 - m.cnt * cnt_mean) / (n - 1);
+      break;
+    case AggregationFunction::SUM:
+      value = N * sum_mean;
+      var = N * N * (m.sum2 - m.sum * sum_mean) / (n - 1);
+      break;
+    default: {
+      // Ratio estimator, residuals are `sum - mean*cnt` for every series
+      value = m.sum / m.cnt;
+      double resid = m.sum2 - 2 * value * m.prod + value * value * m.cnt2;
+      var = resid / (n - 1) / (cnt_mean * cnt_mean);
+      break;
+    }
+  }
+  Estimate result = { value, value, value };
+  if (n >= N) {
+    // Every series was read
+    return result;
+  }
+  if (n < 2) {
+    result.lower = -std::numeric_limits<double>::infinity();
+    result.upper = std::numeric_limits<double>::infinity();
+    return result;
+  }
+  // Variance of the sample mean with finite population correction
+  double delta = z * std::sqrt(std::max(var, 0.0) / n * (1.0 - n / N));
+  result.lower = value - delta;
+  result.upper = value + delta;
+  return result;
+}
+
+std::tuple<common::Status, ApproximateAggregateMaterializer::Estimate, Timestamp>
+ApproximateAggregateMaterializer::read_group(u32 ix) {
+  auto const& group = groups_.at(ix);
+  const size_t min_sample = std::min(group.size(), static_cast<size_t>(MIN_SAMPLE_SIZE));
+  Moments moments = {};
+  Estimate est = {};
+  Timestamp last = 0;
+  for (auto it: group) {
+    Timestamp ts = 0;
+    AggregationResult agg = INIT_AGGRES;
+    common::Status status;
+    size_t outsz;
+    std::tie(status, outsz) = iters_.at(it)->read(&ts, &agg, 1);
+    if (!status.IsOk() && status.Code() != common::Status::kNoData) {
+      return std::make_tuple(status, est, last);
+    }
+    if (outsz == 1) {
+      moments.add(agg.cnt, agg.sum);
+      last = std::max(last, agg._end);
+    } else {
+      // Series has no data in the search range
+      moments.add(0, 0);
+    }
+    if (moments.n < min_sample) {
+      continue;
+    }
+    est = estimate(moments, group.size(), func_.at(ix), z_);
+    if (est.upper - est.value <= approx_.error * std::abs(est.value)) {
+      break;
+    }
+    if (approx_.budget != 0 && std::chrono::steady_clock::now() > deadline_) {
+      break;
+    }
+  }
+  return std::make_tuple(common::Status::Ok(), est, last);
+}
+
+std::tuple<common::Status, size_t> ApproximateAggregateMaterializer::read(u8 *dest, size_t size) {
+  const size_t sample_size = sizeof(Sample) + TUPLE_SIZE * sizeof(double);
+  if (!started_) {
+    // Time budget includes the whole query
+    deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(approx_.budget);
+    started_ = true;
+  }
+  size_t outsz = 0;
+  while (pos_ < groups_.size()) {
+    if (size - outsz < sample_size) {
+      return std::make_tuple(common::Status::Ok(), outsz);
+    }
+    common::Status status;
+    Estimate est;
+    Timestamp ts;
+    std::tie(status, est, ts) = read_group(pos_);
+    if (!status.IsOk()) {
+      return std::make_tuple(status, outsz);
+    }
+    union {
+      double d;
+      u64 u;
+    } bits;
+    bits.u = (static_cast<u64>(TUPLE_SIZE) << 58) | ((1ull << TUPLE_SIZE) - 1);
+    Sample* sample = reinterpret_cast<Sample*>(dest + outsz);
+    sample->paramid = ids_.at(pos_);
+    sample->timestamp = ts;
+    sample->payload.type = PAYLOAD_TUPLE;
+    sample->payload.size = static_cast<u16>(sample_size);
+    sample->payload.float64 = bits.d;
+    double* tuple = reinterpret_cast<double*>(sample->payload.data);
+    tuple[0] = est.value;
+    tuple[1] = est.lower;
+    tuple[2] = est.upper;
+    outsz += sample_size;
+    pos_++;
+  }
+  return std::make_tuple(common::Status::NoData(), outsz);
+}
+
 }  // namespace storage
 }  // namespace stdb
@@ -5,6 +5,7 @@
 #define STDB_STORAGE_OPERATORS_AGGREGATE_H_
 
 #include <cassert>
+#include <chrono>
 
 #include "stdb/common/status.h"
 #include "stdb/storage/operators/operator.h"
@@ -67,6 +68,32 @@ struct FanInAggregateOperator : AggregateOperator {
   virtual Direction get_direction();
 };
 
+/** Aggregate operator that returns precomputed values.
+ */
+struct BufferedAggregateOperator : AggregateOperator {
+  std::vector<Timestamp>         ts_;
+  std::vector<AggregationResult> xs_;
+  Direction                      dir_;
+  size_t                         pos_;
+
+  BufferedAggregateOperator(std::vector<Timestamp>&& ts, std::vector<AggregationResult>&& xs, Direction dir);
+
+  virtual std::tuple<common::Status, size_t> read(Timestamp *destts, AggregationResult *destval, size_t size);
+  virtual Direction get_direction();
+};
+
+/** Combine groups of group-aggregate operators.
+ * Every group is read eagerly and merged into one buffered operator (values
+ * with the same timestamp are combined like in FanInAggregateOperator).
+ * Groups are processed by `nthreads` threads so operators shouldn't share
+ * any state.
+ * @param groups is a list of groups
+ * @param nthreads is a number of worker threads (0 - number of cores)
+ * @return status and one operator per group
+ */
+std::tuple<common::Status, std::vector<std::unique_ptr<AggregateOperator>>>
+    combine_group_aggregates(std::vector<std::vector<std::unique_ptr<AggregateOperator>>>&& groups,
+                             u32 nthreads);
 
 /** 
  * Aggregating operator (group-by + aggregate).
@@ -163,21 +190,70 @@ class AggregateMaterializer : public ColumnMaterializer {
   std::tuple<common::Status, size_t> read(u8* dest, size_t size);
 };
 
+/** Gap filling parameters of the group-aggregate query.
+ * Buckets are aligned to the beginning of the query range, every
+ * bucket in [begin, end) range is reported when the policy is set.
+ */
+struct GroupAggregateFill {
+  FillPolicy policy;
+  double     value;  //! Constant used by FillPolicy::CONSTANT
+  Timestamp  begin;
+  Timestamp  end;
+  u64        step;
+};
+
 struct SeriesOrderAggregateMaterializer : TupleOutputUtils, ColumnMaterializer {
+  enum {
+    RDBUF_SIZE = 0x100,
+  };
+
   std::vector<std::unique_ptr<AggregateOperator>> iters_;
   std::vector<ParamId> ids_;
   std::vector<AggregationFunction> tuple_;
   u32 pos_;
 
+  // Gap filling state, only one bucket of the current series is kept
+  GroupAggregateFill fill_;
+  u64 nbins_;                 //! Total number of buckets in query range
+  u64 bin_;                   //! Next bucket that should be reported
+  bool exhausted_;            //! Current iterator is done
+  bool pending_;              //! Bucket that wasn't reported yet is stored in `pending_val_`
+  u64 pending_bin_;
+  AggregationResult pending_val_;
+  bool has_prev_;             //! Previous non-empty bucket is stored in `prev_`
+  u64 prev_bin_;
+  std::vector<double> prev_;
+  std::vector<double> next_;
+  std::vector<Timestamp> rdts_;
+  std::vector<AggregationResult> rdval_;
+  size_t rdpos_;
+  size_t rdsize_;
+
   SeriesOrderAggregateMaterializer(std::vector<ParamId>&& ids,
                                    std::vector<std::unique_ptr<AggregateOperator>>&& it,
-                                   const std::vector<AggregationFunction>& components)
-      : iters_(std::move(it))
-        , ids_(std::move(ids))
-        , tuple_(std::move(components))
-        , pos_(0) { }
+                                   const std::vector<AggregationFunction>& components,
+                                   const GroupAggregateFill& fill = GroupAggregateFill());
 
   virtual std::tuple<common::Status, size_t> read(u8 *dest, size_t size) override;
+
+ private:
+  //! Read with gap filling
+  std::tuple<common::Status, size_t> read_filled(u8 *dest, size_t size);
+
+  //! Get bucket index of the timestamp
+  u64 get_bin(Timestamp ts) const;
+
+  //! Get timestamp of the bucket
+  Timestamp get_bin_timestamp(u64 bin) const;
+
+  //! Write empty bucket, return number of bytes written
+  size_t write_gap(u8* dest, u64 bin);
+
+  //! Write sample header of the bucket, return pointer to tuple values
+  double* write_tuple(u8* dest, u64 bin);
+
+  //! Switch to the next series
+  void next_series();
 };
 
 
@@ -187,7 +263,8 @@ struct TimeOrderAggregateMaterializer : TupleOutputUtils, ColumnMaterializer {
 
   TimeOrderAggregateMaterializer(const std::vector<ParamId>& ids,
                                  std::vector<std::unique_ptr<AggregateOperator>>& it,
-                                 const std::vector<AggregationFunction>& components) {
+                                 const std::vector<AggregationFunction>& components,
+                                 const GroupAggregateFill& fill = GroupAggregateFill()) {
     assert(it.size());
     bool forward = it.front()->get_direction() == AggregateOperator::Direction::FORWARD;
     std::vector<std::unique_ptr<ColumnMaterializer>> iters;
@@ -196,7 +273,7 @@ struct TimeOrderAggregateMaterializer : TupleOutputUtils, ColumnMaterializer {
       auto agg = std::move(it.at(i));
       std::vector<std::unique_ptr<AggregateOperator>> agglist;
       agglist.push_back(std::move(agg));
-      auto ptr = new SeriesOrderAggregateMaterializer({ ids[i] }, std::move(agglist), components);
+      auto ptr = new SeriesOrderAggregateMaterializer({ ids[i] }, std::move(agglist), components, fill);
       iter.reset(ptr);
       iters.push_back(std::move(iter));
     }
@@ -208,6 +285,126 @@ struct TimeOrderAggregateMaterializer : TupleOutputUtils, ColumnMaterializer {
   }
 };
 
+/** M4 downsampling materializer.
+ * Every bucket of the group-aggregate operator (one pixel column) is turned
+ * into up to four float samples: first, min, max and last value, each with
+ * its original timestamp. Samples are ordered by timestamp within the bucket,
+ * duplicates (e.g. first value is also the min value) are reported once.
+ */
+struct M4Materializer : ColumnMaterializer {
+  enum {
+    RDBUF_SIZE = 0x100,
+  };
+
+  std::vector<std::unique_ptr<AggregateOperator>> iters_;
+  std::vector<ParamId> ids_;
+  u32 pos_;
+  bool forward_;
+  bool exhausted_;
+  std::vector<Timestamp> rdts_;
+  std::vector<AggregationResult> rdval_;
+  size_t rdpos_;
+  size_t rdsize_;
+
+  M4Materializer(std::vector<ParamId>&& ids, std::vector<std::unique_ptr<AggregateOperator>>&& it);
+
+  virtual std::tuple<common::Status, size_t> read(u8 *dest, size_t size) override;
+
+ private:
+  //! Write samples of the bucket, return number of bytes written
+  size_t write_bucket(u8* dest, AggregationResult const& bucket);
+};
+
+//! M4 downsampling with output ordered by timestamp
+struct TimeOrderM4Materializer : ColumnMaterializer {
+  typedef MergeJoinMaterializer<MergeJoinUtil::OrderByTimestamp> Materializer;
+  std::unique_ptr<Materializer> join_iter_;
+
+  TimeOrderM4Materializer(const std::vector<ParamId>& ids,
+                          std::vector<std::unique_ptr<AggregateOperator>>& it) {
+    assert(it.size());
+    bool forward = it.front()->get_direction() == AggregateOperator::Direction::FORWARD;
+    std::vector<std::unique_ptr<ColumnMaterializer>> iters;
+    for (size_t i = 0; i < ids.size(); i++) {
+      std::vector<std::unique_ptr<AggregateOperator>> agglist;
+      agglist.push_back(std::move(it.at(i)));
+      iters.emplace_back(new M4Materializer({ ids[i] }, std::move(agglist)));
+    }
+    join_iter_.reset(new Materializer(std::move(iters), forward));
+  }
+
+  virtual std::tuple<common::Status, size_t> read(u8 *dest, size_t size) override {
+    return join_iter_->read(dest, size);
+  }
+};
+
+/** Approximate aggregate materializer.
+ * Operators with the same id form a group (series that share the group-by
+ * tag value or a single series). Series of the group are read in random
+ * order until the confidence interval of the estimate is narrow enough or
+ * the time budget runs out, count and sum of the unread series are
+ * extrapolated from the sample. Every group produces a tuple with the
+ * estimate and the lower and upper bound of the confidence interval.
+ * Only count, sum and mean are supported.
+ */
+struct ApproximateAggregateMaterializer : ColumnMaterializer {
+  enum {
+    MIN_SAMPLE_SIZE = 16,
+    TUPLE_SIZE = 3,
+  };
+
+  //! Running sums of the sampled series
+  struct Moments {
+    double n;
+    double cnt;    //! sum of counts
+    double cnt2;   //! sum of squared counts
+    double sum;    //! sum of sums
+    double sum2;   //! sum of squared sums
+    double prod;   //! sum of count * sum products
+
+    void add(double c, double y);
+  };
+
+  //! Estimate of the group aggregate and its confidence interval
+  struct Estimate {
+    double value;
+    double lower;
+    double upper;
+  };
+
+  std::vector<std::unique_ptr<AggregateOperator>> iters_;
+  std::vector<ParamId> ids_;               //! Id of every group
+  std::vector<std::vector<u32>> groups_;   //! Operators of every group
+  std::vector<AggregationFunction> func_;  //! Function of every group
+  AggregateApproximation approx_;
+  double z_;                               //! Critical value for `approx_.confidence`
+  std::chrono::steady_clock::time_point deadline_;
+  bool started_;
+  u32 pos_;
+
+  ApproximateAggregateMaterializer(std::vector<ParamId> const& ids,
+                                   std::vector<std::unique_ptr<AggregateOperator>>&& it,
+                                   std::vector<AggregationFunction> const& func,
+                                   AggregateApproximation const& approx);
+
+  virtual std::tuple<common::Status, size_t> read(u8 *dest, size_t size) override;
+
+  /** Estimate group aggregate using the sample.
+   * @param m is a sample of the group
+   * @param total is a number of series in the group
+   * @param func is an aggregation function (count, sum or mean)
+   * @param z is a critical value of the standard normal distribution
+   */
+  static Estimate estimate(Moments const& m, size_t total, AggregationFunction func, double z);
+
+  //! Critical value of the two-sided confidence interval
+  static double normal_quantile(double confidence);
+
+ private:
+  //! Sample series of the group, return estimate and the timestamp of the last value
+  std::tuple<common::Status, Estimate, Timestamp> read_group(u32 ix);
+};
+
 }  // namespace storage
 }  // namespace stdb
 
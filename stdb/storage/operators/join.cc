@@ -102,5 +102,139 @@ std::tuple<common::Status, size_t> JoinMaterializer::read(u8 *dest, size_t size)
   return std::make_tuple(common::Status::Ok(), pos);
 }
 
+AsOfJoinMaterializer::AsOfJoinMaterializer(std::vector<std::unique_ptr<RealValuedOperator>>&& iters,
+                                           ParamId id,
+                                           Timestamp tolerance)
+   : iters_(std::move(iters)),
+     done_(iters_.size(), 0),
+     found_(iters_.size(), 0),
+     last_ts_(iters_.size(), 0),
+     last_xs_(iters_.size(), .0),
+     id_(id),
+     tolerance_(tolerance),
+     forward_(true),
+     max_ssize_(static_cast<u32>(sizeof(Sample) + sizeof(double) * iters_.size())) {
+  if (!iters_.empty()) {
+    forward_ = iters_.front()->get_direction() == RealValuedOperator::Direction::FORWARD;
+  }
+  for (size_t i = 0; i < iters_.size(); i++) {
+    ranges_.push_back(Range(static_cast<ParamId>(i)));
+  }
+}
+
+common::Status AsOfJoinMaterializer::refill(size_t ix) {
+  Range& range = ranges_[ix];
+  if (!range.empty() || done_[ix]) {
+    return common::Status::Ok();
+  }
+  common::Status status;
+  size_t outsize;
+  std::tie(status, outsize) = iters_[ix]->read(range.ts.data(), range.xs.data(), RANGE_SIZE);
+  if (!status.IsOk() && (status.Code() != common::Status::kNoData)) {
+    return status;
+  }
+  range.size = outsize;
+  range.pos  = 0;
+  if (outsize == 0) {
+    done_[ix] = 1;
+  }
+  return common::Status::Ok();
+}
+
+common::Status AsOfJoinMaterializer::seek(size_t ix, Timestamp ts) {
+  Range& range = ranges_[ix];
+  if (forward_) {
+    // Consume all values up to `ts`, the last consumed value is the result
+    while (true) {
+      auto status = refill(ix);
+      if (!status.IsOk()) {
+        return status;
+      }
+      if (range.empty() || range.ts[range.pos] > ts) {
+        break;
+      }
+      found_[ix]   = 1;
+      last_ts_[ix] = range.ts[range.pos];
+      last_xs_[ix] = range.xs[range.pos];
+      range.advance();
+    }
+  } else {
+    // Skip values newer than `ts`, the next value is the result but
+    // it shouldn't be consumed since it can be joined again
+    found_[ix] = 0;
+    while (true) {
+      auto status = refill(ix);
+      if (!status.IsOk()) {
+        return status;
+      }
+      if (range.empty()) {
+        break;
+      }
+      if (range.ts[range.pos] <= ts) {
+        found_[ix]   = 1;
+        last_ts_[ix] = range.ts[range.pos];
+        last_xs_[ix] = range.xs[range.pos];
+        break;
+      }
+      range.advance();
+    }
+  }
+  return common::Status::Ok();
+}
+
+std::tuple<common::Status, size_t> AsOfJoinMaterializer::read(u8 *dest, size_t size) {
+  if (iters_.empty()) {
+    return std::make_tuple(common::Status::NoData(), 0);
+  }
+  size_t pos = 0;
+  while (pos + max_ssize_ <= size) {
+    auto status = refill(0);
+    if (!status.IsOk()) {
+      return std::make_tuple(status, 0);
+    }
+    Range& driver = ranges_[0];
+    if (driver.empty()) {
+      return std::make_tuple(common::Status::NoData(), pos);
+    }
+    Timestamp ts = driver.ts[driver.pos];
+    double    xs = driver.xs[driver.pos];
+    driver.advance();
+
+    Sample* sample;
+    double* values;
+    std::tie(sample, values) = cast(dest + pos);
+
+    union {
+      double d;
+      u64    u;
+    } ctrl;
+    ctrl.u = 1;
+    values[0] = xs;
+    u32 tuple_pos = 1;
+
+    for (u32 i = 1; i < iters_.size(); i++) {
+      status = seek(i, ts);
+      if (!status.IsOk()) {
+        return std::make_tuple(status, 0);
+      }
+      if (found_[i] && (tolerance_ == 0 || ts - last_ts_[i] <= tolerance_)) {
+        ctrl.u |= 1ull << i;
+        values[tuple_pos] = last_xs_[i];
+        tuple_pos++;
+      }
+    }
+
+    auto outsize            = sizeof(Sample) + tuple_pos * sizeof(double);
+    pos                    += outsize;
+    ctrl.u                 |= static_cast<u64>(iters_.size()) << 58;
+    sample->timestamp       = ts;
+    sample->paramid         = id_;
+    sample->payload.float64 = ctrl.d;
+    sample->payload.type    = PAYLOAD_TUPLE;
+    sample->payload.size    = static_cast<u16>(outsize);
+  }
+  return std::make_tuple(common::Status::Ok(), pos);
+}
+
 }  // namespace storage
 }  // namespace stdb
@@ -52,6 +52,61 @@ class JoinMaterializer : public ColumnMaterializer {
   common::Status fill_buffer();
 };
 
+/** As-of join operator.
+ * The first series is a driver. Operator produces a tuple for every value of
+ * the driver. The tuple contains the value of the driver and the last values
+ * of the other series with timestamps at or before the timestamp of the
+ * driver value. Values that are older than `tolerance` are not joined.
+ * Input series are merged in a streaming fashion, only one read buffer per
+ * series is used.
+ * Tuple can contain up to 58 elements.
+ */
+class AsOfJoinMaterializer : public ColumnMaterializer {
+  enum {
+    RANGE_SIZE = 1024
+  };
+  typedef internal::Range<double, RANGE_SIZE> Range;
+
+  std::vector<std::unique_ptr<RealValuedOperator>> iters_;  //< scan operators (first one is a driver)
+  std::vector<Range>                               ranges_;  //< read buffers
+  std::vector<u8>                                  done_;    //< set if operator is fully consumed
+  std::vector<u8>                                  found_;   //< set if the last value is found
+  std::vector<Timestamp>                           last_ts_; //< timestamps of the last values
+  std::vector<double>                              last_xs_; //< last values
+  ParamId                                          id_;      //< id of the resulting time-series
+  Timestamp                                        tolerance_;
+  bool                                             forward_;
+  const u32                                        max_ssize_;
+
+ public:
+  /**
+   * @brief AsOfJoinMaterializer c-tor
+   * @param iters is an array of scan operators, the first one is a driver
+   * @param id is an id of the resulting series
+   * @param tolerance is a max distance between driver timestamp and the
+   *        timestamp of the joined value (0 means unlimited)
+   */
+  AsOfJoinMaterializer(std::vector<std::unique_ptr<RealValuedOperator>>&& iters,
+                       ParamId id,
+                       Timestamp tolerance);
+
+  /**
+   * @brief Read materialized value into buffer
+   * Output format is the same as in JoinMaterializer.
+   * @param dest is a pointer to recieving buffer
+   * @param size is a size of the recieving buffer
+   * @return status and output size (in bytes)
+   */
+  std::tuple<common::Status, size_t> read(u8 *dest, size_t size);
+
+ private:
+  //! Refill read buffer of the series if it's empty
+  common::Status refill(size_t ix);
+
+  //! Find last value of the series with timestamp not greater than `ts`
+  common::Status seek(size_t ix, Timestamp ts);
+};
+
 struct JoinConcatMaterializer : ColumnMaterializer {
   std::vector<std::unique_ptr<ColumnMaterializer>> iters_;
   size_t ix_;
@@ -0,0 +1,397 @@
+/*!
+ * \file kernels.cc
+ */
+#include "stdb/storage/operators/kernels.h"
+
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define STDB_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace stdb {
+namespace storage {
+
+namespace {
+
+const double INF = std::numeric_limits<double>::infinity();
+
+//! Process elements [begin, size) sequentially, `out` should be initialized
+void aggregate_tail(const double* xs, size_t begin, size_t size, KernelAggregate* out) {
+  for (size_t i = begin; i < size; i++) {
+    out->sum += xs[i];
+    if (out->min > xs[i]) {
+      out->min = xs[i];
+      out->argmin = i;
+    }
+    if (out->max < xs[i]) {
+      out->max = xs[i];
+      out->argmax = i;
+    }
+  }
+}
+
+void aggregate_scalar(const double* xs, size_t size, KernelAggregate* out) {
+  out->sum = 0;
+  out->min = INF;
+  out->max = -INF;
+  out->argmin = size;
+  out->argmax = size;
+  aggregate_tail(xs, 0, size, out);
+}
+
+//! Kind of the filter bound
+enum {
+  NO_BOUND,
+  STRICT_BOUND,
+  INCLUSIVE_BOUND,
+};
+
+//! Upper bound of the filter (kind and threshold)
+std::pair<int, double> upper_bound(ValueFilter const& filter) {
+  if (filter.mask & (1 << ValueFilter::LT)) {
+    return std::make_pair(STRICT_BOUND, filter.thresholds[ValueFilter::LT]);
+  } else if (filter.mask & (1 << ValueFilter::LE)) {
+    return std::make_pair(INCLUSIVE_BOUND, filter.thresholds[ValueFilter::LE]);
+  }
+  return std::make_pair(NO_BOUND, .0);
+}
+
+//! Lower bound of the filter (kind and threshold)
+std::pair<int, double> lower_bound(ValueFilter const& filter) {
+  if (filter.mask & (1 << ValueFilter::GT)) {
+    return std::make_pair(STRICT_BOUND, filter.thresholds[ValueFilter::GT]);
+  } else if (filter.mask & (1 << ValueFilter::GE)) {
+    return std::make_pair(INCLUSIVE_BOUND, filter.thresholds[ValueFilter::GE]);
+  }
+  return std::make_pair(NO_BOUND, .0);
+}
+
+template<int HI, int LO>
+bool match_bounds(double x, double hi, double lo) {
+  bool result = true;
+  if (HI == STRICT_BOUND) {
+    result &= x < hi;
+  } else if (HI == INCLUSIVE_BOUND) {
+    result &= x <= hi;
+  }
+  if (LO == STRICT_BOUND) {
+    result &= x > lo;
+  } else if (LO == INCLUSIVE_BOUND) {
+    result &= x >= lo;
+  }
+  return result;
+}
+
+//! Process elements [begin, size) sequentially, every element is copied and the output position is advanced on match
+template<int HI, int LO>
+size_t filter_tail(double hi, double lo, const Timestamp* ts, const double* xs, size_t begin, size_t size,
+                   Timestamp* outts, double* outxs, size_t n) {
+  for (size_t i = begin; i < size; i++) {
+    Timestamp t = ts[i];
+    double x = xs[i];
+    outts[n] = t;
+    outxs[n] = x;
+    n += match_bounds<HI, LO>(x, hi, lo);
+  }
+  return n;
+}
+
+struct FilterScalar {
+  template<int HI, int LO>
+  static size_t run(double hi, double lo, const Timestamp* ts, const double* xs, size_t size,
+                    Timestamp* outts, double* outxs) {
+    return filter_tail<HI, LO>(hi, lo, ts, xs, 0, size, outts, outxs, 0);
+  }
+};
+
+//! Instantiate the filter implementation for the bounds of the filter
+template<class Impl>
+size_t filter_dispatch(ValueFilter const& filter, const Timestamp* ts, const double* xs, size_t size,
+                       Timestamp* outts, double* outxs) {
+  auto hi = upper_bound(filter);
+  auto lo = lower_bound(filter);
+  switch (hi.first * 3 + lo.first) {
+    case NO_BOUND * 3 + NO_BOUND:
+      return Impl::template run<NO_BOUND, NO_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case NO_BOUND * 3 + STRICT_BOUND:
+      return Impl::template run<NO_BOUND, STRICT_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case NO_BOUND * 3 + INCLUSIVE_BOUND:
+      return Impl::template run<NO_BOUND, INCLUSIVE_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case STRICT_BOUND * 3 + NO_BOUND:
+      return Impl::template run<STRICT_BOUND, NO_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case STRICT_BOUND * 3 + STRICT_BOUND:
+      return Impl::template run<STRICT_BOUND, STRICT_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case STRICT_BOUND * 3 + INCLUSIVE_BOUND:
+      return Impl::template run<STRICT_BOUND, INCLUSIVE_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case INCLUSIVE_BOUND * 3 + NO_BOUND:
+      return Impl::template run<INCLUSIVE_BOUND, NO_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    case INCLUSIVE_BOUND * 3 + STRICT_BOUND:
+      return Impl::template run<INCLUSIVE_BOUND, STRICT_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+    default:
+      return Impl::template run<INCLUSIVE_BOUND, INCLUSIVE_BOUND>(hi.second, lo.second, ts, xs, size, outts, outxs);
+  };
+}
+
+size_t filter_scalar(ValueFilter const& filter, const Timestamp* ts, const double* xs, size_t size,
+                     Timestamp* outts, double* outxs) {
+  return filter_dispatch<FilterScalar>(filter, ts, xs, size, outts, outxs);
+}
+
+#ifdef STDB_KERNELS_AVX2
+__attribute__((target("avx2")))
+void aggregate_avx2(const double* xs, size_t size, KernelAggregate* out) {
+  // Every lane tracks the first minimum and maximum of its own elements,
+  // element indexes are stored as doubles (exact up to 2^53).
+  __m256d sum0 = _mm256_setzero_pd();
+  __m256d sum1 = _mm256_setzero_pd();
+  __m256d vmin = _mm256_set1_pd(INF);
+  __m256d vmax = _mm256_set1_pd(-INF);
+  __m256d minix = _mm256_set1_pd(-1.0);
+  __m256d maxix = _mm256_set1_pd(-1.0);
+  __m256d ix = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+  const __m256d four = _mm256_set1_pd(4.0);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256d a = _mm256_loadu_pd(xs + i);
+    __m256d b = _mm256_loadu_pd(xs + i + 4);
+    sum0 = _mm256_add_pd(sum0, a);
+    sum1 = _mm256_add_pd(sum1, b);
+    __m256d lt = _mm256_cmp_pd(a, vmin, _CMP_LT_OQ);
+    __m256d gt = _mm256_cmp_pd(a, vmax, _CMP_GT_OQ);
+    vmin = _mm256_blendv_pd(vmin, a, lt);
+    minix = _mm256_blendv_pd(minix, ix, lt);
+    vmax = _mm256_blendv_pd(vmax, a, gt);
+    maxix = _mm256_blendv_pd(maxix, ix, gt);
+    ix = _mm256_add_pd(ix, four);
+    lt = _mm256_cmp_pd(b, vmin, _CMP_LT_OQ);
+    gt = _mm256_cmp_pd(b, vmax, _CMP_GT_OQ);
+    vmin = _mm256_blendv_pd(vmin, b, lt);
+    minix = _mm256_blendv_pd(minix, ix, lt);
+    vmax = _mm256_blendv_pd(vmax, b, gt);
+    maxix = _mm256_blendv_pd(maxix, ix, gt);
+    ix = _mm256_add_pd(ix, four);
+  }
+  if (i + 4 <= size) {
+    __m256d a = _mm256_loadu_pd(xs + i);
+    sum0 = _mm256_add_pd(sum0, a);
+    __m256d lt = _mm256_cmp_pd(a, vmin, _CMP_LT_OQ);
+    __m256d gt = _mm256_cmp_pd(a, vmax, _CMP_GT_OQ);
+    vmin = _mm256_blendv_pd(vmin, a, lt);
+    minix = _mm256_blendv_pd(minix, ix, lt);
+    vmax = _mm256_blendv_pd(vmax, a, gt);
+    maxix = _mm256_blendv_pd(maxix, ix, gt);
+    i += 4;
+  }
+  alignas(32) double sums[4], mins[4], maxs[4], minixs[4], maxixs[4];
+  _mm256_store_pd(sums, _mm256_add_pd(sum0, sum1));
+  _mm256_store_pd(mins, vmin);
+  _mm256_store_pd(maxs, vmax);
+  _mm256_store_pd(minixs, minix);
+  _mm256_store_pd(maxixs, maxix);
+  out->sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  out->min = INF;
+  out->max = -INF;
+  out->argmin = size;
+  out->argmax = size;
+  // Lanes hold interleaved elements, ties are resolved using the index
+  for (int l = 0; l < 4; l++) {
+    if (minixs[l] >= 0) {
+      auto lix = static_cast<size_t>(minixs[l]);
+      if (mins[l] < out->min || (mins[l] == out->min && lix < out->argmin)) {
+        out->min = mins[l];
+        out->argmin = lix;
+      }
+    }
+    if (maxixs[l] >= 0) {
+      auto lix = static_cast<size_t>(maxixs[l]);
+      if (maxs[l] > out->max || (maxs[l] == out->max && lix < out->argmax)) {
+        out->max = maxs[l];
+        out->argmax = lix;
+      }
+    }
+  }
+  // Signed zeroes compare equal, report the value of the selected element
+  if (out->argmin < size) {
+    out->min = xs[out->argmin];
+  }
+  if (out->argmax < size) {
+    out->max = xs[out->argmax];
+  }
+  aggregate_tail(xs, i, size, out);
+}
+
+/** Compress-store permutations.
+ * AVX2 doesn't have compress instruction, every 4-bit selection mask is mapped
+ * to the permutation of 32-bit lanes that moves selected 64-bit elements to
+ * the beginning of the vector.
+ */
+struct CompressTable {
+  alignas(32) u32 perm[16][8];
+
+  CompressTable() {
+    for (int mask = 0; mask < 16; mask++) {
+      int n = 0;
+      for (int lane = 0; lane < 4; lane++) {
+        if (mask & (1 << lane)) {
+          perm[mask][2*n]     = static_cast<u32>(2*lane);
+          perm[mask][2*n + 1] = static_cast<u32>(2*lane + 1);
+          n++;
+        }
+      }
+      for (; n < 4; n++) {
+        perm[mask][2*n]     = 0;
+        perm[mask][2*n + 1] = 1;
+      }
+    }
+  }
+};
+
+const CompressTable compress_table;
+
+struct FilterAVX2 {
+  template<int HI, int LO>
+  __attribute__((target("avx2")))
+  static size_t run(double hi, double lo, const Timestamp* ts, const double* xs, size_t size,
+                    Timestamp* outts, double* outxs) {
+    const __m256d vhi = _mm256_set1_pd(hi);
+    const __m256d vlo = _mm256_set1_pd(lo);
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+      __m256d x = _mm256_loadu_pd(xs + i);
+      __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ts + i));
+      __m256d sel = _mm256_cmp_pd(x, x, _CMP_TRUE_UQ);
+      if (HI == STRICT_BOUND) {
+        sel = _mm256_and_pd(sel, _mm256_cmp_pd(x, vhi, _CMP_LT_OQ));
+      } else if (HI == INCLUSIVE_BOUND) {
+        sel = _mm256_and_pd(sel, _mm256_cmp_pd(x, vhi, _CMP_LE_OQ));
+      }
+      if (LO == STRICT_BOUND) {
+        sel = _mm256_and_pd(sel, _mm256_cmp_pd(x, vlo, _CMP_GT_OQ));
+      } else if (LO == INCLUSIVE_BOUND) {
+        sel = _mm256_and_pd(sel, _mm256_cmp_pd(x, vlo, _CMP_GE_OQ));
+      }
+      int mask = _mm256_movemask_pd(sel);
+      // Output position never overtakes the input position so the full
+      // vector store doesn't overwrite unprocessed input (filtering in place)
+      // and stays inside the output array.
+      __m256i perm = _mm256_load_si256(reinterpret_cast<const __m256i*>(compress_table.perm[mask]));
+      _mm256_storeu_pd(outxs + n, _mm256_castsi256_pd(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(x), perm)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(outts + n), _mm256_permutevar8x32_epi32(t, perm));
+      n += static_cast<size_t>(__builtin_popcount(mask));
+    }
+    return filter_tail<HI, LO>(hi, lo, ts, xs, i, size, outts, outxs, n);
+  }
+};
+
+size_t filter_avx2(ValueFilter const& filter, const Timestamp* ts, const double* xs, size_t size,
+                   Timestamp* outts, double* outxs) {
+  return filter_dispatch<FilterAVX2>(filter, ts, xs, size, outts, outxs);
+}
+
+bool avx2_available() {
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+/** Find first element of ts[begin, size) that belongs to the next bucket.
+ * Element belongs to the next bucket if it's not less than `limit` (forward)
+ * or not greater than `limit` (backward).
+ */
+template<bool FORWARD>
+size_t find_boundary(const Timestamp* ts, size_t begin, size_t size, Timestamp limit) {
+  auto crossed = [limit](Timestamp t) {
+    return FORWARD ? t >= limit : t <= limit;
+  };
+  // Exponential search, boundary is in (begin + lo, begin + hi]
+  size_t lo = 0;
+  size_t hi = 1;
+  while (begin + hi < size && !crossed(ts[begin + hi])) {
+    lo = hi;
+    hi *= 2;
+  }
+  if (begin + hi >= size) {
+    if (!crossed(ts[size - 1])) {
+      return size;
+    }
+    hi = size - 1 - begin;
+  }
+  // Branchless binary search, ts[base] is not crossed, ts[base + n] is crossed
+  const Timestamp* base = ts + begin + lo;
+  size_t n = hi - lo;
+  while (n > 1) {
+    size_t half = n / 2;
+    base = crossed(base[half]) ? base : base + half;
+    n -= half;
+  }
+  return static_cast<size_t>(base - ts) + 1;
+}
+
+}  // namespace
+
+aggregate_kernel_t chose_aggregate_kernel(KernelHint hint) {
+#ifdef STDB_KERNELS_AVX2
+  switch (hint) {
+    case KernelHint::FORCE_SCALAR:
+      return &aggregate_scalar;
+    case KernelHint::FORCE_AVX2:
+    case KernelHint::DETECT:
+      return avx2_available() ? &aggregate_avx2 : &aggregate_scalar;
+  };
+#endif
+  return &aggregate_scalar;
+}
+
+aggregate_kernel_t get_aggregate_kernel() {
+  static const aggregate_kernel_t kernel = chose_aggregate_kernel(KernelHint::DETECT);
+  return kernel;
+}
+
+filter_kernel_t chose_filter_kernel(KernelHint hint) {
+#ifdef STDB_KERNELS_AVX2
+  switch (hint) {
+    case KernelHint::FORCE_SCALAR:
+      return &filter_scalar;
+    case KernelHint::FORCE_AVX2:
+    case KernelHint::DETECT:
+      return avx2_available() ? &filter_avx2 : &filter_scalar;
+  };
+#endif
+  return &filter_scalar;
+}
+
+filter_kernel_t get_filter_kernel() {
+  static const filter_kernel_t kernel = chose_filter_kernel(KernelHint::DETECT);
+  return kernel;
+}
+
+size_t split_buckets(const Timestamp* ts, size_t size, Timestamp base, u64 step, bool forward, u32* bounds) {
+  size_t nbuckets = 0;
+  size_t i = 0;
+  while (i < size) {
+    size_t next = size;
+    if (forward) {
+      u64 bucket = (ts[i] - base) / step;
+      // Start of the next bucket (all remaining elements are in this bucket on overflow)
+      u64 offset = (bucket + 1) * step;
+      if (offset / step == bucket + 1 && offset <= std::numeric_limits<Timestamp>::max() - base) {
+        next = find_boundary<true>(ts, i, size, base + offset);
+      }
+    } else {
+      u64 bucket = (base - ts[i]) / step;
+      u64 offset = (bucket + 1) * step;
+      if (offset / step == bucket + 1 && offset <= base) {
+        next = find_boundary<false>(ts, i, size, base - offset);
+      }
+    }
+    bounds[nbuckets++] = static_cast<u32>(next);
+    i = next;
+  }
+  return nbuckets;
+}
+
+}  // namespace storage
+}  // namespace stdb
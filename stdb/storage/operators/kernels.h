@@ -0,0 +1,78 @@
+/*!
+ * \file kernels.h
+ *
+ * Vectorized kernels used by the leaf-level operators. Every kernel has
+ * scalar implementation and (on x86-64) AVX2 implementation, the best one
+ * is chosen at runtime.
+ */
+#ifndef STDB_STORAGE_OPERATORS_KERNELS_H_
+#define STDB_STORAGE_OPERATORS_KERNELS_H_
+
+#include <stddef.h>
+
+#include "stdb/common/basic.h"
+#include "stdb/storage/operators/operator.h"
+
+namespace stdb {
+namespace storage {
+
+enum class KernelHint {
+  DETECT,
+  FORCE_SCALAR,
+  FORCE_AVX2,
+};
+
+//! Result of the aggregate kernel
+struct KernelAggregate {
+  double sum;
+  double min;
+  double max;
+  //! Index of the first minimum (`size` if there is no value smaller than +inf)
+  size_t argmin;
+  //! Index of the first maximum (`size` if there is no value larger than -inf)
+  size_t argmax;
+};
+
+/** Aggregate kernel.
+ * Computes sum, min and max of the array. Comparisons are strict and NaNs are
+ * never selected (same as sequential `if (min > x) min = x;` loop).
+ */
+typedef void (*aggregate_kernel_t)(const double* xs, size_t size, KernelAggregate* out);
+
+//! Return aggregate kernel implementation (AVX2 is not forced if not supported)
+aggregate_kernel_t chose_aggregate_kernel(KernelHint hint = KernelHint::DETECT);
+
+//! Return best aggregate kernel (detected once)
+aggregate_kernel_t get_aggregate_kernel();
+
+/** Split sorted timestamps into step buckets.
+ * Bucket of the timestamp is `(ts - base) / step` in forward direction (`ts` is
+ * sorted in ascending order) or `(base - ts) / step` in backward direction
+ * (`ts` is sorted in descending order). Bucket boundaries are found using
+ * exponential search followed by the branchless binary search so the cost
+ * doesn't depend on the number of elements in the bucket.
+ * @param bounds receives the end offset of every bucket (should have `size` elements)
+ * @return number of buckets
+ */
+size_t split_buckets(const Timestamp* ts, size_t size, Timestamp base, u64 step, bool forward, u32* bounds);
+
+/** Filter kernel.
+ * Copies all elements that match the ValueFilter to the output arrays
+ * preserving their order and returns the number of copied elements. Filter
+ * is evaluated for a chunk of values at once, the selection mask is used to
+ * compact timestamps and values. Output arrays should have `size` elements,
+ * they can be the same as the input arrays.
+ */
+typedef size_t (*filter_kernel_t)(ValueFilter const& filter, const Timestamp* ts, const double* xs, size_t size,
+                                  Timestamp* outts, double* outxs);
+
+//! Return filter kernel implementation (AVX2 is not forced if not supported)
+filter_kernel_t chose_filter_kernel(KernelHint hint = KernelHint::DETECT);
+
+//! Return best filter kernel (detected once)
+filter_kernel_t get_filter_kernel();
+
+}  // namespace storage
+}  // namespace stdb
+
+#endif  // STDB_STORAGE_OPERATORS_KERNELS_H_
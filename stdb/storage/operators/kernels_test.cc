@@ -0,0 +1,182 @@
+/*!
+ * \file kernels_test.cc
+ */
+#include "stdb/storage/operators/kernels.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace stdb {
+namespace storage {
+
+static void expect_same(KernelAggregate const& expected, KernelAggregate const& actual, size_t size) {
+  EXPECT_NEAR(expected.sum, actual.sum, 1e-9 * size);
+  EXPECT_EQ(expected.argmin, actual.argmin);
+  EXPECT_EQ(expected.argmax, actual.argmax);
+  if (expected.argmin < size) {
+    EXPECT_EQ(expected.min, actual.min);
+  }
+  if (expected.argmax < size) {
+    EXPECT_EQ(expected.max, actual.max);
+  }
+}
+
+TEST(TestKernels, Test_aggregate_kernels_match_scalar) {
+  auto scalar = chose_aggregate_kernel(KernelHint::FORCE_SCALAR);
+  auto best = chose_aggregate_kernel(KernelHint::FORCE_AVX2);
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> dist(-20, 20);
+  for (size_t size = 0; size < 100; size++) {
+    // Small integer values to have a lot of ties
+    std::vector<double> xs(size);
+    for (auto& x: xs) {
+      x = dist(gen);
+    }
+    KernelAggregate expected, actual;
+    scalar(xs.data(), size, &expected);
+    best(xs.data(), size, &actual);
+    expect_same(expected, actual, size);
+  }
+}
+
+TEST(TestKernels, Test_aggregate_kernels_special_values) {
+  auto scalar = chose_aggregate_kernel(KernelHint::FORCE_SCALAR);
+  auto best = chose_aggregate_kernel(KernelHint::FORCE_AVX2);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> inputs = {
+    { nan, nan, nan, nan, nan, nan, nan, nan, nan },
+    { nan, 1, nan, -1, nan, 2, nan, -2, nan, 3 },
+    { 0.0, -0.0, 0.0, -0.0, 0.0, -0.0, 0.0, -0.0, 0.0 },
+    { inf, inf, inf, inf, -inf, -inf, -inf, -inf, 5 },
+    { 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7 },
+  };
+  for (auto const& xs: inputs) {
+    KernelAggregate expected, actual;
+    scalar(xs.data(), xs.size(), &expected);
+    best(xs.data(), xs.size(), &actual);
+    EXPECT_EQ(expected.argmin, actual.argmin);
+    EXPECT_EQ(expected.argmax, actual.argmax);
+    EXPECT_EQ(std::isnan(expected.sum), std::isnan(actual.sum));
+  }
+  KernelAggregate res;
+  best(inputs[1].data(), inputs[1].size(), &res);
+  EXPECT_EQ(7u, res.argmin);
+  EXPECT_EQ(9u, res.argmax);
+  best(inputs[0].data(), inputs[0].size(), &res);
+  EXPECT_EQ(9u, res.argmin);
+  EXPECT_EQ(9u, res.argmax);
+}
+
+static void check_filter(ValueFilter const& filter, std::vector<Timestamp> const& ts, std::vector<double> const& xs) {
+  std::vector<Timestamp> expts;
+  std::vector<double> expxs;
+  for (size_t i = 0; i < ts.size(); i++) {
+    if (filter.match(xs[i])) {
+      expts.push_back(ts[i]);
+      expxs.push_back(xs[i]);
+    }
+  }
+  for (auto hint: { KernelHint::FORCE_SCALAR, KernelHint::FORCE_AVX2 }) {
+    auto kernel = chose_filter_kernel(hint);
+    std::vector<Timestamp> outts(ts.size());
+    std::vector<double> outxs(xs.size());
+    auto n = kernel(filter, ts.data(), xs.data(), ts.size(), outts.data(), outxs.data());
+    outts.resize(n);
+    outxs.resize(n);
+    EXPECT_EQ(expts, outts) << filter.debug_string();
+    ASSERT_EQ(expxs.size(), outxs.size());
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_TRUE(expxs[i] == outxs[i] || (std::isnan(expxs[i]) && std::isnan(outxs[i])));
+    }
+    // In place
+    auto tsin = ts;
+    auto xsin = xs;
+    n = kernel(filter, tsin.data(), xsin.data(), tsin.size(), tsin.data(), xsin.data());
+    tsin.resize(n);
+    EXPECT_EQ(expts, tsin);
+  }
+}
+
+TEST(TestKernels, Test_filter_kernels) {
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> dist(0, 100);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<ValueFilter> filters(9);
+  filters[1].less_than(50);
+  filters[2].less_or_equal(50);
+  filters[3].greater_than(50);
+  filters[4].greater_or_equal(50);
+  filters[5].greater_than(20).less_than(80);
+  filters[6].greater_or_equal(20).less_or_equal(80);
+  filters[7].greater_than(20).less_or_equal(80);
+  filters[8].greater_or_equal(20).less_than(80);
+  for (size_t size: { 0, 1, 3, 4, 7, 64, 1000 }) {
+    std::vector<Timestamp> ts(size);
+    std::vector<double> xs(size);
+    for (size_t i = 0; i < size; i++) {
+      ts[i] = 1000 + i;
+      xs[i] = dist(gen) == 0 ? nan : dist(gen);
+    }
+    for (auto const& filter: filters) {
+      check_filter(filter, ts, xs);
+    }
+  }
+}
+
+static std::vector<u32> split_naive(std::vector<Timestamp> const& ts, Timestamp base, u64 step, bool forward) {
+  std::vector<u32> bounds;
+  for (size_t i = 1; i <= ts.size(); i++) {
+    if (i == ts.size()) {
+      bounds.push_back(static_cast<u32>(i));
+      break;
+    }
+    auto a = forward ? (ts[i - 1] - base) / step : (base - ts[i - 1]) / step;
+    auto b = forward ? (ts[i] - base) / step : (base - ts[i]) / step;
+    if (a != b) {
+      bounds.push_back(static_cast<u32>(i));
+    }
+  }
+  return bounds;
+}
+
+TEST(TestKernels, Test_split_buckets) {
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<Timestamp> delta(1, 100);
+  for (u64 step: { 1ul, 7ul, 100ul, 1000ul, 100000ul }) {
+    std::vector<Timestamp> ts;
+    Timestamp t = 1000;
+    for (int i = 0; i < 2000; i++) {
+      // Irregular series with duplicates
+      t += delta(gen) > 90 ? 0 : delta(gen);
+      ts.push_back(t);
+    }
+    std::vector<u32> bounds(ts.size());
+    auto n = split_buckets(ts.data(), ts.size(), 1000, step, true, bounds.data());
+    bounds.resize(n);
+    EXPECT_EQ(split_naive(ts, 1000, step, true), bounds);
+
+    std::vector<Timestamp> rts(ts.rbegin(), ts.rend());
+    Timestamp base = ts.back() + 3;
+    bounds.resize(rts.size());
+    n = split_buckets(rts.data(), rts.size(), base, step, false, bounds.data());
+    bounds.resize(n);
+    EXPECT_EQ(split_naive(rts, base, step, false), bounds);
+  }
+  // Next bucket boundary doesn't fit into Timestamp
+  std::vector<Timestamp> ts = { std::numeric_limits<Timestamp>::max() - 2, std::numeric_limits<Timestamp>::max() };
+  u32 bounds[2];
+  EXPECT_EQ(1u, split_buckets(ts.data(), ts.size(), 0, std::numeric_limits<Timestamp>::max() / 2 + 1, true, bounds));
+  EXPECT_EQ(2u, bounds[0]);
+  std::vector<Timestamp> rts = { 10, 2, 1 };
+  EXPECT_EQ(2u, split_buckets(rts.data(), rts.size(), 10, 9, false, bounds));
+  EXPECT_EQ(2u, bounds[0]);
+  EXPECT_EQ(3u, bounds[1]);
+}
+
+}  // namespace storage
+}  // namespace stdb
@@ -6,6 +6,8 @@
 #include <cassert>
 #include <sstream>
 
+#include "stdb/storage/operators/kernels.h"
+
 namespace stdb {
 namespace storage {
 
@@ -25,16 +27,16 @@ void AggregationResult::copy_from(SubtreeRef const& r) {
 void AggregationResult::do_the_math(Timestamp* tss, double const* xss, size_t size, bool inverted) {
   assert(size);
   cnt += size;
-  for (size_t i = 0; i < size; i++) {
-    sum += xss[i];
-    if (min > xss[i]) {
-      min = xss[i];
-      mints = tss[i];
-    }
-    if (max < xss[i]) {
-      max = xss[i];
-      maxts = tss[i];
-    }
+  KernelAggregate agg;
+  get_aggregate_kernel()(xss, size, &agg);
+  sum += agg.sum;
+  if (agg.argmin < size && min > agg.min) {
+    min = agg.min;
+    mints = tss[agg.argmin];
+  }
+  if (agg.argmax < size && max < agg.max) {
+    max = agg.max;
+    maxts = tss[agg.argmax];
   }
   if (!inverted) {
     first = xss[0];
@@ -44,6 +44,23 @@ enum class AggregationFunction {
   FIRST_TIMESTAMP,
 };
 
+//! Gap filling policy of the group-aggregate output
+enum class FillPolicy {
+  NONE,        //! Empty buckets are not reported
+  NULL_VALUE,  //! Empty bucket is reported as a tuple without values
+  PREVIOUS,    //! Empty bucket repeats the previous non-empty bucket
+  LINEAR,      //! Linear interpolation between surrounding buckets
+  CONSTANT,    //! Empty bucket is filled with the constant
+};
+
+//! Parameters of the approximate aggregate query
+struct AggregateApproximation {
+  bool enabled;
+  double error;       //! Target relative error (half-width of the confidence interval)
+  double confidence;  //! Confidence level of the interval
+  u32 budget;         //! Time budget in milliseconds (0 - no budget)
+};
+
 //! Result of the aggregation operation that has several components.
 struct AggregationResult {
   double cnt;
@@ -0,0 +1,322 @@
+/**
+ * \file sax_index.cc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdb/storage/sax_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "stdb/common/logging.h"
+
+namespace stdb {
+namespace storage {
+
+namespace {
+
+//! Inverse of the standard normal CDF (Acklam's rational approximation)
+double normal_quantile(double p) {
+  static const double a[] = {
+    -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+    1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00
+  };
+  static const double b[] = {
+    -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+    6.680131188771972e+01, -1.328068155288572e+01
+  };
+  static const double c[] = {
+    -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+    -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00
+  };
+  static const double d[] = {
+    7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+    3.754408661907416e+00
+  };
+  const double plow = 0.02425;
+  if (p < plow) {
+    double q = std::sqrt(-2 * std::log(p));
+    return (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+           ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+  }
+  if (p > 1 - plow) {
+    double q = std::sqrt(-2 * std::log(1 - p));
+    return -(((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+            ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+  }
+  double q = p - 0.5;
+  double r = q * q;
+  return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5])*q /
+         (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1);
+}
+
+struct Breakpoints {
+  //! bp[i] separates symbols i and i + 1
+  double bp[SAXIndex::ALPHABET_SIZE - 1];
+
+  Breakpoints() {
+    for (int i = 0; i < SAXIndex::ALPHABET_SIZE - 1; i++) {
+      bp[i] = normal_quantile(static_cast<double>(i + 1) / SAXIndex::ALPHABET_SIZE);
+    }
+  }
+};
+
+const Breakpoints& get_breakpoints() {
+  static Breakpoints breakpoints;
+  return breakpoints;
+}
+
+//! Get range of the segment `i` of the window of `size` elements
+std::tuple<size_t, size_t> segment(size_t i, size_t size, u32 word_length) {
+  return std::make_tuple(i * size / word_length, (i + 1) * size / word_length);
+}
+
+u32 root_key(const u8* word, u32 word_length) {
+  u32 key = 0;
+  for (u32 i = 0; i < word_length; i++) {
+    key |= static_cast<u32>(word[i] >> 7) << i;
+  }
+  return key;
+}
+
+struct MatchCmp {
+  bool operator () (SAXMatch const& lhs, SAXMatch const& rhs) const {
+    return lhs.distance < rhs.distance;
+  }
+};
+
+}  // namespace
+
+SAXIndex::SAXIndex(SAXIndexParams const& params)
+    : params_(params)
+    , size_(0) {
+  if (params_.word_length == 0 || params_.word_length > MAX_WORD_LENGTH || params_.window < params_.word_length) {
+    LOG(FATAL) << "Invalid SAX index parameters, window=" << params_.window
+               << ", word_length=" << params_.word_length;
+  }
+}
+
+SAXIndexParams const& SAXIndex::get_params() const {
+  return params_;
+}
+
+void SAXIndex::znormalize(double* xs, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  double mean = 0;
+  for (size_t i = 0; i < size; i++) {
+    mean += xs[i];
+  }
+  mean /= static_cast<double>(size);
+  double var = 0;
+  for (size_t i = 0; i < size; i++) {
+    var += (xs[i] - mean) * (xs[i] - mean);
+  }
+  double stddev = std::sqrt(var / static_cast<double>(size));
+  if (stddev < 1e-8) {
+    // Flat window
+    std::fill(xs, xs + size, 0.0);
+    return;
+  }
+  for (size_t i = 0; i < size; i++) {
+    xs[i] = (xs[i] - mean) / stddev;
+  }
+}
+
+void SAXIndex::paa(const double* xs, size_t size, double* out, u32 word_length) {
+  for (u32 i = 0; i < word_length; i++) {
+    size_t begin, end;
+    std::tie(begin, end) = segment(i, size, word_length);
+    double sum = 0;
+    for (size_t j = begin; j < end; j++) {
+      sum += xs[j];
+    }
+    out[i] = sum / static_cast<double>(end - begin);
+  }
+}
+
+void SAXIndex::to_word(const double* paa, u32 word_length, u8* out) {
+  auto const& bp = get_breakpoints().bp;
+  for (u32 i = 0; i < word_length; i++) {
+    auto it = std::upper_bound(bp, bp + ALPHABET_SIZE - 1, paa[i]);
+    out[i] = static_cast<u8>(it - bp);
+  }
+}
+
+double SAXIndex::mindist(const double* paa, const u8* word, u32 word_length, u32 window, u32 bits) {
+  auto const& bp = get_breakpoints().bp;
+  const u32 shift = 8 - bits;
+  double sum = 0;
+  for (u32 i = 0; i < word_length; i++) {
+    // Range of symbols that match the prefix
+    u32 lo = (static_cast<u32>(word[i]) >> shift) << shift;
+    u32 hi = lo + (1u << shift);
+    double d = 0;
+    if (lo > 0 && paa[i] < bp[lo - 1]) {
+      d = bp[lo - 1] - paa[i];
+    } else if (hi < ALPHABET_SIZE && paa[i] > bp[hi - 1]) {
+      d = paa[i] - bp[hi - 1];
+    }
+    size_t begin, end;
+    std::tie(begin, end) = segment(i, window, word_length);
+    sum += static_cast<double>(end - begin) * d * d;
+  }
+  return std::sqrt(sum);
+}
+
+void SAXIndex::add_window(ParamId id, Tail const& tail) {
+  std::vector<double> xs(tail.xs);
+  double paa_buf[MAX_WORD_LENGTH];
+  znormalize(xs.data(), xs.size());
+  paa(xs.data(), xs.size(), paa_buf, params_.word_length);
+  Entry entry = {};
+  entry.id = id;
+  entry.begin = tail.ts.front();
+  entry.end = tail.ts.back();
+  to_word(paa_buf, params_.word_length, entry.word);
+  roots_[root_key(entry.word, params_.word_length)].push_back(entry);
+  size_++;
+}
+
+void SAXIndex::append(ParamId id, const Timestamp* ts, const double* xs, size_t size) {
+  common::UniqueLock lock(lock_);
+  auto& tail = tails_[id];
+  for (size_t i = 0; i < size; i++) {
+    if (tail.has_last && ts[i] <= tail.last) {
+      continue;
+    }
+    tail.last = ts[i];
+    tail.has_last = true;
+    tail.ts.push_back(ts[i]);
+    tail.xs.push_back(xs[i]);
+    if (tail.xs.size() == params_.window) {
+      add_window(id, tail);
+      tail.ts.clear();
+      tail.xs.clear();
+    }
+  }
+}
+
+void SAXIndex::on_leaf_commit(ParamId id, std::vector<Timestamp> const& ts, std::vector<double> const& xs) {
+  append(id, ts.data(), xs.data(), std::min(ts.size(), xs.size()));
+}
+
+size_t SAXIndex::size() const {
+  common::SharedLock lock(lock_);
+  return size_;
+}
+
+std::tuple<common::Status, std::vector<SAXMatch>> SAXIndex::search(SAXQuery const& query, FetchFn const& fetch) const {
+  std::vector<SAXMatch> result;
+  const u32 window = params_.window;
+  const u32 wlen = params_.word_length;
+  if (query.pattern.size() != window || query.k == 0) {
+    return std::make_tuple(common::Status::BadArg(), result);
+  }
+  std::vector<double> pattern(query.pattern);
+  double qpaa[MAX_WORD_LENGTH];
+  znormalize(pattern.data(), pattern.size());
+  paa(pattern.data(), pattern.size(), qpaa, wlen);
+
+  // Order root nodes by lower bound
+  std::vector<std::pair<double, u32>> roots;
+  {
+    common::SharedLock lock(lock_);
+    for (auto const& kv: roots_) {
+      Word word;
+      for (u32 i = 0; i < wlen; i++) {
+        word[i] = static_cast<u8>(((kv.first >> i) & 1) << 7);
+      }
+      roots.push_back(std::make_pair(mindist(qpaa, word, wlen, window, 1), kv.first));
+    }
+  }
+  std::sort(roots.begin(), roots.end());
+
+  std::priority_queue<SAXMatch, std::vector<SAXMatch>, MatchCmp> top;
+  auto threshold = [&]() {
+    return top.size() < query.k ? std::numeric_limits<double>::max() : top.top().distance;
+  };
+  std::vector<std::pair<double, Entry>> candidates;
+  std::vector<double> xs;
+  for (auto const& root: roots) {
+    if (root.first >= threshold()) {
+      break;
+    }
+    candidates.clear();
+    {
+      // Lower bounds are computed under the lock, raw data is fetched without it
+      common::SharedLock lock(lock_);
+      auto it = roots_.find(root.second);
+      if (it == roots_.end()) {
+        continue;
+      }
+      double bound = threshold();
+      for (auto const& entry: it->second) {
+        if (!query.all_series && !std::binary_search(query.ids.begin(), query.ids.end(), entry.id)) {
+          continue;
+        }
+        if (entry.begin < query.begin || entry.end > query.end) {
+          continue;
+        }
+        double lb = mindist(qpaa, entry.word, wlen, window, 8);
+        if (lb < bound) {
+          candidates.push_back(std::make_pair(lb, entry));
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](std::pair<double, Entry> const& lhs, std::pair<double, Entry> const& rhs) {
+                return lhs.first < rhs.first;
+              });
+    for (auto const& cand: candidates) {
+      double bound = threshold();
+      if (cand.first >= bound) {
+        break;
+      }
+      Entry const& entry = cand.second;
+      xs.clear();
+      auto status = fetch(entry.id, entry.begin, entry.end, &xs);
+      if (!status.IsOk() || xs.size() != window) {
+        // Data was removed or can't be read
+        continue;
+      }
+      znormalize(xs.data(), xs.size());
+      double bound2 = bound == std::numeric_limits<double>::max() ? bound : bound * bound;
+      double sum = 0;
+      for (u32 i = 0; i < window && sum < bound2; i++) {
+        double d = xs[i] - pattern[i];
+        sum += d * d;
+      }
+      if (sum >= bound2) {
+        continue;
+      }
+      SAXMatch match = { entry.id, entry.begin, entry.end, std::sqrt(sum) };
+      top.push(match);
+      if (top.size() > query.k) {
+        top.pop();
+      }
+    }
+  }
+  while (!top.empty()) {
+    result.push_back(top.top());
+    top.pop();
+  }
+  std::reverse(result.begin(), result.end());
+  return std::make_tuple(common::Status::Ok(), result);
+}
+
+}  // namespace storage
+}  // namespace stdb
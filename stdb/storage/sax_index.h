@@ -0,0 +1,161 @@
+/**
+ * \file sax_index.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Similarity search index (iSAX).
+ * Every series is split into non-overlapping windows of fixed number of
+ * points. Each window is z-normalized and converted to SAX word (PAA of the
+ * window quantized using N(0, 1) breakpoints, 256 symbols per segment).
+ * Words are grouped by the 1-bit per segment prefix (iSAX root nodes).
+ * Search visits root nodes in the order of their lower bound distance to
+ * the query, computes lower bound for each word and verifies exact
+ * distance only if lower bound is smaller than the current k-th best
+ * distance.
+ */
+#ifndef STDB_STORAGE_SAX_INDEX_H_
+#define STDB_STORAGE_SAX_INDEX_H_
+
+#include <functional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "stdb/common/basic.h"
+#include "stdb/common/rwlock.h"
+#include "stdb/common/status.h"
+#include "stdb/storage/nbtree.h"
+
+namespace stdb {
+namespace storage {
+
+struct SAXIndexParams {
+  //! Number of points in the window
+  u32 window;
+  //! Number of segments in SAX word (can't be larger than 16)
+  u32 word_length;
+};
+
+struct SAXMatch {
+  ParamId   id;
+  //! Timestamp of the first point of the window
+  Timestamp begin;
+  //! Timestamp of the last point of the window
+  Timestamp end;
+  //! Euclidean distance between z-normalized pattern and window
+  double    distance;
+};
+
+struct SAXQuery {
+  //! Pattern (should contain exactly `window` values)
+  std::vector<double> pattern;
+  //! Number of matches to return
+  size_t k;
+  //! Search every indexed series, `ids` is ignored
+  bool all_series;
+  //! Series to search, should be sorted
+  std::vector<ParamId> ids;
+  //! Only windows inside [begin, end] are returned
+  Timestamp begin;
+  Timestamp end;
+};
+
+class SAXIndex : public NBTreeLeafListener {
+ public:
+  enum {
+    MAX_WORD_LENGTH = 16,
+    ALPHABET_SIZE = 256,
+  };
+
+  typedef u8 Word[MAX_WORD_LENGTH];
+
+  /** Read window of the series.
+   * Should return `window` values in [begin, end] range.
+   */
+  typedef std::function<common::Status(ParamId, Timestamp, Timestamp, std::vector<double>*)> FetchFn;
+
+ private:
+  struct Entry {
+    ParamId   id;
+    Timestamp begin;
+    Timestamp end;
+    Word      word;
+  };
+
+  //! Incomplete window of the series
+  struct Tail {
+    std::vector<Timestamp> ts;
+    std::vector<double>    xs;
+    Timestamp              last;
+    bool                   has_last;
+  };
+
+  const SAXIndexParams params_;
+  //! iSAX root nodes (key is 1-bit per segment word)
+  std::unordered_map<u32, std::vector<Entry>> roots_;
+  std::unordered_map<ParamId, Tail> tails_;
+  size_t size_;
+  mutable common::RWLock lock_;
+
+  //! Convert complete window to word and add it to index (lock should be held)
+  void add_window(ParamId id, Tail const& tail);
+
+ public:
+  explicit SAXIndex(SAXIndexParams const& params);
+
+  SAXIndexParams const& get_params() const;
+
+  /** Add values to the index.
+   * Values should be ordered by timestamp. Values that are not newer than
+   * previously added values of the same series are ignored, so the same data
+   * can be added twice (e.g. during backfill).
+   */
+  void append(ParamId id, const Timestamp* ts, const double* xs, size_t size);
+
+  //! NBTreeLeafListener interface
+  virtual void on_leaf_commit(ParamId id,
+                              std::vector<Timestamp> const& ts,
+                              std::vector<double> const& xs) override;
+
+  /** Find top-k windows closest to the pattern.
+   * @param query is a query
+   * @param fetch is used to read raw values of the candidate windows
+   * @return status and matches ordered by distance
+   */
+  std::tuple<common::Status, std::vector<SAXMatch>> search(SAXQuery const& query, FetchFn const& fetch) const;
+
+  //! Get number of indexed windows
+  size_t size() const;
+
+  // Utility functions
+
+  //! Z-normalize values inplace
+  static void znormalize(double* xs, size_t size);
+
+  //! Compute PAA of the z-normalized values
+  static void paa(const double* xs, size_t size, double* out, u32 word_length);
+
+  //! Convert PAA to SAX word
+  static void to_word(const double* paa, u32 word_length, u8* out);
+
+  /** Lower bound of the distance between z-normalized values with PAA `paa`
+   * and any window with SAX word `word`.
+   * @param bits is a number of significant bits of each symbol
+   */
+  static double mindist(const double* paa, const u8* word, u32 word_length, u32 window, u32 bits);
+};
+
+}  // namespace storage
+}  // namespace stdb
+
+#endif  // STDB_STORAGE_SAX_INDEX_H_
@@ -0,0 +1,186 @@
+/*!
+ * \file sax_index_test.cc
+ */
+#include "stdb/storage/sax_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stdb/common/logging.h"
+
+namespace stdb {
+namespace storage {
+
+typedef std::map<ParamId, std::vector<std::pair<Timestamp, double>>> SeriesMap;
+
+static SeriesMap generate_random_walks(size_t nseries, size_t npoints, u32 seed) {
+  std::mt19937 gen(seed);
+  std::normal_distribution<double> dist(0.0, 1.0);
+  SeriesMap series;
+  for (ParamId id = 1; id <= nseries; id++) {
+    double x = 0;
+    for (Timestamp ts = 0; ts < npoints; ts++) {
+      x += dist(gen);
+      series[id].push_back(std::make_pair(ts * 10, x));
+    }
+  }
+  return series;
+}
+
+static SAXIndex::FetchFn make_fetch(SeriesMap const& series, size_t* nfetch) {
+  return [&series, nfetch](ParamId id, Timestamp begin, Timestamp end, std::vector<double>* out) {
+    (*nfetch)++;
+    auto it = series.find(id);
+    if (it == series.end()) {
+      return common::Status::NotFound();
+    }
+    for (auto const& kv: it->second) {
+      if (kv.first >= begin && kv.first <= end) {
+        out->push_back(kv.second);
+      }
+    }
+    return common::Status::Ok();
+  };
+}
+
+static double znorm_distance(std::vector<double> a, std::vector<double> b) {
+  SAXIndex::znormalize(a.data(), a.size());
+  SAXIndex::znormalize(b.data(), b.size());
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    sum += (a[i] - b[i]) * (a[i] - b[i]);
+  }
+  return std::sqrt(sum);
+}
+
+TEST(TestSAXIndex, Test_mindist_is_lower_bound) {
+  const u32 window = 64;
+  const u32 wlen = 8;
+  std::mt19937 gen(42);
+  std::normal_distribution<double> dist(0.0, 1.0);
+  for (int i = 0; i < 1000; i++) {
+    std::vector<double> a(window), b(window);
+    double x = 0, y = 0;
+    for (u32 j = 0; j < window; j++) {
+      x += dist(gen);
+      y += dist(gen);
+      a[j] = x;
+      b[j] = y;
+    }
+    double exact = znorm_distance(a, b);
+    SAXIndex::znormalize(a.data(), a.size());
+    SAXIndex::znormalize(b.data(), b.size());
+    double apaa[wlen], bpaa[wlen];
+    SAXIndex::paa(a.data(), window, apaa, wlen);
+    SAXIndex::paa(b.data(), window, bpaa, wlen);
+    u8 word[wlen];
+    SAXIndex::to_word(bpaa, wlen, word);
+    for (u32 bits = 1; bits <= 8; bits++) {
+      EXPECT_LE(SAXIndex::mindist(apaa, word, wlen, window, bits), exact + 1e-9);
+    }
+  }
+}
+
+TEST(TestSAXIndex, Test_append_ignores_old_values) {
+  SAXIndexParams params = { 16, 4 };
+  SAXIndex index(params);
+  std::vector<Timestamp> ts;
+  std::vector<double> xs;
+  for (Timestamp i = 0; i < 100; i++) {
+    ts.push_back(i);
+    xs.push_back(std::sin(i * 0.1));
+  }
+  index.append(1, ts.data(), xs.data(), 50);
+  EXPECT_EQ(3u, index.size());
+  // Overlapping range, first 50 values are already indexed
+  index.append(1, ts.data(), xs.data(), ts.size());
+  EXPECT_EQ(6u, index.size());
+}
+
+TEST(TestSAXIndex, Test_search_matches_brute_force) {
+  const u32 window = 32;
+  SAXIndexParams params = { window, 8 };
+  SAXIndex index(params);
+  auto series = generate_random_walks(20, 2000, 1);
+  for (auto const& kv: series) {
+    std::vector<Timestamp> ts;
+    std::vector<double> xs;
+    for (auto const& p: kv.second) {
+      ts.push_back(p.first);
+      xs.push_back(p.second);
+    }
+    index.append(kv.first, ts.data(), xs.data(), ts.size());
+  }
+  EXPECT_EQ(20u * (2000 / window), index.size());
+
+  // Brute force distances of all windows
+  auto pattern_src = series[7];
+  std::vector<double> pattern;
+  for (u32 i = 0; i < window; i++) {
+    pattern.push_back(pattern_src.at(window * 11 + i).second + 0.01 * i);
+  }
+  std::vector<std::pair<double, std::pair<ParamId, Timestamp>>> expected;
+  for (auto const& kv: series) {
+    for (size_t i = 0; i + window <= kv.second.size(); i += window) {
+      std::vector<double> xs;
+      for (u32 j = 0; j < window; j++) {
+        xs.push_back(kv.second.at(i + j).second);
+      }
+      expected.push_back(std::make_pair(znorm_distance(pattern, xs),
+                                        std::make_pair(kv.first, kv.second.at(i).first)));
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+
+  SAXQuery query = {};
+  query.pattern = pattern;
+  query.k = 5;
+  query.all_series = true;
+  query.begin = 0;
+  query.end = std::numeric_limits<Timestamp>::max();
+  size_t nfetch = 0;
+  common::Status status;
+  std::vector<SAXMatch> result;
+  std::tie(status, result) = index.search(query, make_fetch(series, &nfetch));
+  ASSERT_TRUE(status.IsOk());
+  ASSERT_EQ(5u, result.size());
+  for (size_t i = 0; i < result.size(); i++) {
+    EXPECT_NEAR(expected[i].first, result[i].distance, 1e-9);
+    EXPECT_EQ(expected[i].second.first, result[i].id);
+    EXPECT_EQ(expected[i].second.second, result[i].begin);
+  }
+  // Best match is the window the pattern was taken from
+  EXPECT_EQ(7u, result[0].id);
+  EXPECT_EQ(static_cast<Timestamp>(window * 11 * 10), result[0].begin);
+  // Lower bound should prune most of the windows
+  EXPECT_LT(nfetch, expected.size() / 2);
+
+  // Restrict search to one series
+  query.all_series = false;
+  query.ids = { 3 };
+  std::tie(status, result) = index.search(query, make_fetch(series, &nfetch));
+  ASSERT_TRUE(status.IsOk());
+  ASSERT_EQ(5u, result.size());
+  for (auto const& match: result) {
+    EXPECT_EQ(3u, match.id);
+  }
+
+  // Empty series list doesn't match anything
+  query.ids.clear();
+  std::tie(status, result) = index.search(query, make_fetch(series, &nfetch));
+  ASSERT_TRUE(status.IsOk());
+  EXPECT_TRUE(result.empty());
+
+  // Pattern of the wrong size
+  query.pattern.pop_back();
+  std::tie(status, result) = index.search(query, make_fetch(series, &nfetch));
+  EXPECT_EQ(common::Status::BadArg(), status);
+}
+
+}  // namespace storage
+}  // namespace stdb
@@ -0,0 +1,167 @@
+/*!
+ * \file stdb_export.cc
+ */
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "stdb/common/logging.h"
+#include "stdb/core/controller.h"
+#include "stdb/core/cursor.h"
+#include "stdb/core/query_results_formatter.h"
+
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+static const char* CLI_HELP_MESSAGE = R"(stdb_export - export query results to Arrow IPC stream or Parquet file
+
+SYNOPSIS
+        stdb_export --db <name> --query <json> --output <path> [options]
+
+DESCRIPTION
+        Runs select or group-aggregate query against the local database and
+        writes results in columnar format. Output options from the `output`
+        field of the query are used unless overridden by the command line.
+        Rows are written in batches so memory use doesn't depend on the
+        result size. Output is not complete (and the file is removed) if the
+        query fails.
+)";
+
+enum {
+  WRITE_BUFFER_SIZE = 0x100000,
+};
+
+int main(int argc, char** argv) {
+  po::options_description options_desc("Options");
+  options_desc.add_options()
+      ( "help", "Produce help message" )
+      ( "db", po::value<std::string>(), "Database name" )
+      ( "query", po::value<std::string>(), "Query text (JSON)" )
+      ( "query-file", po::value<std::string>(), "Read query from file" )
+      ( "format", po::value<std::string>(), "Output format: arrow, parquet, csv or resp (default: arrow)" )
+      ( "output", po::value<std::string>()->default_value("-"), "Output file path, `-` for stdout" )
+      ( "batch-size", po::value<uint32_t>(), "Rows per record batch or row group" )
+      ( "location", "Add lon/lat columns" )
+      ;
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options_desc), vm);
+    po::notify(vm);
+  } catch (po::error const& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help") || !vm.count("db") || (vm.count("query") == vm.count("query-file"))) {
+    std::cout << CLI_HELP_MESSAGE << std::endl << options_desc << std::endl;
+    return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  std::string query;
+  if (vm.count("query")) {
+    query = vm["query"].as<std::string>();
+  } else {
+    std::ifstream input(vm["query-file"].as<std::string>());
+    if (!input) {
+      std::cerr << "Can't read query file " << vm["query-file"].as<std::string>() << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::stringstream text;
+    text << input.rdbuf();
+    query = text.str();
+  }
+
+  stdb::OutputOptions options;
+  options.format = stdb::OutputFormat::ARROW;
+  stdb::common::Status status;
+  std::string error;
+  std::tie(status, error) = stdb::parse_output_options(query.c_str(), &options);
+  if (!status.IsOk()) {
+    std::cerr << "Invalid query: " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (vm.count("format")) {
+    auto format = vm["format"].as<std::string>();
+    if (format == "arrow") {
+      options.format = stdb::OutputFormat::ARROW;
+    } else if (format == "parquet") {
+      options.format = stdb::OutputFormat::PARQUET;
+    } else if (format == "csv") {
+      options.format = stdb::OutputFormat::CSV;
+    } else if (format == "resp") {
+      options.format = stdb::OutputFormat::RESP;
+    } else {
+      std::cerr << "Unknown format " << format << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (vm.count("batch-size")) {
+    options.batch_size = std::max(vm["batch-size"].as<uint32_t>(), 1u);
+  }
+  if (vm.count("location")) {
+    options.location = true;
+  }
+
+  stdb::initialize();
+  auto controller = stdb::Controller::Get();
+  controller->init((stdb::common::GetHomeDir() + "/.stdbrc").c_str());
+  auto database = controller->open_standalone_database(vm["db"].as<std::string>().c_str());
+  if (!database) {
+    std::cerr << "Database " << vm["db"].as<std::string>() << " not found" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto path = vm["output"].as<std::string>();
+  FILE* output = path == "-" ? stdout : fopen(path.c_str(), "wb");
+  if (output == nullptr) {
+    std::cerr << "Can't open " << path << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int retcode = EXIT_SUCCESS;
+  {
+    auto session = database->create_session();
+    auto cursor = stdb::ConcurrentCursor::make(&stdb::DatabaseSession::query, session.get(), query.c_str());
+    stdb::QueryResultsFormatter formatter(cursor.get(), session.get(), options);
+    std::vector<char> buffer(WRITE_BUFFER_SIZE);
+    uint64_t nbytes = 0;
+    while (true) {
+      auto size = formatter.read_some(buffer.data(), buffer.size());
+      if (size == 0) {
+        break;
+      }
+      if (fwrite(buffer.data(), 1, size, output) != size) {
+        std::cerr << "Can't write to " << path << std::endl;
+        retcode = EXIT_FAILURE;
+        break;
+      }
+      nbytes += size;
+    }
+    const char* message = nullptr;
+    if (cursor->is_error(&message, &status)) {
+      std::cerr << "Query failed: " << (message != nullptr && message[0] != '\0' ? message : status.ToString())
+                << std::endl;
+      retcode = EXIT_FAILURE;
+    }
+    cursor->close();
+    LOG(INFO) << "Exported " << formatter.get_names().size() << " series, " << nbytes << " bytes";
+  }
+
+  if (output != stdout) {
+    fclose(output);
+    if (retcode != EXIT_SUCCESS) {
+      remove(path.c_str());
+    }
+  } else {
+    fflush(output);
+  }
+  controller->close();
+  return retcode;
+}